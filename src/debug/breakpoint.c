@@ -41,6 +41,7 @@
 #include "../device/drvcpu.h"
 #include "../fault.h"
 #include "../main.h"
+#include "../physmem.h"
 #include "../utils.h"
 #include "breakpoint.h"
 #include "gdb.h"
@@ -94,6 +95,7 @@ void physmem_breakpoint_add(ptr36_t address, len36_t length,
     physmem_breakpoint_t *breakpoint = physmem_breakpoint_init(address, length, kind, access_flags);
 
     list_append(&physmem_breakpoints, &breakpoint->item);
+    physmem_update_breakpoints();
 }
 
 /** Deactivate memory breakpoint with specified address
@@ -111,6 +113,7 @@ bool physmem_breakpoint_remove(ptr36_t address)
         if (breakpoint->addr == address) {
             list_remove(&physmem_breakpoints, &breakpoint->item);
             safe_free(breakpoint);
+            physmem_update_breakpoints();
 
             return true;
         }
@@ -142,6 +145,8 @@ void physmem_breakpoint_remove_filtered(breakpoint_filter_t filter)
         list_remove(&physmem_breakpoints, &removed->item);
         safe_free(removed);
     }
+
+    physmem_update_breakpoints();
 }
 
 /** Print activated memory breakpoints for the user */
@@ -337,3 +342,31 @@ bool breakpoint_check_for_code_breakpoints(void)
 
     return hit;
 }
+
+/** Check whether any processor has a code breakpoint
+ *
+ * @return True, if at least one code breakpoint is set.
+ *
+ */
+bool breakpoint_code_breakpoints_armed(void)
+{
+    device_t *dev = NULL;
+
+    while (dev_next(&dev, DEVICE_FILTER_R4K_PROCESSOR)) {
+        r4k_cpu_t *cpu = get_r4k(dev);
+
+        if (!is_empty(&cpu->bps)) {
+            return true;
+        }
+    }
+
+    while (dev_next(&dev, DEVICE_FILTER_RV_PROCESSOR)) {
+        const rv_cpu_t *cpu = get_rv(dev);
+
+        if (!is_empty(&cpu->bps)) {
+            return true;
+        }
+    }
+
+    return false;
+}
@@ -51,7 +51,7 @@ typedef struct {
 } breakpoint_t;
 
 /** Structure for the memory breakpoints */
-typedef struct {
+typedef struct physmem_breakpoint {
     item_t item;
 
     breakpoint_kind_t kind;
@@ -80,5 +80,6 @@ extern breakpoint_t *breakpoint_init(ptr64_t address, breakpoint_kind_t kind);
 extern breakpoint_t *breakpoint_find_by_address(list_t breakpoints,
         ptr64_t address, breakpoint_filter_t filter);
 extern bool breakpoint_check_for_code_breakpoints(void);
+extern bool breakpoint_code_breakpoints_armed(void);
 
 #endif
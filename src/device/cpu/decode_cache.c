@@ -0,0 +1,593 @@
+/*
+ * Copyright (c) 2026 Matus Jurcak
+ * All rights reserved.
+ *
+ * Distributed under the terms of GPL.
+ *
+ *
+ *  Cache of decoded instruction pages
+ *
+ *  The pages of all processor models share a common memory budget
+ *  (see the decodecache variable). A page is found through a hash
+ *  table, the pages to evict are chosen by the clock algorithm.
+ *
+ */
+
+#include <errno.h>
+#include <inttypes.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "../../assert.h"
+#include "../../fault.h"
+#include "../../physmem.h"
+#include "../../smp.h"
+#include "../../utils.h"
+#include "decode_cache.h"
+
+#define DECODE_CACHE_MIN_BUCKETS 64
+
+/** Maximal length of a line of a decoded page profile */
+#define DECODE_PROFILE_LINE 256
+
+/** Maximal number of threads decoding the pages of a profile */
+#define DECODE_PROFILE_THREADS 16
+
+/** List of all caches with pages */
+static decode_cache_t *caches = NULL;
+
+/** Memory used by the pages of all caches */
+static size_t decode_cache_bytes = 0;
+
+static size_t page_size(const decode_cache_t *cache)
+{
+    return sizeof(decode_page_t) + cache->data_size;
+}
+
+static size_t bucket_index(const decode_cache_t *cache, ptr36_t addr)
+{
+    return ADDR2FRAME(addr) & (cache->buckets_count - 1);
+}
+
+/** Rebuild the hash table with the given number of buckets
+ *
+ */
+static void rehash(decode_cache_t *cache, size_t buckets_count)
+{
+    safe_free(cache->buckets);
+
+    cache->buckets = (decode_page_t **) safe_malloc(buckets_count * sizeof(decode_page_t *));
+    cache->buckets_count = buckets_count;
+    memset(cache->buckets, 0, buckets_count * sizeof(decode_page_t *));
+
+    for (size_t i = 0; i < cache->ring_count; i++) {
+        decode_page_t *page = cache->ring[i];
+        size_t index = bucket_index(cache, page->addr);
+
+        page->next = cache->buckets[index];
+        cache->buckets[index] = page;
+    }
+}
+
+/** Register a cache in the list of all caches
+ *
+ * The processors register the cache of their model on initialization,
+ * so that a profile can be loaded before any page is decoded.
+ *
+ */
+void decode_cache_register(decode_cache_t *cache)
+{
+    if (!cache->registered) {
+        cache->next_cache = caches;
+        caches = cache;
+        cache->registered = true;
+    }
+}
+
+static decode_page_t *lookup(decode_cache_t *cache, ptr36_t addr)
+{
+    if (cache->buckets_count == 0) {
+        return NULL;
+    }
+
+    ptr36_t page_addr = ALIGN_DOWN(addr, FRAME_SIZE);
+    decode_page_t *page = cache->buckets[bucket_index(cache, page_addr)];
+
+    while (page != NULL) {
+        if (page->addr == page_addr) {
+            return page;
+        }
+
+        page = page->next;
+    }
+
+    return NULL;
+}
+
+/** Find a decoded page
+ *
+ * @param cache Decoded page cache.
+ * @param addr  Physical address within the page.
+ *
+ * @return The page or NULL if the page is not cached.
+ *
+ */
+decode_page_t *decode_cache_find(decode_cache_t *cache, ptr36_t addr)
+{
+    decode_page_t *page = lookup(cache, addr);
+
+    if (page != NULL) {
+        page->referenced = true;
+        decode_page_looked_up(page);
+    }
+
+    return page;
+}
+
+/** Remove a page from the cache
+ *
+ * The page memory is released only after the processors stop
+ * running in parallel, as the other processors may still execute
+ * from the page.
+ *
+ */
+static void evict(decode_cache_t *cache, decode_page_t *page)
+{
+    decode_page_t **link = &cache->buckets[bucket_index(cache, page->addr)];
+
+    while (*link != page) {
+        link = &(*link)->next;
+    }
+
+    *link = page->next;
+
+    cache->ring_count--;
+    cache->ring[page->slot] = cache->ring[cache->ring_count];
+    cache->ring[page->slot]->slot = page->slot;
+
+    cache->epoch++;
+    decode_cache_bytes -= page_size(cache);
+
+    page->addr = DECODE_PAGE_INVALID;
+
+    if (smp_active) {
+        page->next = cache->retired;
+        cache->retired = page;
+    } else {
+        safe_free(page);
+    }
+}
+
+/** Evict a page chosen by the clock algorithm
+ *
+ */
+static void evict_one(decode_cache_t *cache)
+{
+    ASSERT(cache->ring_count > 0);
+
+    while (true) {
+        if (cache->hand >= cache->ring_count) {
+            cache->hand = 0;
+        }
+
+        decode_page_t *page = cache->ring[cache->hand];
+
+        if (!page->referenced) {
+            evict(cache, page);
+            return;
+        }
+
+        page->referenced = false;
+        cache->hand++;
+    }
+}
+
+/** Insert a page without decoding its instructions
+ *
+ * The write generations of the frame are recorded,
+ * the instructions have to be decoded afterwards.
+ *
+ */
+static decode_page_t *insert(decode_cache_t *cache, frame_t *frame, ptr36_t addr)
+{
+    decode_cache_register(cache);
+
+    if (cache->ring_count == cache->ring_size) {
+        size_t ring_size = (cache->ring_size == 0) ? DECODE_CACHE_MIN_BUCKETS : 2 * cache->ring_size;
+        decode_page_t **ring = (decode_page_t **) safe_malloc(ring_size * sizeof(decode_page_t *));
+
+        if (cache->ring_count > 0) {
+            memcpy(ring, cache->ring, cache->ring_count * sizeof(decode_page_t *));
+        }
+
+        safe_free(cache->ring);
+        cache->ring = ring;
+        cache->ring_size = ring_size;
+    }
+
+    decode_page_t *page = (decode_page_t *) safe_malloc(page_size(cache));
+
+    page->addr = ALIGN_DOWN(addr, FRAME_SIZE);
+    page->referenced = true;
+    page->slot = cache->ring_count;
+    page->frame = frame;
+    page->lookups = 0;
+
+    for (size_t line = 0; line < FRAME_LINES; line++) {
+        page->generations[line] = physmem_line_generation(frame, page->addr + line * FRAME_LINE_SIZE);
+    }
+
+    cache->ring[cache->ring_count++] = page;
+    decode_cache_bytes += page_size(cache);
+
+    if (cache->ring_count > cache->buckets_count) {
+        size_t buckets_count = (cache->buckets_count == 0) ? DECODE_CACHE_MIN_BUCKETS : 2 * cache->buckets_count;
+        rehash(cache, buckets_count);
+    } else {
+        size_t index = bucket_index(cache, page->addr);
+
+        page->next = cache->buckets[index];
+        cache->buckets[index] = page;
+    }
+
+    return page;
+}
+
+/** Add a page to the cache
+ *
+ * Evicts pages of the cache to keep the memory budget
+ * and decodes the instructions of the page.
+ *
+ * @param cache Decoded page cache.
+ * @param frame Frame containing the address.
+ * @param addr  Physical address within the page.
+ *
+ * @return The new page.
+ *
+ */
+decode_page_t *decode_cache_add(decode_cache_t *cache, frame_t *frame, ptr36_t addr)
+{
+    size_t limit = ((size_t) machine_decode_cache_limit) << 20;
+
+    while ((limit != 0) && (cache->ring_count > 0)
+            && (decode_cache_bytes + page_size(cache) > limit)) {
+        evict_one(cache);
+    }
+
+    decode_page_t *page = insert(cache, frame, addr);
+    page->lookups = 1;
+    cache->fill(page, page->addr, FRAME_SIZE);
+
+    return page;
+}
+
+static void release_retired(decode_cache_t *cache)
+{
+    while (cache->retired != NULL) {
+        decode_page_t *page = cache->retired;
+        cache->retired = page->next;
+        safe_free(page);
+    }
+}
+
+/** Remove all pages from the cache
+ *
+ */
+void decode_cache_done(decode_cache_t *cache)
+{
+    for (size_t i = 0; i < cache->ring_count; i++) {
+        safe_free(cache->ring[i]);
+    }
+
+    decode_cache_bytes -= cache->ring_count * page_size(cache);
+
+    safe_free(cache->ring);
+    safe_free(cache->buckets);
+    release_retired(cache);
+
+    cache->ring_count = 0;
+    cache->ring_size = 0;
+    cache->buckets_count = 0;
+    cache->hand = 0;
+    cache->epoch++;
+}
+
+/** Release the pages evicted while the processors ran in parallel
+ *
+ * To be called once the processors do not run in parallel.
+ *
+ */
+void decode_cache_collect(void)
+{
+    ASSERT(!smp_active);
+
+    for (decode_cache_t *cache = caches; cache != NULL; cache = cache->next_cache) {
+        release_retired(cache);
+    }
+}
+
+/** Remove all pages from all caches
+ *
+ * To be called when physical memory frames are removed,
+ * as the pages refer to the frames.
+ *
+ */
+void decode_cache_flush(void)
+{
+    ASSERT(!smp_active);
+
+    for (decode_cache_t *cache = caches; cache != NULL; cache = cache->next_cache) {
+        while (cache->ring_count > 0) {
+            evict(cache, cache->ring[0]);
+        }
+
+        cache->hand = 0;
+    }
+}
+
+/** Page of a profile to be decoded */
+typedef struct {
+    decode_cache_t *cache;
+    decode_page_t *page;
+} profile_entry_t;
+
+static int profile_entry_compare(const void *a, const void *b)
+{
+    const profile_entry_t *entry_a = (const profile_entry_t *) a;
+    const profile_entry_t *entry_b = (const profile_entry_t *) b;
+
+    /* The hottest pages first */
+    if (entry_a->page->lookups != entry_b->page->lookups) {
+        return (entry_a->page->lookups > entry_b->page->lookups) ? -1 : 1;
+    }
+
+    if (entry_a->page->addr != entry_b->page->addr) {
+        return (entry_a->page->addr < entry_b->page->addr) ? -1 : 1;
+    }
+
+    return strcmp(entry_a->cache->name, entry_b->cache->name);
+}
+
+/** Pages of the loaded profile decoded by the threads */
+static profile_entry_t *prefill_entries = NULL;
+static size_t prefill_count = 0;
+static atomic_size_t prefill_next;
+
+static void *prefill_worker(void *arg)
+{
+    while (true) {
+        size_t index = atomic_fetch_add(&prefill_next, 1);
+        if (index >= prefill_count) {
+            break;
+        }
+
+        profile_entry_t *entry = &prefill_entries[index];
+        if (entry->page != NULL) {
+            entry->cache->fill_ahead(entry->page, entry->page->addr, FRAME_SIZE);
+        }
+    }
+
+    return NULL;
+}
+
+/** Decode the pages of the loaded profile in parallel
+ *
+ * The pages are decoded completely, so that their instructions
+ * are not decoded again on their first execution.
+ * The first page of each cache is decoded by the calling thread,
+ * so that the decoders initialize their tables (if any) before
+ * running in parallel.
+ *
+ */
+static void prefill(profile_entry_t *entries, size_t count)
+{
+    for (decode_cache_t *cache = caches; cache != NULL; cache = cache->next_cache) {
+        for (size_t i = 0; i < count; i++) {
+            if (entries[i].cache == cache) {
+                cache->fill_ahead(entries[i].page, entries[i].page->addr, FRAME_SIZE);
+                entries[i].page = NULL;
+                break;
+            }
+        }
+    }
+
+    size_t threads_count = DECODE_PROFILE_THREADS;
+
+#ifdef _SC_NPROCESSORS_ONLN
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    if ((cpus > 0) && ((size_t) cpus < threads_count)) {
+        threads_count = cpus;
+    }
+#endif
+
+    if (threads_count > count) {
+        threads_count = count;
+    }
+
+    prefill_entries = entries;
+    prefill_count = count;
+    atomic_store(&prefill_next, 0);
+
+    /* The calling thread decodes as well */
+    pthread_t threads[DECODE_PROFILE_THREADS];
+    size_t started = 0;
+
+    while (started + 1 < threads_count) {
+        if (pthread_create(&threads[started], NULL, prefill_worker, NULL) != 0) {
+            break;
+        }
+
+        started++;
+    }
+
+    prefill_worker(NULL);
+
+    for (size_t i = 0; i < started; i++) {
+        pthread_join(threads[i], NULL);
+    }
+
+    prefill_entries = NULL;
+    prefill_count = 0;
+}
+
+static decode_cache_t *find_cache(const char *name)
+{
+    for (decode_cache_t *cache = caches; cache != NULL; cache = cache->next_cache) {
+        if (strcmp(cache->name, name) == 0) {
+            return cache;
+        }
+    }
+
+    return NULL;
+}
+
+/** Decode the pages listed in a profile
+ *
+ * The pages of the processor models present in the machine are decoded
+ * (in parallel host threads) before the simulation starts, the hottest
+ * pages first as long as they fit the memory limit of the caches.
+ * A missing profile is not an error, as it is created at exit
+ * (see decode_cache_profile_save()).
+ *
+ * @param path Name of the profile file.
+ *
+ */
+void decode_cache_profile_load(const char *path)
+{
+    ASSERT(!smp_active);
+
+    FILE *file = fopen(path, "r");
+    if (file == NULL) {
+        if (errno != ENOENT) {
+            io_error(path);
+        }
+
+        return;
+    }
+
+    size_t limit = ((size_t) machine_decode_cache_limit) << 20;
+
+    profile_entry_t *entries = NULL;
+    size_t entries_count = 0;
+    size_t entries_size = 0;
+
+    char line[DECODE_PROFILE_LINE];
+    size_t lineno = 0;
+
+    while (fgets(line, sizeof(line), file) != NULL) {
+        lineno++;
+
+        if ((line[0] == '#') || (line[0] == '\n')) {
+            continue;
+        }
+
+        char name[32];
+        uint64_t addr;
+        unsigned int lookups;
+
+        if (sscanf(line, "%31s %" SCNx64 " %u", name, &addr, &lookups) != 3) {
+            error("%s:%zu: Invalid decoded page profile entry", path, lineno);
+            break;
+        }
+
+        /* Pages of processor models not present in the machine */
+        decode_cache_t *cache = find_cache(name);
+        if (cache == NULL) {
+            continue;
+        }
+
+        if (lookup(cache, addr) != NULL) {
+            continue;
+        }
+
+        frame_t *frame = physmem_find_frame(addr);
+        if (frame == NULL) {
+            continue;
+        }
+
+        if ((limit != 0) && (decode_cache_bytes + page_size(cache) > limit)) {
+            continue;
+        }
+
+        if (entries_count == entries_size) {
+            size_t size = (entries_size == 0) ? 64 : 2 * entries_size;
+            profile_entry_t *resized = (profile_entry_t *) safe_malloc(size * sizeof(profile_entry_t));
+
+            if (entries_count > 0) {
+                memcpy(resized, entries, entries_count * sizeof(profile_entry_t));
+            }
+
+            safe_free(entries);
+            entries = resized;
+            entries_size = size;
+        }
+
+        entries[entries_count++] = (profile_entry_t) {
+            .cache = cache,
+            .page = insert(cache, frame, addr)
+        };
+    }
+
+    safe_fclose(file, path);
+
+    if (entries_count > 0) {
+        prefill(entries, entries_count);
+    }
+
+    safe_free(entries);
+}
+
+/** Save the profile of the decoded pages
+ *
+ * Lists the pages of all caches used since they were decoded,
+ * the hottest (most often looked up) pages first.
+ *
+ * @param path Name of the profile file.
+ *
+ */
+void decode_cache_profile_save(const char *path)
+{
+    size_t count = 0;
+    for (decode_cache_t *cache = caches; cache != NULL; cache = cache->next_cache) {
+        count += cache->ring_count;
+    }
+
+    profile_entry_t *entries = (count > 0) ? (profile_entry_t *) safe_malloc(count * sizeof(profile_entry_t)) : NULL;
+    size_t used = 0;
+
+    for (decode_cache_t *cache = caches; cache != NULL; cache = cache->next_cache) {
+        for (size_t i = 0; i < cache->ring_count; i++) {
+            /* Pages of a profile never executed in this run */
+            if (cache->ring[i]->lookups == 0) {
+                continue;
+            }
+
+            entries[used++] = (profile_entry_t) {
+                .cache = cache,
+                .page = cache->ring[i]
+            };
+        }
+    }
+
+    if (used > 0) {
+        qsort(entries, used, sizeof(profile_entry_t), profile_entry_compare);
+    }
+
+    FILE *file = try_fopen(path, "w");
+    if (file != NULL) {
+        fprintf(file, "# MSIM decoded page profile (cache, physical page address, lookups)\n");
+
+        for (size_t i = 0; i < used; i++) {
+            fprintf(file, "%s 0x%" PRIx64 " %u\n", entries[i].cache->name,
+                    (uint64_t) entries[i].page->addr, entries[i].page->lookups);
+        }
+
+        safe_fclose(file, path);
+    }
+
+    safe_free(entries);
+}
@@ -0,0 +1,188 @@
+/*
+ * Copyright (c) 2026 Matus Jurcak
+ * All rights reserved.
+ *
+ * Distributed under the terms of GPL.
+ *
+ *
+ *  Cache of decoded instruction pages
+ *
+ */
+
+#ifndef DECODE_CACHE_H_
+#define DECODE_CACHE_H_
+
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "../../main.h"
+#include "../../physmem.h"
+
+/** Address of a page which is no longer cached */
+#define DECODE_PAGE_INVALID ((ptr36_t) -1)
+
+/** Page of decoded instructions
+ *
+ * The decoded instructions (in a processor specific format)
+ * follow the structure.
+ *
+ */
+typedef struct decode_page {
+    /* Next page in the hash bucket (or in the retired list) */
+    struct decode_page *next;
+
+    /* Physical address of the page */
+    ptr36_t addr;
+
+    /* Used since the last pass of the clock hand */
+    bool referenced;
+
+    /* Position in the clock ring */
+    size_t slot;
+
+    /* Frame the instructions are decoded from */
+    frame_t *frame;
+
+    /* Write generations of the lines when they were decoded */
+    unsigned int generations[FRAME_LINES];
+
+    /* Number of lookups of the page, including the fetches from the page
+       remembered by a processor (its hotness in profiles) */
+    atomic_uint lookups;
+} decode_page_t;
+
+/** Fill a part of a page with instructions decoded from memory
+ *
+ * @param page  Decoded page.
+ * @param start Physical address of the first instruction.
+ * @param size  Size of the part (in bytes).
+ *
+ */
+typedef void (*decode_fill_t)(decode_page_t *page, ptr36_t start, len36_t size);
+
+/** Decoded page cache of a processor model */
+typedef struct decode_cache {
+    /* Name of the cache in decoded page profiles */
+    const char *name;
+
+    /* Size of the decoded instructions of a page */
+    size_t data_size;
+
+    /* Decoder of the instructions */
+    decode_fill_t fill;
+
+    /* Decoder of the instructions ahead of their execution (including
+       the parts otherwise decoded on the first execution), used for
+       the pages of a profile */
+    decode_fill_t fill_ahead;
+
+    /* Hash table of the pages */
+    decode_page_t **buckets;
+    size_t buckets_count;
+
+    /* Clock ring of the pages */
+    decode_page_t **ring;
+    size_t ring_count;
+    size_t ring_size;
+    size_t hand;
+
+    /* Incremented whenever a page is evicted */
+    unsigned int epoch;
+
+    /* Pages evicted while the processors run in parallel */
+    decode_page_t *retired;
+
+    /* Next cache in the list of all caches */
+    struct decode_cache *next_cache;
+    bool registered;
+} decode_cache_t;
+
+#define DECODE_CACHE_INITIALIZER(cache_name, size, decoder, ahead_decoder) \
+    { \
+        .name = (cache_name), \
+        .data_size = (size), \
+        .fill = (decoder), \
+        .fill_ahead = (ahead_decoder) \
+    }
+
+/** Decoded instructions of a page */
+#define decode_page_data(page, type) \
+    ((type *) ((decode_page_t *) (page) + 1))
+
+extern void decode_cache_register(decode_cache_t *cache);
+extern decode_page_t *decode_cache_find(decode_cache_t *cache, ptr36_t addr);
+extern decode_page_t *decode_cache_add(decode_cache_t *cache, frame_t *frame, ptr36_t addr);
+extern void decode_cache_done(decode_cache_t *cache);
+extern void decode_cache_collect(void);
+extern void decode_cache_flush(void);
+extern void decode_cache_profile_load(const char *path);
+extern void decode_cache_profile_save(const char *path);
+
+/** Count a lookup of a page
+ *
+ * Concurrent lookups of parallel processors may be counted only once,
+ * which does not matter for the hotness of the page.
+ *
+ */
+static inline void decode_page_looked_up(decode_page_t *page)
+{
+    unsigned int lookups = atomic_load_explicit(&page->lookups, memory_order_relaxed);
+    atomic_store_explicit(&page->lookups, lookups + 1, memory_order_relaxed);
+}
+
+/** Check whether a page remembered by a processor is still cached
+ *
+ * @param cache Decoded page cache.
+ * @param page  Remembered page (may be NULL).
+ * @param epoch Epoch of the cache when the page was remembered.
+ * @param addr  Physical address of the page.
+ *
+ */
+static inline bool decode_cache_valid(const decode_cache_t *cache,
+        decode_page_t *page, unsigned int epoch, ptr36_t addr)
+{
+    if ((page == NULL) || (epoch != cache->epoch) || (page->addr != addr)) {
+        return false;
+    }
+
+    page->referenced = true;
+    decode_page_looked_up(page);
+    return true;
+}
+
+/** Check whether the decoded instructions of a line are up to date
+ *
+ * @param page Decoded page.
+ * @param addr Physical address within the line.
+ *
+ */
+static inline bool decode_page_fresh(const decode_page_t *page, ptr36_t addr)
+{
+    return page->generations[FRAME_LINE(addr)] == physmem_line_generation(page->frame, addr);
+}
+
+/** Record the write generation of a stale line
+ *
+ * To be called before decoding the instructions of the line
+ * not to miss a concurrent write.
+ *
+ * @param page Decoded page.
+ * @param addr Physical address within the line.
+ *
+ * @return True if the line is stale and has to be decoded again.
+ *
+ */
+static inline bool decode_page_refresh(decode_page_t *page, ptr36_t addr)
+{
+    unsigned int generation = physmem_line_generation(page->frame, addr);
+
+    if (page->generations[FRAME_LINE(addr)] == generation) {
+        return false;
+    }
+
+    page->generations[FRAME_LINE(addr)] = generation;
+    return true;
+}
+
+#endif
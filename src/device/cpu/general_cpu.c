@@ -11,6 +11,7 @@
 
 #include "../../assert.h"
 #include "../../main.h"
+#include "../../smp.h"
 #include "general_cpu.h"
 
 // list of all cpus
@@ -80,6 +81,9 @@ void cpu_interrupt_up(general_cpu_t *cpu, unsigned int no)
     if (cpu == NULL) {
         cpu = get_fallback_cpu();
     }
+    if (smp_defer_interrupt(cpu, no, true)) {
+        return;
+    }
     cpu->type->interrupt_up(cpu->data, no);
 }
 
@@ -88,6 +92,9 @@ void cpu_interrupt_down(general_cpu_t *cpu, unsigned int no)
     if (cpu == NULL) {
         cpu = get_fallback_cpu();
     }
+    if (smp_defer_interrupt(cpu, no, false)) {
+        return;
+    }
     cpu->type->interrupt_down(cpu->data, no);
 }
 
@@ -10,6 +10,7 @@
  */
 
 #include <inttypes.h>
+#include <stdatomic.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -24,9 +25,11 @@
 #include "../../../input.h"
 #include "../../../main.h"
 #include "../../../physmem.h"
+#include "../../../smp.h"
 #include "../../../text.h"
 #include "../../../utils.h"
 #include "../../device.h"
+#include "../decode_cache.h"
 #include "cpu.h"
 #include "debug.h"
 
@@ -299,7 +302,88 @@ static shift_tab_t shift_tab_right_store[] = {
     { UINT32_C(0x00ffffff), 24 }
 };
 
+/** Bucket of the TLB lookup index for the given VPN2
+ *
+ */
+static inline unsigned int tlb_bucket(uint32_t vpn2)
+{
+    return (uint32_t) (vpn2 * UINT32_C(0x9e3779b1)) >> 26;
+}
+
+/** Add a TLB entry to the lookup index
+ *
+ */
+static void tlb_index_insert(r4k_cpu_t *cpu, unsigned int index)
+{
+    tlb_entry_t *entry = &cpu->tlb[index];
+    unsigned int bucket = tlb_bucket(entry->vpn2);
+
+    cpu->tlb_next[index] = cpu->tlb_buckets[bucket];
+    cpu->tlb_buckets[bucket] = index;
+
+    /* Register the page mask of the entry */
+    unsigned int i;
+    for (i = 0; i < cpu->tlb_masks_count; i++) {
+        if (cpu->tlb_masks[i] == entry->mask) {
+            break;
+        }
+    }
+
+    if (i == cpu->tlb_masks_count) {
+        cpu->tlb_masks[i] = entry->mask;
+        cpu->tlb_mask_entries[i] = 0;
+        cpu->tlb_masks_count++;
+    }
+
+    cpu->tlb_mask_entries[i]++;
+}
+
+/** Remove a TLB entry from the lookup index
+ *
+ */
+static void tlb_index_remove(r4k_cpu_t *cpu, unsigned int index)
+{
+    tlb_entry_t *entry = &cpu->tlb[index];
+    int8_t *link = &cpu->tlb_buckets[tlb_bucket(entry->vpn2)];
+
+    while (*link != (int8_t) index) {
+        ASSERT(*link >= 0);
+        link = &cpu->tlb_next[*link];
+    }
+
+    *link = cpu->tlb_next[index];
+
+    /* Unregister the page mask of the entry */
+    unsigned int i;
+    for (i = 0; cpu->tlb_masks[i] != entry->mask; i++) {
+        ASSERT(i < cpu->tlb_masks_count);
+    }
+
+    cpu->tlb_mask_entries[i]--;
+    if (cpu->tlb_mask_entries[i] == 0) {
+        cpu->tlb_masks_count--;
+        cpu->tlb_masks[i] = cpu->tlb_masks[cpu->tlb_masks_count];
+        cpu->tlb_mask_entries[i] = cpu->tlb_mask_entries[cpu->tlb_masks_count];
+    }
+}
+
+/** Build the TLB lookup index of all entries
+ *
+ */
+static void tlb_index_init(r4k_cpu_t *cpu)
+{
+    memset(cpu->tlb_buckets, -1, sizeof(cpu->tlb_buckets));
+    cpu->tlb_masks_count = 0;
+
+    for (unsigned int i = 0; i < TLB_ENTRIES; i++) {
+        tlb_index_insert(cpu, i);
+    }
+}
+
 /** Address traslation through the TLB table
+ *
+ * The entries are looked up in the TLB lookup index by the VPN2
+ * of the address under each of the page masks present in the TLB.
  *
  * See tlb_look_t definition
  *
@@ -314,15 +398,20 @@ static tlb_look_t tlb_look(r4k_cpu_t *cpu, ptr64_t virt, ptr36_t *phys, bool wr)
         return TLBL_OK;
     }
 
-    unsigned int hint = cpu->tlb_hint;
-    unsigned int i;
+    for (unsigned int m = 0; m < cpu->tlb_masks_count; m++) {
+        uint32_t mask = cpu->tlb_masks[m];
+        uint32_t vpn2 = virt.lo & mask;
+        int i;
 
-    /* Look for the TBL hit */
-    for (i = 0; i < TLB_ENTRIES; i++) {
-        tlb_entry_t *entry = &cpu->tlb[(i + hint) % TLB_ENTRIES];
+        /* Look for the TBL hit */
+        for (i = cpu->tlb_buckets[tlb_bucket(vpn2)]; i >= 0; i = cpu->tlb_next[i]) {
+            tlb_entry_t *entry = &cpu->tlb[i];
+
+            /* TLB hit? */
+            if ((entry->mask != mask) || (entry->vpn2 != vpn2)) {
+                continue;
+            }
 
-        /* TLB hit? */
-        if ((virt.lo & entry->mask) == entry->vpn2) {
             /* Test ASID */
             if ((!entry->global) && (entry->asid != cp0_entryhi_asid(cpu))) {
                 continue;
@@ -345,9 +434,6 @@ static tlb_look_t tlb_look(r4k_cpu_t *cpu, ptr64_t virt, ptr36_t *phys, bool wr)
             ptr36_t amask = virt.lo & (~smask);
             *phys = amask | (entry->pg[subpage].pfn & smask);
 
-            /* Update optimization hint */
-            cpu->tlb_hint = i;
-
             return TLBL_OK;
         }
     }
@@ -673,6 +759,49 @@ r4k_exc_t r4k_convert_addr(r4k_cpu_t *cpu, ptr64_t virt, ptr36_t *phys, bool wri
     }
 }
 
+/** Convert the address through a micro-TLB
+ *
+ * The translation of the last accessed page is kept in the micro-TLB,
+ * so that further accesses to the same page do not search the TLB
+ * again. The micro-TLB is invalidated whenever the translation might
+ * change, i.e. when the Status register or the ASID changes or when
+ * a TLB entry is written.
+ *
+ * @param write Write access.
+ * @param noisy Fill apropriate processor registers
+ *              if the address is incorrect.
+ *
+ */
+static r4k_exc_t micro_tlb_convert_addr(r4k_cpu_t *cpu, r4k_micro_tlb_t *utlb,
+        ptr64_t virt, ptr36_t *phys, bool write, bool noisy)
+{
+    uint64_t page = ALIGN_DOWN(virt.ptr, FRAME_SIZE);
+
+    if ((utlb->valid) && (utlb->virt == page)
+            && (utlb->status == cp0_status(cpu).val)
+            && (utlb->asid == cp0_entryhi_asid(cpu))
+            && (utlb->tlb_generation == cpu->tlb_generation)) {
+        *phys = utlb->phys + (virt.ptr - page);
+        return r4k_excNone;
+    }
+
+    r4k_exc_t res = r4k_convert_addr(cpu, virt, phys, write, noisy);
+
+    if (res != r4k_excNone) {
+        utlb->valid = false;
+        return res;
+    }
+
+    utlb->valid = true;
+    utlb->virt = page;
+    utlb->phys = ALIGN_DOWN(*phys, FRAME_SIZE);
+    utlb->status = cp0_status(cpu).val;
+    utlb->asid = cp0_entryhi_asid(cpu);
+    utlb->tlb_generation = cpu->tlb_generation;
+
+    return r4k_excNone;
+}
+
 /** Test for correct alignment (16 bits)
  *
  * Fill BadVAddr if the alignment is not correct.
@@ -743,7 +872,8 @@ static r4k_exc_t access_mem(r4k_cpu_t *cpu, acc_mode_t mode, ptr64_t virt,
     ASSERT(cpu != NULL);
     ASSERT(phys != NULL);
 
-    r4k_exc_t res = r4k_convert_addr(cpu, virt, phys, mode == AM_WRITE, noisy);
+    r4k_micro_tlb_t *utlb = (mode == AM_WRITE) ? &cpu->store_tlb : &cpu->load_tlb;
+    r4k_exc_t res = micro_tlb_convert_addr(cpu, utlb, virt, phys, mode == AM_WRITE, noisy);
 
     /* Check for watched address */
     if (((cp0_watchlo_r(cpu)) && (mode == AM_READ))
@@ -794,7 +924,7 @@ static r4k_exc_t cpu_read_mem8(r4k_cpu_t *cpu, ptr64_t addr, uint8_t *val, bool
         ASSERT(false);
     }
 
-    *val = physmem_read8(cpu->procno, phys, true);
+    *val = physmem_tlb_read8(&cpu->physmem_tlb, cpu->procno, phys);
     return res;
 }
 
@@ -833,7 +963,7 @@ static r4k_exc_t cpu_read_mem16(r4k_cpu_t *cpu, ptr64_t addr, uint16_t *val, boo
         ASSERT(false);
     }
 
-    *val = physmem_read16(cpu->procno, phys, true);
+    *val = physmem_tlb_read16(&cpu->physmem_tlb, cpu->procno, phys);
     return res;
 }
 
@@ -872,7 +1002,7 @@ r4k_exc_t r4k_read_mem32(r4k_cpu_t *cpu, ptr64_t addr, uint32_t *val, bool noisy
         ASSERT(false);
     }
 
-    *val = physmem_read32(cpu->procno, phys, true);
+    *val = physmem_tlb_read32(&cpu->physmem_tlb, cpu->procno, phys);
     return res;
 }
 
@@ -911,7 +1041,7 @@ static r4k_exc_t cpu_read_mem64(r4k_cpu_t *cpu, ptr64_t addr, uint64_t *val, boo
         ASSERT(false);
     }
 
-    *val = physmem_read64(cpu->procno, phys, true);
+    *val = physmem_tlb_read64(&cpu->physmem_tlb, cpu->procno, phys);
     return res;
 }
 
@@ -939,7 +1069,7 @@ static r4k_exc_t cpu_write_mem8(r4k_cpu_t *cpu, ptr64_t addr, uint8_t value, boo
         ASSERT(false);
     }
 
-    physmem_write8(cpu->procno, phys, value, true);
+    physmem_tlb_write8(&cpu->physmem_tlb, cpu->procno, phys, value);
     return res;
 }
 
@@ -978,7 +1108,7 @@ static r4k_exc_t cpu_write_mem16(r4k_cpu_t *cpu, ptr64_t addr, uint16_t value,
         ASSERT(false);
     }
 
-    physmem_write16(cpu->procno, phys, value, true);
+    physmem_tlb_write16(&cpu->physmem_tlb, cpu->procno, phys, value);
     return res;
 }
 
@@ -1017,7 +1147,7 @@ static r4k_exc_t cpu_write_mem32(r4k_cpu_t *cpu, ptr64_t addr, uint32_t value,
         ASSERT(false);
     }
 
-    physmem_write32(cpu->procno, phys, value, true);
+    physmem_tlb_write32(&cpu->physmem_tlb, cpu->procno, phys, value);
     return res;
 }
 
@@ -1056,7 +1186,7 @@ static r4k_exc_t cpu_write_mem64(r4k_cpu_t *cpu, ptr64_t addr, uint64_t value,
         ASSERT(false);
     }
 
-    physmem_write64(cpu->procno, phys, value, true);
+    physmem_tlb_write64(&cpu->physmem_tlb, cpu->procno, phys, value);
     return res;
 }
 
@@ -1159,6 +1289,8 @@ static r4k_exc_t TLBW(r4k_cpu_t *cpu, bool random)
         } else {
             /* Fill TLB */
             tlb_entry_t *entry = &cpu->tlb[index];
+            cpu->tlb_generation++;
+            tlb_index_remove(cpu, index);
 
             entry->mask = cp0_entryhi_vpn2_mask & ~cp0_pagemask(cpu).val;
             entry->vpn2 = cp0_entryhi(cpu).val & entry->mask;
@@ -1174,6 +1306,8 @@ static r4k_exc_t TLBW(r4k_cpu_t *cpu, bool random)
             entry->pg[1].cohh = cp0_entrylo1_c(cpu);
             entry->pg[1].dirty = cp0_entrylo1_d(cpu);
             entry->pg[1].valid = cp0_entrylo1_v(cpu);
+
+            tlb_index_insert(cpu, index);
         }
 
         return r4k_excNone;
@@ -2625,6 +2759,9 @@ mnemonics_fnc_t decode_mnemonics(r4k_instr_t instr)
 #define EXCEPTION_NORMAL_RESET_ADDRESS HARD_RESET_START_ADDRESS
 #define EXCEPTION_OFFSET UINT64_C(0x0180)
 
+/** Pages of decoded instructions (defined with the fetch functions) */
+static decode_cache_t r4k_instruction_cache;
+
 /** Initialize simulation environment
  *
  */
@@ -2641,6 +2778,9 @@ void r4k_init(r4k_cpu_t *cpu, unsigned int procno)
     cpu->procno = procno;
     r4k_set_pc(cpu, start_address);
 
+    /* All TLB entries are zero */
+    tlb_index_init(cpu);
+
     /* Inicialize cp0 registers */
     cp0_config(cpu).val = HARD_RESET_CONFIG;
     cp0_random(cpu).val = HARD_RESET_RANDOM;
@@ -2656,6 +2796,8 @@ void r4k_init(r4k_cpu_t *cpu, unsigned int procno)
 
     /* Breakpoints */
     list_init(&cpu->bps);
+
+    decode_cache_register(&r4k_instruction_cache);
 }
 
 /** Set the PC register
@@ -2836,108 +2978,188 @@ static r4k_instr_fnc_t decode(r4k_instr_t instr)
     return fnc;
 }
 
+#define PHYS2CACHEINSTR(phys) (((phys) & FRAME_MASK) / sizeof(r4k_instr_t))
+
+/** Decoded instruction */
 typedef struct {
-    item_t item;
-    ptr36_t addr;
-    r4k_instr_fnc_t instrs[FRAME_SIZE / sizeof(r4k_instr_t)];
-} cache_item_t;
+    /* Instruction implementation (NULL until the instruction is decoded,
+       the flags below are not valid until then either) */
+    r4k_instr_fnc_t fnc;
 
-#define PHYS2CACHEINSTR(phys) (((phys) & FRAME_MASK) / sizeof(r4k_instr_t))
+    /* Instruction word */
+    r4k_instr_t instr;
 
-static void cache_item_init(cache_item_t *cache_item)
-{
-    item_init(&cache_item->item);
-    cache_item->addr = 0;
-    // Skip instrs init
-}
+    /* The instruction takes part in LL-SC tracking */
+    bool ll_sc;
 
-list_t r4k_instruction_cache = LIST_INITIALIZER;
+    /*
+     * The instruction accesses the CP0 registers updated
+     * in bulk by the block execution (see execute_block())
+     */
+    bool serialize;
+} r4k_decoded_t;
 
-static bool cache_hit(ptr36_t phys, cache_item_t **cache_item)
-{
-    ptr36_t target_page = ALIGN_DOWN(phys, FRAME_SIZE);
-    cache_item_t *c;
-    for_each(r4k_instruction_cache, c, cache_item_t)
-    {
-        if (c->addr == target_page) {
-            *cache_item = c;
-            return true;
-        }
+static void cache_page_decode(decode_page_t *page, ptr36_t start, len36_t size);
+static void cache_page_decode_ahead(decode_page_t *page, ptr36_t start, len36_t size);
+
+/** Pages of decoded instructions */
+static decode_cache_t r4k_instruction_cache = DECODE_CACHE_INITIALIZER("r4k",
+        (FRAME_SIZE / sizeof(r4k_instr_t)) * sizeof(r4k_decoded_t), cache_page_decode,
+        cache_page_decode_ahead);
+
+/** Check whether the instruction takes part in LL-SC tracking
+ *
+ */
+static bool is_ll_sc(r4k_instr_t instr)
+{
+    switch (instr.i.opcode) {
+    case r4k_opcLL:
+    case r4k_opcLDD:
+    case r4k_opcSC:
+    case r4k_opcSCD:
+        return true;
+    default:
+        return false;
     }
-    return false;
 }
 
-static void cache_item_page_decode(r4k_cpu_t *cpu, cache_item_t *cache_item)
+/** Check whether the instruction is to be executed on its own
+ *
+ * See r4k_decoded_t.
+ *
+ */
+static bool is_serialize(r4k_instr_t instr)
 {
-    for (size_t i = 0; i < FRAME_SIZE / sizeof(r4k_instr_t); ++i) {
-        ptr36_t addr = cache_item->addr + (i * sizeof(r4k_instr_t));
-        r4k_instr_t instr_data = (r4k_instr_t) physmem_read32(cpu->procno, addr, false);
-        cache_item->instrs[i] = decode(instr_data);
+    switch (instr.r.opcode) {
+    case r4k_opcCOP0:
+        return true;
+    case r4k_opcSPECIAL:
+        return func_map[instr.r.func] == instr__xcrd;
+    default:
+        return false;
     }
 }
 
-static void update_cache_item(r4k_cpu_t *cpu, cache_item_t *cache_item)
+/** Fill the page with instructions read from memory
+ *
+ * Only the instruction words are stored, the instructions
+ * are decoded on their first execution (see decode_resolve()).
+ *
+ */
+static void cache_page_decode(decode_page_t *page, ptr36_t start, len36_t size)
 {
-    frame_t *frame = physmem_find_frame(cache_item->addr);
-    ASSERT(frame != NULL);
+    r4k_decoded_t *instrs = decode_page_data(page, r4k_decoded_t);
+    uint32_t words[FRAME_SIZE / sizeof(r4k_instr_t)];
+    size_t count = size / sizeof(r4k_instr_t);
 
-    if (frame->valid) {
-        return;
-    }
+    physmem_frame_read32(page->frame, start, words, count);
 
-    cache_item_page_decode(cpu, cache_item);
+    for (size_t i = 0; i < count; i++) {
+        r4k_decoded_t *decoded = &instrs[PHYS2CACHEINSTR(start) + i];
 
-    frame->valid = true;
-    return;
+        decoded->instr = (r4k_instr_t) words[i];
+        decoded->fnc = NULL;
+    }
 }
 
-static cache_item_t *cache_try_add(r4k_cpu_t *cpu, ptr36_t phys)
+/** Decode an instruction stored by cache_page_decode()
+ *
+ * The record lives in a page of decoded instructions. The flags
+ * are stored before the implementation, so that parallel processors
+ * finding the implementation find them decoded.
+ *
+ */
+static void decode_resolve(const r4k_decoded_t *decoded)
 {
-    frame_t *frame = physmem_find_frame(phys);
-    if (frame == NULL) {
-        return NULL;
-    }
+    r4k_decoded_t *record = (r4k_decoded_t *) decoded;
 
-    cache_item_t *cache_item = safe_malloc(sizeof(cache_item_t));
+    record->ll_sc = is_ll_sc(record->instr);
+    record->serialize = is_serialize(record->instr);
 
-    cache_item_init(cache_item);
-    cache_item->addr = ALIGN_DOWN(phys, FRAME_SIZE);
+    r4k_instr_fnc_t fnc = decode(record->instr);
+    atomic_thread_fence(memory_order_release);
+    record->fnc = fnc;
+}
 
-    list_push(&r4k_instruction_cache, &cache_item->item);
+/** Fill the page with instructions decoded ahead of their execution
+ *
+ * Used for the pages of a profile (see decode_cache_profile_load()).
+ *
+ */
+static void cache_page_decode_ahead(decode_page_t *page, ptr36_t start, len36_t size)
+{
+    r4k_decoded_t *instrs = decode_page_data(page, r4k_decoded_t);
 
-    cache_item_page_decode(cpu, cache_item);
+    cache_page_decode(page, start, size);
 
-    frame->valid = true;
-    return cache_item;
+    for (size_t i = 0; i < size / sizeof(r4k_instr_t); i++) {
+        decode_resolve(&instrs[PHYS2CACHEINSTR(start) + i]);
+    }
 }
 
-static r4k_instr_fnc_t fetch_instr(r4k_cpu_t *cpu, ptr36_t phys)
+static void update_cache_page(r4k_cpu_t *cpu, decode_page_t *page, ptr36_t phys)
 {
-    cache_item_t *cache_item = NULL;
+    /* Only the line of the fetched instruction is decoded again */
+    if (decode_page_refresh(page, phys)) {
+        cache_page_decode(page, ALIGN_DOWN(phys, FRAME_LINE_SIZE), FRAME_LINE_SIZE);
+        cpu->line_refresh++;
+    }
+}
 
-    if (cache_hit(phys, &cache_item)) {
-        ASSERT(cache_item != NULL);
-        update_cache_item(cpu, cache_item);
+static decode_page_t *cache_try_add(r4k_cpu_t *cpu, ptr36_t phys)
+{
+    frame_t *frame = physmem_find_frame(phys);
+    if (frame == NULL) {
+        return NULL;
+    }
 
-        // Move item to front of list on hit
-        if (r4k_instruction_cache.head != &cache_item->item) {
-            list_remove(&r4k_instruction_cache, &cache_item->item);
-            list_push(&r4k_instruction_cache, &cache_item->item);
-        }
+    return decode_cache_add(&r4k_instruction_cache, frame, phys);
+}
 
-        return cache_item->instrs[PHYS2CACHEINSTR(phys)];
-    }
+static const r4k_decoded_t *cache_fetch_instr(r4k_cpu_t *cpu, ptr36_t phys)
+{
+    decode_page_t *page = decode_cache_find(&r4k_instruction_cache, phys);
 
-    cache_item = cache_try_add(cpu, phys);
+    if (page != NULL) {
+        update_cache_page(cpu, page, phys);
+    } else {
+        page = cache_try_add(cpu, phys);
+    }
 
-    if (cache_item != NULL) {
-        return cache_item->instrs[PHYS2CACHEINSTR(phys)];
+    if (page != NULL) {
+        cpu->fetch_cache = page;
+        cpu->fetch_epoch = r4k_instruction_cache.epoch;
+        return &decode_page_data(page, r4k_decoded_t)[PHYS2CACHEINSTR(phys)];
     }
 
     alert("Trying to fetch instructions from outside of physical memory");
     return NULL;
 }
 
+/** Fetch a decoded instruction
+ *
+ * Repeated fetches from the same page bypass the cache lookup
+ * as long as the line of the instruction has not been written to.
+ * On success, the page of the instruction is remembered
+ * in cpu->fetch_cache.
+ *
+ */
+static const r4k_decoded_t *fetch_instr(r4k_cpu_t *cpu, ptr36_t phys)
+{
+    decode_page_t *page = (decode_page_t *) cpu->fetch_cache;
+
+    if ((decode_cache_valid(&r4k_instruction_cache, page, cpu->fetch_epoch, ALIGN_DOWN(phys, FRAME_SIZE))) && (decode_page_fresh(page, phys))) {
+        return &decode_page_data(page, r4k_decoded_t)[PHYS2CACHEINSTR(phys)];
+    }
+
+    /* The instruction cache is shared by all processors */
+    smp_lock();
+    const r4k_decoded_t *decoded = cache_fetch_instr(cpu, phys);
+    smp_unlock();
+
+    return decoded;
+}
+
 /** Change the processor state according to the exception type
  *
  */
@@ -3022,53 +3244,32 @@ static void handle_exception(r4k_cpu_t *cpu, r4k_exc_t res)
     cp0_status(cpu).val |= cp0_status_exl_mask;
 }
 
-/** Execute one CPU instruction
+/** Execute a fetched instruction
+ *
+ * Updates the PC (and the exception address) as the instruction
+ * at the PC has been executed.
  *
  */
-static r4k_exc_t execute(r4k_cpu_t *cpu)
+static r4k_exc_t execute_decoded(r4k_cpu_t *cpu, const r4k_decoded_t *decoded)
 {
-    ASSERT(cpu != NULL);
-
-    /* Instruction fetch */
-
-    ptr36_t phys;
-    r4k_exc_t res = r4k_convert_addr(cpu, cpu->pc, &phys, false, true);
-
-    switch (res) {
-    case r4k_excNone:
-        break;
-    case r4k_excAddrError:
-        if (cpu->branch == BRANCH_NONE) {
-            cpu->excaddr = cpu->pc;
-        }
-        return r4k_excAdEL;
-    case r4k_excTLB:
-        if (cpu->branch == BRANCH_NONE) {
-            cpu->excaddr = cpu->pc;
-        }
-        return r4k_excTLBL;
-    case r4k_excTLBR:
-        if (cpu->branch == BRANCH_NONE) {
-            cpu->excaddr = cpu->pc;
-        }
-        return r4k_excTLBLR;
-    default:
-        ASSERT(false);
+    if (decoded->fnc == NULL) {
+        decode_resolve(decoded);
     }
 
-    r4k_instr_fnc_t fnc = fetch_instr(cpu, phys);
-
-    if (fnc == NULL) {
-        return r4k_excAdEL;
-    }
+    r4k_instr_fnc_t fnc = decoded->fnc;
 
-    r4k_instr_t instr = (r4k_instr_t) physmem_read32(cpu->procno, phys, false);
+    r4k_exc_t exc;
 
-    /* Execute instruction */
-    r4k_exc_t exc = fnc(cpu, instr);
+    if (decoded->ll_sc) {
+        physmem_exclusive_begin();
+        exc = fnc(cpu, decoded->instr);
+        physmem_exclusive_end();
+    } else {
+        exc = fnc(cpu, decoded->instr);
+    }
 
     if (machine_trace) {
-        r4k_idump(cpu, cpu->pc, instr, true);
+        r4k_idump(cpu, cpu->pc, decoded->instr, true);
     }
 
     /* Branch test */
@@ -3100,6 +3301,68 @@ static r4k_exc_t execute(r4k_cpu_t *cpu)
     return exc;
 }
 
+/** Translate the address of the instruction specified by the program counter
+ *
+ * @param noisy Fill apropriate processor registers
+ *              if the address is incorrect.
+ *
+ */
+static r4k_exc_t fetch_translate(r4k_cpu_t *cpu, ptr36_t *phys, bool noisy)
+{
+    return micro_tlb_convert_addr(cpu, &cpu->fetch_tlb, cpu->pc, phys, false, noisy);
+}
+
+/** Execute one CPU instruction
+ *
+ */
+static r4k_exc_t execute(r4k_cpu_t *cpu)
+{
+    ASSERT(cpu != NULL);
+
+    /* Instruction fetch */
+
+    ptr36_t phys;
+    r4k_exc_t res = fetch_translate(cpu, &phys, true);
+
+    switch (res) {
+    case r4k_excNone:
+        break;
+    case r4k_excAddrError:
+        if (cpu->branch == BRANCH_NONE) {
+            cpu->excaddr = cpu->pc;
+        }
+        return r4k_excAdEL;
+    case r4k_excTLB:
+        if (cpu->branch == BRANCH_NONE) {
+            cpu->excaddr = cpu->pc;
+        }
+        return r4k_excTLBL;
+    case r4k_excTLBR:
+        if (cpu->branch == BRANCH_NONE) {
+            cpu->excaddr = cpu->pc;
+        }
+        return r4k_excTLBLR;
+    default:
+        ASSERT(false);
+    }
+
+    const r4k_decoded_t *decoded = fetch_instr(cpu, phys);
+
+    if (decoded == NULL) {
+        return r4k_excAdEL;
+    }
+
+    return execute_decoded(cpu, decoded);
+}
+
+/** Test for an enabled interrupt request
+ *
+ */
+static bool interrupt_pending(r4k_cpu_t *cpu)
+{
+    return (!cp0_status_exl(cpu)) && (!cp0_status_erl(cpu)) && (cp0_status_ie(cpu)) && ((cp0_cause(cpu).val & cp0_status(cpu).val) & cp0_cause_ip_mask) != 0;
+}
+
 /** CPU management
  *
  */
@@ -3108,7 +3371,7 @@ static void manage(r4k_cpu_t *cpu, r4k_exc_t exc, ptr64_t old_pc)
     ASSERT(cpu != NULL);
 
     /* Test for interrupt request */
-    if ((exc == r4k_excNone) && (!cp0_status_exl(cpu)) && (!cp0_status_erl(cpu)) && (cp0_status_ie(cpu)) && ((cp0_cause(cpu).val & cp0_status(cpu).val) & cp0_cause_ip_mask) != 0) {
+    if ((exc == r4k_excNone) && (interrupt_pending(cpu))) {
         exc = r4k_excInt;
     }
 
@@ -3186,6 +3449,243 @@ void r4k_step(r4k_cpu_t *cpu)
     account(cpu);
 }
 
+/** Get the number of cycles the processor stays idle for
+ *
+ * The processor is idle in the standby mode until an interrupt
+ * request is enabled. The only interrupt source of its own is
+ * the timer, which fires when Count reaches Compare.
+ *
+ * @return Number of cycles which can be accounted by r4k_skip()
+ *         instead of stepping the processor (0 if not idle).
+ *
+ */
+uint64_t r4k_idle_cycles(r4k_cpu_t *cpu)
+{
+    ASSERT(cpu != NULL);
+
+    if ((!cpu->stdby) || (interrupt_pending(cpu))) {
+        return 0;
+    }
+
+    uint32_t until_compare = cp0_compare(cpu).lo - cp0_count(cpu).lo;
+    if (until_compare == 0) {
+        return UINT64_C(1) << 32;
+    }
+
+    return until_compare;
+}
+
+/** Advance the Random register by the given number of cycles
+ *
+ * Random decrements every cycle in the range from Wired to 47.
+ *
+ */
+static void skip_random(r4k_cpu_t *cpu, uint64_t cycles)
+{
+    uint64_t wired = cp0_wired(cpu).val;
+
+    /* Get into the regular range first */
+    while ((cycles > 0) && ((cp0_random(cpu).val < wired) || (cp0_random(cpu).val > 47))) {
+        if (cp0_random(cpu).val-- == 0) {
+            cp0_random(cpu).val = 47;
+        }
+
+        if (cp0_random(cpu).val < wired) {
+            cp0_random(cpu).val = 47;
+        }
+
+        cycles--;
+    }
+
+    uint64_t period = 48 - wired;
+    uint64_t position = cp0_random(cpu).val - wired;
+
+    cp0_random(cpu).val = wired + (position + period - (cycles % period)) % period;
+}
+
+/** Account idle cycles of the processor at once
+ *
+ * Equivalent to calling r4k_step() for each of the cycles,
+ * provided that the number of cycles does not exceed the value
+ * returned by r4k_idle_cycles().
+ *
+ */
+void r4k_skip(r4k_cpu_t *cpu, uint64_t cycles)
+{
+    ASSERT(cpu != NULL);
+    ASSERT(cpu->stdby);
+
+    cp0_count(cpu).val += cycles;
+    skip_random(cpu, cycles);
+
+    if (cp0_count(cpu).lo == cp0_compare(cpu).lo) {
+        /* Generate interrupt request */
+        cp0_cause(cpu).val |= 1 << cp0_cause_ip7_shift;
+    }
+
+    if (cpu->branch > cycles) {
+        cpu->branch -= cycles;
+    } else {
+        cpu->branch = BRANCH_NONE;
+    }
+
+    cpu->w_cycles += cycles;
+}
+
+/** Account the cycles executed within a block at once
+ *
+ * Equivalent to the processor management and the cycle accounting
+ * of each of the cycles, provided that Count does not reach Compare
+ * and no exception or interrupt occurs in the cycles. The branch
+ * delay slot control is done per instruction by execute_block().
+ *
+ */
+static void advance(r4k_cpu_t *cpu, unsigned int cycles)
+{
+    if (cycles == 0) {
+        return;
+    }
+
+    cp0_count(cpu).val += cycles;
+    skip_random(cpu, cycles);
+
+    if (CPU_KERNEL_MODE(cpu)) {
+        cpu->k_cycles += cycles;
+    } else {
+        cpu->u_cycles += cycles;
+    }
+}
+
+/** Execute instructions of a page back to back
+ *
+ * The instructions are executed while the PC stays within the page
+ * of the first one, following the branches and their delay slots.
+ * The fetch address is translated only once per block and Count
+ * and Random are updated in bulk. The last cycle of the block
+ * goes through the regular processor management, therefore the
+ * block ends with any instruction raising an exception or
+ * after which an interrupt request is enabled.
+ *
+ * The COP0 instructions (which may change the address translation
+ * or access the registers updated in bulk) are executed alone.
+ * The block also ends no later than in the cycle in which Count
+ * reaches Compare.
+ *
+ * @return Number of cycles executed.
+ *
+ */
+static unsigned int execute_block(r4k_cpu_t *cpu, unsigned int limit)
+{
+    ptr36_t phys;
+
+    if (fetch_translate(cpu, &phys, false) != r4k_excNone) {
+        /* Let the exception be raised by the regular step */
+        r4k_step(cpu);
+        return 1;
+    }
+
+    ptr64_t old_pc = cpu->pc;
+    const r4k_decoded_t *decoded = fetch_instr(cpu, phys);
+
+    if (decoded == NULL) {
+        manage(cpu, r4k_excAdEL, old_pc);
+        account(cpu);
+        return 1;
+    }
+
+    /* The timer interrupt request is raised in the last cycle at most */
+    uint32_t until_compare = cp0_compare(cpu).lo - cp0_count(cpu).lo;
+    if ((until_compare != 0) && (until_compare < limit)) {
+        limit = until_compare;
+    }
+
+    decode_page_t *page = (decode_page_t *) cpu->fetch_cache;
+    const r4k_decoded_t *instrs = decode_page_data(page, r4k_decoded_t);
+    uint64_t virt_page = ALIGN_DOWN(cpu->pc.ptr, FRAME_SIZE);
+    unsigned int cycles = 0;
+
+    while (true) {
+        r4k_exc_t exc = execute_decoded(cpu, decoded);
+
+        if ((exc == r4k_excNone) && (!decoded->serialize)
+                && (cycles + 1 < limit) && (!interrupt_pending(cpu))
+                && (!machine_halt) && (!machine_interactive) && (!machine_trace)) {
+            uint64_t offset = cpu->pc.ptr - virt_page;
+
+            if (offset < FRAME_SIZE) {
+                phys = page->addr + offset;
+                const r4k_decoded_t *next = &instrs[PHYS2CACHEINSTR(phys)];
+
+                if (decode_page_fresh(page, phys)) {
+                    if (next->fnc == NULL) {
+                        decode_resolve(next);
+                    }
+
+                    if (!next->serialize) {
+                        /* Continue with the next instruction of the page */
+                        if (cpu->branch > BRANCH_NONE) {
+                            cpu->branch--;
+                        }
+
+                        decoded = next;
+                        old_pc = cpu->pc;
+                        cycles++;
+                        cpu->run_cycles++;
+                        continue;
+                    }
+                }
+            }
+        }
+
+        advance(cpu, cycles);
+        manage(cpu, exc, old_pc);
+        account(cpu);
+
+        return cycles + 1;
+    }
+}
+
+/** Simulate the given number of cycles of the processor
+ *
+ * Equivalent to calling r4k_step() for each of the cycles,
+ * but the instructions are executed in blocks. Fewer cycles
+ * are executed if the simulation is to be interrupted.
+ *
+ * @return Number of cycles executed.
+ *
+ */
+unsigned int r4k_run(r4k_cpu_t *cpu, unsigned int cycles)
+{
+    ASSERT(cpu != NULL);
+
+    unsigned int executed = 0;
+
+    while ((executed < cycles) && (!machine_halt) && (!machine_interactive)) {
+        cpu->run_cycles = executed;
+
+        if ((cpu->stdby) || (machine_trace)) {
+            r4k_step(cpu);
+            executed++;
+        } else {
+            executed += execute_block(cpu, cycles - executed);
+        }
+    }
+
+    return executed;
+}
+
+/** Get the number of cycles executed so far by r4k_run()
+ *
+ * To be called while an instruction is being executed.
+ *
+ */
+uint64_t r4k_run_elapsed(r4k_cpu_t *cpu)
+{
+    ASSERT(cpu != NULL);
+
+    return cpu->run_cycles;
+}
+
 bool r4k_sc_access(r4k_cpu_t *cpu, ptr36_t addr, int size)
 {
     // MIPS R4K SC fails on write to whole cache line
@@ -3200,9 +3700,9 @@ bool r4k_sc_access(r4k_cpu_t *cpu, ptr36_t addr, int size)
 void r4k_done(r4k_cpu_t *cpu)
 {
     // Clean whole cache
-    while (!is_empty(&r4k_instruction_cache)) {
-        cache_item_t *cache_item = (cache_item_t *) (r4k_instruction_cache.head);
-        list_remove(&r4k_instruction_cache, &cache_item->item);
-        safe_free(cache_item);
-    }
+    cpu->fetch_cache = NULL;
+    cpu->fetch_tlb.valid = false;
+    cpu->load_tlb.valid = false;
+    cpu->store_tlb.valid = false;
+    decode_cache_done(&r4k_instruction_cache);
 }
@@ -26,6 +26,7 @@
 #define R4K_REG_VARIANTS 3
 
 #define TLB_ENTRIES 48
+#define TLB_BUCKETS 64
 #define INTR_COUNT 8
 #define TLB_PHYSMASK UINT64_C(0x780000000)
 
@@ -495,6 +496,20 @@ typedef struct {
     tlb_rec_t pg[2]; /**< Subpages */
 } tlb_entry_t;
 
+/** Micro-TLB holding the translation of the last accessed page
+ *
+ * The translation is valid while the Status register,
+ * the ASID and the TLB generation do not change.
+ */
+typedef struct {
+    bool valid;
+    uint64_t virt; /**< Virtual page address */
+    ptr36_t phys; /**< Physical page address */
+    uint64_t status; /**< Status register */
+    uint8_t asid; /**< Address Space ID */
+    unsigned int tlb_generation;
+} r4k_micro_tlb_t;
+
 typedef enum {
     BRANCH_NONE = 0,
     BRANCH_PASSED = 1,
@@ -596,7 +611,18 @@ typedef struct r4k_cpu {
 
     /* TLB structures */
     tlb_entry_t tlb[TLB_ENTRIES];
-    unsigned int tlb_hint;
+
+    /* TLB lookup index (hash of VPN2 under the page mask of the entry) */
+    int8_t tlb_buckets[TLB_BUCKETS];
+    int8_t tlb_next[TLB_ENTRIES];
+
+    /* Distinct page masks of the TLB entries and their numbers of entries */
+    uint32_t tlb_masks[TLB_ENTRIES];
+    unsigned int tlb_mask_entries[TLB_ENTRIES];
+    unsigned int tlb_masks_count;
+
+    /* Incremented whenever a TLB entry is written */
+    unsigned int tlb_generation;
 
     /* Old registers (for debug info) */
     reg64_t old_regs[R4K_REG_COUNT];
@@ -626,8 +652,26 @@ typedef struct r4k_cpu {
     uint64_t tlb_modified;
     uint64_t intr[INTR_COUNT];
 
+    /* Instruction lines decoded again after being written to */
+    uint64_t line_refresh;
+
     /* breakpoints */
     list_t bps;
+
+    /* Cycles executed so far by r4k_run() */
+    unsigned int run_cycles;
+
+    /* Instruction cache page of the last fetch and its cache epoch */
+    void *fetch_cache;
+    unsigned int fetch_epoch;
+
+    /* Instruction fetch, load and store micro-TLBs */
+    r4k_micro_tlb_t fetch_tlb;
+    r4k_micro_tlb_t load_tlb;
+    r4k_micro_tlb_t store_tlb;
+
+    /* Physical memory soft-TLB */
+    physmem_tlb_t physmem_tlb;
 } r4k_cpu_t;
 
 /** Opcode numbers
@@ -958,6 +1002,10 @@ extern mnemonics_fnc_t decode_mnemonics(r4k_instr_t);
 extern void r4k_init(r4k_cpu_t *cpu, unsigned int procno);
 extern void r4k_set_pc(r4k_cpu_t *cpu, ptr64_t value);
 extern void r4k_step(r4k_cpu_t *cpu);
+extern unsigned int r4k_run(r4k_cpu_t *cpu, unsigned int cycles);
+extern uint64_t r4k_run_elapsed(r4k_cpu_t *cpu);
+extern uint64_t r4k_idle_cycles(r4k_cpu_t *cpu);
+extern void r4k_skip(r4k_cpu_t *cpu, uint64_t cycles);
 extern void r4k_done(r4k_cpu_t *cpu);
 
 /** Addresing function */
@@ -9,6 +9,7 @@
  *
  */
 
+#include <stdatomic.h>
 #include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
@@ -18,9 +19,12 @@
 #include "../../../list.h"
 #include "../../../main.h"
 #include "../../../physmem.h"
+#include "../../../smp.h"
 #include "../../../utils.h"
+#include "../decode_cache.h"
 #include "cpu.h"
 #include "csr.h"
+#include "jit.h"
 #include "tlb.h"
 #include "virt_mem.h"
 
@@ -30,45 +34,15 @@
 
 /// Caching of decoded instructions
 
-/**
- * @brief Item of a list of pages of cached instructions
- */
-typedef struct {
-    item_t item; // The list item
-    ptr36_t addr; // The base address of the page
-    rv_instr_func_t instrs[FRAME_SIZE / sizeof(rv_instr_t)]; // Decoded instructions (represented as function pointers)
-} cache_item_t;
-
 #define PHYS2CACHEINSTR(phys) (((phys) & FRAME_MASK) / sizeof(rv_instr_t))
 
-static void cache_item_init(cache_item_t *cache_item)
-{
-    item_init(&cache_item->item);
-    cache_item->addr = 0;
-    // Skip instrs init
-}
-
-list_t rv_instruction_cache = LIST_INITIALIZER;
+static void cache_page_decode(decode_page_t *page, ptr36_t start, len36_t size);
+static void cache_page_decode_ahead(decode_page_t *page, ptr36_t start, len36_t size);
 
-/**
- * @brief Looks into cache for the instruction on the given physical address
- * @par phys The physical address to check
- * @par cache_item A pointer to a found cache_item_t will be stored here on success
- * @returns Whether the address is in the cache
- */
-static bool cache_hit(ptr36_t phys, cache_item_t **cache_item)
-{
-    ptr36_t target_page = ALIGN_DOWN(phys, FRAME_SIZE);
-    cache_item_t *c;
-    for_each(rv_instruction_cache, c, cache_item_t)
-    {
-        if (c->addr == target_page) {
-            *cache_item = c;
-            return true;
-        }
-    }
-    return false;
-}
+/** Pages of decoded instructions (represented as function pointers) */
+static decode_cache_t rv_instruction_cache = DECODE_CACHE_INITIALIZER("rv32",
+        (FRAME_SIZE / sizeof(rv_instr_t)) * sizeof(rv_decoded_t), cache_page_decode,
+        cache_page_decode_ahead);
 
 static void init_regs(rv32_cpu_t *cpu)
 {
@@ -100,6 +74,8 @@ void rv32_cpu_init(rv32_cpu_t *cpu, unsigned int procno)
 
     /* Breakpoints */
     list_init(&cpu->bps);
+
+    decode_cache_register(&rv_instruction_cache);
 }
 
 /**
@@ -108,11 +84,10 @@ void rv32_cpu_init(rv32_cpu_t *cpu, unsigned int procno)
 void rv32_cpu_done(rv32_cpu_t *cpu)
 {
     // Clean whole cache for simplicity whenever any cpu is done
-    while (!is_empty(&rv_instruction_cache)) {
-        cache_item_t *cache_item = (cache_item_t *) (rv_instruction_cache.head);
-        list_remove(&rv_instruction_cache, &cache_item->item);
-        safe_free(cache_item);
-    }
+    cpu->fetch_cache = NULL;
+    cpu->fetch_tlb.valid = false;
+    decode_cache_done(&rv_instruction_cache);
+    rv32_jit_done();
 
     rv32_tlb_done(&cpu->tlb);
 }
@@ -191,30 +166,42 @@ static rv_exc_t rv32_pagewalk(rv32_cpu_t *cpu, uint32_t virt, ptr36_t *phys, boo
     uint32_t vpn1 = (virt & 0xFFC00000) >> 22;
     uint32_t ppn = rv_csr_satp_ppn(cpu);
 
-    ptr36_t a = ((ptr36_t) ppn) << RV_PAGESIZE;
-    ptr36_t pte_addr = a + vpn1 * RV_PTESIZE;
+    ptr36_t a;
+    ptr36_t pte_addr;
+    uint32_t pte_val;
+    sv32_pte_t pte;
 
-    // PMP or PMA check goes here if implemented
-    uint32_t pte_val = physmem_read32(cpu->csr.mhartid, pte_addr, noisy);
+    bool is_megapage = false;
+    bool is_global = false;
 
-    sv32_pte_t pte = pte_from_uint(pte_val);
+    // The non-leaf PTEs are kept in the page-walk cache
+    if (!rv32_tlb_get_walk(&cpu->tlb, cpu->csr.satp, vpn1, &pte)) {
+        a = ((ptr36_t) ppn) << RV_PAGESIZE;
+        pte_addr = a + vpn1 * RV_PTESIZE;
 
-    if (!is_pte_valid(pte)) {
-        return page_fault_exception;
-    }
+        // PMP or PMA check goes here if implemented
+        pte_val = physmem_read32(cpu->csr.mhartid, pte_addr, noisy);
 
-    bool is_megapage = false;
-    bool is_global = false;
+        pte = pte_from_uint(pte_val);
 
-    if (is_pte_leaf(pte)) {
-        // MEGAPAGE
-        // Missaligned megapage
-        if (pte_ppn0(pte) != 0) {
+        if (!is_pte_valid(pte)) {
             return page_fault_exception;
         }
-        is_megapage = true;
-        is_global = pte.g;
-    } else {
+
+        if (is_pte_leaf(pte)) {
+            // MEGAPAGE
+            // Missaligned megapage
+            if (pte_ppn0(pte) != 0) {
+                return page_fault_exception;
+            }
+            is_megapage = true;
+            is_global = pte.g;
+        } else {
+            rv32_tlb_add_walk(&cpu->tlb, cpu->csr.satp, vpn1, pte);
+        }
+    }
+
+    if (!is_megapage) {
         // Non leaf PTE, make second translation step
 
         // PMP or PMA check goes here if implemented
@@ -339,90 +326,215 @@ rv_exc_t rv32_convert_addr(rv32_cpu_t *cpu, virt_t virt, ptr36_t *phys, bool wr,
 #include "instr.c"
 
 /**
- * @brief Fills the cache_item instrs field with decoded data based on the addr field
+ * @brief Decodes an instruction stored by cache_page_decode()
+ *
+ * The operands are stored before the implementation, so that
+ * parallel processors calling the implementation find them decoded.
+ *
+ * @returns The implementation of the instruction
  */
-static void cache_item_page_decode(rv32_cpu_t *cpu, cache_item_t *cache_item)
+static rv_instr_func_t decode_resolve(rv_decoded_t *instr)
 {
-    for (size_t i = 0; i < FRAME_SIZE / sizeof(rv_instr_t); ++i) {
-        ptr36_t addr = cache_item->addr + (i * sizeof(rv_instr_t));
-        rv_instr_t instr_data = (rv_instr_t) physmem_read32(cpu->csr.mhartid, addr, false);
-        cache_item->instrs[i] = rv32_instr_decode(instr_data);
+    rv_decoded_t decoded = rv_decode_operands(instr->data);
+
+    instr->imm = decoded.imm;
+    instr->rd = decoded.rd;
+    instr->rs1 = decoded.rs1;
+    instr->rs2 = decoded.rs2;
+    instr->length = decoded.length;
+
+    rv_instr_func_t func = rv32_instr_decode(instr->data);
+    atomic_thread_fence(memory_order_release);
+    instr->func = func;
+
+    return func;
+}
+
+/**
+ * @brief Decodes an instruction on its first execution
+ *
+ * The decoded instruction is patched, so that its next executions
+ * call the implementation directly.
+ */
+static rv_exc_t decode_lazy(rv_cpu_t *cpu, const rv_decoded_t *instr)
+{
+    /* The record lives in a page of decoded instructions */
+    rv_instr_func_t func = decode_resolve((rv_decoded_t *) instr);
+
+    return func(cpu, instr);
+}
+
+/**
+ * @brief Fills the page with instructions read from memory
+ *
+ * Only the instruction words are stored, the instructions are decoded
+ * on their first execution (see decode_lazy()) and the blocks of a line
+ * on the first entry to any of them (see line_blocks()).
+ */
+static void cache_page_decode(decode_page_t *page, ptr36_t start, len36_t size)
+{
+    rv_decoded_t *instrs = decode_page_data(page, rv_decoded_t);
+    uint32_t words[FRAME_SIZE / sizeof(rv_instr_t)];
+    size_t count = size / sizeof(rv_instr_t);
+
+    physmem_frame_read32(page->frame, start, words, count);
+
+    for (size_t i = 0; i < count; i++) {
+        rv_decoded_t *instr = &instrs[PHYS2CACHEINSTR(start) + i];
+        instr->func = decode_lazy;
+        instr->data = (rv_instr_t) words[i];
+        instr->block = 0;
     }
 }
 
 /**
- * @brief Updates the cache item to represent the data in memory
+ * @brief Decodes the instructions of the block starting with the instruction
+ *
+ * Used before the block is translated (see jit.c).
  */
-static void update_cache_item(rv32_cpu_t *cpu, cache_item_t *cache_item)
+void rv32_cpu_decode_block(rv_decoded_t *instrs)
 {
-    frame_t *frame = physmem_find_frame(cache_item->addr);
-    ASSERT(frame != NULL);
+    ASSERT(instrs->block > 0);
 
-    if (frame->valid) {
-        return;
+    for (unsigned int i = 0; i < instrs->block; i++) {
+        if (instrs[i].func == decode_lazy) {
+            decode_resolve(&instrs[i]);
+        }
     }
+}
 
-    cache_item_page_decode(cpu, cache_item);
+/**
+ * @brief Computes the blocks of the line containing the address
+ *
+ * Blocks do not cross the lines, which are decoded independently.
+ */
+static void line_blocks(decode_page_t *page, ptr36_t phys)
+{
+    rv_decoded_t *instrs = decode_page_data(page, rv_decoded_t);
 
-    frame->valid = true;
-    return;
+    rv_decode_blocks(&instrs[PHYS2CACHEINSTR(ALIGN_DOWN(phys, FRAME_LINE_SIZE))],
+            FRAME_LINE_SIZE / sizeof(rv_instr_t));
 }
 
 /**
- * @brief Tries to add a new entry to the cache based on the given address
+ * @brief Fills the page with instructions decoded ahead of their execution
  *
- * @return cache_item_t* the added intem or NULL, if the address does not lead to valid memory area
+ * Used for the pages of a profile (see decode_cache_profile_load()).
  */
-static cache_item_t *cache_try_add(rv32_cpu_t *cpu, ptr36_t phys)
+static void cache_page_decode_ahead(decode_page_t *page, ptr36_t start, len36_t size)
+{
+    rv_decoded_t *instrs = decode_page_data(page, rv_decoded_t);
+
+    cache_page_decode(page, start, size);
+
+    for (size_t i = 0; i < size / sizeof(rv_instr_t); i++) {
+        decode_resolve(&instrs[PHYS2CACHEINSTR(start) + i]);
+    }
+
+    for (ptr36_t line = start; line < start + size; line += FRAME_LINE_SIZE) {
+        line_blocks(page, line);
+    }
+}
+
+/**
+ * @brief Updates the cached page to represent the data in memory
+ */
+static void update_cache_page(rv32_cpu_t *cpu, decode_page_t *page, ptr36_t phys)
+{
+    /* Only the line of the fetched instruction is decoded again */
+    if (decode_page_refresh(page, phys)) {
+        cache_page_decode(page, ALIGN_DOWN(phys, FRAME_LINE_SIZE), FRAME_LINE_SIZE);
+    }
+}
+
+/**
+ * @brief Tries to add a new page to the cache based on the given address
+ *
+ * @return decode_page_t* the added page or NULL, if the address does not lead to valid memory area
+ */
+static decode_page_t *cache_try_add(rv32_cpu_t *cpu, ptr36_t phys)
 {
     frame_t *frame = physmem_find_frame(phys);
     if (frame == NULL) {
         return NULL;
     }
 
-    cache_item_t *cache_item = safe_malloc(sizeof(cache_item_t));
+    return decode_cache_add(&rv_instruction_cache, frame, phys);
+}
 
-    cache_item_init(cache_item);
-    cache_item->addr = ALIGN_DOWN(phys, FRAME_SIZE);
+/**
+ * @brief Fethes a page of decoded instructions from memory
+ *
+ * Consults the cache first and updates the cache on misses or on invalid memory
+ *
+ * @return decode_page_t* the page or NULL, if the address does not lead to valid memory area
+ */
+static decode_page_t *cache_fetch_instr(rv32_cpu_t *cpu, ptr36_t phys)
+{
+    decode_page_t *page = decode_cache_find(&rv_instruction_cache, phys);
 
-    list_push(&rv_instruction_cache, &cache_item->item);
+    if (page != NULL) {
+        update_cache_page(cpu, page, phys);
+    } else {
+        page = cache_try_add(cpu, phys);
+    }
 
-    cache_item_page_decode(cpu, cache_item);
+    if (page != NULL) {
+        cpu->fetch_cache = page;
+        cpu->fetch_epoch = rv_instruction_cache.epoch;
+    }
 
-    frame->valid = true;
-    return cache_item;
+    return page;
 }
 
 /**
- * @brief Fethes a decoded instruction from memory
+ * @brief Fetches the page of decoded instructions containing the address
  *
- * Consults the cache first and updates the cache on misses or on invalid memory
+ * Repeated fetches from the same page bypass the cache lookup
+ * as long as the line of the instruction has not been written to.
+ *
+ * @return decode_page_t* the page or NULL, if the address does not lead to valid memory area
  */
-static rv_instr_func_t fetch_instr(rv32_cpu_t *cpu, ptr36_t phys)
+static decode_page_t *fetch_page(rv32_cpu_t *cpu, ptr36_t phys)
 {
-    cache_item_t *cache_item = NULL;
+    decode_page_t *page = (decode_page_t *) cpu->fetch_cache;
 
-    if (cache_hit(phys, &cache_item)) {
-        ASSERT(cache_item != NULL);
-        update_cache_item(cpu, cache_item);
+    if ((!decode_cache_valid(&rv_instruction_cache, page, cpu->fetch_epoch, ALIGN_DOWN(phys, FRAME_SIZE))) || (!decode_page_fresh(page, phys))) {
+        /* The instruction cache is shared by all processors */
+        smp_lock();
+        page = cache_fetch_instr(cpu, phys);
+        smp_unlock();
+    }
 
-        // Move item to front of list on hit
+    return page;
+}
 
-        if (rv_instruction_cache.head != &cache_item->item) {
-            list_remove(&rv_instruction_cache, &cache_item->item);
-            list_push(&rv_instruction_cache, &cache_item->item);
-        }
+/**
+ * @brief Fetches a pre-decoded instruction
+ */
+static void fetch_instr(rv32_cpu_t *cpu, ptr36_t phys, rv_decoded_t *instr)
+{
+    decode_page_t *page = fetch_page(cpu, phys);
 
-        return cache_item->instrs[PHYS2CACHEINSTR(phys)];
+    if (page == NULL) {
+        alert("Trying to fetch instructions from outside of physical memory");
+        rv_instr_t instr_data = (rv_instr_t) physmem_read32(cpu->csr.mhartid, phys, true);
+        *instr = rv_decode_operands(instr_data);
+        instr->func = rv32_instr_decode(instr_data);
+        return;
+    }
+
+    rv_decoded_t *decoded = &decode_page_data(page, rv_decoded_t)[PHYS2CACHEINSTR(phys)];
+    if (decoded->func == decode_lazy) {
+        decode_resolve(decoded);
     }
 
-    cache_item = cache_try_add(cpu, phys);
+    *instr = *decoded;
 
-    if (cache_item != NULL) {
-        return cache_item->instrs[PHYS2CACHEINSTR(phys)];
+    /* Instruction fetches are subject to memory breakpoints */
+    if (page->frame->breakpoints_count > 0) {
+        physmem_read32(cpu->csr.mhartid, phys, true);
     }
-    alert("Trying to fetch instructions from outside of physical memory");
-    return rv32_instr_decode((rv_instr_t) physmem_read32(cpu->csr.mhartid, phys, true));
 }
 
 /**
@@ -630,51 +742,45 @@ static void try_handle_interrupt(rv_cpu_t *cpu)
 }
 
 /**
- * @brief Increases the HPM counters based in the event specifying CSRs
+ * @brief Checks whether an interrupt would be trapped in the next step
  *
- * @param cpu The cpu on which these counters are
- * @param i The index of the HPM in range [0..29)
+ * Side-effect free counterpart of try_handle_interrupt
  */
-static void account_hmp(rv_cpu_t *cpu, int i)
+static bool interrupt_ready(rv32_cpu_t *cpu)
 {
-    ASSERT((i >= 0 && i < 29));
+    uint32_t mip = cpu->csr.mip
+            | (cpu->csr.external_SEIP ? rv_csr_sei_mask : 0)
+            | (cpu->csr.external_STIP ? rv_csr_sti_mask : 0);
 
-    uint32_t mask = (1 << (i + 3));
-    bool inhibited = cpu->csr.mcountinhibit & mask;
+    bool can_trap_to_M = (cpu->priv_mode == rv_mmode && rv_csr_mstatus_mie(cpu)) || (cpu->priv_mode < rv_mmode);
+    if (can_trap_to_M && (mip & cpu->csr.mie & ~cpu->csr.mideleg & rv_csr_mi_mask)) {
+        return true;
+    }
 
-    if (inhibited) {
+    bool can_trap_to_S = (cpu->priv_mode == rv_smode && rv_csr_sstatus_sie(cpu)) || (cpu->priv_mode < rv_smode);
+    return can_trap_to_S && (mip & cpu->csr.mie & rv_csr_si_mask);
+}
+
+/**
+ * @brief Account the cycles to the events of the active HPM counters
+ *
+ * The cycles are accounted to the event of the current privilege mode
+ * (and to the wait cycles while in standby). The counters themselves
+ * are updated only when they are accessed (see rv_csr_hpm_update).
+ *
+ * @param cycles The number of cycles to account
+ */
+static void account_hpm(rv32_cpu_t *cpu, uint64_t cycles)
+{
+    if (cpu->csr.hpm_active == 0) {
         return;
     }
 
-    rv_csr_hpm_event_t event = cpu->csr.hpmevents[i];
+    // The U, S and M mode cycle events follow the privilege mode encoding
+    cpu->csr.hpm_event_cycles[hpm_u_cycles + cpu->priv_mode] += cycles;
 
-    switch (event) {
-    case (hpm_u_cycles): {
-        if (cpu->priv_mode == rv_umode) {
-            cpu->csr.hpmcounters[i]++;
-        }
-        break;
-    }
-    case (hpm_s_cycles): {
-        if (cpu->priv_mode == rv_smode) {
-            cpu->csr.hpmcounters[i]++;
-        }
-        break;
-    }
-    case (hpm_m_cycles): {
-        if (cpu->priv_mode == rv_mmode) {
-            cpu->csr.hpmcounters[i]++;
-        }
-        break;
-    }
-    case (hpm_w_cycles): {
-        if (cpu->stdby) {
-            cpu->csr.hpmcounters[i]++;
-        }
-        break;
-    }
-    default:
-        break;
+    if (cpu->stdby) {
+        cpu->csr.hpm_event_cycles[hpm_w_cycles] += cycles;
     }
 }
 
@@ -692,37 +798,160 @@ static void manage_timer_interrupts(rv32_cpu_t *cpu)
 }
 
 /**
- * @brief Increase the counter CSRs and raise timer interrupts if desired
+ * @brief Advances mtime by the accounted cycles
+ *
+ * In the virtual time mode, mtime ticks (in milliseconds) once per
+ * machine_time_frequency cycles. Otherwise mtime follows the host
+ * time, which is sampled only once per RV_HOST_TIME_SAMPLE_CYCLES
+ * cycles (or when forced).
+ *
+ * @param cycles The number of cycles to account
+ * @param sample Sample the host time regardless of the cycles
  */
-static void account(rv32_cpu_t *cpu, bool instruction_retired)
+static void update_mtime(rv32_cpu_t *cpu, uint64_t cycles, bool sample)
 {
-    if (!(cpu->csr.mcountinhibit & 0b001)) {
-        cpu->csr.cycle++;
+    cpu->csr.time_cycles += cycles;
+
+    if (machine_time_frequency != 0) {
+        if (cpu->csr.time_cycles >= machine_time_frequency) {
+            cpu->csr.mtime += cpu->csr.time_cycles / machine_time_frequency;
+            cpu->csr.time_cycles %= machine_time_frequency;
+        }
+
+        return;
+    }
+
+    if ((!sample) && (cpu->csr.time_cycles < RV_HOST_TIME_SAMPLE_CYCLES)) {
+        return;
     }
 
-    // mtime cannot be inhibited
     uint64_t current_tick_time = current_timestamp();
     cpu->csr.mtime += (current_tick_time - cpu->csr.last_tick_time);
     cpu->csr.last_tick_time = current_tick_time;
+    cpu->csr.time_cycles = 0;
+}
+
+/**
+ * @brief Bring mtime up to date in the middle of a block
+ *
+ * The cycles of a block are accounted at its end (see execute_block).
+ * In the virtual time mode, the instructions of the current block
+ * executed so far are accounted to mtime already and deducted from
+ * time_cycles, so that they are not counted twice at the end of the block.
+ */
+void rv32_cpu_sync_mtime(rv32_cpu_t *cpu)
+{
+    ASSERT(cpu != NULL);
 
-    if (!(cpu->csr.mcountinhibit & 0b100) && instruction_retired) {
-        cpu->csr.instret++;
+    if ((machine_time_frequency == 0) || (!cpu->run_block)) {
+        return;
     }
 
-    for (int i = 0; i < 29; ++i) {
-        account_hmp(cpu, i);
+    uint64_t pending = (uint32_t) (cpu->pc - cpu->run_block_pc) / sizeof(rv_instr_t);
+    uint64_t cycles = cpu->csr.time_cycles + pending;
+
+    cpu->csr.mtime += cycles / machine_time_frequency;
+    cpu->csr.time_cycles = cycles % machine_time_frequency - pending;
+}
+
+/**
+ * @brief Get the number of cycles until mtime reaches mtimecmp
+ *
+ * Defined only in the virtual time mode.
+ *
+ * @returns The number of cycles (UINT64_MAX if mtime has already reached
+ *          mtimecmp or if the number of cycles does not fit)
+ */
+static uint64_t mtime_deadline_cycles(rv32_cpu_t *cpu)
+{
+    ASSERT(machine_time_frequency != 0);
+
+    if (cpu->csr.mtime >= cpu->csr.mtimecmp) {
+        return UINT64_MAX;
     }
 
+    uint64_t ticks = cpu->csr.mtimecmp - cpu->csr.mtime;
+    if (ticks > UINT64_MAX / machine_time_frequency) {
+        return UINT64_MAX;
+    }
+
+    return ticks * machine_time_frequency - cpu->csr.time_cycles;
+}
+
+/**
+ * @brief Increase the counter CSRs and raise timer interrupts if desired
+ *
+ * @param cycles The number of cycles to account
+ * @param retired The number of instructions retired in these cycles
+ */
+static void account(rv32_cpu_t *cpu, uint64_t cycles, uint64_t retired)
+{
+    if (!(cpu->csr.mcountinhibit & 0b001)) {
+        cpu->csr.cycle += cycles;
+    }
+
+    // mtime cannot be inhibited
+    update_mtime(cpu, cycles, false);
+
+    if (!(cpu->csr.mcountinhibit & 0b100)) {
+        cpu->csr.instret += retired;
+    }
+
+    account_hpm(cpu, cycles);
+
     manage_timer_interrupts(cpu);
 }
 
+/**
+ * @brief Translate the address of the instruction PC is pointing to
+ *
+ * The translation of the page of the last fetch is kept in the fetch
+ * micro-TLB, so that the instructions of the same page are fetched
+ * without looking up the TLB again. The micro-TLB is invalidated
+ * whenever the translation might change, i.e. when the privilege mode,
+ * mstatus or satp changes or when a mapping is removed from the TLB.
+ *
+ * @param noisy Shall the translation change the processor and global state
+ */
+static rv_exc_t fetch_translate(rv32_cpu_t *cpu, ptr36_t *phys, bool noisy)
+{
+    rv32_fetch_tlb_t *ftlb = &cpu->fetch_tlb;
+    uint32_t virt = ALIGN_DOWN(cpu->pc, FRAME_SIZE);
+
+    if ((ftlb->valid) && (ftlb->virt == virt)
+            && (ftlb->priv_mode == cpu->priv_mode)
+            && (ftlb->mstatus == cpu->csr.mstatus)
+            && (ftlb->satp == cpu->csr.satp)
+            && (ftlb->tlb_generation == cpu->tlb.generation)) {
+        *phys = ftlb->phys + (cpu->pc - virt);
+        return rv_exc_none;
+    }
+
+    rv_exc_t ex = rv_convert_addr(cpu, cpu->pc, phys, false, true, noisy);
+
+    if (ex != rv_exc_none) {
+        ftlb->valid = false;
+        return ex;
+    }
+
+    ftlb->valid = true;
+    ftlb->virt = virt;
+    ftlb->phys = ALIGN_DOWN(*phys, FRAME_SIZE);
+    ftlb->priv_mode = cpu->priv_mode;
+    ftlb->mstatus = cpu->csr.mstatus;
+    ftlb->satp = cpu->csr.satp;
+    ftlb->tlb_generation = cpu->tlb.generation;
+
+    return rv_exc_none;
+}
+
 /**
  * @brief Execute the instruction that PC is pointing to and handle interrupts or exceptions
  */
 static rv_exc_t execute(rv32_cpu_t *cpu)
 {
     ptr36_t phys;
-    rv_exc_t ex = rv_convert_addr(cpu, cpu->pc, &phys, false, true, true);
+    rv_exc_t ex = fetch_translate(cpu, &phys, true);
 
     if (ex != rv_exc_none) {
         alert("Fetching from unconvertable address!");
@@ -732,17 +961,24 @@ static rv_exc_t execute(rv32_cpu_t *cpu)
         return ex;
     }
 
-    rv_instr_func_t instr_func = fetch_instr(cpu, phys);
-    rv_instr_t instr_data = (rv_instr_t) physmem_read32(cpu->csr.mhartid, phys, true);
+    rv_decoded_t instr;
+    fetch_instr(cpu, phys, &instr);
 
     if (machine_trace) {
-        rv32_idump(cpu, cpu->pc, instr_data);
+        rv32_idump(cpu, cpu->pc, instr.data);
     }
 
-    ex = instr_func(cpu, instr_data);
+    if (instr.data.r.opcode == rv_opcAMO) {
+        /* Atomic read-modify-write and LR/SC bookkeeping */
+        physmem_exclusive_begin();
+        ex = instr.func(cpu, &instr);
+        physmem_exclusive_end();
+    } else {
+        ex = instr.func(cpu, &instr);
+    }
 
     if (ex == rv_exc_illegal_instruction) {
-        cpu->csr.tval_next = instr_data.val;
+        cpu->csr.tval_next = instr.data.val;
     }
 
     return ex;
@@ -770,7 +1006,7 @@ void rv32_cpu_step(rv32_cpu_t *cpu)
         try_handle_interrupt(cpu);
     }
 
-    account(cpu, instruction_retired);
+    account(cpu, 1, instruction_retired ? 1 : 0);
 
     if (!cpu->stdby) {
         cpu->pc = cpu->pc_next;
@@ -782,6 +1018,240 @@ void rv32_cpu_step(rv32_cpu_t *cpu)
     cpu->csr.tval_next = 0;
 }
 
+/**
+ * @brief Interpret the instructions of a basic block
+ *
+ * Stops at the first exception, when the simulation is to be interrupted
+ * or when the line of the block is written to. PC and PC next are left
+ * at the last executed instruction.
+ *
+ * @param count The number of instructions to execute
+ * @param ex The exception raised by the last executed instruction
+ * @return The number of instructions retired
+ */
+static unsigned int interpret_block(rv32_cpu_t *cpu, decode_page_t *page, ptr36_t phys,
+        const rv_decoded_t *instrs, unsigned int count, rv_exc_t *ex)
+{
+    unsigned int retired = 0;
+
+    while (true) {
+        const rv_decoded_t *instr = &instrs[retired];
+
+        if (instr->data.r.opcode == rv_opcAMO) {
+            /* Atomic read-modify-write and LR/SC bookkeeping */
+            physmem_exclusive_begin();
+            *ex = instr->func(cpu, instr);
+            physmem_exclusive_end();
+        } else {
+            *ex = instr->func(cpu, instr);
+        }
+
+        // x0 is always 0
+        cpu->regs[0] = 0;
+
+        if (*ex != rv_exc_none) {
+            return retired;
+        }
+
+        retired++;
+
+        /* The rest of the block might have been overwritten */
+        if ((retired == count) || (machine_halt) || (machine_interactive) || (!decode_page_fresh(page, phys))) {
+            return retired;
+        }
+
+        cpu->pc = cpu->pc_next;
+        cpu->pc_next = cpu->pc + 4;
+    }
+}
+
+/**
+ * @brief Execute the basic block PC is pointing to
+ *
+ * The instructions of the block are executed back to back, pending
+ * interrupts are checked and the counters are updated once at the end
+ * of the block.
+ *
+ * @param limit The maximal number of cycles to execute
+ * @return The number of cycles executed
+ */
+static unsigned int execute_block(rv32_cpu_t *cpu, unsigned int limit)
+{
+    ptr36_t phys;
+
+    /* The fetch fault is raised by the regular step */
+    if (fetch_translate(cpu, &phys, false) != rv_exc_none) {
+        rv32_cpu_step(cpu);
+        return 1;
+    }
+
+    decode_page_t *page = fetch_page(cpu, phys);
+
+    /* Fetches subject to memory breakpoints are checked one by one */
+    if ((page == NULL) || (page->frame->breakpoints_count > 0)) {
+        rv32_cpu_step(cpu);
+        return 1;
+    }
+
+    const rv_decoded_t *instrs = &decode_page_data(page, rv_decoded_t)[PHYS2CACHEINSTR(phys)];
+    if (instrs->block == 0) {
+        line_blocks(page, phys);
+    }
+
+    unsigned int count = (instrs->block < limit) ? instrs->block : limit;
+    unsigned int retired;
+    rv_exc_t ex = rv_exc_none;
+
+    rv32_jit_block_t block = NULL;
+
+    /* The translation memory is not shared by parallel processors */
+    if ((machine_jit) && (!smp_active) && (instrs->block <= limit)) {
+        block = rv32_jit_get(page, rv_instruction_cache.epoch, phys, cpu->pc, instrs);
+    }
+
+    cpu->run_block = true;
+
+    if (block != NULL) {
+        retired = block(cpu, &ex);
+    } else {
+        retired = interpret_block(cpu, page, phys, instrs, count, &ex);
+    }
+
+    cpu->run_block = false;
+
+    if (ex == rv_exc_illegal_instruction) {
+        cpu->csr.tval_next = instrs[retired].data.val;
+    }
+
+    unsigned int cycles = retired;
+
+    if (ex != rv_exc_none) {
+        account(cpu, retired, retired);
+        handle_exception(cpu, ex);
+        account(cpu, 1, 0);
+        cycles++;
+    } else {
+        // If any interrupts are pending, handle them
+        try_handle_interrupt(cpu);
+        account(cpu, retired, retired);
+    }
+
+    if (!cpu->stdby) {
+        cpu->pc = cpu->pc_next;
+        cpu->pc_next = cpu->pc + 4;
+    }
+
+    cpu->csr.tval_next = 0;
+
+    return cycles;
+}
+
+/**
+ * @brief Simulate the given number of cycles of the CPU
+ *
+ * Equivalent to calling rv32_cpu_step for each of the cycles, except
+ * that pending interrupts are only checked at the end of each basic
+ * block. Stops early when the simulation is to be interrupted.
+ *
+ * @returns The number of cycles simulated
+ */
+unsigned int rv32_cpu_run(rv32_cpu_t *cpu, unsigned int cycles)
+{
+    ASSERT(cpu != NULL);
+
+    unsigned int executed = 0;
+
+    while ((executed < cycles) && (!machine_halt) && (!machine_interactive)) {
+        cpu->run_cycles = executed;
+        cpu->run_block_pc = cpu->pc;
+
+        if ((cpu->stdby) || (machine_trace)) {
+            rv32_cpu_step(cpu);
+            executed++;
+        } else {
+            executed += execute_block(cpu, cycles - executed);
+        }
+    }
+
+    return executed;
+}
+
+/**
+ * @brief Get the number of cycles executed so far by rv32_cpu_run
+ *
+ * To be called while an instruction is being executed. The PC is kept
+ * at the executed instruction, so the instructions of the current block
+ * executed before are given by its distance from the start of the block.
+ */
+uint64_t rv32_cpu_run_elapsed(rv32_cpu_t *cpu)
+{
+    ASSERT(cpu != NULL);
+
+    return cpu->run_cycles + (uint32_t) (cpu->pc - cpu->run_block_pc) / sizeof(rv_instr_t);
+}
+
+/**
+ * @brief Get the number of cycles the CPU stays idle for
+ *
+ * The CPU is idle while waiting for an interrupt (WFI) which
+ * cannot be trapped yet. In the virtual time mode, the idle period
+ * ends no later than when mtime reaches mtimecmp. Otherwise mtime
+ * follows the host time, so the mtimecmp deadline cannot be expressed
+ * in cycles and the mtime is only sampled at the end of the idle period.
+ *
+ * @returns The number of cycles which can be accounted by rv32_cpu_skip
+ *          instead of stepping the CPU (0 if not idle)
+ */
+uint64_t rv32_cpu_idle_cycles(rv32_cpu_t *cpu)
+{
+    ASSERT(cpu != NULL);
+
+    if (!cpu->stdby || interrupt_ready(cpu)) {
+        return 0;
+    }
+
+    uint64_t idle = UINT64_MAX;
+
+    if (machine_time_frequency != 0) {
+        idle = mtime_deadline_cycles(cpu);
+    }
+
+    if (cpu->csr.mcountinhibit & 0b001) {
+        return idle;
+    }
+
+    // Cycles until the (32-bit) scyclecmp comparison changes
+    uint32_t cycle = (uint32_t) cpu->csr.cycle;
+    if (cycle < cpu->csr.scyclecmp) {
+        return MIN(idle, (uint64_t) (cpu->csr.scyclecmp - cycle));
+    }
+
+    return MIN(idle, (UINT64_C(1) << 32) - cycle);
+}
+
+/**
+ * @brief Account idle cycles of the CPU at once
+ *
+ * Equivalent to calling rv32_cpu_step for each of the cycles, provided
+ * that their number does not exceed the value returned
+ * by rv32_cpu_idle_cycles
+ */
+void rv32_cpu_skip(rv32_cpu_t *cpu, uint64_t cycles)
+{
+    ASSERT(cpu != NULL);
+    ASSERT(cpu->stdby);
+
+    if (!(cpu->csr.mcountinhibit & 0b001)) {
+        cpu->csr.cycle += cycles;
+    }
+
+    update_mtime(cpu, cycles, true);
+
+    account_hpm(cpu, cycles);
+
+    manage_timer_interrupts(cpu);
+}
+
 /**
  * @brief Notify the CPU that an adress has been writen ti
  *
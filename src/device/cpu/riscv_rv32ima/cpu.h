@@ -18,16 +18,30 @@
 #include <stdint.h>
 
 #include "../../../main.h"
+#include "../../../physmem.h"
 #include "../riscv_rv_ima/csr.h"
 #include "../riscv_rv_ima/types.h"
 #include "tlb.h"
 
 #define RV_REG_COUNT 32
 
-#define RV_INSTR_CACHE_SIZE 1024
-
 struct rv_tlb;
 
+/** Translation of the page of the last instruction fetch
+ *
+ * The translation is valid while the privilege mode, mstatus, satp
+ * and the TLB generation do not change.
+ */
+typedef struct {
+    bool valid;
+    uint32_t virt;
+    ptr36_t phys;
+    rv_priv_mode_t priv_mode;
+    uint64_t mstatus;
+    uxlen_t satp;
+    unsigned int tlb_generation;
+} rv32_fetch_tlb_t;
+
 /** Main processor structure */
 typedef struct rv32_cpu {
     /** Non privileged registers */
@@ -60,13 +74,40 @@ typedef struct rv32_cpu {
     /** breakpoints **/
     list_t bps;
 
+    /** Instruction cache page of the last fetch and its cache epoch */
+    void *fetch_cache;
+    unsigned int fetch_epoch;
+
+    /** Instruction fetch micro-TLB */
+    rv32_fetch_tlb_t fetch_tlb;
+
+    /** Physical memory soft-TLB */
+    physmem_tlb_t physmem_tlb;
+
+    /** Cycles of the current run executed before the current block
+     *  and the address of the block (see rv32_cpu_run_elapsed)
+     */
+    unsigned int run_cycles;
+    uint32_t run_block_pc;
+
+    /** The block starting at run_block_pc is being executed */
+    bool run_block;
+
 } rv32_cpu_t;
 
+struct rv_decoded;
+
 /** Basic CPU routines */
 extern void rv32_cpu_init(rv32_cpu_t *cpu, unsigned int procno);
 extern void rv32_cpu_done(rv32_cpu_t *cpu);
 extern void rv32_cpu_set_pc(rv32_cpu_t *cpu, uint32_t value);
 extern void rv32_cpu_step(rv32_cpu_t *cpu);
+extern unsigned int rv32_cpu_run(rv32_cpu_t *cpu, unsigned int cycles);
+extern uint64_t rv32_cpu_run_elapsed(rv32_cpu_t *cpu);
+extern void rv32_cpu_sync_mtime(rv32_cpu_t *cpu);
+extern uint64_t rv32_cpu_idle_cycles(rv32_cpu_t *cpu);
+extern void rv32_cpu_skip(rv32_cpu_t *cpu, uint64_t cycles);
+extern void rv32_cpu_decode_block(struct rv_decoded *instrs);
 
 /** Interrupts */
 extern void rv32_interrupt_up(rv32_cpu_t *cpu, unsigned int no);
@@ -61,5 +61,10 @@ extern void rv32_csr_set_asid_len(rv_cpu_t *cpu, unsigned asid_len)
     rv32_tlb_flush(&cpu->tlb);
 }
 
+extern void rv32_csr_hpm_update(rv_cpu_t *cpu)
+{
+    rv_csr_hpm_update(cpu);
+}
+
 #undef rv_cpu
 #undef rv_cpu_t
@@ -32,4 +32,7 @@ extern enum rv_exc rv32_csr_rc(rv_cpu_t *cpu, csr_num_t csr, uint32_t value, uin
  */
 extern void rv32_csr_set_asid_len(rv_cpu_t *cpu, unsigned asid_active_bits);
 
+/** Brings the lazily updated HPM counters up to date (before dumping them) */
+extern void rv32_csr_hpm_update(rv_cpu_t *cpu);
+
 #endif // RISCV_CSR_H_
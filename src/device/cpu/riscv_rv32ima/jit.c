@@ -0,0 +1,789 @@
+/*
+ * Copyright (c) 2026 Matus Jurcak
+ * All rights reserved.
+ *
+ * Distributed under the terms of GPL.
+ *
+ *
+ *  RISC-V RV32IMA binary translation to x86-64
+ *
+ *  Basic blocks executed often enough are translated to host code.
+ *  Simple integer instructions are translated inline, the other
+ *  instructions call their interpreter implementation. Blocks
+ *  containing system or atomic instructions are left to the
+ *  interpreter. A translation is used only as long as the line
+ *  it was translated from has not been written to and the page
+ *  of decoded instructions has not been evicted.
+ *
+ *  The translated code is never writable and executable at the same
+ *  time: the pages being written to are made executable only after
+ *  the translation. The decoded instructions passed to the called
+ *  implementations are kept in a separate, non-executable memory.
+ *
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "../../../assert.h"
+#include "../../../fault.h"
+#include "../../../main.h"
+#include "../../../physmem.h"
+#include "../../../utils.h"
+#include "jit.h"
+
+#if defined(__x86_64__) && defined(__linux__)
+
+#include <unistd.h>
+#include <sys/mman.h>
+
+/** Number of executions after which a block is translated */
+#define JIT_HOT_THRESHOLD 16
+
+/** Number of entries of the translation table (power of 2) */
+#define JIT_TABLE_SIZE 16384
+
+/** Size of the memory for the translated code */
+#define JIT_ARENA_SIZE (16 << 20)
+
+/** Maximal size of a translated block */
+#define JIT_BLOCK_MAX_SIZE 4096
+
+/** Number of the decoded instruction copies */
+#define JIT_COPIES_COUNT (1 << 16)
+
+/** Translation table entry */
+typedef struct {
+    /* Physical address and PC of the block */
+    ptr36_t phys;
+    uint32_t pc;
+
+    /* Decoded instruction cache epoch and line write generation */
+    unsigned int epoch;
+    unsigned int generation;
+
+    /* Number of executions before the translation */
+    unsigned int count;
+    bool untranslatable;
+
+    rv32_jit_block_t code;
+} jit_entry_t;
+
+static jit_entry_t *table = NULL;
+
+/** Memory for the translated code */
+static uint8_t *arena = NULL;
+static size_t arena_used = 0;
+static bool arena_failed = false;
+static size_t page_size;
+
+/** Copies of the decoded instructions of the translated blocks */
+static rv_decoded_t *copies = NULL;
+static size_t copies_used = 0;
+
+/** Code being emitted */
+typedef struct {
+    uint8_t *pos;
+
+    /* Address of the shared epilogue */
+    uint8_t *epilogue;
+} jit_code_t;
+
+static void jit_flush(void)
+{
+    for (size_t i = 0; i < JIT_TABLE_SIZE; i++) {
+        table[i].phys = (ptr36_t) -1;
+        table[i].code = NULL;
+    }
+
+    arena_used = 0;
+    copies_used = 0;
+}
+
+static bool jit_init(void)
+{
+    if (arena != NULL) {
+        return true;
+    }
+
+    if (arena_failed) {
+        return false;
+    }
+
+    void *mem = mmap(NULL, JIT_ARENA_SIZE, PROT_READ | PROT_EXEC,
+            MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (mem == MAP_FAILED) {
+        alert("Unable to allocate executable memory, binary translation disabled");
+        arena_failed = true;
+        return false;
+    }
+
+    arena = (uint8_t *) mem;
+    page_size = (size_t) sysconf(_SC_PAGESIZE);
+    table = (jit_entry_t *) safe_malloc(JIT_TABLE_SIZE * sizeof(jit_entry_t));
+    copies = (rv_decoded_t *) safe_malloc(JIT_COPIES_COUNT * sizeof(rv_decoded_t));
+    jit_flush();
+
+    return true;
+}
+
+/** Make the arena pages of a translated block writable or executable
+ *
+ * @param block Start of the block in the arena.
+ *
+ * @return False if the protection cannot be changed.
+ *
+ */
+static bool arena_protect(uint8_t *block, bool writable)
+{
+    uintptr_t start = ALIGN_DOWN((uintptr_t) block, page_size);
+    uintptr_t end = ALIGN_UP((uintptr_t) (block + JIT_BLOCK_MAX_SIZE), page_size);
+    int prot = writable ? (PROT_READ | PROT_WRITE) : (PROT_READ | PROT_EXEC);
+
+    return mprotect((void *) start, end - start, prot) == 0;
+}
+
+/*
+ * Code emitting
+ *
+ * The translated code keeps the processor structure pointer in rbx
+ * and the exception pointer in r12. Guest registers are loaded to
+ * eax and ecx.
+ *
+ */
+
+#define REG_DISP(reg) ((uint32_t) (offsetof(rv32_cpu_t, regs) + (reg) * sizeof(uint32_t)))
+#define PC_DISP ((uint32_t) offsetof(rv32_cpu_t, pc))
+#define PC_NEXT_DISP ((uint32_t) offsetof(rv32_cpu_t, pc_next))
+
+static void emit8(jit_code_t *code, uint8_t byte)
+{
+    *code->pos++ = byte;
+}
+
+static void emit32(jit_code_t *code, uint32_t value)
+{
+    memcpy(code->pos, &value, sizeof(value));
+    code->pos += sizeof(value);
+}
+
+static void emit64(jit_code_t *code, uint64_t value)
+{
+    memcpy(code->pos, &value, sizeof(value));
+    code->pos += sizeof(value);
+}
+
+static void emit_bytes(jit_code_t *code, size_t count, const uint8_t *bytes)
+{
+    memcpy(code->pos, bytes, count);
+    code->pos += count;
+}
+
+#define EMIT(code, ...) \
+    do { \
+        const uint8_t bytes[] = { __VA_ARGS__ }; \
+        emit_bytes((code), sizeof(bytes), bytes); \
+    } while (0)
+
+/** mov eax, [rbx + regs[reg]] */
+static void emit_load_eax(jit_code_t *code, unsigned int reg)
+{
+    EMIT(code, 0x8b, 0x83);
+    emit32(code, REG_DISP(reg));
+}
+
+/** mov ecx, [rbx + regs[reg]] */
+static void emit_load_ecx(jit_code_t *code, unsigned int reg)
+{
+    EMIT(code, 0x8b, 0x8b);
+    emit32(code, REG_DISP(reg));
+}
+
+/** mov [rbx + regs[reg]], eax */
+static void emit_store_eax(jit_code_t *code, unsigned int reg)
+{
+    EMIT(code, 0x89, 0x83);
+    emit32(code, REG_DISP(reg));
+}
+
+/** mov dword [rbx + disp], imm32 */
+static void emit_store_imm(jit_code_t *code, uint32_t disp, uint32_t value)
+{
+    EMIT(code, 0xc7, 0x83);
+    emit32(code, disp);
+    emit32(code, value);
+}
+
+/** movzx eax, al after setcc */
+static void emit_setcc(jit_code_t *code, uint8_t cc)
+{
+    EMIT(code, 0x0f, cc, 0xc0, 0x0f, 0xb6, 0xc0);
+}
+
+/** Jump to the epilogue returning the given number of retired instructions */
+static void emit_exit(jit_code_t *code, unsigned int retired)
+{
+    /* mov eax, retired */
+    emit8(code, 0xb8);
+    emit32(code, retired);
+
+    /* jmp epilogue */
+    emit8(code, 0xe9);
+    emit32(code, (uint32_t) (code->epilogue - (code->pos + 4)));
+}
+
+/** Short conditional jump to be patched */
+static uint8_t *emit_jcc8(jit_code_t *code, uint8_t opcode)
+{
+    EMIT(code, opcode, 0x00);
+    return code->pos - 1;
+}
+
+static void patch_jcc8(jit_code_t *code, uint8_t *site)
+{
+    ptrdiff_t offset = code->pos - (site + 1);
+    ASSERT((offset >= 0) && (offset < 128));
+
+    *site = (uint8_t) offset;
+}
+
+/** Branch if not equal to the stop exit */
+static uint8_t *emit_flag_check(jit_code_t *code, const bool *flag)
+{
+    /* mov rax, flag */
+    EMIT(code, 0x48, 0xb8);
+    emit64(code, (uint64_t) (uintptr_t) flag);
+
+    /* cmp byte [rax], 0 */
+    EMIT(code, 0x80, 0x38, 0x00);
+
+    /* jne stop */
+    return emit_jcc8(code, 0x75);
+}
+
+/** Call the interpreter implementation of an instruction */
+static void emit_call(jit_code_t *code, const rv_decoded_t *instr,
+        uint32_t pc, unsigned int index, const atomic_uint *generation,
+        unsigned int generation_value)
+{
+    emit_store_imm(code, PC_DISP, pc);
+    emit_store_imm(code, PC_NEXT_DISP, pc + 4);
+
+    /* mov rdi, rbx */
+    EMIT(code, 0x48, 0x89, 0xdf);
+
+    /* mov rsi, instr */
+    EMIT(code, 0x48, 0xbe);
+    emit64(code, (uint64_t) (uintptr_t) instr);
+
+    /* mov rax, func; call rax */
+    EMIT(code, 0x48, 0xb8);
+    emit64(code, (uint64_t) (uintptr_t) instr->func);
+    EMIT(code, 0xff, 0xd0);
+
+    /* x0 is always 0 */
+    emit_store_imm(code, REG_DISP(0), 0);
+
+    /* cmp eax, rv_exc_none */
+    emit8(code, 0x3d);
+    emit32(code, (uint32_t) rv_exc_none);
+    uint8_t *no_exception = emit_jcc8(code, 0x74);
+
+    /* mov [r12], eax */
+    EMIT(code, 0x41, 0x89, 0x04, 0x24);
+    emit_exit(code, index);
+
+    patch_jcc8(code, no_exception);
+
+    /* Memory accesses might stop the simulation or overwrite the block */
+    switch (instr->data.r.opcode) {
+    case rv_opcLOAD:
+    case rv_opcSTORE: {
+        uint8_t *halt = emit_flag_check(code, &machine_halt);
+        uint8_t *interactive = emit_flag_check(code, &machine_interactive);
+
+        /* mov rax, generation; cmp dword [rax], generation_value */
+        EMIT(code, 0x48, 0xb8);
+        emit64(code, (uint64_t) (uintptr_t) generation);
+        EMIT(code, 0x81, 0x38);
+        emit32(code, generation_value);
+        uint8_t *fresh = emit_jcc8(code, 0x74);
+
+        patch_jcc8(code, halt);
+        patch_jcc8(code, interactive);
+        emit_exit(code, index + 1);
+
+        patch_jcc8(code, fresh);
+        break;
+    }
+    default:
+        break;
+    }
+}
+
+/** Translate an instruction with an immediate operand inline
+ *
+ * @return False if the instruction has to be called.
+ *
+ */
+static bool emit_op_imm(jit_code_t *code, const rv_decoded_t *instr)
+{
+    uint32_t imm = (uint32_t) instr->imm;
+    unsigned int funct7 = instr->data.r.funct7;
+
+    /* Validate the shift encodings first */
+    switch (instr->data.i.funct3) {
+    case rv_func_SLLI:
+        if (funct7 != 0) {
+            return false;
+        }
+        break;
+    case rv_func_SRI:
+        if ((funct7 != rv_SRLI) && (funct7 != rv_SRAI)) {
+            return false;
+        }
+        break;
+    default:
+        break;
+    }
+
+    if (instr->rd == 0) {
+        return true;
+    }
+
+    emit_load_eax(code, instr->rs1);
+
+    switch (instr->data.i.funct3) {
+    case rv_func_ADDI:
+        emit8(code, 0x05);
+        emit32(code, imm);
+        break;
+    case rv_func_SLTI:
+        emit8(code, 0x3d);
+        emit32(code, imm);
+        emit_setcc(code, 0x9c);
+        break;
+    case rv_func_SLTIU:
+        emit8(code, 0x3d);
+        emit32(code, imm);
+        emit_setcc(code, 0x92);
+        break;
+    case rv_func_XORI:
+        emit8(code, 0x35);
+        emit32(code, imm);
+        break;
+    case rv_func_ORI:
+        emit8(code, 0x0d);
+        emit32(code, imm);
+        break;
+    case rv_func_ANDI:
+        emit8(code, 0x25);
+        emit32(code, imm);
+        break;
+    case rv_func_SLLI:
+        EMIT(code, 0xc1, 0xe0, imm & 0x1f);
+        break;
+    case rv_func_SRI:
+        EMIT(code, 0xc1, (funct7 == rv_SRAI) ? 0xf8 : 0xe8, imm & 0x1f);
+        break;
+    default:
+        ASSERT(false);
+    }
+
+    emit_store_eax(code, instr->rd);
+    return true;
+}
+
+/** Translate an instruction with register operands inline
+ *
+ * @return False if the instruction has to be called.
+ *
+ */
+static bool emit_op(jit_code_t *code, const rv_decoded_t *instr)
+{
+    rv_instr_t data = instr->data;
+    rv_op_func_t funct = (rv_op_func_t) RV_R_FUNCT(data);
+
+    /* Operation on eax and ecx */
+    uint8_t ops[6];
+    size_t ops_count;
+
+    switch (funct) {
+    case rv_func_ADD:
+        ops[0] = 0x01;
+        ops[1] = 0xc8;
+        ops_count = 2;
+        break;
+    case rv_func_SUB:
+        ops[0] = 0x29;
+        ops[1] = 0xc8;
+        ops_count = 2;
+        break;
+    case rv_func_SLL:
+        ops[0] = 0xd3;
+        ops[1] = 0xe0;
+        ops_count = 2;
+        break;
+    case rv_func_SLT:
+    case rv_func_SLTU:
+        ops[0] = 0x39;
+        ops[1] = 0xc8;
+        ops[2] = 0x0f;
+        ops[3] = (funct == rv_func_SLT) ? 0x9c : 0x92;
+        ops[4] = 0xc0;
+        ops_count = 5;
+        break;
+    case rv_func_XOR:
+        ops[0] = 0x31;
+        ops[1] = 0xc8;
+        ops_count = 2;
+        break;
+    case rv_func_SRL:
+        ops[0] = 0xd3;
+        ops[1] = 0xe8;
+        ops_count = 2;
+        break;
+    case rv_func_SRA:
+        ops[0] = 0xd3;
+        ops[1] = 0xf8;
+        ops_count = 2;
+        break;
+    case rv_func_OR:
+        ops[0] = 0x09;
+        ops[1] = 0xc8;
+        ops_count = 2;
+        break;
+    case rv_func_AND:
+        ops[0] = 0x21;
+        ops[1] = 0xc8;
+        ops_count = 2;
+        break;
+    case rv_func_MUL:
+        ops[0] = 0x0f;
+        ops[1] = 0xaf;
+        ops[2] = 0xc1;
+        ops_count = 3;
+        break;
+    default:
+        /* Divisions and high multiplications */
+        return false;
+    }
+
+    if (instr->rd == 0) {
+        return true;
+    }
+
+    emit_load_eax(code, instr->rs1);
+    emit_load_ecx(code, instr->rs2);
+    emit_bytes(code, ops_count, ops);
+
+    if ((funct == rv_func_SLT) || (funct == rv_func_SLTU)) {
+        /* movzx eax, al */
+        EMIT(code, 0x0f, 0xb6, 0xc0);
+    }
+
+    emit_store_eax(code, instr->rd);
+    return true;
+}
+
+/** Translate a conditional branch inline
+ *
+ * @return False if the instruction has to be called.
+ *
+ */
+static bool emit_branch(jit_code_t *code, const rv_decoded_t *instr, uint32_t pc)
+{
+    uint32_t target = pc + (uint32_t) instr->imm;
+
+    if (!IS_ALIGNED(target, 4)) {
+        return false;
+    }
+
+    /* Condition for not taking the branch */
+    uint8_t skip;
+
+    switch (instr->data.b.funct3) {
+    case rv_func_BEQ:
+        skip = 0x75;
+        break;
+    case rv_func_BNE:
+        skip = 0x74;
+        break;
+    case rv_func_BLT:
+        skip = 0x7d;
+        break;
+    case rv_func_BGE:
+        skip = 0x7c;
+        break;
+    case rv_func_BLTU:
+        skip = 0x73;
+        break;
+    case rv_func_BGEU:
+        skip = 0x72;
+        break;
+    default:
+        return false;
+    }
+
+    emit_load_eax(code, instr->rs1);
+
+    /* cmp eax, [rbx + regs[rs2]] */
+    EMIT(code, 0x3b, 0x83);
+    emit32(code, REG_DISP(instr->rs2));
+
+    emit_store_imm(code, PC_NEXT_DISP, pc + 4);
+    uint8_t *not_taken = emit_jcc8(code, skip);
+    emit_store_imm(code, PC_NEXT_DISP, target);
+    patch_jcc8(code, not_taken);
+
+    return true;
+}
+
+/** Translate a jump inline
+ *
+ * @return False if the instruction has to be called.
+ *
+ */
+static bool emit_jal(jit_code_t *code, const rv_decoded_t *instr, uint32_t pc)
+{
+    uint32_t target = pc + (uint32_t) instr->imm;
+
+    if (!IS_ALIGNED(target, 4)) {
+        return false;
+    }
+
+    if (instr->rd != 0) {
+        emit_store_imm(code, REG_DISP(instr->rd), pc + 4);
+    }
+
+    emit_store_imm(code, PC_NEXT_DISP, target);
+    return true;
+}
+
+/** Check whether a block can be translated
+ *
+ * System instructions (which form blocks of their own)
+ * and atomic instructions are left to the interpreter.
+ *
+ */
+static bool translatable(const rv_decoded_t *instrs)
+{
+    for (unsigned int i = 0; i < instrs->block; i++) {
+        switch (instrs[i].data.r.opcode) {
+        case rv_opcSYSTEM:
+        case rv_opcAMO:
+            return false;
+        default:
+            break;
+        }
+    }
+
+    return true;
+}
+
+/** Translate a basic block
+ *
+ */
+static rv32_jit_block_t translate(decode_page_t *page, ptr36_t phys,
+        uint32_t pc, const rv_decoded_t *instrs)
+{
+    unsigned int count = instrs->block;
+    const atomic_uint *generation = &page->frame->generations[FRAME_LINE(phys)];
+    unsigned int generation_value = physmem_line_generation(page->frame, phys);
+
+    /* The called implementations get copies of the decoded instructions */
+    rv32_cpu_decode_block((rv_decoded_t *) instrs);
+    rv_decoded_t *block_copies = &copies[copies_used];
+    memcpy(block_copies, instrs, count * sizeof(rv_decoded_t));
+    copies_used += count;
+
+    uint8_t *start = arena + arena_used;
+    jit_code_t code = {
+        .pos = start
+    };
+
+    /* Epilogue: pop r13; pop r12; pop rbx; ret */
+    code.epilogue = code.pos;
+    EMIT(&code, 0x41, 0x5d, 0x41, 0x5c, 0x5b, 0xc3);
+
+    /* Prologue: push rbx; push r12; push r13; mov rbx, rdi; mov r12, rsi */
+    uint8_t *entry = code.pos;
+    EMIT(&code, 0x53, 0x41, 0x54, 0x41, 0x55);
+    EMIT(&code, 0x48, 0x89, 0xfb, 0x49, 0x89, 0xf4);
+
+    bool pc_next_set = false;
+
+    for (unsigned int i = 0; i < count; i++) {
+        const rv_decoded_t *instr = &block_copies[i];
+        uint32_t instr_pc = pc + i * sizeof(rv_instr_t);
+        bool inlined;
+
+        switch (instr->data.r.opcode) {
+        case rv_opcOP_IMM:
+            inlined = emit_op_imm(&code, instr);
+            pc_next_set = false;
+            break;
+        case rv_opcOP:
+            inlined = emit_op(&code, instr);
+            pc_next_set = false;
+            break;
+        case rv_opcLUI:
+        case rv_opcAUIPC:
+            if (instr->rd != 0) {
+                uint32_t value = (uint32_t) instr->imm;
+
+                if (instr->data.r.opcode == rv_opcAUIPC) {
+                    value += instr_pc;
+                }
+
+                emit_store_imm(&code, REG_DISP(instr->rd), value);
+            }
+
+            inlined = true;
+            pc_next_set = false;
+            break;
+        case rv_opcBRANCH:
+            inlined = emit_branch(&code, instr, instr_pc);
+            pc_next_set = true;
+            break;
+        case rv_opcJAL:
+            inlined = emit_jal(&code, instr, instr_pc);
+            pc_next_set = true;
+            break;
+        default:
+            inlined = false;
+            break;
+        }
+
+        if (!inlined) {
+            emit_call(&code, instr, instr_pc, i, generation, generation_value);
+            pc_next_set = true;
+        }
+    }
+
+    uint32_t last_pc = pc + (count - 1) * sizeof(rv_instr_t);
+
+    emit_store_imm(&code, PC_DISP, last_pc);
+    if (!pc_next_set) {
+        emit_store_imm(&code, PC_NEXT_DISP, last_pc + 4);
+    }
+
+    emit_exit(&code, count);
+
+    ASSERT((size_t) (code.pos - start) <= JIT_BLOCK_MAX_SIZE);
+    arena_used = ALIGN_UP((size_t) (code.pos - arena), 16);
+
+    return (rv32_jit_block_t) (void *) entry;
+}
+
+static void entry_reset(jit_entry_t *entry, ptr36_t phys, uint32_t pc,
+        unsigned int epoch, unsigned int generation)
+{
+    entry->phys = phys;
+    entry->pc = pc;
+    entry->epoch = epoch;
+    entry->generation = generation;
+    entry->count = 0;
+    entry->untranslatable = false;
+    entry->code = NULL;
+}
+
+/** Get the translation of a basic block
+ *
+ * Counts the executions of the block and translates it
+ * once it gets hot.
+ *
+ * @param page   Page of decoded instructions containing the block.
+ * @param epoch  Current epoch of the decoded instruction cache.
+ * @param phys   Physical address of the block.
+ * @param pc     Virtual address of the block.
+ * @param instrs Decoded instructions of the block.
+ *
+ * @return The translated block or NULL if the block is to be interpreted.
+ *
+ */
+rv32_jit_block_t rv32_jit_get(decode_page_t *page, unsigned int epoch,
+        ptr36_t phys, uint32_t pc, const rv_decoded_t *instrs)
+{
+    if (!jit_init()) {
+        return NULL;
+    }
+
+    unsigned int generation = physmem_line_generation(page->frame, phys);
+    jit_entry_t *entry = &table[(phys / sizeof(rv_instr_t)) & (JIT_TABLE_SIZE - 1)];
+
+    if ((entry->phys != phys) || (entry->pc != pc) || (entry->epoch != epoch)
+            || (entry->generation != generation)) {
+        entry_reset(entry, phys, pc, epoch, generation);
+    }
+
+    if ((entry->code != NULL) || (entry->untranslatable)) {
+        return entry->code;
+    }
+
+    entry->count++;
+    if (entry->count < JIT_HOT_THRESHOLD) {
+        return NULL;
+    }
+
+    if (!translatable(instrs)) {
+        entry->untranslatable = true;
+        return NULL;
+    }
+
+    if ((arena_used + JIT_BLOCK_MAX_SIZE > JIT_ARENA_SIZE)
+            || (copies_used + instrs->block > JIT_COPIES_COUNT)) {
+        /* Start over with an empty translation memory */
+        jit_flush();
+        entry_reset(entry, phys, pc, epoch, generation);
+    }
+
+    uint8_t *block = arena + arena_used;
+    if (!arena_protect(block, true)) {
+        entry->untranslatable = true;
+        return NULL;
+    }
+
+    rv32_jit_block_t code = translate(page, phys, pc, instrs);
+
+    /* The pages are left writable on failure, the block cannot be used */
+    if (!arena_protect(block, false)) {
+        alert("Unable to protect the translated code, binary translation disabled");
+        rv32_jit_done();
+        arena_failed = true;
+        return NULL;
+    }
+
+    entry->code = code;
+    return entry->code;
+}
+
+/** Release the translated code
+ *
+ */
+void rv32_jit_done(void)
+{
+    if (arena != NULL) {
+        munmap(arena, JIT_ARENA_SIZE);
+        arena = NULL;
+        arena_used = 0;
+    }
+
+    safe_free(table);
+    safe_free(copies);
+}
+
+#else
+
+rv32_jit_block_t rv32_jit_get(decode_page_t *page, unsigned int epoch,
+        ptr36_t phys, uint32_t pc, const rv_decoded_t *instrs)
+{
+    return NULL;
+}
+
+void rv32_jit_done(void)
+{
+}
+
+#endif
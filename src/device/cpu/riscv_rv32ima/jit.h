@@ -0,0 +1,38 @@
+/*
+ * Copyright (c) 2026 Matus Jurcak
+ * All rights reserved.
+ *
+ * Distributed under the terms of GPL.
+ *
+ *
+ *  RISC-V RV32IMA binary translation
+ *
+ */
+
+#ifndef RISCV_RV32IMA_JIT_H_
+#define RISCV_RV32IMA_JIT_H_
+
+#include <stdint.h>
+
+#include "../decode_cache.h"
+#include "cpu.h"
+
+/** Generic types */
+#include "../riscv_rv_ima/instr.h"
+
+/** Translated basic block
+ *
+ * Executes the block like the interpreter would, stopping at the
+ * first exception (stored to ex) or when the simulation is to be
+ * interrupted. PC and PC next are set to the last executed instruction.
+ *
+ * @return Number of instructions retired.
+ *
+ */
+typedef unsigned int (*rv32_jit_block_t)(rv32_cpu_t *cpu, rv_exc_t *ex);
+
+extern rv32_jit_block_t rv32_jit_get(decode_page_t *page, unsigned int epoch,
+        ptr36_t phys, uint32_t pc, const rv_decoded_t *instrs);
+extern void rv32_jit_done(void);
+
+#endif // RISCV_RV32IMA_JIT_H_
@@ -1,139 +1,201 @@
 #include <inttypes.h>
+#include <stdlib.h>
 #include <string.h>
 
 #include "../../../assert.h"
 #include "../../../utils.h"
 #include "tlb.h"
 
+/** Minimal number of entries of a TLB set */
+#define RV_TLB_WAYS 4
+
 typedef struct rv32_tlb_entry {
-    item_t item; // Item to be used in LRU or free-list
+    bool valid;
     sv32_pte_t pte;
     uint32_t vpn;
     unsigned asid;
     bool global;
     bool megapage;
+    uint64_t used; // Time of the last use (for the LRU replacement)
 } rv32_tlb_entry_t;
 
+/** Returns the virtual page number of the address for the given page size */
+static inline uint32_t virt_vpn(uint32_t virt, bool megapage)
+{
+    return virt >> (megapage ? RV_MEGAPAGESIZE : RV_PAGESIZE);
+}
+
+/** Returns the first entry of the set caching the given virtual page number
+ *
+ * The entries are distributed evenly among the sets, the set ends where
+ * the following set starts.
+ */
+static inline rv32_tlb_entry_t *set_start(rv32_tlb_t *tlb, size_t set)
+{
+    return &tlb->entries[(set * tlb->size) / tlb->sets];
+}
+
+static inline size_t vpn_set(rv32_tlb_t *tlb, uint32_t vpn)
+{
+    return vpn & (tlb->sets - 1);
+}
+
+/** Looks up the entry holding a mapping of the virtual page number of the given page size */
+static rv32_tlb_entry_t *probe(rv32_tlb_t *tlb, unsigned asid, uint32_t vpn, bool megapage)
+{
+    size_t set = vpn_set(tlb, vpn);
+    rv32_tlb_entry_t *end = set_start(tlb, set + 1);
+
+    for (rv32_tlb_entry_t *entry = set_start(tlb, set); entry < end; entry++) {
+        if ((!entry->valid) || (entry->vpn != vpn) || (entry->megapage != megapage)) {
+            continue;
+        }
+
+        // Skip non-global mappings with wrong asid
+        if (!entry->global && entry->asid != asid) {
+            continue;
+        }
+
+        return entry;
+    }
+
+    return NULL;
+}
+
+/** Looks up the entry holding a mapping of the virtual address
+ * gives priority to megapage mappings
+ */
+static rv32_tlb_entry_t *lookup(rv32_tlb_t *tlb, unsigned asid, uint32_t virt)
+{
+    rv32_tlb_entry_t *entry = probe(tlb, asid, virt_vpn(virt, true), true);
+
+    if (entry == NULL) {
+        entry = probe(tlb, asid, virt_vpn(virt, false), false);
+    }
+
+    return entry;
+}
+
 /** Caches a mapping into the TLB */
 extern void rv32_tlb_add_mapping(rv32_tlb_t *tlb, unsigned asid, uint32_t virt, sv32_pte_t pte, bool megapage, bool global)
 {
-
+    uint32_t vpn = virt_vpn(virt, megapage);
+    size_t set = vpn_set(tlb, vpn);
+    rv32_tlb_entry_t *end = set_start(tlb, set + 1);
     rv32_tlb_entry_t *entry = NULL;
 
-    if (!is_empty(&tlb->free_list)) {
-        // If there are some unused entries, use them first
-
-        item_t *popped_free_item = tlb->free_list.head;
-        list_remove(&tlb->free_list, popped_free_item);
-        // Safe cast because the item is the first field
-        entry = (rv32_tlb_entry_t *) popped_free_item;
-    } else {
-        // If all entries are used, reuse the Least Recently Used entry from the used list
+    // Use an unused entry of the set first, otherwise reuse the Least Recently Used one
+    for (rv32_tlb_entry_t *candidate = set_start(tlb, set); candidate < end; candidate++) {
+        if (!candidate->valid) {
+            entry = candidate;
+            break;
+        }
 
-        item_t *popped_reused_item = tlb->lru_list.tail;
-        list_remove(&tlb->lru_list, popped_reused_item);
-        // Safe cast because the item is the first field
-        entry = (rv32_tlb_entry_t *) popped_reused_item;
+        if ((entry == NULL) || (candidate->used < entry->used)) {
+            entry = candidate;
+        }
     }
 
     ASSERT(entry != NULL);
 
+    if (entry->valid) {
+        tlb->generation++;
+    }
+
+    entry->valid = true;
     entry->pte = pte;
     entry->megapage = megapage;
-    entry->vpn = virt >> (megapage ? RV_MEGAPAGESIZE : RV_PAGESIZE);
+    entry->vpn = vpn;
     entry->asid = asid;
     entry->global = global;
-
-    // Push to front of LRU list
-    list_push(&tlb->lru_list, &entry->item);
+    entry->used = ++tlb->clock;
 }
 
-static void move_lru_entry_to_front(rv32_tlb_t *tlb, rv32_tlb_entry_t *entry)
+/** Retrieves a cached mapping
+ * gives priority to megapage mappings
+ */
+extern bool rv32_tlb_get_mapping(rv32_tlb_t *tlb, unsigned asid, uint32_t virt, sv32_pte_t *pte, bool *megapage, bool noisy)
 {
+    rv32_tlb_entry_t *entry = lookup(tlb, asid, virt);
+
+    if (entry == NULL) {
+        return false;
+    }
 
-    // Fast path exit
-    if (tlb->lru_list.head == &entry->item) {
-        return;
+    if (noisy) {
+        // Ensure LRU behavior
+        entry->used = ++tlb->clock;
     }
 
-    ASSERT(entry->item.list == &tlb->lru_list);
+    *pte = entry->pte;
+    *megapage = entry->megapage;
 
-    // Move entry to the front of the list by first removing it and then pushing it to the front
-    list_remove(&tlb->lru_list, &entry->item);
-    list_push(&tlb->lru_list, &entry->item);
+    return true;
 }
 
-/** Returns whether the given TLB entry holds a mapping of the specified virtual address */
-static bool entry_maps_virt(rv32_tlb_entry_t *entry, uint32_t virt)
+/** Invalidates all cached non-leaf PTEs */
+static void flush_walk_cache(rv32_tlb_t *tlb)
 {
-    uint32_t vpn = virt >> RV_PAGESIZE;
-    uint32_t mvpn = virt >> RV_MEGAPAGESIZE;
-    return entry->vpn == (entry->megapage ? mvpn : vpn);
+    memset(tlb->walk_cache, 0, sizeof(tlb->walk_cache));
 }
 
-/** Retrieves a cached mapping
- * gives priority to megapage mappings
+/** Retrieves a cached non-leaf PTE of a page walk
+ *
+ * The cached PTEs are dropped whenever satp changes.
  */
-extern bool rv32_tlb_get_mapping(rv32_tlb_t *tlb, unsigned asid, uint32_t virt, sv32_pte_t *pte, bool *megapage, bool noisy)
+extern bool rv32_tlb_get_walk(rv32_tlb_t *tlb, uint32_t satp, uint32_t vpn, sv32_pte_t *pte)
 {
+    if (tlb->walk_satp != satp) {
+        flush_walk_cache(tlb);
+        tlb->walk_satp = satp;
+        return false;
+    }
 
-    rv32_tlb_entry_t *entry;
-
-    for_each(tlb->lru_list, entry, rv32_tlb_entry_t)
-    {
-
-        // Skip non-global mappings with wrong asid
-        if (!entry->global && entry->asid != asid) {
-            continue;
-        }
-
-        if (entry_maps_virt(entry, virt)) {
+    rv32_walk_entry_t *entry = &tlb->walk_cache[vpn % RV_WALK_CACHE_SIZE];
 
-            if (noisy) {
-                // Ensure LRU behavior, by moving the entry to the front of the LRU list on access
-                move_lru_entry_to_front(tlb, entry);
-            }
+    if ((!entry->valid) || (entry->vpn != vpn)) {
+        return false;
+    }
 
-            *pte = entry->pte;
-            *megapage = entry->megapage;
+    *pte = entry->pte;
+    return true;
+}
 
-            return true;
-        }
+/** Caches a non-leaf PTE of a page walk */
+extern void rv32_tlb_add_walk(rv32_tlb_t *tlb, uint32_t satp, uint32_t vpn, sv32_pte_t pte)
+{
+    if (tlb->walk_satp != satp) {
+        flush_walk_cache(tlb);
+        tlb->walk_satp = satp;
     }
 
-    return false;
+    rv32_walk_entry_t *entry = &tlb->walk_cache[vpn % RV_WALK_CACHE_SIZE];
+
+    entry->valid = true;
+    entry->vpn = vpn;
+    entry->pte = pte;
 }
 
 static void invalidate_tlb_entry(rv32_tlb_t *tlb, rv32_tlb_entry_t *entry)
 {
-    ASSERT(entry->item.list == &tlb->lru_list);
+    ASSERT(entry->valid);
 
-    list_remove(&tlb->lru_list, &entry->item);
-    list_push(&tlb->free_list, &entry->item);
+    entry->valid = false;
+
+    tlb->generation++;
 }
 
 static bool is_entry_valid(rv32_tlb_t *tlb, rv32_tlb_entry_t *entry)
 {
-    return entry->item.list == &tlb->lru_list;
+    return entry->valid;
 }
 
 extern void rv32_tlb_remove_mapping(rv32_tlb_t *tlb, unsigned asid, uint32_t virt)
 {
+    rv32_tlb_entry_t *entry = lookup(tlb, asid, virt);
 
-    rv32_tlb_entry_t *entry;
-
-    for_each(tlb->lru_list, entry, rv32_tlb_entry_t)
-    {
-
-        // Skip non-global mappings with wrong asid
-        if (!entry->global && entry->asid != asid) {
-            continue;
-        }
-
-        if (entry_maps_virt(entry, virt)) {
-            invalidate_tlb_entry(tlb, entry);
-            return;
-        }
+    if (entry != NULL) {
+        invalidate_tlb_entry(tlb, entry);
     }
 }
 
@@ -142,6 +204,8 @@ extern void rv32_tlb_remove_mapping(rv32_tlb_t *tlb, unsigned asid, uint32_t vir
 // Invalidates all entries
 extern void rv32_tlb_flush(rv32_tlb_t *tlb)
 {
+    flush_walk_cache(tlb);
+
     for (size_t i = 0; i < tlb->size; ++i) {
         if (is_entry_valid(tlb, &tlb->entries[i])) {
             invalidate_tlb_entry(tlb, &tlb->entries[i]);
@@ -152,6 +216,8 @@ extern void rv32_tlb_flush(rv32_tlb_t *tlb)
 // Invalidates all entries of the given asid
 extern void rv32_tlb_flush_by_asid(rv32_tlb_t *tlb, unsigned asid)
 {
+    flush_walk_cache(tlb);
+
     for (size_t i = 0; i < tlb->size; ++i) {
 
         if (!is_entry_valid(tlb, &tlb->entries[i])) {
@@ -167,60 +233,56 @@ extern void rv32_tlb_flush_by_asid(rv32_tlb_t *tlb, unsigned asid)
     }
 }
 
-// Invalidates all entries that map the given virtual address
-extern void rv32_tlb_flush_by_addr(rv32_tlb_t *tlb, uint32_t virt)
+/** Invalidates the entries of the given page size that map the address
+ * and are of the given asid (or all of them if any_asid is set)
+ */
+static void flush_vpn(rv32_tlb_t *tlb, uint32_t virt, bool megapage, unsigned asid, bool any_asid)
 {
-    uint32_t vpn = virt >> RV_PAGESIZE;
-    uint32_t mvpn = virt >> RV_MEGAPAGESIZE;
-
-    for (size_t i = 0; i < tlb->size; ++i) {
+    uint32_t vpn = virt_vpn(virt, megapage);
+    size_t set = vpn_set(tlb, vpn);
+    rv32_tlb_entry_t *end = set_start(tlb, set + 1);
 
-        if (!is_entry_valid(tlb, &tlb->entries[i])) {
+    for (rv32_tlb_entry_t *entry = set_start(tlb, set); entry < end; entry++) {
+        if ((!entry->valid) || (entry->vpn != vpn) || (entry->megapage != megapage)) {
             continue;
         }
 
-        if (tlb->entries[i].megapage) {
-            if (tlb->entries[i].vpn == mvpn) {
-                invalidate_tlb_entry(tlb, &tlb->entries[i]);
-            }
-        } else {
-            if (tlb->entries[i].vpn == vpn) {
-                invalidate_tlb_entry(tlb, &tlb->entries[i]);
-            }
+        if ((any_asid) || ((!entry->global) && (entry->asid == asid))) {
+            invalidate_tlb_entry(tlb, entry);
         }
     }
 }
 
-// Invalidates all entries that map the given address and are of the given asid
-extern void rv32_tlb_flush_by_asid_and_addr(rv32_tlb_t *tlb, unsigned asid, uint32_t virt)
+// Invalidates all entries that map the given virtual address
+extern void rv32_tlb_flush_by_addr(rv32_tlb_t *tlb, uint32_t virt)
 {
-    uint32_t vpn = virt >> RV_PAGESIZE;
-    uint32_t mvpn = virt >> RV_MEGAPAGESIZE;
+    flush_walk_cache(tlb);
 
-    for (size_t i = 0; i < tlb->size; ++i) {
+    flush_vpn(tlb, virt, false, 0, true);
+    flush_vpn(tlb, virt, true, 0, true);
+}
 
-        if (!is_entry_valid(tlb, &tlb->entries[i])) {
-            continue;
-        }
+// Invalidates all entries that map the given address and are of the given asid
+extern void rv32_tlb_flush_by_asid_and_addr(rv32_tlb_t *tlb, unsigned asid, uint32_t virt)
+{
+    flush_walk_cache(tlb);
 
-        if (tlb->entries[i].global) {
-            continue;
-        }
+    flush_vpn(tlb, virt, false, asid, false);
+    flush_vpn(tlb, virt, true, asid, false);
+}
 
-        if (tlb->entries[i].asid != asid) {
-            continue;
-        }
+/** Allocates the (empty) entries of the TLB */
+static void alloc_entries(rv32_tlb_t *tlb, size_t size)
+{
+    tlb->entries = safe_malloc(size * sizeof(rv32_tlb_entry_t));
+    tlb->size = size;
+    tlb->sets = 1;
 
-        if (tlb->entries[i].megapage) {
-            if (tlb->entries[i].vpn == mvpn) {
-                invalidate_tlb_entry(tlb, &tlb->entries[i]);
-            }
-        } else {
-            if (tlb->entries[i].vpn == vpn) {
-                invalidate_tlb_entry(tlb, &tlb->entries[i]);
-            }
-        }
+    while (tlb->sets * 2 * RV_TLB_WAYS <= size) {
+        tlb->sets *= 2;
     }
+
+    memset(tlb->entries, 0, size * sizeof(rv32_tlb_entry_t));
 }
 
 /** Initializes the TLB data structure */
@@ -228,16 +290,11 @@ extern void rv32_tlb_init(rv32_tlb_t *tlb, size_t size)
 {
     ASSERT(size != 0);
 
-    tlb->entries = safe_malloc(size * sizeof(rv32_tlb_entry_t));
-    tlb->size = size;
-    list_init(&tlb->lru_list);
-    list_init(&tlb->free_list);
-
-    memset(tlb->entries, 0, size * sizeof(rv32_tlb_entry_t));
-
-    for (size_t i = 0; i < size; ++i) {
-        list_append(&tlb->free_list, &tlb->entries[i].item);
-    }
+    alloc_entries(tlb, size);
+    flush_walk_cache(tlb);
+    tlb->clock = 0;
+    tlb->walk_satp = 0;
+    tlb->generation = 0;
 }
 
 /** Cleans up the TLB structure */
@@ -248,17 +305,11 @@ extern void rv32_tlb_done(rv32_tlb_t *tlb)
 
 extern bool rv32_tlb_resize(rv32_tlb_t *tlb, size_t size)
 {
-    safe_free(tlb->entries);
-    tlb->entries = safe_malloc(size * sizeof(rv32_tlb_entry_t));
-    tlb->size = size;
-    list_init(&tlb->lru_list);
-    list_init(&tlb->free_list);
-
-    memset(tlb->entries, 0, size * sizeof(rv32_tlb_entry_t));
+    tlb->generation++;
 
-    for (size_t i = 0; i < size; ++i) {
-        list_append(&tlb->free_list, &tlb->entries[i].item);
-    }
+    safe_free(tlb->entries);
+    alloc_entries(tlb, size);
+    flush_walk_cache(tlb);
 
     return true;
 }
@@ -273,6 +324,15 @@ static inline void dump_tlb_entry(rv32_tlb_entry_t entry, string_t *text)
             entry.megapage ? "T" : "F");
 }
 
+/** Orders the entries from the most recently used one */
+static int compare_entries_lru(const void *a, const void *b)
+{
+    const rv32_tlb_entry_t *entry_a = *((const rv32_tlb_entry_t **) a);
+    const rv32_tlb_entry_t *entry_b = *((const rv32_tlb_entry_t **) b);
+
+    return (entry_a->used < entry_b->used) - (entry_a->used > entry_b->used);
+}
+
 extern void rv32_tlb_dump(rv32_tlb_t *tlb)
 {
     string_t s_text;
@@ -281,25 +341,27 @@ extern void rv32_tlb_dump(rv32_tlb_t *tlb)
     printf("TLB    size: %ld entries\n", tlb->size);
     printf("%8s: %10s => %-11s [ %s ]\n", "index", "virt", "phys", "info");
 
-    bool printed = false;
+    rv32_tlb_entry_t **entries = safe_malloc(tlb->size * sizeof(rv32_tlb_entry_t *));
+    size_t count = 0;
 
-    rv32_tlb_entry_t *entry;
-    size_t i = 0;
+    for (size_t i = 0; i < tlb->size; ++i) {
+        if (is_entry_valid(tlb, &tlb->entries[i])) {
+            entries[count++] = &tlb->entries[i];
+        }
+    }
 
-    for_each(tlb->lru_list, entry, rv32_tlb_entry_t)
-    {
-        printed = true;
+    qsort(entries, count, sizeof(rv32_tlb_entry_t *), compare_entries_lru);
 
+    for (size_t i = 0; i < count; ++i) {
         string_clear(&s_text);
-        dump_tlb_entry(*entry, &s_text);
+        dump_tlb_entry(*entries[i], &s_text);
         printf("%8ld: %s\n", i, s_text.str);
-
-        ++i;
     }
 
-    if (!printed) {
+    if (count == 0) {
         printf("\t Empty\n");
     }
 
+    safe_free(entries);
     string_done(&s_text);
 }
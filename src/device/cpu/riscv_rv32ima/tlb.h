@@ -16,17 +16,44 @@
 
 #define XLEN 32
 
-#include "../../../list.h"
 #include "../../../main.h"
 #include "virt_mem.h"
 
 struct rv32_tlb_entry;
 
+#define RV_WALK_CACHE_SIZE 16
+
+/** Non-leaf PTE cached by the page-walk cache */
+typedef struct {
+    bool valid;
+    uint32_t vpn; /** VPN bits translated by the PTE */
+    sv32_pte_t pte;
+} rv32_walk_entry_t;
+
+/** Set-associative TLB
+ *
+ * The entries are split into a power of two sets indexed by the low bits
+ * of the virtual page number (of the page size of the mapping). The least
+ * recently used entry of a set is replaced.
+ */
 typedef struct rv32_tlb {
     struct rv32_tlb_entry *entries;
     size_t size;
-    list_t lru_list;
-    list_t free_list;
+
+    /** Number of sets (a power of two) */
+    size_t sets;
+
+    /** Time of the last use of an entry (for the LRU replacement) */
+    uint64_t clock;
+
+    /** Page-walk cache of the non-leaf PTEs (direct-mapped by the VPN) */
+    rv32_walk_entry_t walk_cache[RV_WALK_CACHE_SIZE];
+
+    /** The satp the non-leaf PTEs are cached for */
+    uint32_t walk_satp;
+
+    /** Incremented whenever a mapping is removed (e.g. by a flush) */
+    unsigned int generation;
 } rv32_tlb_t;
 
 #define DEFAULT_RV_TLB_SIZE 48
@@ -37,6 +64,12 @@ extern void rv32_tlb_add_mapping(rv32_tlb_t *tlb, unsigned asid, uint32_t virt,
 /** Retrieves a cached mapping, giving priority to megapage mappings */
 extern bool rv32_tlb_get_mapping(rv32_tlb_t *tlb, unsigned asid, uint32_t virt, sv32_pte_t *pte, bool *megapage, bool noisy);
 
+/** Retrieves a cached non-leaf PTE of a page walk */
+extern bool rv32_tlb_get_walk(rv32_tlb_t *tlb, uint32_t satp, uint32_t vpn, sv32_pte_t *pte);
+
+/** Caches a non-leaf PTE of a page walk */
+extern void rv32_tlb_add_walk(rv32_tlb_t *tlb, uint32_t satp, uint32_t vpn, sv32_pte_t pte);
+
 /** Removes the first mapping that matches the given address and is global or has the right ASID */
 extern void rv32_tlb_remove_mapping(rv32_tlb_t *tlb, unsigned asid, uint32_t virt);
 
@@ -10,6 +10,7 @@
  *
  */
 
+#include <stdatomic.h>
 #include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
@@ -19,7 +20,9 @@
 #include "../../../list.h"
 #include "../../../main.h"
 #include "../../../physmem.h"
+#include "../../../smp.h"
 #include "../../../utils.h"
+#include "../decode_cache.h"
 #include "cpu.h"
 #include "csr.h"
 #include "tlb.h"
@@ -31,45 +34,15 @@
 
 /// Caching of decoded instructions
 
-/**
- * @brief Item of a list of pages of cached instructions
- */
-typedef struct {
-    item_t item; // The list item
-    ptr36_t addr; // The base address of the page
-    rv_instr_func_t instrs[FRAME_SIZE / sizeof(rv_instr_t)]; // Decoded instructions (represented as function pointers)
-} cache_item_t;
-
 #define PHYS2CACHEINSTR(phys) (((phys) & FRAME_MASK) / sizeof(rv_instr_t))
 
-static void cache_item_init(cache_item_t *cache_item)
-{
-    item_init(&cache_item->item);
-    cache_item->addr = 0;
-    // Skip instrs init
-}
-
-list_t rv64_instruction_cache = LIST_INITIALIZER;
+static void cache_page_decode(decode_page_t *page, ptr36_t start, len36_t size);
+static void cache_page_decode_ahead(decode_page_t *page, ptr36_t start, len36_t size);
 
-/**
- * @brief Looks into cache for the instruction on the given physical address
- * @par phys The physical address to check
- * @par cache_item A pointer to a found cache_item_t will be stored here on success
- * @returns Whether the address is in the cache
- */
-static bool cache_hit(ptr36_t phys, cache_item_t **cache_item)
-{
-    ptr36_t target_page = ALIGN_DOWN(phys, FRAME_SIZE);
-    cache_item_t *c;
-    for_each(rv64_instruction_cache, c, cache_item_t)
-    {
-        if (c->addr == target_page) {
-            *cache_item = c;
-            return true;
-        }
-    }
-    return false;
-}
+/** Pages of decoded instructions (represented as function pointers) */
+static decode_cache_t rv64_instruction_cache = DECODE_CACHE_INITIALIZER("rv64",
+        (FRAME_SIZE / sizeof(rv_instr_t)) * sizeof(rv_decoded_t), cache_page_decode,
+        cache_page_decode_ahead);
 
 static void init_regs(rv64_cpu_t *cpu)
 {
@@ -97,6 +70,8 @@ void rv64_cpu_init(rv64_cpu_t *cpu, unsigned int procno)
     rv64_tlb_init(&cpu->tlb, DEFAULT_RV64_TLB_SIZE);
 
     cpu->priv_mode = rv_mmode;
+
+    decode_cache_register(&rv64_instruction_cache);
 }
 
 /**
@@ -105,11 +80,9 @@ void rv64_cpu_init(rv64_cpu_t *cpu, unsigned int procno)
 void rv64_cpu_done(rv64_cpu_t *cpu)
 {
     // Clean whole cache for simplicity whenever any cpu is done
-    while (!is_empty(&rv64_instruction_cache)) {
-        cache_item_t *cache_item = (cache_item_t *) (rv64_instruction_cache.head);
-        list_remove(&rv64_instruction_cache, &cache_item->item);
-        safe_free(cache_item);
-    }
+    cpu->fetch_cache = NULL;
+    cpu->fetch_tlb.valid = false;
+    decode_cache_done(&rv64_instruction_cache);
 
     rv64_tlb_done(&cpu->tlb);
 }
@@ -218,43 +191,32 @@ static rv_exc_t rv64_pagewalk(rv64_cpu_t *cpu, uint64_t virt, ptr55_t *phys, boo
     uint64_t vpn2 = (virt & 0x007FC0000000ULL) >> 30; // Bits 30-38
     uint64_t ppn = rv_csr_satp_ppn(cpu);
 
-    ptr55_t a = ((ptr55_t) ppn) << RV64_PAGESIZE;
-    ptr55_t pte_addr = a + vpn2 * RV64_PTESIZE;
-
-    // PMP or PMA check goes here if implemented
-    uint64_t pte_val = physmem_read64(cpu->csr.mhartid, pte_addr, noisy);
+    uint64_t vpn[3] = { vpn0, vpn1, vpn2 };
 
-    sv39_pte_t pte = sv39_pte_from_uint(pte_val);
+    // VPN bits translated by the non-leaf PTE of a level and the PTEs above it
+    uint64_t walk_vpn[3] = { 0, (vpn2 << 9) | vpn1, vpn2 };
 
-    if (!sv39_is_pte_valid(pte)) {
-        return page_fault_exception;
-    }
+    ptr55_t a = ((ptr55_t) ppn) << RV64_PAGESIZE;
+    ptr55_t pte_addr;
+    uint64_t pte_val;
+    sv39_pte_t pte;
 
-    sv39_page_type_t page_type;
+    unsigned level = 2;
     bool is_global = false;
 
-    if (sv39_is_pte_leaf(pte)) {
-        // First level
-        // Gigapage
-
-        // Misaligned gigapage, both PPN0 and PPN1 must be zero
-        if (sv39_pte_ppn0(pte) != 0 || sv39_pte_ppn1(pte) != 0) {
-            return page_fault_exception;
+    // Continue the walk below the deepest non-leaf PTE in the page-walk cache
+    for (unsigned cached = 1; cached <= 2; cached++) {
+        if (rv64_tlb_get_walk(&cpu->tlb, cpu->csr.satp, cached, walk_vpn[cached], &pte, &is_global)) {
+            a = sv39_pte_ppn_phys(pte);
+            level = cached - 1;
+            break;
         }
+    }
 
-        page_type = gigapage;
-        is_global = pte.g;
-    } else {
-        // Second level
-        // Non leaf PTE, make second translation step
+    while (true) {
+        pte_addr = a + vpn[level] * RV64_PTESIZE;
 
         // PMP or PMA check goes here if implemented
-        a = sv39_pte_ppn_phys(pte);
-        pte_addr = a + vpn1 * RV64_PTESIZE;
-
-        // Global non-leaf PTE implies that the translation is global
-        is_global = pte.g;
-
         pte_val = physmem_read64(cpu->csr.mhartid, pte_addr, noisy);
         pte = sv39_pte_from_uint(pte_val);
 
@@ -262,38 +224,45 @@ static rv_exc_t rv64_pagewalk(rv64_cpu_t *cpu, uint64_t virt, ptr55_t *phys, boo
             return page_fault_exception;
         }
 
-        if (sv39_is_pte_leaf(pte)) {
-            // This is a megapage
-
-            if (sv39_pte_ppn0(pte) != 0) {
-                return page_fault_exception;
-            }
+        // The translation is global if any PTE of the walk is global
+        is_global |= pte.g;
 
-            page_type = megapage;
-            is_global |= pte.g;
-        } else {
-            // Third level
-
-            is_global |= pte.g;
+        if (sv39_is_pte_leaf(pte)) {
+            break;
+        }
 
-            a = sv39_pte_ppn_phys(pte);
-            pte_addr = a + vpn0 * RV64_PTESIZE;
+        // Non-leaf page on last level means bad ):
+        if (level == 0) {
+            return page_fault_exception;
+        }
 
-            pte_val = physmem_read64(cpu->csr.mhartid, pte_addr, noisy);
-            pte = sv39_pte_from_uint(pte_val);
+        // Non leaf PTE, make next translation step
+        rv64_tlb_add_walk(&cpu->tlb, cpu->csr.satp, level, walk_vpn[level], pte, is_global);
 
-            if (!sv39_is_pte_valid(pte)) {
-                return page_fault_exception;
-            }
+        a = sv39_pte_ppn_phys(pte);
+        level--;
+    }
 
-            // Non-leaf page on last level means bad ):
-            if (!sv39_is_pte_leaf(pte)) {
-                return page_fault_exception;
-            }
+    sv39_page_type_t page_type;
 
-            page_type = page;
-            is_global |= pte.g;
+    switch (level) {
+    case 2:
+        // Misaligned gigapage, both PPN0 and PPN1 must be zero
+        if (sv39_pte_ppn0(pte) != 0 || sv39_pte_ppn1(pte) != 0) {
+            return page_fault_exception;
+        }
+        page_type = gigapage;
+        break;
+    case 1:
+        // Misaligned megapage
+        if (sv39_pte_ppn0(pte) != 0) {
+            return page_fault_exception;
         }
+        page_type = megapage;
+        break;
+    default:
+        page_type = page;
+        break;
     }
 
     if (!rv64_is_access_allowed(cpu, pte, wr, fetch)) {
@@ -394,90 +363,199 @@ rv_exc_t rv64_convert_addr(rv64_cpu_t *cpu, virt_t virt, ptr36_t *phys, bool wr,
 #include "instr.c"
 
 /**
- * @brief Fills the cache_item instrs field with decoded data based on the addr field
+ * @brief Decodes an instruction stored by cache_page_decode()
+ *
+ * The operands are stored before the implementation, so that
+ * parallel processors calling the implementation find them decoded.
+ *
+ * @returns The implementation of the instruction
+ */
+static rv_instr_func_t decode_resolve(rv_decoded_t *instr)
+{
+    rv_decoded_t decoded = rv_decode_operands(instr->data);
+
+    instr->imm = decoded.imm;
+    instr->rd = decoded.rd;
+    instr->rs1 = decoded.rs1;
+    instr->rs2 = decoded.rs2;
+    instr->length = decoded.length;
+
+    rv_instr_func_t func = rv64_instr_decode(instr->data);
+    atomic_thread_fence(memory_order_release);
+    instr->func = func;
+
+    return func;
+}
+
+/**
+ * @brief Decodes an instruction on its first execution
+ *
+ * The decoded instruction is patched, so that its next executions
+ * call the implementation directly.
+ */
+static rv_exc_t decode_lazy(rv_cpu_t *cpu, const rv_decoded_t *instr)
+{
+    /* The record lives in a page of decoded instructions */
+    rv_instr_func_t func = decode_resolve((rv_decoded_t *) instr);
+
+    return func(cpu, instr);
+}
+
+/**
+ * @brief Fills the page with instructions read from memory
+ *
+ * Only the instruction words are stored, the instructions are decoded
+ * on their first execution (see decode_lazy()) and the blocks of a line
+ * on the first entry to any of them (see line_blocks()).
  */
-static void cache_item_page_decode(rv64_cpu_t *cpu, cache_item_t *cache_item)
+static void cache_page_decode(decode_page_t *page, ptr36_t start, len36_t size)
 {
-    for (size_t i = 0; i < FRAME_SIZE / sizeof(rv_instr_t); ++i) {
-        ptr36_t addr = cache_item->addr + (i * sizeof(rv_instr_t));
-        rv_instr_t instr_data = (rv_instr_t) physmem_read32(cpu->csr.mhartid, addr, false);
-        cache_item->instrs[i] = rv64_instr_decode(instr_data);
+    rv_decoded_t *instrs = decode_page_data(page, rv_decoded_t);
+    uint32_t words[FRAME_SIZE / sizeof(rv_instr_t)];
+    size_t count = size / sizeof(rv_instr_t);
+
+    physmem_frame_read32(page->frame, start, words, count);
+
+    for (size_t i = 0; i < count; i++) {
+        rv_decoded_t *instr = &instrs[PHYS2CACHEINSTR(start) + i];
+        instr->func = decode_lazy;
+        instr->data = (rv_instr_t) words[i];
+        instr->block = 0;
     }
 }
 
 /**
- * @brief Updates the cache item to represent the data in memory
+ * @brief Computes the blocks of the line containing the address
+ *
+ * Blocks do not cross the lines, which are decoded independently.
  */
-static void update_cache_item(rv64_cpu_t *cpu, cache_item_t *cache_item)
+static void line_blocks(decode_page_t *page, ptr36_t phys)
 {
-    frame_t *frame = physmem_find_frame(cache_item->addr);
-    ASSERT(frame != NULL);
+    rv_decoded_t *instrs = decode_page_data(page, rv_decoded_t);
 
-    if (frame->valid) {
-        return;
+    rv_decode_blocks(&instrs[PHYS2CACHEINSTR(ALIGN_DOWN(phys, FRAME_LINE_SIZE))],
+            FRAME_LINE_SIZE / sizeof(rv_instr_t));
+}
+
+/**
+ * @brief Fills the page with instructions decoded ahead of their execution
+ *
+ * Used for the pages of a profile (see decode_cache_profile_load()).
+ */
+static void cache_page_decode_ahead(decode_page_t *page, ptr36_t start, len36_t size)
+{
+    rv_decoded_t *instrs = decode_page_data(page, rv_decoded_t);
+
+    cache_page_decode(page, start, size);
+
+    for (size_t i = 0; i < size / sizeof(rv_instr_t); i++) {
+        decode_resolve(&instrs[PHYS2CACHEINSTR(start) + i]);
     }
 
-    cache_item_page_decode(cpu, cache_item);
+    for (ptr36_t line = start; line < start + size; line += FRAME_LINE_SIZE) {
+        line_blocks(page, line);
+    }
+}
 
-    frame->valid = true;
-    return;
+/**
+ * @brief Updates the cached page to represent the data in memory
+ */
+static void update_cache_page(rv64_cpu_t *cpu, decode_page_t *page, ptr36_t phys)
+{
+    /* Only the line of the fetched instruction is decoded again */
+    if (decode_page_refresh(page, phys)) {
+        cache_page_decode(page, ALIGN_DOWN(phys, FRAME_LINE_SIZE), FRAME_LINE_SIZE);
+    }
 }
 
 /**
- * @brief Tries to add a new entry to the cache based on the given address
+ * @brief Tries to add a new page to the cache based on the given address
  *
- * @return cache_item_t* the added intem or NULL, if the address does not lead to valid memory area
+ * @return decode_page_t* the added page or NULL, if the address does not lead to valid memory area
  */
-static cache_item_t *cache_try_add(rv64_cpu_t *cpu, ptr36_t phys)
+static decode_page_t *cache_try_add(rv64_cpu_t *cpu, ptr36_t phys)
 {
     frame_t *frame = physmem_find_frame(phys);
     if (frame == NULL) {
         return NULL;
     }
 
-    cache_item_t *cache_item = safe_malloc(sizeof(cache_item_t));
+    return decode_cache_add(&rv64_instruction_cache, frame, phys);
+}
 
-    cache_item_init(cache_item);
-    cache_item->addr = ALIGN_DOWN(phys, FRAME_SIZE);
+/**
+ * @brief Fethes a page of decoded instructions from memory
+ *
+ * Consults the cache first and updates the cache on misses or on invalid memory
+ *
+ * @return decode_page_t* the page or NULL, if the address does not lead to valid memory area
+ */
+static decode_page_t *cache_fetch_instr(rv64_cpu_t *cpu, ptr36_t phys)
+{
+    decode_page_t *page = decode_cache_find(&rv64_instruction_cache, phys);
 
-    list_push(&rv64_instruction_cache, &cache_item->item);
+    if (page != NULL) {
+        update_cache_page(cpu, page, phys);
+    } else {
+        page = cache_try_add(cpu, phys);
+    }
 
-    cache_item_page_decode(cpu, cache_item);
+    if (page != NULL) {
+        cpu->fetch_cache = page;
+        cpu->fetch_epoch = rv64_instruction_cache.epoch;
+    }
 
-    frame->valid = true;
-    return cache_item;
+    return page;
 }
 
 /**
- * @brief Fethes a decoded instruction from memory
+ * @brief Fetches the page of decoded instructions containing the address
  *
- * Consults the cache first and updates the cache on misses or on invalid memory
+ * Repeated fetches from the same page bypass the cache lookup
+ * as long as the line of the instruction has not been written to.
+ *
+ * @return decode_page_t* the page or NULL, if the address does not lead to valid memory area
  */
-static rv_instr_func_t fetch_instr(rv64_cpu_t *cpu, ptr36_t phys)
+static decode_page_t *fetch_page(rv64_cpu_t *cpu, ptr36_t phys)
 {
-    cache_item_t *cache_item = NULL;
+    decode_page_t *page = (decode_page_t *) cpu->fetch_cache;
+
+    if ((!decode_cache_valid(&rv64_instruction_cache, page, cpu->fetch_epoch, ALIGN_DOWN(phys, FRAME_SIZE))) || (!decode_page_fresh(page, phys))) {
+        /* The instruction cache is shared by all processors */
+        smp_lock();
+        page = cache_fetch_instr(cpu, phys);
+        smp_unlock();
+    }
 
-    if (cache_hit(phys, &cache_item)) {
-        ASSERT(cache_item != NULL);
-        update_cache_item(cpu, cache_item);
+    return page;
+}
 
-        // Move item to front of list on hit
+/**
+ * @brief Fetches a pre-decoded instruction
+ */
+static void fetch_instr(rv64_cpu_t *cpu, ptr36_t phys, rv_decoded_t *instr)
+{
+    decode_page_t *page = fetch_page(cpu, phys);
 
-        if (rv64_instruction_cache.head != &cache_item->item) {
-            list_remove(&rv64_instruction_cache, &cache_item->item);
-            list_push(&rv64_instruction_cache, &cache_item->item);
-        }
+    if (page == NULL) {
+        alert("Trying to fetch instructions from outside of physical memory");
+        rv_instr_t instr_data = (rv_instr_t) physmem_read32(cpu->csr.mhartid, phys, true);
+        *instr = rv_decode_operands(instr_data);
+        instr->func = rv64_instr_decode(instr_data);
+        return;
+    }
 
-        return cache_item->instrs[PHYS2CACHEINSTR(phys)];
+    rv_decoded_t *decoded = &decode_page_data(page, rv_decoded_t)[PHYS2CACHEINSTR(phys)];
+    if (decoded->func == decode_lazy) {
+        decode_resolve(decoded);
     }
 
-    cache_item = cache_try_add(cpu, phys);
+    *instr = *decoded;
 
-    if (cache_item != NULL) {
-        return cache_item->instrs[PHYS2CACHEINSTR(phys)];
+    /* Instruction fetches are subject to memory breakpoints */
+    if (page->frame->breakpoints_count > 0) {
+        physmem_read32(cpu->csr.mhartid, phys, true);
     }
-    alert("Trying to fetch instructions from outside of physical memory");
-    return rv64_instr_decode((rv_instr_t) physmem_read32(cpu->csr.mhartid, phys, true));
 }
 
 /**
@@ -697,51 +775,45 @@ static void try_handle_interrupt(rv64_cpu_t *cpu)
 }
 
 /**
- * @brief Increases the HPM counters based in the event specifying CSRs
+ * @brief Checks whether an interrupt would be trapped in the next step
  *
- * @param cpu The cpu on which these counters are
- * @param i The index of the HPM in range [0..29)
+ * Side-effect free counterpart of try_handle_interrupt
  */
-static void account_hmp(rv64_cpu_t *cpu, int i)
+static bool interrupt_ready(rv64_cpu_t *cpu)
 {
-    ASSERT((i >= 0 && i < 29));
+    uint64_t mip = cpu->csr.mip
+            | (cpu->csr.external_SEIP ? rv_csr_sei_mask : 0)
+            | (cpu->csr.external_STIP ? rv_csr_sti_mask : 0);
 
-    uint64_t mask = (1 << (i + 3));
-    bool inhibited = cpu->csr.mcountinhibit & mask;
+    bool can_trap_to_M = (cpu->priv_mode == rv_mmode && rv_csr_mstatus_mie(cpu)) || (cpu->priv_mode < rv_mmode);
+    if (can_trap_to_M && (mip & cpu->csr.mie & ~cpu->csr.mideleg & rv_csr_mi_mask)) {
+        return true;
+    }
+
+    bool can_trap_to_S = (cpu->priv_mode == rv_smode && rv_csr_sstatus_sie(cpu)) || (cpu->priv_mode < rv_smode);
+    return can_trap_to_S && (mip & cpu->csr.mie & rv_csr_si_mask);
+}
 
-    if (inhibited) {
+/**
+ * @brief Account the cycles to the events of the active HPM counters
+ *
+ * The cycles are accounted to the event of the current privilege mode
+ * (and to the wait cycles while in standby). The counters themselves
+ * are updated only when they are accessed (see rv_csr_hpm_update).
+ *
+ * @param cycles The number of cycles to account
+ */
+static void account_hpm(rv64_cpu_t *cpu, uint64_t cycles)
+{
+    if (cpu->csr.hpm_active == 0) {
         return;
     }
 
-    rv_csr_hpm_event_t event = cpu->csr.hpmevents[i];
+    // The U, S and M mode cycle events follow the privilege mode encoding
+    cpu->csr.hpm_event_cycles[hpm_u_cycles + cpu->priv_mode] += cycles;
 
-    switch (event) {
-    case (hpm_u_cycles): {
-        if (cpu->priv_mode == rv_umode) {
-            cpu->csr.hpmcounters[i]++;
-        }
-        break;
-    }
-    case (hpm_s_cycles): {
-        if (cpu->priv_mode == rv_smode) {
-            cpu->csr.hpmcounters[i]++;
-        }
-        break;
-    }
-    case (hpm_m_cycles): {
-        if (cpu->priv_mode == rv_mmode) {
-            cpu->csr.hpmcounters[i]++;
-        }
-        break;
-    }
-    case (hpm_w_cycles): {
-        if (cpu->stdby) {
-            cpu->csr.hpmcounters[i]++;
-        }
-        break;
-    }
-    default:
-        break;
+    if (cpu->stdby) {
+        cpu->csr.hpm_event_cycles[hpm_w_cycles] += cycles;
     }
 }
 
@@ -759,37 +831,160 @@ static void manage_timer_interrupts(rv64_cpu_t *cpu)
 }
 
 /**
- * @brief Increase the counter CSRs and raise timer interrupts if desired
+ * @brief Advances mtime by the accounted cycles
+ *
+ * In the virtual time mode, mtime ticks (in milliseconds) once per
+ * machine_time_frequency cycles. Otherwise mtime follows the host
+ * time, which is sampled only once per RV_HOST_TIME_SAMPLE_CYCLES
+ * cycles (or when forced).
+ *
+ * @param cycles The number of cycles to account
+ * @param sample Sample the host time regardless of the cycles
  */
-static void account(rv64_cpu_t *cpu, bool instruction_retired)
+static void update_mtime(rv64_cpu_t *cpu, uint64_t cycles, bool sample)
 {
-    if (!(cpu->csr.mcountinhibit & 0b001)) {
-        cpu->csr.cycle++;
+    cpu->csr.time_cycles += cycles;
+
+    if (machine_time_frequency != 0) {
+        if (cpu->csr.time_cycles >= machine_time_frequency) {
+            cpu->csr.mtime += cpu->csr.time_cycles / machine_time_frequency;
+            cpu->csr.time_cycles %= machine_time_frequency;
+        }
+
+        return;
+    }
+
+    if ((!sample) && (cpu->csr.time_cycles < RV_HOST_TIME_SAMPLE_CYCLES)) {
+        return;
     }
 
-    // mtime cannot be inhibited
     uint64_t current_tick_time = current_timestamp();
     cpu->csr.mtime += (current_tick_time - cpu->csr.last_tick_time);
     cpu->csr.last_tick_time = current_tick_time;
+    cpu->csr.time_cycles = 0;
+}
 
-    if (!(cpu->csr.mcountinhibit & 0b100) && instruction_retired) {
-        cpu->csr.instret++;
+/**
+ * @brief Bring mtime up to date in the middle of a block
+ *
+ * The cycles of a block are accounted at its end (see execute_block).
+ * In the virtual time mode, the instructions of the current block
+ * executed so far are accounted to mtime already and deducted from
+ * time_cycles, so that they are not counted twice at the end of the block.
+ */
+void rv64_cpu_sync_mtime(rv64_cpu_t *cpu)
+{
+    ASSERT(cpu != NULL);
+
+    if ((machine_time_frequency == 0) || (!cpu->run_block)) {
+        return;
     }
 
-    for (int i = 0; i < 29; ++i) {
-        account_hmp(cpu, i);
+    uint64_t pending = (uint64_t) (cpu->pc - cpu->run_block_pc) / sizeof(rv_instr_t);
+    uint64_t cycles = cpu->csr.time_cycles + pending;
+
+    cpu->csr.mtime += cycles / machine_time_frequency;
+    cpu->csr.time_cycles = cycles % machine_time_frequency - pending;
+}
+
+/**
+ * @brief Get the number of cycles until mtime reaches mtimecmp
+ *
+ * Defined only in the virtual time mode.
+ *
+ * @returns The number of cycles (UINT64_MAX if mtime has already reached
+ *          mtimecmp or if the number of cycles does not fit)
+ */
+static uint64_t mtime_deadline_cycles(rv64_cpu_t *cpu)
+{
+    ASSERT(machine_time_frequency != 0);
+
+    if (cpu->csr.mtime >= cpu->csr.mtimecmp) {
+        return UINT64_MAX;
+    }
+
+    uint64_t ticks = cpu->csr.mtimecmp - cpu->csr.mtime;
+    if (ticks > UINT64_MAX / machine_time_frequency) {
+        return UINT64_MAX;
+    }
+
+    return ticks * machine_time_frequency - cpu->csr.time_cycles;
+}
+
+/**
+ * @brief Increase the counter CSRs and raise timer interrupts if desired
+ *
+ * @param cycles The number of cycles to account
+ * @param retired The number of instructions retired in these cycles
+ */
+static void account(rv64_cpu_t *cpu, uint64_t cycles, uint64_t retired)
+{
+    if (!(cpu->csr.mcountinhibit & 0b001)) {
+        cpu->csr.cycle += cycles;
+    }
+
+    // mtime cannot be inhibited
+    update_mtime(cpu, cycles, false);
+
+    if (!(cpu->csr.mcountinhibit & 0b100)) {
+        cpu->csr.instret += retired;
     }
 
+    account_hpm(cpu, cycles);
+
     manage_timer_interrupts(cpu);
 }
 
+/**
+ * @brief Translate the address of the instruction PC is pointing to
+ *
+ * The translation of the page of the last fetch is kept in the fetch
+ * micro-TLB, so that the instructions of the same page are fetched
+ * without looking up the TLB again. The micro-TLB is invalidated
+ * whenever the translation might change, i.e. when the privilege mode,
+ * mstatus or satp changes or when a mapping is removed from the TLB.
+ *
+ * @param noisy Shall the translation change the processor and global state
+ */
+static rv_exc_t fetch_translate(rv64_cpu_t *cpu, ptr36_t *phys, bool noisy)
+{
+    rv64_fetch_tlb_t *ftlb = &cpu->fetch_tlb;
+    virt_t virt = ALIGN_DOWN(cpu->pc, FRAME_SIZE);
+
+    if ((ftlb->valid) && (ftlb->virt == virt)
+            && (ftlb->priv_mode == cpu->priv_mode)
+            && (ftlb->mstatus == cpu->csr.mstatus)
+            && (ftlb->satp == cpu->csr.satp)
+            && (ftlb->tlb_generation == cpu->tlb.generation)) {
+        *phys = ftlb->phys + (cpu->pc - virt);
+        return rv_exc_none;
+    }
+
+    rv_exc_t ex = rv_convert_addr(cpu, cpu->pc, phys, false, true, noisy);
+
+    if (ex != rv_exc_none) {
+        ftlb->valid = false;
+        return ex;
+    }
+
+    ftlb->valid = true;
+    ftlb->virt = virt;
+    ftlb->phys = ALIGN_DOWN(*phys, FRAME_SIZE);
+    ftlb->priv_mode = cpu->priv_mode;
+    ftlb->mstatus = cpu->csr.mstatus;
+    ftlb->satp = cpu->csr.satp;
+    ftlb->tlb_generation = cpu->tlb.generation;
+
+    return rv_exc_none;
+}
+
 /**
  * @brief Execute the instruction that PC is pointing to and handle interrupts or exceptions
  */
 static rv_exc_t execute(rv64_cpu_t *cpu)
 {
     ptr36_t phys;
-    rv_exc_t ex = rv_convert_addr(cpu, cpu->pc, &phys, false, true, true);
+    rv_exc_t ex = fetch_translate(cpu, &phys, true);
 
     if (ex != rv_exc_none) {
         alert("Fetching from unconvertable address!");
@@ -799,18 +994,26 @@ static rv_exc_t execute(rv64_cpu_t *cpu)
         return ex;
     }
 
-    rv_instr_func_t instr_func = fetch_instr(cpu, phys);
-    rv_instr_t instr_data = (rv_instr_t) physmem_read32(cpu->csr.mhartid, phys, true);
+    rv_decoded_t instr;
+    fetch_instr(cpu, phys, &instr);
 
     // if (machine_trace) {
-    //     rv64_idump(cpu, cpu->pc, instr_data);
+    //     rv64_idump(cpu, cpu->pc, instr.data);
     // }
 
-    // TODO: Fix this ugly hack
-    ex = instr_func((void *) cpu, instr_data);
+    if (instr.data.r.opcode == rv_opcAMO) {
+        /* Atomic read-modify-write and LR/SC bookkeeping */
+        physmem_exclusive_begin();
+        // TODO: Fix this ugly hack
+        ex = instr.func((void *) cpu, &instr);
+        physmem_exclusive_end();
+    } else {
+        // TODO: Fix this ugly hack
+        ex = instr.func((void *) cpu, &instr);
+    }
 
     if (ex == rv_exc_illegal_instruction) {
-        cpu->csr.tval_next = instr_data.val;
+        cpu->csr.tval_next = instr.data.val;
     }
 
     return ex;
@@ -838,7 +1041,7 @@ void rv64_cpu_step(rv64_cpu_t *cpu)
         try_handle_interrupt(cpu);
     }
 
-    account(cpu, instruction_retired);
+    account(cpu, 1, instruction_retired ? 1 : 0);
 
     if (!cpu->stdby) {
         cpu->pc = cpu->pc_next;
@@ -850,6 +1053,226 @@ void rv64_cpu_step(rv64_cpu_t *cpu)
     cpu->csr.tval_next = 0;
 }
 
+/**
+ * @brief Interpret the instructions of a basic block
+ *
+ * Stops at the first exception, when the simulation is to be interrupted
+ * or when the line of the block is written to. PC and PC next are left
+ * at the last executed instruction.
+ *
+ * @param count The number of instructions to execute
+ * @param ex The exception raised by the last executed instruction
+ * @return The number of instructions retired
+ */
+static unsigned int interpret_block(rv64_cpu_t *cpu, decode_page_t *page, ptr36_t phys,
+        const rv_decoded_t *instrs, unsigned int count, rv_exc_t *ex)
+{
+    unsigned int retired = 0;
+
+    while (true) {
+        const rv_decoded_t *instr = &instrs[retired];
+
+        if (instr->data.r.opcode == rv_opcAMO) {
+            /* Atomic read-modify-write and LR/SC bookkeeping */
+            physmem_exclusive_begin();
+            *ex = instr->func((void *) cpu, instr);
+            physmem_exclusive_end();
+        } else {
+            *ex = instr->func((void *) cpu, instr);
+        }
+
+        // x0 is always 0
+        cpu->regs[0] = 0;
+
+        if (*ex != rv_exc_none) {
+            return retired;
+        }
+
+        retired++;
+
+        /* The rest of the block might have been overwritten */
+        if ((retired == count) || (machine_halt) || (machine_interactive) || (!decode_page_fresh(page, phys))) {
+            return retired;
+        }
+
+        cpu->pc = cpu->pc_next;
+        cpu->pc_next = cpu->pc + 4;
+    }
+}
+
+/**
+ * @brief Execute the basic block PC is pointing to
+ *
+ * The instructions of the block are executed back to back, pending
+ * interrupts are checked and the counters are updated once at the end
+ * of the block.
+ *
+ * @param limit The maximal number of cycles to execute
+ * @return The number of cycles executed
+ */
+static unsigned int execute_block(rv64_cpu_t *cpu, unsigned int limit)
+{
+    ptr36_t phys;
+
+    /* The fetch fault is raised by the regular step */
+    if (fetch_translate(cpu, &phys, false) != rv_exc_none) {
+        rv64_cpu_step(cpu);
+        return 1;
+    }
+
+    decode_page_t *page = fetch_page(cpu, phys);
+
+    /* Fetches subject to memory breakpoints are checked one by one */
+    if ((page == NULL) || (page->frame->breakpoints_count > 0)) {
+        rv64_cpu_step(cpu);
+        return 1;
+    }
+
+    const rv_decoded_t *instrs = &decode_page_data(page, rv_decoded_t)[PHYS2CACHEINSTR(phys)];
+    if (instrs->block == 0) {
+        line_blocks(page, phys);
+    }
+
+    unsigned int count = (instrs->block < limit) ? instrs->block : limit;
+    unsigned int retired;
+    rv_exc_t ex = rv_exc_none;
+
+    cpu->run_block = true;
+    retired = interpret_block(cpu, page, phys, instrs, count, &ex);
+    cpu->run_block = false;
+
+    if (ex == rv_exc_illegal_instruction) {
+        cpu->csr.tval_next = instrs[retired].data.val;
+    }
+
+    unsigned int cycles = retired;
+
+    if (ex != rv_exc_none) {
+        account(cpu, retired, retired);
+        handle_exception(cpu, ex);
+        account(cpu, 1, 0);
+        cycles++;
+    } else {
+        // If any interrupts are pending, handle them
+        try_handle_interrupt(cpu);
+        account(cpu, retired, retired);
+    }
+
+    if (!cpu->stdby) {
+        cpu->pc = cpu->pc_next;
+        cpu->pc_next = cpu->pc + 4;
+    }
+
+    cpu->csr.tval_next = 0;
+
+    return cycles;
+}
+
+/**
+ * @brief Simulate the given number of cycles of the CPU
+ *
+ * Equivalent to calling rv64_cpu_step for each of the cycles, except
+ * that pending interrupts are only checked at the end of each basic
+ * block. Stops early when the simulation is to be interrupted.
+ *
+ * @returns The number of cycles simulated
+ */
+unsigned int rv64_cpu_run(rv64_cpu_t *cpu, unsigned int cycles)
+{
+    ASSERT(cpu != NULL);
+
+    unsigned int executed = 0;
+
+    while ((executed < cycles) && (!machine_halt) && (!machine_interactive)) {
+        cpu->run_cycles = executed;
+        cpu->run_block_pc = cpu->pc;
+
+        if ((cpu->stdby) || (machine_trace)) {
+            rv64_cpu_step(cpu);
+            executed++;
+        } else {
+            executed += execute_block(cpu, cycles - executed);
+        }
+    }
+
+    return executed;
+}
+
+/**
+ * @brief Get the number of cycles executed so far by rv64_cpu_run
+ *
+ * To be called while an instruction is being executed. The PC is kept
+ * at the executed instruction, so the instructions of the current block
+ * executed before are given by its distance from the start of the block.
+ */
+uint64_t rv64_cpu_run_elapsed(rv64_cpu_t *cpu)
+{
+    ASSERT(cpu != NULL);
+
+    return cpu->run_cycles + (uint64_t) (cpu->pc - cpu->run_block_pc) / sizeof(rv_instr_t);
+}
+
+/**
+ * @brief Get the number of cycles the CPU stays idle for
+ *
+ * The CPU is idle while waiting for an interrupt (WFI) which
+ * cannot be trapped yet. In the virtual time mode, the idle period
+ * ends no later than when mtime reaches mtimecmp. Otherwise mtime
+ * follows the host time, so the mtimecmp deadline cannot be expressed
+ * in cycles and the mtime is only sampled at the end of the idle period.
+ *
+ * @returns The number of cycles which can be accounted by rv64_cpu_skip
+ *          instead of stepping the CPU (0 if not idle)
+ */
+uint64_t rv64_cpu_idle_cycles(rv64_cpu_t *cpu)
+{
+    ASSERT(cpu != NULL);
+
+    if (!cpu->stdby || interrupt_ready(cpu)) {
+        return 0;
+    }
+
+    uint64_t idle = UINT64_MAX;
+
+    if (machine_time_frequency != 0) {
+        idle = mtime_deadline_cycles(cpu);
+    }
+
+    if (cpu->csr.mcountinhibit & 0b001) {
+        return idle;
+    }
+
+    // Cycles until the scyclecmp comparison changes
+    if (cpu->csr.cycle < cpu->csr.scyclecmp) {
+        return MIN(idle, cpu->csr.scyclecmp - cpu->csr.cycle);
+    }
+
+    return idle;
+}
+
+/**
+ * @brief Account idle cycles of the CPU at once
+ *
+ * Equivalent to calling rv64_cpu_step for each of the cycles, provided
+ * that their number does not exceed the value returned
+ * by rv64_cpu_idle_cycles
+ */
+void rv64_cpu_skip(rv64_cpu_t *cpu, uint64_t cycles)
+{
+    ASSERT(cpu != NULL);
+    ASSERT(cpu->stdby);
+
+    if (!(cpu->csr.mcountinhibit & 0b001)) {
+        cpu->csr.cycle += cycles;
+    }
+
+    update_mtime(cpu, cycles, true);
+
+    account_hpm(cpu, cycles);
+
+    manage_timer_interrupts(cpu);
+}
+
 /**
  * @brief Notify the CPU that an adress has been writen ti
  *
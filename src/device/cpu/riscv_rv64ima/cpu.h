@@ -19,6 +19,7 @@
 #include <stdint.h>
 
 #include "../../../main.h"
+#include "../../../physmem.h"
 #include "../riscv_rv_ima/csr.h"
 #include "../riscv_rv_ima/types.h"
 #include "tlb.h"
@@ -27,6 +28,21 @@
 
 struct rv64_tlb;
 
+/** Translation of the page of the last instruction fetch
+ *
+ * The translation is valid while the privilege mode, mstatus, satp
+ * and the TLB generation do not change.
+ */
+typedef struct {
+    bool valid;
+    virt_t virt;
+    ptr36_t phys;
+    rv_priv_mode_t priv_mode;
+    uint64_t mstatus;
+    uxlen_t satp;
+    unsigned int tlb_generation;
+} rv64_fetch_tlb_t;
+
 /** Main processor structure */
 typedef struct rv64_cpu {
     /** Non privileged registers */
@@ -56,6 +72,25 @@ typedef struct rv64_cpu {
     /** Translation Lookaside Buffer used for caching translated addresses */
     rv64_tlb_t tlb;
 
+    /** Instruction cache page of the last fetch and its cache epoch */
+    void *fetch_cache;
+    unsigned int fetch_epoch;
+
+    /** Instruction fetch micro-TLB */
+    rv64_fetch_tlb_t fetch_tlb;
+
+    /** Physical memory soft-TLB */
+    physmem_tlb_t physmem_tlb;
+
+    /** Cycles of the current run executed before the current block
+     *  and the address of the block (see rv64_cpu_run_elapsed)
+     */
+    unsigned int run_cycles;
+    uint64_t run_block_pc;
+
+    /** The block starting at run_block_pc is being executed */
+    bool run_block;
+
 } rv64_cpu_t;
 
 /** Basic CPU routines */
@@ -63,6 +98,11 @@ extern void rv64_cpu_init(rv64_cpu_t *cpu, unsigned int procno);
 extern void rv64_cpu_done(rv64_cpu_t *cpu);
 extern void rv64_cpu_set_pc(rv64_cpu_t *cpu, virt_t value);
 extern void rv64_cpu_step(rv64_cpu_t *cpu);
+extern unsigned int rv64_cpu_run(rv64_cpu_t *cpu, unsigned int cycles);
+extern uint64_t rv64_cpu_run_elapsed(rv64_cpu_t *cpu);
+extern void rv64_cpu_sync_mtime(rv64_cpu_t *cpu);
+extern uint64_t rv64_cpu_idle_cycles(rv64_cpu_t *cpu);
+extern void rv64_cpu_skip(rv64_cpu_t *cpu, uint64_t cycles);
 
 /** Interrupts */
 extern void rv64_interrupt_up(rv64_cpu_t *cpu, unsigned int no);
@@ -62,3 +62,8 @@ extern void rv64_csr_set_asid_len(rv_cpu_t *cpu, unsigned asid_len)
 
     rv64_tlb_flush(&cpu->tlb);
 }
+
+extern void rv64_csr_hpm_update(rv_cpu_t *cpu)
+{
+    rv_csr_hpm_update(cpu);
+}
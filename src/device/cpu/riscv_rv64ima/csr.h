@@ -36,4 +36,7 @@ extern enum rv_exc rv64_csr_rc(rv_cpu_t *cpu, csr_num_t csr, uint64_t value, uin
  */
 extern void rv64_csr_set_asid_len(rv_cpu_t *cpu, unsigned asid_active_bits);
 
+/** Brings the lazily updated HPM counters up to date (before dumping them) */
+extern void rv64_csr_hpm_update(rv_cpu_t *cpu);
+
 #endif
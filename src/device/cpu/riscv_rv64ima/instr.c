@@ -32,10 +32,10 @@
 
 static_assert(sizeof(uxlen_t) == sizeof(uint64_t), "XLEN is not set to 64 bits in RV64");
 
-static rv_exc_t rv64_dump_instr(rv_cpu_t *cpu, rv_instr_t instr)
+static rv_exc_t rv64_dump_instr(rv_cpu_t *cpu, const rv_decoded_t *instr)
 {
     ASSERT(cpu != NULL);
-    ASSERT(instr.i.opcode == rv_opcSYSTEM);
+    ASSERT(instr->data.i.opcode == rv_opcSYSTEM);
     alert("EDUMP: Dumping general registers");
     rv64_reg_dump(cpu);
     return rv_exc_none;
@@ -64,12 +64,12 @@ static rv_instr_func_t decode_LOAD(rv_instr_t instr)
     }
 }
 
-static rv_exc_t _rv64_csr_rd_instr(rv_cpu_t *cpu, rv_instr_t instr)
+static rv_exc_t _rv64_csr_rd_instr(rv_cpu_t *cpu, const rv_decoded_t *instr)
 {
     ASSERT(cpu != NULL);
-    ASSERT(instr.i.opcode == rv_opcSYSTEM);
+    ASSERT(instr->data.i.opcode == rv_opcSYSTEM);
     alert("ECSRD: Dump CSR");
-    uint64_t csr = cpu->regs[instr.i.rd] & 0xFFF;
+    uint64_t csr = cpu->regs[instr->rd] & 0xFFF;
 
     if (csr >= 0x1000) {
         alert("Wrong CSR number!");
@@ -79,27 +79,27 @@ static rv_exc_t _rv64_csr_rd_instr(rv_cpu_t *cpu, rv_instr_t instr)
     return rv_exc_none;
 }
 
-static rv_exc_t _rv64_sfence_instr(rv_cpu_t *cpu, rv_instr_t instr)
+static rv_exc_t _rv64_sfence_instr(rv_cpu_t *cpu, const rv_decoded_t *instr)
 {
     if (rv_csr_mstatus_tvm(cpu) || cpu->priv_mode < rv_smode) {
         return rv_exc_illegal_instruction;
     }
 
-    if (instr.r.rs1 == 0) {
-        if (instr.r.rs2 == 0) {
+    if (instr->rs1 == 0) {
+        if (instr->rs2 == 0) {
             // rs1 == x0 && rs2 == x0
             rv64_tlb_flush(&cpu->tlb);
         } else {
             // rs1 == x0 && rs2 != x0
-            rv64_tlb_flush_by_asid(&cpu->tlb, cpu->regs[instr.r.rs2] & rv_asid_mask);
+            rv64_tlb_flush_by_asid(&cpu->tlb, cpu->regs[instr->rs2] & rv_asid_mask);
         }
     } else {
-        if (instr.r.rs2 == 0) {
+        if (instr->rs2 == 0) {
             // rs1 != x0 && rs2 == x0
-            rv64_tlb_flush_by_addr(&cpu->tlb, cpu->regs[instr.r.rs1]);
+            rv64_tlb_flush_by_addr(&cpu->tlb, cpu->regs[instr->rs1]);
         } else {
             // rs1 != x0 && rs2 != x0
-            rv64_tlb_flush_by_asid_and_addr(&cpu->tlb, cpu->regs[instr.r.rs2] & rv_asid_mask, cpu->regs[instr.r.rs1]);
+            rv64_tlb_flush_by_asid_and_addr(&cpu->tlb, cpu->regs[instr->rs2] & rv_asid_mask, cpu->regs[instr->rs1]);
         }
     }
     return rv_exc_none;
@@ -1,4 +1,5 @@
 #include <inttypes.h>
+#include <stdlib.h>
 #include <string.h>
 
 #include "../../../assert.h"
@@ -6,157 +7,217 @@
 #include "tlb.h"
 #include "virt_mem.h"
 
+/** Minimal number of entries of a TLB set */
+#define RV64_TLB_WAYS 4
+
 typedef struct rv64_tlb_entry {
-    item_t item; // Item to be used in LRU or free-list
+    bool valid;
     sv39_pte_t pte;
     uint64_t vpn;
     unsigned asid;
     bool global;
     sv39_page_type_t page_type;
+    uint64_t used; // Time of the last use (for the LRU replacement)
 } rv64_tlb_entry_t;
 
+/** Returns the virtual page number of the address for the given page size */
+static inline uint64_t virt_vpn(uint64_t virt, sv39_page_type_t page_type)
+{
+    switch (page_type) {
+    case megapage:
+        return virt >> RV64_MEGAPAGESIZE;
+    case gigapage:
+        return virt >> RV64_GIGAPAGESIZE;
+    default:
+        return virt >> RV64_PAGESIZE;
+    }
+}
+
+/** Returns the first entry of the set caching the given virtual page number
+ *
+ * The entries are distributed evenly among the sets, the set ends where
+ * the following set starts.
+ */
+static inline rv64_tlb_entry_t *set_start(rv64_tlb_t *tlb, size_t set)
+{
+    return &tlb->entries[(set * tlb->size) / tlb->sets];
+}
+
+static inline size_t vpn_set(rv64_tlb_t *tlb, uint64_t vpn)
+{
+    return vpn & (tlb->sets - 1);
+}
+
+/** Looks up the entry holding a mapping of the virtual page number of the given page size */
+static rv64_tlb_entry_t *probe(rv64_tlb_t *tlb, unsigned asid, uint64_t vpn, sv39_page_type_t page_type)
+{
+    size_t set = vpn_set(tlb, vpn);
+    rv64_tlb_entry_t *end = set_start(tlb, set + 1);
+
+    for (rv64_tlb_entry_t *entry = set_start(tlb, set); entry < end; entry++) {
+        if ((!entry->valid) || (entry->vpn != vpn) || (entry->page_type != page_type)) {
+            continue;
+        }
+
+        // Skip non-global mappings with wrong asid
+        if (!entry->global && entry->asid != asid) {
+            continue;
+        }
+
+        return entry;
+    }
+
+    return NULL;
+}
+
+/** Looks up the entry holding a mapping of the virtual address
+ * gives priority to mappings of larger pages
+ */
+static rv64_tlb_entry_t *lookup(rv64_tlb_t *tlb, unsigned asid, uint64_t virt)
+{
+    rv64_tlb_entry_t *entry = probe(tlb, asid, virt_vpn(virt, gigapage), gigapage);
+
+    if (entry == NULL) {
+        entry = probe(tlb, asid, virt_vpn(virt, megapage), megapage);
+    }
+
+    if (entry == NULL) {
+        entry = probe(tlb, asid, virt_vpn(virt, page), page);
+    }
+
+    return entry;
+}
+
 /** Caches a mapping into the TLB */
 extern void rv64_tlb_add_mapping(rv64_tlb_t *tlb, unsigned asid, uint64_t virt, sv39_pte_t pte, sv39_page_type_t page_type, bool global)
 {
+    uint64_t vpn = virt_vpn(virt, page_type);
+    size_t set = vpn_set(tlb, vpn);
+    rv64_tlb_entry_t *end = set_start(tlb, set + 1);
     rv64_tlb_entry_t *entry = NULL;
 
-    if (!is_empty(&tlb->free_list)) {
-        // If there are some unused entries, use them first
-
-        item_t *popped_free_item = tlb->free_list.head;
-        list_remove(&tlb->free_list, popped_free_item);
-        // Safe cast because the item is the first field
-        entry = (rv64_tlb_entry_t *) popped_free_item;
-    } else {
-        // If all entries are used, reuse the Least Recently Used entry from the used list
-        item_t *popped_reused_item = tlb->lru_list.tail;
-        list_remove(&tlb->lru_list, popped_reused_item);
-        // Safe cast because the item is the first field
-        entry = (rv64_tlb_entry_t *) popped_reused_item;
+    // Use an unused entry of the set first, otherwise reuse the Least Recently Used one
+    for (rv64_tlb_entry_t *candidate = set_start(tlb, set); candidate < end; candidate++) {
+        if (!candidate->valid) {
+            entry = candidate;
+            break;
+        }
+
+        if ((entry == NULL) || (candidate->used < entry->used)) {
+            entry = candidate;
+        }
     }
 
     ASSERT(entry != NULL);
 
-    uint64_t vpn;
-
-    switch (page_type) {
-    case page:
-        vpn = virt >> RV64_PAGESIZE;
-        break;
-    case megapage:
-        vpn = virt >> RV64_MEGAPAGESIZE;
-        break;
-    case gigapage:
-        vpn = virt >> RV64_GIGAPAGESIZE;
-        break;
-    default:
-        return;
+    if (entry->valid) {
+        tlb->generation++;
     }
 
+    entry->valid = true;
     entry->pte = pte;
     entry->page_type = page_type;
     entry->vpn = vpn;
     entry->asid = asid;
     entry->global = global;
-
-    // Push to front of LRU list
-    list_push(&tlb->lru_list, &entry->item);
+    entry->used = ++tlb->clock;
 }
 
-static void move_lru_entry_to_front(rv64_tlb_t *tlb, rv64_tlb_entry_t *entry)
+/** Retrieves a cached mapping
+ * gives priority to mappings of larger pages
+ */
+extern bool rv64_tlb_get_mapping(rv64_tlb_t *tlb, unsigned asid, uint64_t virt, sv39_pte_t *pte, sv39_page_type_t *page_type, bool noisy)
 {
-    // Fast path exit
-    if (tlb->lru_list.head == &entry->item) {
-        return;
+    rv64_tlb_entry_t *entry = lookup(tlb, asid, virt);
+
+    if (entry == NULL) {
+        return false;
     }
 
-    ASSERT(entry->item.list == &tlb->lru_list);
+    if (noisy) {
+        // Ensure LRU behavior
+        entry->used = ++tlb->clock;
+    }
 
-    // Move entry to the front of the list by first removing it and then pushing it to the front
-    list_remove(&tlb->lru_list, &entry->item);
-    list_push(&tlb->lru_list, &entry->item);
+    *pte = entry->pte;
+    *page_type = entry->page_type;
+
+    return true;
 }
 
-/** Returns whether the given TLB entry holds a mapping of the specified virtual address */
-static bool entry_maps_virt(rv64_tlb_entry_t *entry, uint64_t virt)
+/** Invalidates all cached non-leaf PTEs */
+static void flush_walk_cache(rv64_tlb_t *tlb)
 {
-    uint64_t vpn;
-
-    switch (entry->page_type) {
-    case page:
-        vpn = virt >> RV64_PAGESIZE;
-        break;
-    case megapage:
-        vpn = virt >> RV64_MEGAPAGESIZE;
-        break;
-    case gigapage:
-        vpn = virt >> RV64_GIGAPAGESIZE;
-        break;
-    default:
-        return false;
-    }
-
-    return entry->vpn == vpn;
+    memset(tlb->walk_cache, 0, sizeof(tlb->walk_cache));
 }
 
-/** Retrieves a cached mapping
- * gives priority to megapage mappings
+/** Retrieves a cached non-leaf PTE of a page walk
+ *
+ * The cached PTEs are dropped whenever satp changes.
+ *
+ * @param level The level of the PTE (1 or 2)
+ * @param vpn The VPN bits translated by the PTE and the PTEs above it
+ * @param global Set if any PTE of the walk up to the cached one is global
  */
-extern bool rv64_tlb_get_mapping(rv64_tlb_t *tlb, unsigned asid, uint64_t virt, sv39_pte_t *pte, sv39_page_type_t *page_type, bool noisy)
+extern bool rv64_tlb_get_walk(rv64_tlb_t *tlb, uint64_t satp, unsigned level, uint64_t vpn, sv39_pte_t *pte, bool *global)
 {
-    rv64_tlb_entry_t *entry;
+    ASSERT((level == 1) || (level == 2));
 
-    for_each(tlb->lru_list, entry, rv64_tlb_entry_t)
-    {
-        // Skip non-global mappings with wrong asid
-        if (!entry->global && entry->asid != asid) {
-            continue;
-        }
+    if (tlb->walk_satp != satp) {
+        flush_walk_cache(tlb);
+        tlb->walk_satp = satp;
+        return false;
+    }
 
-        if (entry_maps_virt(entry, virt)) {
-            if (noisy) {
-                // Ensure LRU behavior, by moving the entry to the front of the LRU list on access
-                move_lru_entry_to_front(tlb, entry);
-            }
+    rv64_walk_entry_t *entry = &tlb->walk_cache[level - 1][vpn % RV64_WALK_CACHE_SIZE];
 
-            *pte = entry->pte;
-            *page_type = entry->page_type;
+    if ((!entry->valid) || (entry->vpn != vpn)) {
+        return false;
+    }
 
-            return true;
-        }
+    *pte = entry->pte;
+    *global = entry->global;
+    return true;
+}
+
+/** Caches a non-leaf PTE of a page walk */
+extern void rv64_tlb_add_walk(rv64_tlb_t *tlb, uint64_t satp, unsigned level, uint64_t vpn, sv39_pte_t pte, bool global)
+{
+    ASSERT((level == 1) || (level == 2));
+
+    if (tlb->walk_satp != satp) {
+        flush_walk_cache(tlb);
+        tlb->walk_satp = satp;
     }
 
-    return false;
+    rv64_walk_entry_t *entry = &tlb->walk_cache[level - 1][vpn % RV64_WALK_CACHE_SIZE];
+
+    entry->valid = true;
+    entry->vpn = vpn;
+    entry->pte = pte;
+    entry->global = global;
 }
 
 static void invalidate_tlb_entry(rv64_tlb_t *tlb, rv64_tlb_entry_t *entry)
 {
-    ASSERT(entry->item.list == &tlb->lru_list);
+    ASSERT(entry->valid);
 
-    list_remove(&tlb->lru_list, &entry->item);
-    list_push(&tlb->free_list, &entry->item);
+    entry->valid = false;
+
+    tlb->generation++;
 }
 
 static bool is_entry_valid(rv64_tlb_t *tlb, rv64_tlb_entry_t *entry)
 {
-    return entry->item.list == &tlb->lru_list;
+    return entry->valid;
 }
 
 extern void rv64_tlb_remove_mapping(rv64_tlb_t *tlb, unsigned asid, uint64_t virt)
 {
-    rv64_tlb_entry_t *entry;
-
-    for_each(tlb->lru_list, entry, rv64_tlb_entry_t)
-    {
-        // Skip non-global mappings with wrong asid
-        if (!entry->global && entry->asid != asid) {
-            continue;
-        }
+    rv64_tlb_entry_t *entry = lookup(tlb, asid, virt);
 
-        if (entry_maps_virt(entry, virt)) {
-            invalidate_tlb_entry(tlb, entry);
-            return;
-        }
+    if (entry != NULL) {
+        invalidate_tlb_entry(tlb, entry);
     }
 }
 
@@ -165,6 +226,8 @@ extern void rv64_tlb_remove_mapping(rv64_tlb_t *tlb, unsigned asid, uint64_t vir
 // Invalidates all entries
 extern void rv64_tlb_flush(rv64_tlb_t *tlb)
 {
+    flush_walk_cache(tlb);
+
     for (size_t i = 0; i < tlb->size; ++i) {
         if (is_entry_valid(tlb, &tlb->entries[i])) {
             invalidate_tlb_entry(tlb, &tlb->entries[i]);
@@ -175,6 +238,8 @@ extern void rv64_tlb_flush(rv64_tlb_t *tlb)
 // Invalidates all entries of the given asid
 extern void rv64_tlb_flush_by_asid(rv64_tlb_t *tlb, unsigned asid)
 {
+    flush_walk_cache(tlb);
+
     for (size_t i = 0; i < tlb->size; ++i) {
 
         if (!is_entry_valid(tlb, &tlb->entries[i])) {
@@ -190,76 +255,58 @@ extern void rv64_tlb_flush_by_asid(rv64_tlb_t *tlb, unsigned asid)
     }
 }
 
-// Invalidates all entries that map the given virtual address
-extern void rv64_tlb_flush_by_addr(rv64_tlb_t *tlb, uint64_t virt)
+/** Invalidates the entries of the given page size that map the address
+ * and are of the given asid (or all of them if any_asid is set)
+ */
+static void flush_vpn(rv64_tlb_t *tlb, uint64_t virt, sv39_page_type_t page_type, unsigned asid, bool any_asid)
 {
-    uint64_t page_vpn = virt >> RV64_PAGESIZE;
-    uint64_t mega_vpn = virt >> RV64_MEGAPAGESIZE;
-    uint64_t giga_vpn = virt >> RV64_GIGAPAGESIZE;
+    uint64_t vpn = virt_vpn(virt, page_type);
+    size_t set = vpn_set(tlb, vpn);
+    rv64_tlb_entry_t *end = set_start(tlb, set + 1);
 
-    for (size_t i = 0; i < tlb->size; ++i) {
-        if (!is_entry_valid(tlb, &tlb->entries[i])) {
+    for (rv64_tlb_entry_t *entry = set_start(tlb, set); entry < end; entry++) {
+        if ((!entry->valid) || (entry->vpn != vpn) || (entry->page_type != page_type)) {
             continue;
         }
 
-        switch (tlb->entries[i].page_type) {
-        case page:
-            if (tlb->entries[i].vpn == page_vpn) {
-                invalidate_tlb_entry(tlb, &tlb->entries[i]);
-            }
-            break;
-        case megapage:
-            if (tlb->entries[i].vpn == mega_vpn) {
-                invalidate_tlb_entry(tlb, &tlb->entries[i]);
-            }
-            break;
-        case gigapage:
-            if (tlb->entries[i].vpn == giga_vpn) {
-                invalidate_tlb_entry(tlb, &tlb->entries[i]);
-            }
-            break;
+        if ((any_asid) || ((!entry->global) && (entry->asid == asid))) {
+            invalidate_tlb_entry(tlb, entry);
         }
     }
 }
 
+// Invalidates all entries that map the given virtual address
+extern void rv64_tlb_flush_by_addr(rv64_tlb_t *tlb, uint64_t virt)
+{
+    flush_walk_cache(tlb);
+
+    flush_vpn(tlb, virt, page, 0, true);
+    flush_vpn(tlb, virt, megapage, 0, true);
+    flush_vpn(tlb, virt, gigapage, 0, true);
+}
+
 // Invalidates all entries that map the given address and are of the given asid
 extern void rv64_tlb_flush_by_asid_and_addr(rv64_tlb_t *tlb, unsigned asid, uint64_t virt)
 {
-    uint64_t page_vpn = virt >> RV64_PAGESIZE;
-    uint64_t mega_vpn = virt >> RV64_MEGAPAGESIZE;
-    uint64_t giga_vpn = virt >> RV64_GIGAPAGESIZE;
+    flush_walk_cache(tlb);
 
-    for (size_t i = 0; i < tlb->size; ++i) {
-        if (!is_entry_valid(tlb, &tlb->entries[i])) {
-            continue;
-        }
-
-        if (tlb->entries[i].global) {
-            continue;
-        }
+    flush_vpn(tlb, virt, page, asid, false);
+    flush_vpn(tlb, virt, megapage, asid, false);
+    flush_vpn(tlb, virt, gigapage, asid, false);
+}
 
-        if (tlb->entries[i].asid != asid) {
-            continue;
-        }
+/** Allocates the (empty) entries of the TLB */
+static void alloc_entries(rv64_tlb_t *tlb, size_t size)
+{
+    tlb->entries = safe_malloc(size * sizeof(rv64_tlb_entry_t));
+    tlb->size = size;
+    tlb->sets = 1;
 
-        switch (tlb->entries[i].page_type) {
-        case page:
-            if (tlb->entries[i].vpn == page_vpn) {
-                invalidate_tlb_entry(tlb, &tlb->entries[i]);
-            }
-            break;
-        case megapage:
-            if (tlb->entries[i].vpn == mega_vpn) {
-                invalidate_tlb_entry(tlb, &tlb->entries[i]);
-            }
-            break;
-        case gigapage:
-            if (tlb->entries[i].vpn == giga_vpn) {
-                invalidate_tlb_entry(tlb, &tlb->entries[i]);
-            }
-            break;
-        }
+    while (tlb->sets * 2 * RV64_TLB_WAYS <= size) {
+        tlb->sets *= 2;
     }
+
+    memset(tlb->entries, 0, size * sizeof(rv64_tlb_entry_t));
 }
 
 /** Initializes the TLB data structure */
@@ -267,16 +314,11 @@ extern void rv64_tlb_init(rv64_tlb_t *tlb, size_t size)
 {
     ASSERT(size != 0);
 
-    tlb->entries = safe_malloc(size * sizeof(rv64_tlb_entry_t));
-    tlb->size = size;
-    list_init(&tlb->lru_list);
-    list_init(&tlb->free_list);
-
-    memset(tlb->entries, 0, size * sizeof(rv64_tlb_entry_t));
-
-    for (size_t i = 0; i < size; ++i) {
-        list_append(&tlb->free_list, &tlb->entries[i].item);
-    }
+    alloc_entries(tlb, size);
+    flush_walk_cache(tlb);
+    tlb->clock = 0;
+    tlb->walk_satp = 0;
+    tlb->generation = 0;
 }
 
 /** Cleans up the TLB structure */
@@ -287,17 +329,11 @@ extern void rv64_tlb_done(rv64_tlb_t *tlb)
 
 extern bool rv64_tlb_resize(rv64_tlb_t *tlb, size_t size)
 {
-    safe_free(tlb->entries);
-    tlb->entries = safe_malloc(size * sizeof(rv64_tlb_entry_t));
-    tlb->size = size;
-    list_init(&tlb->lru_list);
-    list_init(&tlb->free_list);
+    tlb->generation++;
 
-    memset(tlb->entries, 0, size * sizeof(rv64_tlb_entry_t));
-
-    for (size_t i = 0; i < size; ++i) {
-        list_append(&tlb->free_list, &tlb->entries[i].item);
-    }
+    safe_free(tlb->entries);
+    alloc_entries(tlb, size);
+    flush_walk_cache(tlb);
 
     return true;
 }
@@ -328,6 +364,15 @@ static inline void dump_tlb_entry(rv64_tlb_entry_t entry, string_t *text)
             entry.page_type == page ? "P" : (entry.page_type == megapage ? "M" : "G"));
 }
 
+/** Orders the entries from the most recently used one */
+static int compare_entries_lru(const void *a, const void *b)
+{
+    const rv64_tlb_entry_t *entry_a = *((const rv64_tlb_entry_t **) a);
+    const rv64_tlb_entry_t *entry_b = *((const rv64_tlb_entry_t **) b);
+
+    return (entry_a->used < entry_b->used) - (entry_a->used > entry_b->used);
+}
+
 extern void rv64_tlb_dump(rv64_tlb_t *tlb)
 {
     string_t s_text;
@@ -336,25 +381,27 @@ extern void rv64_tlb_dump(rv64_tlb_t *tlb)
     printf("TLB    size: %ld entries\n", tlb->size);
     printf("%8s: %10s => %-11s [ %s ]\n", "index", "virt", "phys", "info");
 
-    bool printed = false;
+    rv64_tlb_entry_t **entries = safe_malloc(tlb->size * sizeof(rv64_tlb_entry_t *));
+    size_t count = 0;
 
-    rv64_tlb_entry_t *entry;
-    size_t i = 0;
+    for (size_t i = 0; i < tlb->size; ++i) {
+        if (is_entry_valid(tlb, &tlb->entries[i])) {
+            entries[count++] = &tlb->entries[i];
+        }
+    }
 
-    for_each(tlb->lru_list, entry, rv64_tlb_entry_t)
-    {
-        printed = true;
+    qsort(entries, count, sizeof(rv64_tlb_entry_t *), compare_entries_lru);
 
+    for (size_t i = 0; i < count; ++i) {
         string_clear(&s_text);
-        dump_tlb_entry(*entry, &s_text);
+        dump_tlb_entry(*entries[i], &s_text);
         printf("%8ld: %s\n", i, s_text.str);
-
-        ++i;
     }
 
-    if (!printed) {
+    if (count == 0) {
         printf("\t Empty\n");
     }
 
+    safe_free(entries);
     string_done(&s_text);
 }
@@ -16,17 +16,47 @@
 #include <stdbool.h>
 #include <stdint.h>
 
-#include "../../../list.h"
 #include "../../../main.h"
 #include "virt_mem.h"
 
 struct rv64_tlb_entry;
 
+#define RV64_WALK_CACHE_SIZE 16
+
+/** Non-leaf PTE cached by the page-walk cache */
+typedef struct {
+    bool valid;
+    uint64_t vpn; /** VPN bits translated by the PTE and the PTEs above it */
+    sv39_pte_t pte;
+    bool global; /** Any PTE of the walk up to this one is global */
+} rv64_walk_entry_t;
+
+/** Set-associative TLB
+ *
+ * The entries are split into a power of two sets indexed by the low bits
+ * of the virtual page number (of the page size of the mapping). The least
+ * recently used entry of a set is replaced.
+ */
 typedef struct rv64_tlb {
     struct rv64_tlb_entry *entries;
     size_t size;
-    list_t lru_list;
-    list_t free_list;
+
+    /** Number of sets (a power of two) */
+    size_t sets;
+
+    /** Time of the last use of an entry (for the LRU replacement) */
+    uint64_t clock;
+
+    /** Page-walk cache of the non-leaf PTEs of the levels 1 and 2
+     *  (direct-mapped by the VPN)
+     */
+    rv64_walk_entry_t walk_cache[2][RV64_WALK_CACHE_SIZE];
+
+    /** The satp the non-leaf PTEs are cached for */
+    uint64_t walk_satp;
+
+    /** Incremented whenever a mapping is removed (e.g. by a flush) */
+    unsigned int generation;
 } rv64_tlb_t;
 
 #define DEFAULT_RV64_TLB_SIZE 96
@@ -37,6 +67,12 @@ extern void rv64_tlb_add_mapping(rv64_tlb_t *tlb, unsigned asid, uint64_t virt,
 /** Retrieves a cached mapping, giving priority to megapage mappings */
 extern bool rv64_tlb_get_mapping(rv64_tlb_t *tlb, unsigned asid, uint64_t virt, sv39_pte_t *pte, sv39_page_type_t *page_type, bool noisy);
 
+/** Retrieves a cached non-leaf PTE of a page walk */
+extern bool rv64_tlb_get_walk(rv64_tlb_t *tlb, uint64_t satp, unsigned level, uint64_t vpn, sv39_pte_t *pte, bool *global);
+
+/** Caches a non-leaf PTE of a page walk */
+extern void rv64_tlb_add_walk(rv64_tlb_t *tlb, uint64_t satp, unsigned level, uint64_t vpn, sv39_pte_t pte, bool global);
+
 /** Removes the first mapping that matches the given address and is global or has the right ASID */
 extern void rv64_tlb_remove_mapping(rv64_tlb_t *tlb, unsigned asid, uint64_t virt);
 
@@ -12,11 +12,18 @@
 
 #pragma GCC diagnostic ignored "-Wunused-function"
 
+#include "../../../main.h"
 #include "../../../utils.h"
 #include "csr.h"
 #include "exception.h"
 #include "types.h"
 
+#if XLEN == 64
+#define rv_cpu_sync_mtime rv64_cpu_sync_mtime
+#elif XLEN == 32
+#define rv_cpu_sync_mtime rv32_cpu_sync_mtime
+#endif
+
 typedef rv_exc_t (*csr_read_func_t)(rv_cpu_t *, csr_num_t csr, uxlen_t *);
 typedef rv_exc_t (*csr_write_func_t)(rv_cpu_t *, csr_num_t csr, uxlen_t);
 typedef rv_exc_t (*csr_set_func_t)(rv_cpu_t *, csr_num_t csr, uxlen_t);
@@ -35,8 +42,9 @@ static void rv_init_csr(rv_csr_t *csr, unsigned int procno)
     csr->mimpid = RV_IMPLEMENTATION_ID;
     csr->mhartid = procno;
 
-    csr->mtime = current_timestamp();
-    csr->last_tick_time = csr->mtime;
+    // The virtual time starts at zero
+    csr->last_tick_time = current_timestamp();
+    csr->mtime = (machine_time_frequency != 0) ? 0 : csr->last_tick_time;
 
     csr->asid_len = rv_asid_len;
 }
@@ -99,6 +107,48 @@ static rv_exc_t invalid_write(rv_cpu_t *cpu, csr_num_t csr, uxlen_t value)
     return rv_exc_illegal_instruction;
 }
 
+/**
+ * @brief Brings the active HPM counters up to date
+ *
+ * The cycles are accounted to the events only, the counters are updated
+ * from the cycles of their events when they are accessed.
+ */
+static void rv_csr_hpm_update(rv_cpu_t *cpu)
+{
+    for (int i = 0; i < 29; i++) {
+        if (!(cpu->csr.hpm_active & (UINT32_C(1) << i))) {
+            continue;
+        }
+
+        uint64_t event_cycles = cpu->csr.hpm_event_cycles[cpu->csr.hpmevents[i]];
+        cpu->csr.hpmcounters[i] += event_cycles - cpu->csr.hpm_base[i];
+        cpu->csr.hpm_base[i] = event_cycles;
+    }
+}
+
+/**
+ * @brief Recomputes the mask of the active HPM counters
+ *
+ * Called after mcountinhibit or an event selector changes,
+ * the counters have to be brought up to date before the change.
+ */
+static void rv_csr_hpm_activate(rv_cpu_t *cpu)
+{
+    cpu->csr.hpm_active = 0;
+
+    for (int i = 0; i < 29; i++) {
+        rv_csr_hpm_event_t event = cpu->csr.hpmevents[i];
+
+        if ((cpu->csr.mcountinhibit & (UINT32_C(1) << (i + 3)))
+                || (event == hpm_no_event) || (event == hpm_r_cycles)) {
+            continue;
+        }
+
+        cpu->csr.hpm_active |= UINT32_C(1) << i;
+        cpu->csr.hpm_base[i] = cpu->csr.hpm_event_cycles[event];
+    }
+}
+
 #define is_counter_enabled_m(cpu, counter) (cpu->csr.mcounteren & (1 << counter))
 #define is_counter_enabled_s(cpu, counter) (cpu->csr.scounteren & (1 << counter))
 #define is_high_counter(csr) (csr & 0x080)
@@ -115,6 +165,7 @@ static inline void read_counter_csr_unchecked(rv_cpu_t *cpu, csr_num_t csr, uxle
         break;
     }
     case (csr_time & 0x1F): {
+        rv_cpu_sync_mtime(cpu);
         *target = EXTRACT_BITS(cpu->csr.mtime, offset, offset + 32);
         break;
     }
@@ -123,6 +174,7 @@ static inline void read_counter_csr_unchecked(rv_cpu_t *cpu, csr_num_t csr, uxle
         break;
     }
     default: {
+        rv_csr_hpm_update(cpu);
         uint64_t hpc = cpu->csr.hpmcounters[counter - 3];
         *target = EXTRACT_BITS(hpc, offset, offset + 32);
         break;
@@ -198,6 +250,7 @@ static rv_exc_t counter_write(rv_cpu_t *cpu, csr_num_t csr, uxlen_t value)
         break;
     }
     default: {
+        rv_csr_hpm_update(cpu);
         uint64_t hpc = cpu->csr.hpmcounters[counter - 3];
         cpu->csr.hpmcounters[counter - 3] = (hpc & mask) | val;
         break;
@@ -238,6 +291,7 @@ static rv_exc_t counter_set(rv_cpu_t *cpu, csr_num_t csr, uxlen_t value)
         break;
     }
     default: {
+        rv_csr_hpm_update(cpu);
         cpu->csr.hpmcounters[counter - 3] |= val;
         break;
     }
@@ -276,6 +330,7 @@ static rv_exc_t counter_clear(rv_cpu_t *cpu, csr_num_t csr, uxlen_t value)
         break;
     }
     default: {
+        rv_csr_hpm_update(cpu);
         cpu->csr.hpmcounters[counter - 3] &= ~val;
         break;
     }
@@ -296,21 +351,27 @@ static rv_exc_t mcountinhibit_read(rv_cpu_t *cpu, csr_num_t csr, uxlen_t *target
 static rv_exc_t mcountinhibit_write(rv_cpu_t *cpu, csr_num_t csr, uxlen_t value)
 {
     minimal_privilege(rv_mmode, cpu);
+    rv_csr_hpm_update(cpu);
     cpu->csr.mcountinhibit = value & mcountinhibit_mask;
+    rv_csr_hpm_activate(cpu);
     return rv_exc_none;
 }
 
 static rv_exc_t mcountinhibit_set(rv_cpu_t *cpu, csr_num_t csr, uxlen_t value)
 {
     minimal_privilege(rv_mmode, cpu);
+    rv_csr_hpm_update(cpu);
     cpu->csr.mcountinhibit |= value & mcountinhibit_mask;
+    rv_csr_hpm_activate(cpu);
     return rv_exc_none;
 }
 
 static rv_exc_t mcountinhibit_clear(rv_cpu_t *cpu, csr_num_t csr, uxlen_t value)
 {
     minimal_privilege(rv_mmode, cpu);
+    rv_csr_hpm_update(cpu);
     cpu->csr.mcountinhibit &= ~(value & mcountinhibit_mask);
+    rv_csr_hpm_activate(cpu);
     return rv_exc_none;
 }
 
@@ -328,7 +389,9 @@ static rv_exc_t mhpmevent_write(rv_cpu_t *cpu, csr_num_t csr, uxlen_t value)
     int event = (csr & 0x1F) - 3;
 
     if (value < hpm_event_count) {
+        rv_csr_hpm_update(cpu);
         cpu->csr.hpmevents[event] = value;
+        rv_csr_hpm_activate(cpu);
     }
     return rv_exc_none;
 }
@@ -341,7 +404,9 @@ static rv_exc_t mhpmevent_set(rv_cpu_t *cpu, csr_num_t csr, uxlen_t value)
     int val = cpu->csr.hpmevents[event] | value;
 
     if (val < hpm_event_count) {
+        rv_csr_hpm_update(cpu);
         cpu->csr.hpmevents[event] = val;
+        rv_csr_hpm_activate(cpu);
     }
     return rv_exc_none;
 }
@@ -354,7 +419,9 @@ static rv_exc_t mhpmevent_clear(rv_cpu_t *cpu, csr_num_t csr, uxlen_t value)
     int val = cpu->csr.hpmevents[event] & ~value;
 
     if (val < hpm_event_count) {
+        rv_csr_hpm_update(cpu);
         cpu->csr.hpmevents[event] = val;
+        rv_csr_hpm_activate(cpu);
     }
 
     return rv_exc_none;
@@ -393,6 +393,15 @@ typedef struct {
     /* Event selectors */
     uxlen_t hpmevents[29];
 
+    /* Lazily updated HPM counters */
+
+    // Mask of the HPM counters counting an event (and not inhibited)
+    uint32_t hpm_active;
+    // Cycles accounted to each event while any HPM counter was active
+    uint64_t hpm_event_cycles[hpm_event_count];
+    // Cycles of the event of each HPM counter at its last update
+    uint64_t hpm_base[29];
+
     /* Machine-level registers */
 
     /* information */
@@ -465,8 +474,10 @@ typedef struct {
 
     // Value of memory-mapped register mtime
     uint64_t mtime;
-    // The timestamp of the last clock cycle
+    // The host timestamp of the last mtime update
     uint64_t last_tick_time;
+    // Cycles accounted since the last mtime update
+    uint64_t time_cycles;
     // Value of memory-mapped register mtimecmp
     uint64_t mtimecmp;
 
@@ -484,6 +495,9 @@ typedef struct {
 #define RV_MTIME_ADDRESS XLEN_C(0xFF000000)
 #define RV_MTIMECMP_ADDRESS XLEN_C(0xFF000008)
 
+/** Number of cycles between the samples of the host time */
+#define RV_HOST_TIME_SAMPLE_CYCLES 1024
+
 #define RV_A_EXTENSION_BITS XLEN_C(1 << 0)
 #define RV_C_EXTENSION_BITS XLEN_C(1 << 2)
 #define RV_D_EXTENSION_BITS XLEN_C(1 << 3)
@@ -229,6 +229,124 @@ typedef enum {
 #define RV_AMO_32_WLEN 0b010
 #define RV_AMO_64_WLEN 0b011
 
-typedef enum rv_exc (*rv_instr_func_t)(rv_cpu_t *, rv_instr_t);
+typedef struct rv_decoded rv_decoded_t;
+
+typedef enum rv_exc (*rv_instr_func_t)(rv_cpu_t *, const rv_decoded_t *);
+
+/** Pre-decoded instruction
+ *
+ * The operands are extracted once when the instruction is decoded,
+ * the instruction implementations do not need to extract them
+ * from the instruction word on every execution.
+ *
+ */
+struct rv_decoded {
+    /* Instruction implementation */
+    rv_instr_func_t func;
+
+    /* Immediate operand (sign-extended, U-type immediates shifted) */
+    int32_t imm;
+
+    /* Instruction word */
+    rv_instr_t data;
+
+    /* Register operands */
+    uint8_t rd;
+    uint8_t rs1;
+    uint8_t rs2;
+
+    /* Instruction length in bytes */
+    uint8_t length;
+
+    /* Number of instructions of the block starting with the instruction
+       (zero until the blocks of the line are computed) */
+    uint8_t block;
+};
+
+/** Extract the operands of an instruction
+ *
+ * The implementation is left to the caller.
+ *
+ */
+static inline rv_decoded_t rv_decode_operands(rv_instr_t instr)
+{
+    rv_decoded_t decoded = {
+        .func = NULL,
+        .imm = 0,
+        .data = instr,
+        .rd = instr.r.rd,
+        .rs1 = instr.r.rs1,
+        .rs2 = instr.r.rs2,
+        .length = sizeof(rv_instr_t),
+        .block = 1
+    };
+
+    switch (instr.r.opcode) {
+    case rv_opcLOAD:
+    case rv_opcMISC_MEM:
+    case rv_opcOP_IMM:
+    case rv_opcOP_IMM_32:
+    case rv_opcJALR:
+    case rv_opcSYSTEM:
+        decoded.imm = instr.i.imm;
+        break;
+    case rv_opcSTORE:
+        decoded.imm = (int32_t) RV_S_IMM(instr);
+        break;
+    case rv_opcBRANCH:
+        decoded.imm = (int32_t) RV_B_IMM(instr);
+        break;
+    case rv_opcJAL:
+        decoded.imm = (int32_t) RV_J_IMM(instr);
+        break;
+    case rv_opcLUI:
+    case rv_opcAUIPC:
+        decoded.imm = (int32_t) (((uint32_t) instr.u.imm) << 12);
+        break;
+    default:
+        break;
+    }
+
+    return decoded;
+}
+
+/** Compute the basic blocks of a run of decoded instructions
+ *
+ * A block is a straight-line sequence of instructions ending with
+ * a control transfer instruction (or at the end of the run).
+ * System instructions (CSR accesses, traps, fences of the address
+ * translation, WFI) form a block of their own, as they may change
+ * the state the other instructions of the block depend on.
+ *
+ * @param instrs Decoded instructions.
+ * @param count  Number of the instructions.
+ *
+ */
+static inline void rv_decode_blocks(rv_decoded_t *instrs, size_t count)
+{
+    /* Length of the block the preceding instruction continues into */
+    unsigned int next = 0;
+
+    for (size_t i = count; i > 0; i--) {
+        rv_decoded_t *instr = &instrs[i - 1];
+
+        switch (instr->data.r.opcode) {
+        case rv_opcSYSTEM:
+            instr->block = 1;
+            next = 0;
+            break;
+        case rv_opcBRANCH:
+        case rv_opcJAL:
+        case rv_opcJALR:
+            instr->block = 1;
+            next = 1;
+            break;
+        default:
+            instr->block = next + 1;
+            next = instr->block;
+            break;
+        }
+    }
+}
 
 #endif // RISCV_RV_INSTR_H_
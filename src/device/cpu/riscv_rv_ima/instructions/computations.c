@@ -33,214 +33,214 @@ rv_exc_t rv_convert_addr(rv_cpu_t *cpu, virt_t virt, ptr36_t *phys, bool wr, boo
  * OP *
  ******/
 
-static rv_exc_t rv_add_instr(rv_cpu_t *cpu, rv_instr_t instr)
+static rv_exc_t rv_add_instr(rv_cpu_t *cpu, const rv_decoded_t *instr)
 {
     ASSERT(cpu != NULL);
-    ASSERT(instr.r.opcode == rv_opcOP);
+    ASSERT(instr->data.r.opcode == rv_opcOP);
 
-    uxlen_t lhs = cpu->regs[instr.r.rs1];
-    uxlen_t rhs = cpu->regs[instr.r.rs2];
+    uxlen_t lhs = cpu->regs[instr->rs1];
+    uxlen_t rhs = cpu->regs[instr->rs2];
 
-    cpu->regs[instr.r.rd] = lhs + rhs;
+    cpu->regs[instr->rd] = lhs + rhs;
 
     return rv_exc_none;
 }
 
 /** RV64 ONLY */
-static rv_exc_t rv_addw_instr(rv_cpu_t *cpu, rv_instr_t instr)
+static rv_exc_t rv_addw_instr(rv_cpu_t *cpu, const rv_decoded_t *instr)
 {
     ASSERT(cpu != NULL);
-    ASSERT(instr.r.opcode == rv_opcOP_32);
+    ASSERT(instr->data.r.opcode == rv_opcOP_32);
 
-    int32_t lhs = (int32_t) cpu->regs[instr.r.rs1];
-    int32_t rhs = (int32_t) cpu->regs[instr.r.rs2];
+    int32_t lhs = (int32_t) cpu->regs[instr->rs1];
+    int32_t rhs = (int32_t) cpu->regs[instr->rs2];
 
-    cpu->regs[instr.r.rd] = (int64_t) ((int32_t) (lhs + rhs));
+    cpu->regs[instr->rd] = (int64_t) ((int32_t) (lhs + rhs));
 
     return rv_exc_none;
 }
 
-static rv_exc_t rv_sub_instr(rv_cpu_t *cpu, rv_instr_t instr)
+static rv_exc_t rv_sub_instr(rv_cpu_t *cpu, const rv_decoded_t *instr)
 {
     ASSERT(cpu != NULL);
-    ASSERT(instr.r.opcode == rv_opcOP);
+    ASSERT(instr->data.r.opcode == rv_opcOP);
 
-    uxlen_t lhs = cpu->regs[instr.r.rs1];
-    uxlen_t rhs = cpu->regs[instr.r.rs2];
+    uxlen_t lhs = cpu->regs[instr->rs1];
+    uxlen_t rhs = cpu->regs[instr->rs2];
 
-    cpu->regs[instr.r.rd] = lhs - rhs;
+    cpu->regs[instr->rd] = lhs - rhs;
 
     return rv_exc_none;
 }
 
 /** RV64 ONLY */
-static rv_exc_t rv_subw_instr(rv_cpu_t *cpu, rv_instr_t instr)
+static rv_exc_t rv_subw_instr(rv_cpu_t *cpu, const rv_decoded_t *instr)
 {
     ASSERT(cpu != NULL);
-    ASSERT(instr.r.opcode == rv_opcOP_32);
+    ASSERT(instr->data.r.opcode == rv_opcOP_32);
 
-    int32_t lhs = (int32_t) cpu->regs[instr.r.rs1];
-    int32_t rhs = (int32_t) cpu->regs[instr.r.rs2];
+    int32_t lhs = (int32_t) cpu->regs[instr->rs1];
+    int32_t rhs = (int32_t) cpu->regs[instr->rs2];
 
-    cpu->regs[instr.r.rd] = (int64_t) ((int32_t) (lhs - rhs));
+    cpu->regs[instr->rd] = (int64_t) ((int32_t) (lhs - rhs));
 
     return rv_exc_none;
 }
 
-static rv_exc_t rv_sll_instr(rv_cpu_t *cpu, rv_instr_t instr)
+static rv_exc_t rv_sll_instr(rv_cpu_t *cpu, const rv_decoded_t *instr)
 {
     ASSERT(cpu != NULL);
-    ASSERT(instr.r.opcode == rv_opcOP);
+    ASSERT(instr->data.r.opcode == rv_opcOP);
 
-    uxlen_t lhs = cpu->regs[instr.r.rs1];
+    uxlen_t lhs = cpu->regs[instr->rs1];
     // based only on lowest 6 bits
-    uxlen_t rhs = shift_instr_mask(XLEN) & (cpu->regs[instr.r.rs2]);
+    uxlen_t rhs = shift_instr_mask(XLEN) & (cpu->regs[instr->rs2]);
 
-    cpu->regs[instr.r.rd] = lhs << rhs;
+    cpu->regs[instr->rd] = lhs << rhs;
 
     return rv_exc_none;
 }
 
 /** RV64 ONLY */
-static rv_exc_t rv_sllw_instr(rv_cpu_t *cpu, rv_instr_t instr)
+static rv_exc_t rv_sllw_instr(rv_cpu_t *cpu, const rv_decoded_t *instr)
 {
     ASSERT(cpu != NULL);
-    ASSERT(instr.r.opcode == rv_opcOP_32);
+    ASSERT(instr->data.r.opcode == rv_opcOP_32);
 
-    uint32_t lhs = (uint32_t) cpu->regs[instr.r.rs1];
+    uint32_t lhs = (uint32_t) cpu->regs[instr->rs1];
     // based only on lowest 5 bits
-    uint32_t rhs = 0x1F & (cpu->regs[instr.r.rs2]);
+    uint32_t rhs = 0x1F & (cpu->regs[instr->rs2]);
 
     uint32_t result = lhs << rhs;
 
-    cpu->regs[instr.r.rd] = (int64_t) ((int32_t) result);
+    cpu->regs[instr->rd] = (int64_t) ((int32_t) result);
 
     return rv_exc_none;
 }
 
-static rv_exc_t rv_slt_instr(rv_cpu_t *cpu, rv_instr_t instr)
+static rv_exc_t rv_slt_instr(rv_cpu_t *cpu, const rv_decoded_t *instr)
 {
     ASSERT(cpu != NULL);
-    ASSERT(instr.r.opcode == rv_opcOP);
+    ASSERT(instr->data.r.opcode == rv_opcOP);
 
-    xlen_t lhs = cpu->regs[instr.r.rs1];
-    xlen_t rhs = cpu->regs[instr.r.rs2];
+    xlen_t lhs = cpu->regs[instr->rs1];
+    xlen_t rhs = cpu->regs[instr->rs2];
 
-    cpu->regs[instr.r.rd] = (lhs < rhs) ? 1 : 0;
+    cpu->regs[instr->rd] = (lhs < rhs) ? 1 : 0;
 
     return rv_exc_none;
 }
 
-static rv_exc_t rv_sltu_instr(rv_cpu_t *cpu, rv_instr_t instr)
+static rv_exc_t rv_sltu_instr(rv_cpu_t *cpu, const rv_decoded_t *instr)
 {
     ASSERT(cpu != NULL);
-    ASSERT(instr.r.opcode == rv_opcOP);
+    ASSERT(instr->data.r.opcode == rv_opcOP);
 
-    uxlen_t lhs = cpu->regs[instr.r.rs1];
-    uxlen_t rhs = cpu->regs[instr.r.rs2];
+    uxlen_t lhs = cpu->regs[instr->rs1];
+    uxlen_t rhs = cpu->regs[instr->rs2];
 
-    cpu->regs[instr.r.rd] = (lhs < rhs) ? 1 : 0;
+    cpu->regs[instr->rd] = (lhs < rhs) ? 1 : 0;
 
     return rv_exc_none;
 }
 
-static rv_exc_t rv_xor_instr(rv_cpu_t *cpu, rv_instr_t instr)
+static rv_exc_t rv_xor_instr(rv_cpu_t *cpu, const rv_decoded_t *instr)
 {
     ASSERT(cpu != NULL);
-    ASSERT(instr.r.opcode == rv_opcOP);
+    ASSERT(instr->data.r.opcode == rv_opcOP);
 
-    uxlen_t lhs = cpu->regs[instr.r.rs1];
-    uxlen_t rhs = cpu->regs[instr.r.rs2];
+    uxlen_t lhs = cpu->regs[instr->rs1];
+    uxlen_t rhs = cpu->regs[instr->rs2];
 
-    cpu->regs[instr.r.rd] = lhs ^ rhs;
+    cpu->regs[instr->rd] = lhs ^ rhs;
 
     return rv_exc_none;
 }
 
-static rv_exc_t rv_srl_instr(rv_cpu_t *cpu, rv_instr_t instr)
+static rv_exc_t rv_srl_instr(rv_cpu_t *cpu, const rv_decoded_t *instr)
 {
     ASSERT(cpu != NULL);
-    ASSERT(instr.r.opcode == rv_opcOP);
+    ASSERT(instr->data.r.opcode == rv_opcOP);
 
-    uxlen_t lhs = cpu->regs[instr.r.rs1];
+    uxlen_t lhs = cpu->regs[instr->rs1];
     // based only on lowest 6 bits
-    uxlen_t rhs = shift_instr_mask(XLEN) & (cpu->regs[instr.r.rs2]);
+    uxlen_t rhs = shift_instr_mask(XLEN) & (cpu->regs[instr->rs2]);
 
-    cpu->regs[instr.r.rd] = lhs >> rhs;
+    cpu->regs[instr->rd] = lhs >> rhs;
 
     return rv_exc_none;
 }
 
 /** RV64 ONLY */
-static rv_exc_t rv_srlw_instr(rv_cpu_t *cpu, rv_instr_t instr)
+static rv_exc_t rv_srlw_instr(rv_cpu_t *cpu, const rv_decoded_t *instr)
 {
     ASSERT(cpu != NULL);
-    ASSERT(instr.r.opcode == rv_opcOP_32);
+    ASSERT(instr->data.r.opcode == rv_opcOP_32);
 
-    uint32_t lhs = (uint32_t) cpu->regs[instr.r.rs1];
+    uint32_t lhs = (uint32_t) cpu->regs[instr->rs1];
     // based only on lowest 5 bits
-    uint32_t rhs = 0x1F & (cpu->regs[instr.r.rs2]);
+    uint32_t rhs = 0x1F & (cpu->regs[instr->rs2]);
 
     uint32_t result = lhs >> rhs;
 
-    cpu->regs[instr.r.rd] = (int64_t) ((int32_t) result);
+    cpu->regs[instr->rd] = (int64_t) ((int32_t) result);
 
     return rv_exc_none;
 }
 
-static rv_exc_t rv_sra_instr(rv_cpu_t *cpu, rv_instr_t instr)
+static rv_exc_t rv_sra_instr(rv_cpu_t *cpu, const rv_decoded_t *instr)
 {
     ASSERT(cpu != NULL);
-    ASSERT(instr.r.opcode == rv_opcOP);
+    ASSERT(instr->data.r.opcode == rv_opcOP);
 
-    xlen_t lhs = (xlen_t) cpu->regs[instr.r.rs1];
+    xlen_t lhs = (xlen_t) cpu->regs[instr->rs1];
     // based only on lowest 6 bits
-    uxlen_t rhs = shift_instr_mask(XLEN) & (cpu->regs[instr.r.rs2]);
+    uxlen_t rhs = shift_instr_mask(XLEN) & (cpu->regs[instr->rs2]);
 
-    cpu->regs[instr.r.rd] = (uxlen_t) (lhs >> rhs);
+    cpu->regs[instr->rd] = (uxlen_t) (lhs >> rhs);
 
     return rv_exc_none;
 }
 
 /** RV64 ONLY */
-static rv_exc_t rv_sraw_instr(rv_cpu_t *cpu, rv_instr_t instr)
+static rv_exc_t rv_sraw_instr(rv_cpu_t *cpu, const rv_decoded_t *instr)
 {
     ASSERT(cpu != NULL);
-    ASSERT(instr.r.opcode == rv_opcOP_32);
+    ASSERT(instr->data.r.opcode == rv_opcOP_32);
 
-    int32_t lhs = (int32_t) cpu->regs[instr.r.rs1];
+    int32_t lhs = (int32_t) cpu->regs[instr->rs1];
     // based only on lowest 5 bits
-    uint32_t rhs = 0x1F & (cpu->regs[instr.r.rs2]);
+    uint32_t rhs = 0x1F & (cpu->regs[instr->rs2]);
 
     int32_t result = (lhs >> rhs);
 
-    cpu->regs[instr.r.rd] = (int64_t) result;
+    cpu->regs[instr->rd] = (int64_t) result;
 
     return rv_exc_none;
 }
 
-static rv_exc_t rv_or_instr(rv_cpu_t *cpu, rv_instr_t instr)
+static rv_exc_t rv_or_instr(rv_cpu_t *cpu, const rv_decoded_t *instr)
 {
     ASSERT(cpu != NULL);
-    ASSERT(instr.r.opcode == rv_opcOP);
+    ASSERT(instr->data.r.opcode == rv_opcOP);
 
-    uxlen_t lhs = cpu->regs[instr.r.rs1];
-    uxlen_t rhs = cpu->regs[instr.r.rs2];
+    uxlen_t lhs = cpu->regs[instr->rs1];
+    uxlen_t rhs = cpu->regs[instr->rs2];
 
-    cpu->regs[instr.r.rd] = lhs | rhs;
+    cpu->regs[instr->rd] = lhs | rhs;
 
     return rv_exc_none;
 }
 
-static rv_exc_t rv_and_instr(rv_cpu_t *cpu, rv_instr_t instr)
+static rv_exc_t rv_and_instr(rv_cpu_t *cpu, const rv_decoded_t *instr)
 {
     ASSERT(cpu != NULL);
-    ASSERT(instr.r.opcode == rv_opcOP);
+    ASSERT(instr->data.r.opcode == rv_opcOP);
 
-    uxlen_t lhs = cpu->regs[instr.r.rs1];
-    uxlen_t rhs = cpu->regs[instr.r.rs2];
+    uxlen_t lhs = cpu->regs[instr->rs1];
+    uxlen_t rhs = cpu->regs[instr->rs2];
 
-    cpu->regs[instr.r.rd] = lhs & rhs;
+    cpu->regs[instr->rd] = lhs & rhs;
 
     return rv_exc_none;
 }
@@ -249,195 +249,190 @@ static rv_exc_t rv_and_instr(rv_cpu_t *cpu, rv_instr_t instr)
  * OP-IMM *
  **********/
 
-static rv_exc_t rv_addi_instr(rv_cpu_t *cpu, rv_instr_t instr)
+static rv_exc_t rv_addi_instr(rv_cpu_t *cpu, const rv_decoded_t *instr)
 {
     ASSERT(cpu != NULL);
-    ASSERT(instr.i.opcode == rv_opcOP_IMM);
+    ASSERT(instr->data.i.opcode == rv_opcOP_IMM);
 
-    xlen_t imm;
-    if (XLEN == 32) {
-        imm = (int32_t) (instr.i.imm << 20) >> 20;
-    } else {
-        imm = (int64_t) ((int32_t) (instr.i.imm << 20) >> 20);
-    }
+    xlen_t imm = instr->imm;
 
-    cpu->regs[instr.i.rd] = cpu->regs[instr.i.rs1] + imm;
+    cpu->regs[instr->rd] = cpu->regs[instr->rs1] + imm;
 
     return rv_exc_none;
 }
 
 /** RV64 ONLY */
-static rv_exc_t rv_addiw_instr(rv_cpu_t *cpu, rv_instr_t instr)
+static rv_exc_t rv_addiw_instr(rv_cpu_t *cpu, const rv_decoded_t *instr)
 {
     ASSERT(cpu != NULL);
-    ASSERT(instr.i.opcode == rv_opcOP_IMM_32);
+    ASSERT(instr->data.i.opcode == rv_opcOP_IMM_32);
 
-    int32_t imm = (int32_t) (instr.i.imm << 20) >> 20;
+    int32_t imm = instr->imm;
 
-    int32_t result = (int32_t) cpu->regs[instr.i.rs1] + imm;
+    int32_t result = (int32_t) cpu->regs[instr->rs1] + imm;
 
-    cpu->regs[instr.i.rd] = (int64_t) result;
+    cpu->regs[instr->rd] = (int64_t) result;
 
     return rv_exc_none;
 }
 
-static rv_exc_t rv_slti_instr(rv_cpu_t *cpu, rv_instr_t instr)
+static rv_exc_t rv_slti_instr(rv_cpu_t *cpu, const rv_decoded_t *instr)
 {
     ASSERT(cpu != NULL);
-    ASSERT(instr.i.opcode == rv_opcOP_IMM);
+    ASSERT(instr->data.i.opcode == rv_opcOP_IMM);
 
-    xlen_t imm = (xlen_t) ((int32_t) (instr.i.imm << 20) >> 20);
+    xlen_t imm = (xlen_t) instr->imm;
 
-    bool cmp = ((xlen_t) cpu->regs[instr.i.rs1] < imm);
+    bool cmp = ((xlen_t) cpu->regs[instr->rs1] < imm);
 
-    cpu->regs[instr.i.rd] = cmp ? 1 : 0;
+    cpu->regs[instr->rd] = cmp ? 1 : 0;
 
     return rv_exc_none;
 }
 
-static rv_exc_t rv_sltiu_instr(rv_cpu_t *cpu, rv_instr_t instr)
+static rv_exc_t rv_sltiu_instr(rv_cpu_t *cpu, const rv_decoded_t *instr)
 {
     ASSERT(cpu != NULL);
-    ASSERT(instr.i.opcode == rv_opcOP_IMM);
+    ASSERT(instr->data.i.opcode == rv_opcOP_IMM);
 
     // sign extend to 64 bits, then change to unsigned
-    uxlen_t imm = (uxlen_t) ((xlen_t) ((int32_t) (instr.i.imm << 20) >> 20));
+    uxlen_t imm = (uxlen_t) ((xlen_t) instr->imm);
 
-    bool cmp = ((cpu->regs[instr.i.rs1]) < imm);
+    bool cmp = ((cpu->regs[instr->rs1]) < imm);
 
-    cpu->regs[instr.i.rd] = cmp ? 1 : 0;
+    cpu->regs[instr->rd] = cmp ? 1 : 0;
 
     return rv_exc_none;
 }
 
-static rv_exc_t rv_andi_instr(rv_cpu_t *cpu, rv_instr_t instr)
+static rv_exc_t rv_andi_instr(rv_cpu_t *cpu, const rv_decoded_t *instr)
 {
     ASSERT(cpu != NULL);
-    ASSERT(instr.i.opcode == rv_opcOP_IMM);
+    ASSERT(instr->data.i.opcode == rv_opcOP_IMM);
 
-    xlen_t imm = (xlen_t) ((int32_t) (instr.i.imm << 20) >> 20);
+    xlen_t imm = (xlen_t) instr->imm;
 
-    uxlen_t val = cpu->regs[instr.i.rs1] & imm;
+    uxlen_t val = cpu->regs[instr->rs1] & imm;
 
-    cpu->regs[instr.i.rd] = val;
+    cpu->regs[instr->rd] = val;
 
     return rv_exc_none;
 }
 
-static rv_exc_t rv_ori_instr(rv_cpu_t *cpu, rv_instr_t instr)
+static rv_exc_t rv_ori_instr(rv_cpu_t *cpu, const rv_decoded_t *instr)
 {
     ASSERT(cpu != NULL);
-    ASSERT(instr.i.opcode == rv_opcOP_IMM);
+    ASSERT(instr->data.i.opcode == rv_opcOP_IMM);
 
-    xlen_t imm = (xlen_t) ((int32_t) (instr.i.imm << 20) >> 20);
+    xlen_t imm = (xlen_t) instr->imm;
 
-    uxlen_t val = cpu->regs[instr.i.rs1] | imm;
+    uxlen_t val = cpu->regs[instr->rs1] | imm;
 
-    cpu->regs[instr.i.rd] = val;
+    cpu->regs[instr->rd] = val;
 
     return rv_exc_none;
 }
 
-static rv_exc_t rv_xori_instr(rv_cpu_t *cpu, rv_instr_t instr)
+static rv_exc_t rv_xori_instr(rv_cpu_t *cpu, const rv_decoded_t *instr)
 {
     ASSERT(cpu != NULL);
-    ASSERT(instr.i.opcode == rv_opcOP_IMM);
+    ASSERT(instr->data.i.opcode == rv_opcOP_IMM);
 
-    xlen_t imm = (xlen_t) ((int32_t) (instr.i.imm << 20) >> 20);
+    xlen_t imm = (xlen_t) instr->imm;
 
-    uxlen_t val = cpu->regs[instr.i.rs1] ^ imm;
+    uxlen_t val = cpu->regs[instr->rs1] ^ imm;
 
-    cpu->regs[instr.i.rd] = val;
+    cpu->regs[instr->rd] = val;
 
     return rv_exc_none;
 }
 
 // TODO: figure this out
-static rv_exc_t rv_slli_instr(rv_cpu_t *cpu, rv_instr_t instr)
+static rv_exc_t rv_slli_instr(rv_cpu_t *cpu, const rv_decoded_t *instr)
 {
     ASSERT(cpu != NULL);
-    ASSERT(instr.i.opcode == rv_opcOP_IMM);
+    ASSERT(instr->data.i.opcode == rv_opcOP_IMM);
 
-    uint32_t imm = instr.i.imm & 0x3F;
+    uint32_t imm = instr->imm & 0x3F;
 
-    uint64_t val = cpu->regs[instr.i.rs1] << imm;
+    uint64_t val = cpu->regs[instr->rs1] << imm;
 
-    cpu->regs[instr.i.rd] = val;
+    cpu->regs[instr->rd] = val;
 
     return rv_exc_none;
 }
 
 /** RV64 ONLY */
-static rv_exc_t rv_slliw_instr(rv_cpu_t *cpu, rv_instr_t instr)
+static rv_exc_t rv_slliw_instr(rv_cpu_t *cpu, const rv_decoded_t *instr)
 {
     ASSERT(cpu != NULL);
-    ASSERT(instr.i.opcode == rv_opcOP_IMM_32);
+    ASSERT(instr->data.i.opcode == rv_opcOP_IMM_32);
 
-    uint32_t imm = instr.i.imm & 0x1F;
+    uint32_t imm = instr->imm & 0x1F;
 
-    uint32_t val = (uint32_t) cpu->regs[instr.i.rs1] << imm;
+    uint32_t val = (uint32_t) cpu->regs[instr->rs1] << imm;
 
-    cpu->regs[instr.i.rd] = (int64_t) ((int32_t) val);
+    cpu->regs[instr->rd] = (int64_t) ((int32_t) val);
 
     return rv_exc_none;
 }
 
 // TODO: figure this out
-static rv_exc_t rv_srli_instr(rv_cpu_t *cpu, rv_instr_t instr)
+static rv_exc_t rv_srli_instr(rv_cpu_t *cpu, const rv_decoded_t *instr)
 {
     ASSERT(cpu != NULL);
-    ASSERT(instr.i.opcode == rv_opcOP_IMM);
+    ASSERT(instr->data.i.opcode == rv_opcOP_IMM);
 
-    uint32_t imm = instr.i.imm & 0x3F;
+    uint32_t imm = instr->imm & 0x3F;
 
-    uint64_t val = cpu->regs[instr.i.rs1] >> imm;
+    uint64_t val = cpu->regs[instr->rs1] >> imm;
 
-    cpu->regs[instr.i.rd] = val;
+    cpu->regs[instr->rd] = val;
 
     return rv_exc_none;
 }
 
 /** RV64 ONLY */
-static rv_exc_t rv_srliw_instr(rv_cpu_t *cpu, rv_instr_t instr)
+static rv_exc_t rv_srliw_instr(rv_cpu_t *cpu, const rv_decoded_t *instr)
 {
     ASSERT(cpu != NULL);
-    ASSERT(instr.i.opcode == rv_opcOP_IMM_32);
+    ASSERT(instr->data.i.opcode == rv_opcOP_IMM_32);
 
-    uint32_t imm = instr.i.imm & 0x1F;
+    uint32_t imm = instr->imm & 0x1F;
 
-    uint32_t val = (uint32_t) cpu->regs[instr.i.rs1] >> imm;
+    uint32_t val = (uint32_t) cpu->regs[instr->rs1] >> imm;
 
-    cpu->regs[instr.i.rd] = (int64_t) ((int32_t) val);
+    cpu->regs[instr->rd] = (int64_t) ((int32_t) val);
 
     return rv_exc_none;
 }
 
 // TODO: figure this out
-static rv_exc_t rv_srai_instr(rv_cpu_t *cpu, rv_instr_t instr)
+static rv_exc_t rv_srai_instr(rv_cpu_t *cpu, const rv_decoded_t *instr)
 {
     ASSERT(cpu != NULL);
-    ASSERT(instr.i.opcode == rv_opcOP_IMM);
+    ASSERT(instr->data.i.opcode == rv_opcOP_IMM);
 
-    uint32_t imm = instr.i.imm & shift_instr_mask(XLEN);
+    uint32_t imm = instr->imm & shift_instr_mask(XLEN);
 
-    xlen_t val = ((xlen_t) cpu->regs[instr.i.rs1]) >> imm;
+    xlen_t val = ((xlen_t) cpu->regs[instr->rs1]) >> imm;
 
-    cpu->regs[instr.i.rd] = (uxlen_t) val;
+    cpu->regs[instr->rd] = (uxlen_t) val;
 
     return rv_exc_none;
 }
 
 /** RV64 ONLY */
-static rv_exc_t rv_sraiw_instr(rv_cpu_t *cpu, rv_instr_t instr)
+static rv_exc_t rv_sraiw_instr(rv_cpu_t *cpu, const rv_decoded_t *instr)
 {
     ASSERT(cpu != NULL);
-    ASSERT(instr.i.opcode == rv_opcOP_IMM_32);
+    ASSERT(instr->data.i.opcode == rv_opcOP_IMM_32);
 
-    uint32_t imm = instr.i.imm & 0x1F;
+    uint32_t imm = instr->imm & 0x1F;
 
-    int32_t val = (int32_t) cpu->regs[instr.i.rs1] >> imm;
+    int32_t val = (int32_t) cpu->regs[instr->rs1] >> imm;
 
-    cpu->regs[instr.i.rd] = (int64_t) val;
+    cpu->regs[instr->rd] = (int64_t) val;
 
     return rv_exc_none;
 }
@@ -446,28 +441,28 @@ static rv_exc_t rv_sraiw_instr(rv_cpu_t *cpu, rv_instr_t instr)
  * LUI and AUIPC *
  *****************/
 
-static rv_exc_t rv_lui_instr(rv_cpu_t *cpu, rv_instr_t instr)
+static rv_exc_t rv_lui_instr(rv_cpu_t *cpu, const rv_decoded_t *instr)
 {
     ASSERT(cpu != NULL);
-    ASSERT(instr.u.opcode == rv_opcLUI);
+    ASSERT(instr->data.u.opcode == rv_opcLUI);
 
-    xlen_t imm_val = sign_extend_32_to_xlen(instr.u.imm << 12, XLEN);
+    xlen_t imm_val = sign_extend_32_to_xlen(instr->imm, XLEN);
 
-    cpu->regs[instr.u.rd] = imm_val;
+    cpu->regs[instr->rd] = imm_val;
 
     return rv_exc_none;
 }
 
-static rv_exc_t rv_auipc_instr(rv_cpu_t *cpu, rv_instr_t instr)
+static rv_exc_t rv_auipc_instr(rv_cpu_t *cpu, const rv_decoded_t *instr)
 {
     ASSERT(cpu != NULL);
-    ASSERT(instr.u.opcode == rv_opcAUIPC);
+    ASSERT(instr->data.u.opcode == rv_opcAUIPC);
 
-    xlen_t offset = sign_extend_32_to_xlen(instr.u.imm << 12, XLEN);
+    xlen_t offset = sign_extend_32_to_xlen(instr->imm, XLEN);
 
     uxlen_t val = cpu->pc + offset;
 
-    cpu->regs[instr.u.rd] = val;
+    cpu->regs[instr->rd] = val;
 
     return rv_exc_none;
 }
@@ -476,247 +471,247 @@ static rv_exc_t rv_auipc_instr(rv_cpu_t *cpu, rv_instr_t instr)
  * M extension *
  ***************/
 
-static rv_exc_t rv_mul_instr(rv_cpu_t *cpu, rv_instr_t instr)
+static rv_exc_t rv_mul_instr(rv_cpu_t *cpu, const rv_decoded_t *instr)
 {
     ASSERT(cpu != NULL);
-    ASSERT(instr.r.opcode == rv_opcOP);
+    ASSERT(instr->data.r.opcode == rv_opcOP);
 
-    uxlen_t lhs = cpu->regs[instr.r.rs1];
-    uxlen_t rhs = cpu->regs[instr.r.rs2];
+    uxlen_t lhs = cpu->regs[instr->rs1];
+    uxlen_t rhs = cpu->regs[instr->rs2];
 
-    cpu->regs[instr.r.rd] = lhs * rhs;
+    cpu->regs[instr->rd] = lhs * rhs;
 
     return rv_exc_none;
 }
 
 /** RV64 ONLY */
-static rv_exc_t rv_mulw_instr(rv_cpu_t *cpu, rv_instr_t instr)
+static rv_exc_t rv_mulw_instr(rv_cpu_t *cpu, const rv_decoded_t *instr)
 {
     ASSERT(cpu != NULL);
-    ASSERT(instr.r.opcode == rv_opcOP_32);
+    ASSERT(instr->data.r.opcode == rv_opcOP_32);
 
-    int32_t lhs = (int32_t) cpu->regs[instr.r.rs1];
-    int32_t rhs = (int32_t) cpu->regs[instr.r.rs2];
+    int32_t lhs = (int32_t) cpu->regs[instr->rs1];
+    int32_t rhs = (int32_t) cpu->regs[instr->rs2];
 
     int32_t result = lhs * rhs;
 
-    cpu->regs[instr.r.rd] = (int64_t) result;
+    cpu->regs[instr->rd] = (int64_t) result;
 
     return rv_exc_none;
 }
 
-static rv_exc_t rv_mulh_instr(rv_cpu_t *cpu, rv_instr_t instr)
+static rv_exc_t rv_mulh_instr(rv_cpu_t *cpu, const rv_decoded_t *instr)
 {
     ASSERT(cpu != NULL);
-    ASSERT(instr.r.opcode == rv_opcOP);
+    ASSERT(instr->data.r.opcode == rv_opcOP);
 
-    xlen_t lhs = (xlen_t) cpu->regs[instr.r.rs1];
-    xlen_t rhs = (xlen_t) cpu->regs[instr.r.rs2];
+    xlen_t lhs = (xlen_t) cpu->regs[instr->rs1];
+    xlen_t rhs = (xlen_t) cpu->regs[instr->rs2];
 
     bigxlen_t res = (bigxlen_t) lhs * (bigxlen_t) rhs;
 
-    cpu->regs[instr.r.rd] = (uxlen_t) (res >> XLEN);
+    cpu->regs[instr->rd] = (uxlen_t) (res >> XLEN);
     return rv_exc_none;
 }
 
-static rv_exc_t rv_mulhsu_instr(rv_cpu_t *cpu, rv_instr_t instr)
+static rv_exc_t rv_mulhsu_instr(rv_cpu_t *cpu, const rv_decoded_t *instr)
 {
     ASSERT(cpu != NULL);
-    ASSERT(instr.r.opcode == rv_opcOP);
+    ASSERT(instr->data.r.opcode == rv_opcOP);
 
-    xlen_t lhs = (xlen_t) cpu->regs[instr.r.rs1];
-    uxlen_t rhs = cpu->regs[instr.r.rs2];
+    xlen_t lhs = (xlen_t) cpu->regs[instr->rs1];
+    uxlen_t rhs = cpu->regs[instr->rs2];
 
     bigxlen_t res = (bigxlen_t) lhs * (bigxlen_t) rhs;
 
-    cpu->regs[instr.r.rd] = (uxlen_t) (res >> XLEN);
+    cpu->regs[instr->rd] = (uxlen_t) (res >> XLEN);
     return rv_exc_none;
 }
 
-static rv_exc_t rv_mulhu_instr(rv_cpu_t *cpu, rv_instr_t instr)
+static rv_exc_t rv_mulhu_instr(rv_cpu_t *cpu, const rv_decoded_t *instr)
 {
     ASSERT(cpu != NULL);
-    ASSERT(instr.r.opcode == rv_opcOP);
+    ASSERT(instr->data.r.opcode == rv_opcOP);
 
-    uxlen_t lhs = cpu->regs[instr.r.rs1];
-    uxlen_t rhs = cpu->regs[instr.r.rs2];
+    uxlen_t lhs = cpu->regs[instr->rs1];
+    uxlen_t rhs = cpu->regs[instr->rs2];
 
     ubigxlen_t res = (ubigxlen_t) lhs * (ubigxlen_t) rhs;
 
-    cpu->regs[instr.r.rd] = (uxlen_t) (res >> XLEN);
+    cpu->regs[instr->rd] = (uxlen_t) (res >> XLEN);
     return rv_exc_none;
 }
 
-static rv_exc_t rv_div_instr(rv_cpu_t *cpu, rv_instr_t instr)
+static rv_exc_t rv_div_instr(rv_cpu_t *cpu, const rv_decoded_t *instr)
 {
     ASSERT(cpu != NULL);
-    ASSERT(instr.r.opcode == rv_opcOP);
+    ASSERT(instr->data.r.opcode == rv_opcOP);
 
-    xlen_t lhs = (xlen_t) cpu->regs[instr.r.rs1];
-    xlen_t rhs = (xlen_t) cpu->regs[instr.r.rs2];
+    xlen_t lhs = (xlen_t) cpu->regs[instr->rs1];
+    xlen_t rhs = (xlen_t) cpu->regs[instr->rs2];
 
     if (rhs == 0) {
         // as per spec, dividing by 0 sets the result to -1
-        cpu->regs[instr.r.rd] = -1;
+        cpu->regs[instr->rd] = -1;
         return rv_exc_none;
     }
 
     if (lhs == XLEN_MIN && rhs == -1) {
         // as per spec, divide overflow causes the result to be the minimal XLEN
-        cpu->regs[instr.r.rd] = XLEN_MIN;
+        cpu->regs[instr->rd] = XLEN_MIN;
         return rv_exc_none;
     }
 
-    cpu->regs[instr.r.rd] = lhs / rhs;
+    cpu->regs[instr->rd] = lhs / rhs;
     return rv_exc_none;
 }
 
-static rv_exc_t rv_divu_instr(rv_cpu_t *cpu, rv_instr_t instr)
+static rv_exc_t rv_divu_instr(rv_cpu_t *cpu, const rv_decoded_t *instr)
 {
     ASSERT(cpu != NULL);
-    ASSERT(instr.r.opcode == rv_opcOP);
+    ASSERT(instr->data.r.opcode == rv_opcOP);
 
-    uxlen_t lhs = cpu->regs[instr.r.rs1];
-    uxlen_t rhs = cpu->regs[instr.r.rs2];
+    uxlen_t lhs = cpu->regs[instr->rs1];
+    uxlen_t rhs = cpu->regs[instr->rs2];
 
     if (rhs == 0) {
         // as per spec, dividing by 0 sets the result to the maximal val
-        cpu->regs[instr.r.rd] = XLEN_UMAX;
+        cpu->regs[instr->rd] = XLEN_UMAX;
         return rv_exc_none;
     }
 
-    cpu->regs[instr.r.rd] = lhs / rhs;
+    cpu->regs[instr->rd] = lhs / rhs;
     return rv_exc_none;
 }
 
 /** RV64 ONLY */
-static rv_exc_t rv_divw_instr(rv_cpu_t *cpu, rv_instr_t instr)
+static rv_exc_t rv_divw_instr(rv_cpu_t *cpu, const rv_decoded_t *instr)
 {
     ASSERT(cpu != NULL);
-    ASSERT(instr.r.opcode == rv_opcOP_32);
+    ASSERT(instr->data.r.opcode == rv_opcOP_32);
 
     // Truncate to 32 bits
-    int32_t lhs = (int32_t) cpu->regs[instr.r.rs1];
-    int32_t rhs = (int32_t) cpu->regs[instr.r.rs2];
+    int32_t lhs = (int32_t) cpu->regs[instr->rs1];
+    int32_t rhs = (int32_t) cpu->regs[instr->rs2];
 
     if (rhs == 0) {
         // as per spec, dividing by 0 sets the result to -1
-        cpu->regs[instr.r.rd] = (int64_t) ((int32_t) (-1));
+        cpu->regs[instr->rd] = (int64_t) ((int32_t) (-1));
         return rv_exc_none;
     }
 
     if (lhs == INT32_MIN && rhs == -1) {
         // as per spec, divide overflow causes the result to be the minimal int32
-        cpu->regs[instr.r.rd] = (int64_t) INT32_MIN;
+        cpu->regs[instr->rd] = (int64_t) INT32_MIN;
         return rv_exc_none;
     }
 
-    cpu->regs[instr.r.rd] = (int64_t) ((int32_t) (lhs / rhs));
+    cpu->regs[instr->rd] = (int64_t) ((int32_t) (lhs / rhs));
     return rv_exc_none;
 }
 
 /** RV64 ONLY */
-static rv_exc_t rv_divuw_instr(rv_cpu_t *cpu, rv_instr_t instr)
+static rv_exc_t rv_divuw_instr(rv_cpu_t *cpu, const rv_decoded_t *instr)
 {
     ASSERT(cpu != NULL);
-    ASSERT(instr.r.opcode == rv_opcOP_32);
+    ASSERT(instr->data.r.opcode == rv_opcOP_32);
 
-    uint32_t lhs = (uint32_t) cpu->regs[instr.r.rs1];
-    uint32_t rhs = (uint32_t) cpu->regs[instr.r.rs2];
+    uint32_t lhs = (uint32_t) cpu->regs[instr->rs1];
+    uint32_t rhs = (uint32_t) cpu->regs[instr->rs2];
 
     if (rhs == 0) {
         // as per spec, dividing by 0 sets the result to the maximal val
-        cpu->regs[instr.r.rd] = (int64_t) ((int32_t) UINT32_MAX);
+        cpu->regs[instr->rd] = (int64_t) ((int32_t) UINT32_MAX);
         return rv_exc_none;
     }
 
-    cpu->regs[instr.r.rd] = (int64_t) ((int32_t) (lhs / rhs));
+    cpu->regs[instr->rd] = (int64_t) ((int32_t) (lhs / rhs));
     return rv_exc_none;
 }
 
-static rv_exc_t rv_rem_instr(rv_cpu_t *cpu, rv_instr_t instr)
+static rv_exc_t rv_rem_instr(rv_cpu_t *cpu, const rv_decoded_t *instr)
 {
     ASSERT(cpu != NULL);
-    ASSERT(instr.r.opcode == rv_opcOP);
+    ASSERT(instr->data.r.opcode == rv_opcOP);
 
-    xlen_t lhs = (xlen_t) cpu->regs[instr.r.rs1];
-    xlen_t rhs = (xlen_t) cpu->regs[instr.r.rs2];
+    xlen_t lhs = (xlen_t) cpu->regs[instr->rs1];
+    xlen_t rhs = (xlen_t) cpu->regs[instr->rs2];
 
     if (rhs == 0) {
         // as per spec, dividing by 0 sets the remained to the original value
-        cpu->regs[instr.r.rd] = lhs;
+        cpu->regs[instr->rd] = lhs;
         return rv_exc_none;
     }
 
     if (lhs == XLEN_MIN && rhs == -1) {
         // as per spec, divide overflow causes the remainder to be set to 0
-        cpu->regs[instr.r.rd] = 0;
+        cpu->regs[instr->rd] = 0;
         return rv_exc_none;
     }
 
-    cpu->regs[instr.r.rd] = lhs % rhs;
+    cpu->regs[instr->rd] = lhs % rhs;
     return rv_exc_none;
 }
 
 /** RV64 ONLY */
-static rv_exc_t rv_remw_instr(rv_cpu_t *cpu, rv_instr_t instr)
+static rv_exc_t rv_remw_instr(rv_cpu_t *cpu, const rv_decoded_t *instr)
 {
     ASSERT(cpu != NULL);
-    ASSERT(instr.r.opcode == rv_opcOP_32);
+    ASSERT(instr->data.r.opcode == rv_opcOP_32);
 
-    int32_t lhs = (int32_t) cpu->regs[instr.r.rs1];
-    int32_t rhs = (int32_t) cpu->regs[instr.r.rs2];
+    int32_t lhs = (int32_t) cpu->regs[instr->rs1];
+    int32_t rhs = (int32_t) cpu->regs[instr->rs2];
 
     if (rhs == 0) {
         // as per spec, dividing by 0 sets the remained to the original value
-        cpu->regs[instr.r.rd] = (int64_t) lhs;
+        cpu->regs[instr->rd] = (int64_t) lhs;
         return rv_exc_none;
     }
 
     if (lhs == INT32_MIN && rhs == -1) {
         // as per spec, divide overflow causes the remainder to be set to 0
-        cpu->regs[instr.r.rd] = 0;
+        cpu->regs[instr->rd] = 0;
         return rv_exc_none;
     }
 
-    cpu->regs[instr.r.rd] = (int64_t) ((int32_t) (lhs % rhs));
+    cpu->regs[instr->rd] = (int64_t) ((int32_t) (lhs % rhs));
     return rv_exc_none;
 }
 
-static rv_exc_t rv_remu_instr(rv_cpu_t *cpu, rv_instr_t instr)
+static rv_exc_t rv_remu_instr(rv_cpu_t *cpu, const rv_decoded_t *instr)
 {
     ASSERT(cpu != NULL);
-    ASSERT(instr.r.opcode == rv_opcOP);
+    ASSERT(instr->data.r.opcode == rv_opcOP);
 
-    uxlen_t lhs = cpu->regs[instr.r.rs1];
-    uxlen_t rhs = cpu->regs[instr.r.rs2];
+    uxlen_t lhs = cpu->regs[instr->rs1];
+    uxlen_t rhs = cpu->regs[instr->rs2];
 
     if (rhs == 0) {
         // as per spec, dividing by 0 sets the remainder to the original value
-        cpu->regs[instr.r.rd] = lhs;
+        cpu->regs[instr->rd] = lhs;
         return rv_exc_none;
     }
 
-    cpu->regs[instr.r.rd] = lhs % rhs;
+    cpu->regs[instr->rd] = lhs % rhs;
     return rv_exc_none;
 }
 
 /** RV64 ONLY */
-static rv_exc_t rv_remuw_instr(rv_cpu_t *cpu, rv_instr_t instr)
+static rv_exc_t rv_remuw_instr(rv_cpu_t *cpu, const rv_decoded_t *instr)
 {
     ASSERT(cpu != NULL);
-    ASSERT(instr.r.opcode == rv_opcOP_32);
+    ASSERT(instr->data.r.opcode == rv_opcOP_32);
 
-    uint32_t lhs = (uint32_t) cpu->regs[instr.r.rs1];
-    uint32_t rhs = (uint32_t) cpu->regs[instr.r.rs2];
+    uint32_t lhs = (uint32_t) cpu->regs[instr->rs1];
+    uint32_t rhs = (uint32_t) cpu->regs[instr->rs2];
 
     if (rhs == 0) {
         // as per spec, dividing by 0 sets the remainder to the original value
-        cpu->regs[instr.r.rd] = (int64_t) ((int32_t) lhs);
+        cpu->regs[instr->rd] = (int64_t) ((int32_t) lhs);
         return rv_exc_none;
     }
 
-    cpu->regs[instr.r.rd] = (int64_t) ((int32_t) (lhs % rhs));
+    cpu->regs[instr->rd] = (int64_t) ((int32_t) (lhs % rhs));
     return rv_exc_none;
 }
 
@@ -750,12 +745,12 @@ static rv_exc_t rv_remuw_instr(rv_cpu_t *cpu, rv_instr_t instr)
         } \
     }
 
-static rv_exc_t rv_amoswap_w_instr(rv_cpu_t *cpu, rv_instr_t instr)
+static rv_exc_t rv_amoswap_w_instr(rv_cpu_t *cpu, const rv_decoded_t *instr)
 {
     ASSERT(cpu != NULL);
-    ASSERT(instr.r.opcode == rv_opcAMO);
+    ASSERT(instr->data.r.opcode == rv_opcAMO);
 
-    uxlen_t virt = cpu->regs[instr.r.rs1];
+    uxlen_t virt = cpu->regs[instr->rs1];
 
     // Check write privileges first
     throw_if_wrong_privilege(cpu, virt);
@@ -767,20 +762,20 @@ static rv_exc_t rv_amoswap_w_instr(rv_cpu_t *cpu, rv_instr_t instr)
     rv_exc_t ex = rv_read_mem32(cpu, virt, &val, false, true);
     ASSERT(ex == rv_exc_none);
 
-    ex = rv_write_mem32(cpu, virt, (uint32_t) cpu->regs[instr.r.rs2], true);
+    ex = rv_write_mem32(cpu, virt, (uint32_t) cpu->regs[instr->rs2], true);
     ASSERT(ex == rv_exc_none);
 
-    cpu->regs[instr.r.rd] = sign_extend_32_to_xlen(val, XLEN);
+    cpu->regs[instr->rd] = sign_extend_32_to_xlen(val, XLEN);
     return rv_exc_none;
 }
 
 /** RV64 ONLY */
-static rv_exc_t rv_amoswap_d_instr(rv_cpu_t *cpu, rv_instr_t instr)
+static rv_exc_t rv_amoswap_d_instr(rv_cpu_t *cpu, const rv_decoded_t *instr)
 {
     ASSERT(cpu != NULL);
-    ASSERT(instr.r.opcode == rv_opcAMO);
+    ASSERT(instr->data.r.opcode == rv_opcAMO);
 
-    uxlen_t virt = cpu->regs[instr.r.rs1];
+    uxlen_t virt = cpu->regs[instr->rs1];
 
     throw_if_wrong_privilege(cpu, virt);
     throw_if_misaligned_dword(cpu, virt);
@@ -790,16 +785,16 @@ static rv_exc_t rv_amoswap_d_instr(rv_cpu_t *cpu, rv_instr_t instr)
     rv_exc_t ex = rv_read_mem64(cpu, virt, &val, false, true);
     ASSERT(ex == rv_exc_none);
 
-    ex = rv_write_mem64(cpu, virt, cpu->regs[instr.r.rs2], true);
+    ex = rv_write_mem64(cpu, virt, cpu->regs[instr->rs2], true);
     ASSERT(ex == rv_exc_none);
 
-    cpu->regs[instr.r.rd] = val;
+    cpu->regs[instr->rd] = val;
     return rv_exc_none;
 }
 
-static rv_exc_t rv_amoadd_w_instr(rv_cpu_t *cpu, rv_instr_t instr)
+static rv_exc_t rv_amoadd_w_instr(rv_cpu_t *cpu, const rv_decoded_t *instr)
 {
-    uxlen_t virt = cpu->regs[instr.r.rs1];
+    uxlen_t virt = cpu->regs[instr->rs1];
 
     throw_if_wrong_privilege(cpu, virt);
     throw_if_misaligned_word(cpu, virt);
@@ -810,9 +805,9 @@ static rv_exc_t rv_amoadd_w_instr(rv_cpu_t *cpu, rv_instr_t instr)
     ASSERT(ex == rv_exc_none);
 
     // save loaded value to rd
-    cpu->regs[instr.r.rd] = sign_extend_32_to_xlen(val, XLEN);
+    cpu->regs[instr->rd] = sign_extend_32_to_xlen(val, XLEN);
     // add with rs2
-    val += (uint32_t) cpu->regs[instr.r.rs2];
+    val += (uint32_t) cpu->regs[instr->rs2];
 
     //  write to mem
     ex = rv_write_mem32(cpu, virt, val, true);
@@ -821,9 +816,9 @@ static rv_exc_t rv_amoadd_w_instr(rv_cpu_t *cpu, rv_instr_t instr)
 }
 
 /** RV64 ONLY */
-static rv_exc_t rv_amoadd_d_instr(rv_cpu_t *cpu, rv_instr_t instr)
+static rv_exc_t rv_amoadd_d_instr(rv_cpu_t *cpu, const rv_decoded_t *instr)
 {
-    uxlen_t virt = cpu->regs[instr.r.rs1];
+    uxlen_t virt = cpu->regs[instr->rs1];
 
     throw_if_wrong_privilege(cpu, virt);
     throw_if_misaligned_dword(cpu, virt);
@@ -834,9 +829,9 @@ static rv_exc_t rv_amoadd_d_instr(rv_cpu_t *cpu, rv_instr_t instr)
     ASSERT(ex == rv_exc_none);
 
     // save loaded value to rd
-    cpu->regs[instr.r.rd] = val;
+    cpu->regs[instr->rd] = val;
     // add with rs2
-    val += cpu->regs[instr.r.rs2];
+    val += cpu->regs[instr->rs2];
 
     //  write to mem
     ex = rv_write_mem64(cpu, virt, val, true);
@@ -844,9 +839,9 @@ static rv_exc_t rv_amoadd_d_instr(rv_cpu_t *cpu, rv_instr_t instr)
     return ex;
 }
 
-static rv_exc_t rv_amoxor_w_instr(rv_cpu_t *cpu, rv_instr_t instr)
+static rv_exc_t rv_amoxor_w_instr(rv_cpu_t *cpu, const rv_decoded_t *instr)
 {
-    uxlen_t virt = cpu->regs[instr.r.rs1];
+    uxlen_t virt = cpu->regs[instr->rs1];
 
     throw_if_wrong_privilege(cpu, virt);
     throw_if_misaligned_word(cpu, virt);
@@ -855,8 +850,8 @@ static rv_exc_t rv_amoxor_w_instr(rv_cpu_t *cpu, rv_instr_t instr)
     rv_exc_t ex = rv_read_mem32(cpu, virt, &val, false, true);
     ASSERT(ex == rv_exc_none);
 
-    cpu->regs[instr.r.rd] = sign_extend_32_to_xlen(val, XLEN);
-    val ^= (uint32_t) cpu->regs[instr.r.rs2];
+    cpu->regs[instr->rd] = sign_extend_32_to_xlen(val, XLEN);
+    val ^= (uint32_t) cpu->regs[instr->rs2];
     ex = rv_write_mem32(cpu, virt, val, true);
 
     ASSERT(ex == rv_exc_none);
@@ -864,9 +859,9 @@ static rv_exc_t rv_amoxor_w_instr(rv_cpu_t *cpu, rv_instr_t instr)
 }
 
 /** RV64 ONLY */
-static rv_exc_t rv_amoxor_d_instr(rv_cpu_t *cpu, rv_instr_t instr)
+static rv_exc_t rv_amoxor_d_instr(rv_cpu_t *cpu, const rv_decoded_t *instr)
 {
-    uxlen_t virt = cpu->regs[instr.r.rs1];
+    uxlen_t virt = cpu->regs[instr->rs1];
 
     throw_if_wrong_privilege(cpu, virt);
     throw_if_misaligned_dword(cpu, virt);
@@ -875,17 +870,17 @@ static rv_exc_t rv_amoxor_d_instr(rv_cpu_t *cpu, rv_instr_t instr)
     rv_exc_t ex = rv_read_mem64(cpu, virt, &val, false, true);
     ASSERT(ex == rv_exc_none);
 
-    cpu->regs[instr.r.rd] = val;
-    val ^= cpu->regs[instr.r.rs2];
+    cpu->regs[instr->rd] = val;
+    val ^= cpu->regs[instr->rs2];
     ex = rv_write_mem64(cpu, virt, val, true);
 
     ASSERT(ex == rv_exc_none);
     return ex;
 }
 
-static rv_exc_t rv_amoand_w_instr(rv_cpu_t *cpu, rv_instr_t instr)
+static rv_exc_t rv_amoand_w_instr(rv_cpu_t *cpu, const rv_decoded_t *instr)
 {
-    uxlen_t virt = cpu->regs[instr.r.rs1];
+    uxlen_t virt = cpu->regs[instr->rs1];
 
     throw_if_wrong_privilege(cpu, virt);
     throw_if_misaligned_word(cpu, virt);
@@ -894,8 +889,8 @@ static rv_exc_t rv_amoand_w_instr(rv_cpu_t *cpu, rv_instr_t instr)
     rv_exc_t ex = rv_read_mem32(cpu, virt, &val, false, true);
     ASSERT(ex == rv_exc_none);
 
-    cpu->regs[instr.r.rd] = sign_extend_32_to_xlen(val, XLEN);
-    val &= (uint32_t) cpu->regs[instr.r.rs2];
+    cpu->regs[instr->rd] = sign_extend_32_to_xlen(val, XLEN);
+    val &= (uint32_t) cpu->regs[instr->rs2];
 
     ex = rv_write_mem32(cpu, virt, val, true);
     ASSERT(ex == rv_exc_none);
@@ -903,12 +898,12 @@ static rv_exc_t rv_amoand_w_instr(rv_cpu_t *cpu, rv_instr_t instr)
 }
 
 /** RV64 ONLY */
-static rv_exc_t rv_amoand_d_instr(rv_cpu_t *cpu, rv_instr_t instr)
+static rv_exc_t rv_amoand_d_instr(rv_cpu_t *cpu, const rv_decoded_t *instr)
 {
     ASSERT(cpu != NULL);
-    ASSERT(instr.r.opcode == rv_opcAMO);
+    ASSERT(instr->data.r.opcode == rv_opcAMO);
 
-    uxlen_t virt = cpu->regs[instr.r.rs1];
+    uxlen_t virt = cpu->regs[instr->rs1];
 
     throw_if_wrong_privilege(cpu, virt);
     throw_if_misaligned_dword(cpu, virt);
@@ -918,9 +913,9 @@ static rv_exc_t rv_amoand_d_instr(rv_cpu_t *cpu, rv_instr_t instr)
     rv_exc_t ex = rv_read_mem64(cpu, virt, &val, false, true);
     ASSERT(ex == rv_exc_none);
 
-    cpu->regs[instr.r.rd] = val;
+    cpu->regs[instr->rd] = val;
 
-    val &= cpu->regs[instr.r.rs2];
+    val &= cpu->regs[instr->rs2];
 
     ex = rv_write_mem64(cpu, virt, val, true);
     ASSERT(ex == rv_exc_none);
@@ -928,9 +923,9 @@ static rv_exc_t rv_amoand_d_instr(rv_cpu_t *cpu, rv_instr_t instr)
     return ex;
 }
 
-static rv_exc_t rv_amoor_w_instr(rv_cpu_t *cpu, rv_instr_t instr)
+static rv_exc_t rv_amoor_w_instr(rv_cpu_t *cpu, const rv_decoded_t *instr)
 {
-    uxlen_t virt = cpu->regs[instr.r.rs1];
+    uxlen_t virt = cpu->regs[instr->rs1];
 
     throw_if_wrong_privilege(cpu, virt);
     throw_if_misaligned_word(cpu, virt);
@@ -939,8 +934,8 @@ static rv_exc_t rv_amoor_w_instr(rv_cpu_t *cpu, rv_instr_t instr)
     rv_exc_t ex = rv_read_mem32(cpu, virt, &val, false, true);
     ASSERT(ex == rv_exc_none);
 
-    cpu->regs[instr.r.rd] = sign_extend_32_to_xlen(val, XLEN);
-    val |= (uint32_t) cpu->regs[instr.r.rs2];
+    cpu->regs[instr->rd] = sign_extend_32_to_xlen(val, XLEN);
+    val |= (uint32_t) cpu->regs[instr->rs2];
 
     ex = rv_write_mem32(cpu, virt, val, true);
     ASSERT(ex == rv_exc_none);
@@ -948,12 +943,12 @@ static rv_exc_t rv_amoor_w_instr(rv_cpu_t *cpu, rv_instr_t instr)
 }
 
 /** RV64 ONLY */
-static rv_exc_t rv_amoor_d_instr(rv_cpu_t *cpu, rv_instr_t instr)
+static rv_exc_t rv_amoor_d_instr(rv_cpu_t *cpu, const rv_decoded_t *instr)
 {
     ASSERT(cpu != NULL);
-    ASSERT(instr.r.opcode == rv_opcAMO);
+    ASSERT(instr->data.r.opcode == rv_opcAMO);
 
-    uxlen_t virt = cpu->regs[instr.r.rs1];
+    uxlen_t virt = cpu->regs[instr->rs1];
 
     throw_if_wrong_privilege(cpu, virt);
     throw_if_misaligned_dword(cpu, virt);
@@ -963,9 +958,9 @@ static rv_exc_t rv_amoor_d_instr(rv_cpu_t *cpu, rv_instr_t instr)
     rv_exc_t ex = rv_read_mem64(cpu, virt, &val, false, true);
     ASSERT(ex == rv_exc_none);
 
-    cpu->regs[instr.r.rd] = val;
+    cpu->regs[instr->rd] = val;
 
-    val |= cpu->regs[instr.r.rs2];
+    val |= cpu->regs[instr->rs2];
 
     ex = rv_write_mem64(cpu, virt, val, true);
     ASSERT(ex == rv_exc_none);
@@ -973,9 +968,9 @@ static rv_exc_t rv_amoor_d_instr(rv_cpu_t *cpu, rv_instr_t instr)
     return ex;
 }
 
-static rv_exc_t rv_amomin_w_instr(rv_cpu_t *cpu, rv_instr_t instr)
+static rv_exc_t rv_amomin_w_instr(rv_cpu_t *cpu, const rv_decoded_t *instr)
 {
-    uxlen_t virt = cpu->regs[instr.r.rs1];
+    uxlen_t virt = cpu->regs[instr->rs1];
 
     throw_if_wrong_privilege(cpu, virt);
     throw_if_misaligned_word(cpu, virt);
@@ -984,8 +979,8 @@ static rv_exc_t rv_amomin_w_instr(rv_cpu_t *cpu, rv_instr_t instr)
     rv_exc_t ex = rv_read_mem32(cpu, virt, (uint32_t *) &val, false, true);
     ASSERT(ex == rv_exc_none);
 
-    cpu->regs[instr.r.rd] = sign_extend_32_to_xlen(val, XLEN);
-    int32_t rs2 = (int32_t) cpu->regs[instr.r.rs2];
+    cpu->regs[instr->rd] = sign_extend_32_to_xlen(val, XLEN);
+    int32_t rs2 = (int32_t) cpu->regs[instr->rs2];
     val = rs2 < val ? rs2 : val;
 
     ex = rv_write_mem32(cpu, virt, (uint32_t) val, true);
@@ -994,12 +989,12 @@ static rv_exc_t rv_amomin_w_instr(rv_cpu_t *cpu, rv_instr_t instr)
 }
 
 /** RV64 ONLY */
-static rv_exc_t rv_amomin_d_instr(rv_cpu_t *cpu, rv_instr_t instr)
+static rv_exc_t rv_amomin_d_instr(rv_cpu_t *cpu, const rv_decoded_t *instr)
 {
     ASSERT(cpu != NULL);
-    ASSERT(instr.r.opcode == rv_opcAMO);
+    ASSERT(instr->data.r.opcode == rv_opcAMO);
 
-    uxlen_t virt = cpu->regs[instr.r.rs1];
+    uxlen_t virt = cpu->regs[instr->rs1];
 
     throw_if_wrong_privilege(cpu, virt);
     throw_if_misaligned_dword(cpu, virt);
@@ -1008,8 +1003,8 @@ static rv_exc_t rv_amomin_d_instr(rv_cpu_t *cpu, rv_instr_t instr)
     rv_exc_t ex = rv_read_mem64(cpu, virt, (uint64_t *) &val, false, true);
     ASSERT(ex == rv_exc_none);
 
-    cpu->regs[instr.r.rd] = val;
-    int64_t rs2 = (int64_t) cpu->regs[instr.r.rs2];
+    cpu->regs[instr->rd] = val;
+    int64_t rs2 = (int64_t) cpu->regs[instr->rs2];
     val = rs2 < val ? rs2 : val;
 
     ex = rv_write_mem64(cpu, virt, (uint64_t) val, true);
@@ -1017,9 +1012,9 @@ static rv_exc_t rv_amomin_d_instr(rv_cpu_t *cpu, rv_instr_t instr)
     return ex;
 }
 
-static rv_exc_t rv_amomax_w_instr(rv_cpu_t *cpu, rv_instr_t instr)
+static rv_exc_t rv_amomax_w_instr(rv_cpu_t *cpu, const rv_decoded_t *instr)
 {
-    uxlen_t virt = cpu->regs[instr.r.rs1];
+    uxlen_t virt = cpu->regs[instr->rs1];
 
     throw_if_wrong_privilege(cpu, virt);
     throw_if_misaligned_word(cpu, virt);
@@ -1028,8 +1023,8 @@ static rv_exc_t rv_amomax_w_instr(rv_cpu_t *cpu, rv_instr_t instr)
     rv_exc_t ex = rv_read_mem32(cpu, virt, (uint32_t *) &val, false, true);
     ASSERT(ex == rv_exc_none);
 
-    cpu->regs[instr.r.rd] = sign_extend_32_to_xlen(val, XLEN);
-    int32_t rs2 = (int32_t) cpu->regs[instr.r.rs2];
+    cpu->regs[instr->rd] = sign_extend_32_to_xlen(val, XLEN);
+    int32_t rs2 = (int32_t) cpu->regs[instr->rs2];
     val = rs2 > val ? rs2 : val;
 
     ex = rv_write_mem32(cpu, virt, (uint32_t) val, true);
@@ -1038,9 +1033,9 @@ static rv_exc_t rv_amomax_w_instr(rv_cpu_t *cpu, rv_instr_t instr)
 }
 
 /** RV64 ONLY */
-static rv_exc_t rv_amomax_d_instr(rv_cpu_t *cpu, rv_instr_t instr)
+static rv_exc_t rv_amomax_d_instr(rv_cpu_t *cpu, const rv_decoded_t *instr)
 {
-    uxlen_t virt = cpu->regs[instr.r.rs1];
+    uxlen_t virt = cpu->regs[instr->rs1];
 
     throw_if_wrong_privilege(cpu, virt);
     throw_if_misaligned_dword(cpu, virt);
@@ -1049,8 +1044,8 @@ static rv_exc_t rv_amomax_d_instr(rv_cpu_t *cpu, rv_instr_t instr)
     rv_exc_t ex = rv_read_mem64(cpu, virt, (uint64_t *) &val, false, true);
     ASSERT(ex == rv_exc_none);
 
-    cpu->regs[instr.r.rd] = val;
-    int64_t rs2 = (int64_t) cpu->regs[instr.r.rs2];
+    cpu->regs[instr->rd] = val;
+    int64_t rs2 = (int64_t) cpu->regs[instr->rs2];
     val = rs2 > val ? rs2 : val;
 
     ex = rv_write_mem64(cpu, virt, (uint64_t) val, true);
@@ -1058,9 +1053,9 @@ static rv_exc_t rv_amomax_d_instr(rv_cpu_t *cpu, rv_instr_t instr)
     return ex;
 }
 
-static rv_exc_t rv_amominu_w_instr(rv_cpu_t *cpu, rv_instr_t instr)
+static rv_exc_t rv_amominu_w_instr(rv_cpu_t *cpu, const rv_decoded_t *instr)
 {
-    uxlen_t virt = cpu->regs[instr.r.rs1];
+    uxlen_t virt = cpu->regs[instr->rs1];
 
     throw_if_wrong_privilege(cpu, virt);
     throw_if_misaligned_word(cpu, virt);
@@ -1069,8 +1064,8 @@ static rv_exc_t rv_amominu_w_instr(rv_cpu_t *cpu, rv_instr_t instr)
     rv_exc_t ex = rv_read_mem32(cpu, virt, &val, false, true);
     ASSERT(ex == rv_exc_none);
 
-    cpu->regs[instr.r.rd] = zero_extend_32_to_xlen(val, XLEN);
-    uint32_t rs2 = (uint32_t) cpu->regs[instr.r.rs2];
+    cpu->regs[instr->rd] = zero_extend_32_to_xlen(val, XLEN);
+    uint32_t rs2 = (uint32_t) cpu->regs[instr->rs2];
     val = rs2 < val ? rs2 : val;
 
     ex = rv_write_mem32(cpu, virt, val, true);
@@ -1079,12 +1074,12 @@ static rv_exc_t rv_amominu_w_instr(rv_cpu_t *cpu, rv_instr_t instr)
 }
 
 /** RV64 ONLY */
-static rv_exc_t rv_amominu_d_instr(rv_cpu_t *cpu, rv_instr_t instr)
+static rv_exc_t rv_amominu_d_instr(rv_cpu_t *cpu, const rv_decoded_t *instr)
 {
     ASSERT(cpu != NULL);
-    ASSERT(instr.r.opcode == rv_opcAMO);
+    ASSERT(instr->data.r.opcode == rv_opcAMO);
 
-    uxlen_t virt = cpu->regs[instr.r.rs1];
+    uxlen_t virt = cpu->regs[instr->rs1];
 
     throw_if_wrong_privilege(cpu, virt);
     throw_if_misaligned_dword(cpu, virt);
@@ -1093,8 +1088,8 @@ static rv_exc_t rv_amominu_d_instr(rv_cpu_t *cpu, rv_instr_t instr)
     rv_exc_t ex = rv_read_mem64(cpu, virt, &val, false, true);
     ASSERT(ex == rv_exc_none);
 
-    cpu->regs[instr.r.rd] = val;
-    uint64_t rs2 = cpu->regs[instr.r.rs2];
+    cpu->regs[instr->rd] = val;
+    uint64_t rs2 = cpu->regs[instr->rs2];
     val = rs2 < val ? rs2 : val;
 
     ex = rv_write_mem64(cpu, virt, val, true);
@@ -1102,9 +1097,9 @@ static rv_exc_t rv_amominu_d_instr(rv_cpu_t *cpu, rv_instr_t instr)
     return ex;
 }
 
-static rv_exc_t rv_amomaxu_w_instr(rv_cpu_t *cpu, rv_instr_t instr)
+static rv_exc_t rv_amomaxu_w_instr(rv_cpu_t *cpu, const rv_decoded_t *instr)
 {
-    uxlen_t virt = cpu->regs[instr.r.rs1];
+    uxlen_t virt = cpu->regs[instr->rs1];
 
     throw_if_wrong_privilege(cpu, virt);
     throw_if_misaligned_word(cpu, virt);
@@ -1113,8 +1108,8 @@ static rv_exc_t rv_amomaxu_w_instr(rv_cpu_t *cpu, rv_instr_t instr)
     rv_exc_t ex = rv_read_mem32(cpu, virt, &val, false, true);
     ASSERT(ex == rv_exc_none);
 
-    cpu->regs[instr.r.rd] = zero_extend_32_to_xlen(val, XLEN);
-    uint32_t rs2 = (uint32_t) cpu->regs[instr.r.rs2];
+    cpu->regs[instr->rd] = zero_extend_32_to_xlen(val, XLEN);
+    uint32_t rs2 = (uint32_t) cpu->regs[instr->rs2];
     val = rs2 > val ? rs2 : val;
 
     ex = rv_write_mem32(cpu, virt, val, true);
@@ -1123,12 +1118,12 @@ static rv_exc_t rv_amomaxu_w_instr(rv_cpu_t *cpu, rv_instr_t instr)
 }
 
 /** RV64 ONLY */
-static rv_exc_t rv_amomaxu_d_instr(rv_cpu_t *cpu, rv_instr_t instr)
+static rv_exc_t rv_amomaxu_d_instr(rv_cpu_t *cpu, const rv_decoded_t *instr)
 {
     ASSERT(cpu != NULL);
-    ASSERT(instr.r.opcode == rv_opcAMO);
+    ASSERT(instr->data.r.opcode == rv_opcAMO);
 
-    uxlen_t virt = cpu->regs[instr.r.rs1];
+    uxlen_t virt = cpu->regs[instr->rs1];
 
     throw_if_wrong_privilege(cpu, virt);
     throw_if_misaligned_dword(cpu, virt);
@@ -1137,8 +1132,8 @@ static rv_exc_t rv_amomaxu_d_instr(rv_cpu_t *cpu, rv_instr_t instr)
     rv_exc_t ex = rv_read_mem64(cpu, virt, &val, false, true);
     ASSERT(ex == rv_exc_none);
 
-    cpu->regs[instr.r.rd] = val;
-    uint64_t rs2 = cpu->regs[instr.r.rs2];
+    cpu->regs[instr->rd] = val;
+    uint64_t rs2 = cpu->regs[instr->rs2];
     val = rs2 > val ? rs2 : val;
 
     ex = rv_write_mem64(cpu, virt, val, true);
@@ -48,17 +48,17 @@ enum rv_exc rv_csr_rw(rv_cpu_t *cpu, csr_num_t csr, uxlen_t value, uxlen_t *read
 enum rv_exc rv_csr_rs(rv_cpu_t *cpu, csr_num_t csr, uxlen_t value, uxlen_t *read_target, bool write);
 enum rv_exc rv_csr_rc(rv_cpu_t *cpu, csr_num_t csr, uxlen_t value, uxlen_t *read_target, bool write);
 
-static rv_exc_t rv_illegal_instr(rv_cpu_t *cpu, rv_instr_t instr)
+static rv_exc_t rv_illegal_instr(rv_cpu_t *cpu, const rv_decoded_t *instr)
 {
     return machine_undefined ? rv_exc_none : rv_exc_illegal_instruction;
 }
 
-static rv_exc_t rv_lb_instr(rv_cpu_t *cpu, rv_instr_t instr)
+static rv_exc_t rv_lb_instr(rv_cpu_t *cpu, const rv_decoded_t *instr)
 {
     ASSERT(cpu != NULL);
-    ASSERT(instr.i.opcode == rv_opcLOAD);
+    ASSERT(instr->data.i.opcode == rv_opcLOAD);
 
-    uxlen_t virt = cpu->regs[instr.i.rs1] + (xlen_t) instr.i.imm;
+    uxlen_t virt = cpu->regs[instr->rs1] + (xlen_t) instr->imm;
 
     uint8_t val;
 
@@ -69,17 +69,17 @@ static rv_exc_t rv_lb_instr(rv_cpu_t *cpu, rv_instr_t instr)
     }
 
     // Sign extension magic
-    cpu->regs[instr.i.rd] = sign_extend_8_to_xlen(val, XLEN);
+    cpu->regs[instr->rd] = sign_extend_8_to_xlen(val, XLEN);
 
     return rv_exc_none;
 }
 
-static rv_exc_t rv_lh_instr(rv_cpu_t *cpu, rv_instr_t instr)
+static rv_exc_t rv_lh_instr(rv_cpu_t *cpu, const rv_decoded_t *instr)
 {
     ASSERT(cpu != NULL);
-    ASSERT(instr.i.opcode == rv_opcLOAD);
+    ASSERT(instr->data.i.opcode == rv_opcLOAD);
 
-    uxlen_t virt = cpu->regs[instr.i.rs1] + (xlen_t) instr.i.imm;
+    uxlen_t virt = cpu->regs[instr->rs1] + (xlen_t) instr->imm;
 
     uint16_t val;
 
@@ -90,17 +90,17 @@ static rv_exc_t rv_lh_instr(rv_cpu_t *cpu, rv_instr_t instr)
     }
 
     // Sign extension magic
-    cpu->regs[instr.i.rd] = sign_extend_16_to_xlen(val, XLEN);
+    cpu->regs[instr->rd] = sign_extend_16_to_xlen(val, XLEN);
 
     return rv_exc_none;
 }
 
-static rv_exc_t rv_lw_instr(rv_cpu_t *cpu, rv_instr_t instr)
+static rv_exc_t rv_lw_instr(rv_cpu_t *cpu, const rv_decoded_t *instr)
 {
     ASSERT(cpu != NULL);
-    ASSERT(instr.i.opcode == rv_opcLOAD);
+    ASSERT(instr->data.i.opcode == rv_opcLOAD);
 
-    uxlen_t virt = cpu->regs[instr.i.rs1] + (xlen_t) instr.i.imm;
+    uxlen_t virt = cpu->regs[instr->rs1] + (xlen_t) instr->imm;
 
     if (!IS_ALIGNED(virt, 4)) {
         cpu->csr.tval_next = virt;
@@ -115,18 +115,18 @@ static rv_exc_t rv_lw_instr(rv_cpu_t *cpu, rv_instr_t instr)
         return ex;
     }
 
-    cpu->regs[instr.i.rd] = sign_extend_32_to_xlen(val, XLEN);
+    cpu->regs[instr->rd] = sign_extend_32_to_xlen(val, XLEN);
 
     return rv_exc_none;
 }
 
 /** RV64 SPECIFIC */
-static rv_exc_t rv_ld_instr(rv_cpu_t *cpu, rv_instr_t instr)
+static rv_exc_t rv_ld_instr(rv_cpu_t *cpu, const rv_decoded_t *instr)
 {
     ASSERT(cpu != NULL);
-    ASSERT(instr.i.opcode == rv_opcLOAD);
+    ASSERT(instr->data.i.opcode == rv_opcLOAD);
 
-    uxlen_t virt = cpu->regs[instr.i.rs1] + (xlen_t) instr.i.imm;
+    uxlen_t virt = cpu->regs[instr->rs1] + (xlen_t) instr->imm;
 
     // ! Maybe???
     if (!IS_ALIGNED(virt, 8)) {
@@ -142,17 +142,17 @@ static rv_exc_t rv_ld_instr(rv_cpu_t *cpu, rv_instr_t instr)
         return ex;
     }
 
-    cpu->regs[instr.i.rd] = val;
+    cpu->regs[instr->rd] = val;
 
     return rv_exc_none;
 }
 
-static rv_exc_t rv_lbu_instr(rv_cpu_t *cpu, rv_instr_t instr)
+static rv_exc_t rv_lbu_instr(rv_cpu_t *cpu, const rv_decoded_t *instr)
 {
     ASSERT(cpu != NULL);
-    ASSERT(instr.i.opcode == rv_opcLOAD);
+    ASSERT(instr->data.i.opcode == rv_opcLOAD);
 
-    uxlen_t virt = cpu->regs[instr.i.rs1] + (xlen_t) instr.i.imm;
+    uxlen_t virt = cpu->regs[instr->rs1] + (xlen_t) instr->imm;
 
     uint8_t val;
 
@@ -162,17 +162,17 @@ static rv_exc_t rv_lbu_instr(rv_cpu_t *cpu, rv_instr_t instr)
         return ex;
     }
 
-    cpu->regs[instr.i.rd] = (uxlen_t) val;
+    cpu->regs[instr->rd] = (uxlen_t) val;
 
     return rv_exc_none;
 }
 
-static rv_exc_t rv_lhu_instr(rv_cpu_t *cpu, rv_instr_t instr)
+static rv_exc_t rv_lhu_instr(rv_cpu_t *cpu, const rv_decoded_t *instr)
 {
     ASSERT(cpu != NULL);
-    ASSERT(instr.i.opcode == rv_opcLOAD);
+    ASSERT(instr->data.i.opcode == rv_opcLOAD);
 
-    uxlen_t virt = cpu->regs[instr.i.rs1] + (xlen_t) instr.i.imm;
+    uxlen_t virt = cpu->regs[instr->rs1] + (xlen_t) instr->imm;
 
     if (!IS_ALIGNED(virt, 2)) {
         cpu->csr.tval_next = virt;
@@ -187,18 +187,18 @@ static rv_exc_t rv_lhu_instr(rv_cpu_t *cpu, rv_instr_t instr)
         return ex;
     }
 
-    cpu->regs[instr.i.rd] = (uxlen_t) val;
+    cpu->regs[instr->rd] = (uxlen_t) val;
 
     return rv_exc_none;
 }
 
 /** RV64 SPECIFIC */
-static rv_exc_t rv_lwu_instr(rv_cpu_t *cpu, rv_instr_t instr)
+static rv_exc_t rv_lwu_instr(rv_cpu_t *cpu, const rv_decoded_t *instr)
 {
     ASSERT(cpu != NULL);
-    ASSERT(instr.i.opcode == rv_opcLOAD);
+    ASSERT(instr->data.i.opcode == rv_opcLOAD);
 
-    uxlen_t virt = cpu->regs[instr.i.rs1] + (xlen_t) instr.i.imm;
+    uxlen_t virt = cpu->regs[instr->rs1] + (xlen_t) instr->imm;
 
     if (!IS_ALIGNED(virt, 4)) {
         cpu->csr.tval_next = virt;
@@ -213,53 +213,53 @@ static rv_exc_t rv_lwu_instr(rv_cpu_t *cpu, rv_instr_t instr)
         return ex;
     }
 
-    cpu->regs[instr.i.rd] = (uxlen_t) val;
+    cpu->regs[instr->rd] = (uxlen_t) val;
 
     return rv_exc_none;
 }
 
-static rv_exc_t rv_sb_instr(rv_cpu_t *cpu, rv_instr_t instr)
+static rv_exc_t rv_sb_instr(rv_cpu_t *cpu, const rv_decoded_t *instr)
 {
     ASSERT(cpu != NULL);
-    ASSERT(instr.s.opcode == rv_opcSTORE);
+    ASSERT(instr->data.s.opcode == rv_opcSTORE);
 
-    uxlen_t virt = cpu->regs[instr.s.rs1] + RV_S_IMM(instr);
+    uxlen_t virt = cpu->regs[instr->rs1] + (uxlen_t) instr->imm;
 
-    return rv_write_mem8(cpu, virt, (uint8_t) cpu->regs[instr.s.rs2], true);
+    return rv_write_mem8(cpu, virt, (uint8_t) cpu->regs[instr->rs2], true);
 }
 
-static rv_exc_t rv_sh_instr(rv_cpu_t *cpu, rv_instr_t instr)
+static rv_exc_t rv_sh_instr(rv_cpu_t *cpu, const rv_decoded_t *instr)
 {
     ASSERT(cpu != NULL);
-    ASSERT(instr.s.opcode == rv_opcSTORE);
+    ASSERT(instr->data.s.opcode == rv_opcSTORE);
 
-    uxlen_t virt = cpu->regs[instr.s.rs1] + RV_S_IMM(instr);
+    uxlen_t virt = cpu->regs[instr->rs1] + (uxlen_t) instr->imm;
 
-    return rv_write_mem16(cpu, virt, (uint16_t) cpu->regs[instr.s.rs2], true);
+    return rv_write_mem16(cpu, virt, (uint16_t) cpu->regs[instr->rs2], true);
 }
 
-static rv_exc_t rv_sw_instr(rv_cpu_t *cpu, rv_instr_t instr)
+static rv_exc_t rv_sw_instr(rv_cpu_t *cpu, const rv_decoded_t *instr)
 {
     ASSERT(cpu != NULL);
-    ASSERT(instr.s.opcode == rv_opcSTORE);
+    ASSERT(instr->data.s.opcode == rv_opcSTORE);
 
-    uxlen_t virt = cpu->regs[instr.s.rs1] + RV_S_IMM(instr);
+    uxlen_t virt = cpu->regs[instr->rs1] + (uxlen_t) instr->imm;
 
-    return rv_write_mem32(cpu, virt, (uint32_t) cpu->regs[instr.s.rs2], true);
+    return rv_write_mem32(cpu, virt, (uint32_t) cpu->regs[instr->rs2], true);
 }
 
 /** RV64 SPECIFIC */
-static rv_exc_t rv_sd_instr(rv_cpu_t *cpu, rv_instr_t instr)
+static rv_exc_t rv_sd_instr(rv_cpu_t *cpu, const rv_decoded_t *instr)
 {
     ASSERT(cpu != NULL);
-    ASSERT(instr.s.opcode == rv_opcSTORE);
+    ASSERT(instr->data.s.opcode == rv_opcSTORE);
 
-    uxlen_t virt = cpu->regs[instr.s.rs1] + RV_S_IMM(instr);
+    uxlen_t virt = cpu->regs[instr->rs1] + (uxlen_t) instr->imm;
 
-    return rv_write_mem64(cpu, virt, cpu->regs[instr.s.rs2], true);
+    return rv_write_mem64(cpu, virt, cpu->regs[instr->rs2], true);
 }
 
-static rv_exc_t rv_fence_instr(rv_cpu_t *cpu, rv_instr_t instr)
+static rv_exc_t rv_fence_instr(rv_cpu_t *cpu, const rv_decoded_t *instr)
 {
     // FENCE instruction does nothing in deterministic emulator,
     // where out-of-order processing is not allowed
@@ -268,13 +268,13 @@ static rv_exc_t rv_fence_instr(rv_cpu_t *cpu, rv_instr_t instr)
 
 /* A extension LR and SC */
 
-static rv_exc_t rv_lr_w_instr(rv_cpu_t *cpu, rv_instr_t instr)
+static rv_exc_t rv_lr_w_instr(rv_cpu_t *cpu, const rv_decoded_t *instr)
 {
     ASSERT(cpu != NULL);
-    ASSERT(instr.r.opcode == rv_opcAMO);
-    ASSERT(instr.r.rs2 == 0);
+    ASSERT(instr->data.r.opcode == rv_opcAMO);
+    ASSERT(instr->rs2 == 0);
 
-    uxlen_t virt = cpu->regs[instr.r.rs1];
+    uxlen_t virt = cpu->regs[instr->rs1];
 
     uint32_t val;
     rv_exc_t ex = rv_read_mem32(cpu, virt, &val, false, true);
@@ -296,7 +296,7 @@ static rv_exc_t rv_lr_w_instr(rv_cpu_t *cpu, rv_instr_t instr)
     }
 
     // store the read value
-    cpu->regs[instr.r.rd] = zero_extend_32_to_xlen(val, XLEN);
+    cpu->regs[instr->rd] = zero_extend_32_to_xlen(val, XLEN);
 
     // we track physical addresses, so convert
     // this should not fail
@@ -307,25 +307,25 @@ static rv_exc_t rv_lr_w_instr(rv_cpu_t *cpu, rv_instr_t instr)
 
     // register address for tracking
 
-    sc_register(cpu->csr.mhartid);
+    sc_register(cpu->csr.mhartid, phys);
     cpu->reserved_valid = true;
     cpu->reserved_addr = phys;
 
     return rv_exc_none;
 }
 
-static rv_exc_t rv_sc_w_instr(rv_cpu_t *cpu, rv_instr_t instr)
+static rv_exc_t rv_sc_w_instr(rv_cpu_t *cpu, const rv_decoded_t *instr)
 {
     ASSERT(cpu != NULL);
-    ASSERT(instr.r.opcode == rv_opcAMO);
+    ASSERT(instr->data.r.opcode == rv_opcAMO);
 
     // convert addr and check if the target is tracked
-    uxlen_t virt = cpu->regs[instr.r.rs1];
+    uxlen_t virt = cpu->regs[instr->rs1];
     ptr36_t phys;
 
     if (cpu->reserved_valid == false) {
         // reservation is not valid
-        cpu->regs[instr.r.rd] = 1;
+        cpu->regs[instr->rd] = 1;
         return rv_exc_none;
     }
 
@@ -336,18 +336,18 @@ static rv_exc_t rv_sc_w_instr(rv_cpu_t *cpu, rv_instr_t instr)
     rv_exc_t ex = rv_convert_addr(cpu, virt, &phys, true, false, true);
 
     if (ex != rv_exc_none) {
-        cpu->regs[instr.r.rd] = 1;
+        cpu->regs[instr->rd] = 1;
         return ex;
     }
 
     if (!IS_ALIGNED(virt, 4)) {
-        cpu->regs[instr.r.rd] = 1;
+        cpu->regs[instr->rd] = 1;
         return rv_exc_store_amo_address_misaligned;
     }
 
     if (phys != cpu->reserved_addr) {
         alert("RV32IMA: LR/SC addresses do not match");
-        cpu->regs[instr.r.rd] = 1;
+        cpu->regs[instr->rd] = 1;
         return rv_exc_none;
     }
 
@@ -357,15 +357,15 @@ static rv_exc_t rv_sc_w_instr(rv_cpu_t *cpu, rv_instr_t instr)
     // and risc-v allows only aligned accesses (without Zam extension) and only 32-bit atomics are supported here
     // this should be fine
 
-    ex = rv_write_mem32(cpu, virt, (uint32_t) cpu->regs[instr.r.rs2], true);
+    ex = rv_write_mem32(cpu, virt, (uint32_t) cpu->regs[instr->rs2], true);
 
     if (ex != rv_exc_none) {
         alert("RV32IMA: SC write failed after successful address translation");
-        cpu->regs[instr.r.rd] = 1;
+        cpu->regs[instr->rd] = 1;
         return ex;
     }
 
-    cpu->regs[instr.r.rd] = 0;
+    cpu->regs[instr->rd] = 0;
     return rv_exc_none;
 }
 
@@ -375,13 +375,13 @@ static rv_exc_t rv_sc_w_instr(rv_cpu_t *cpu, rv_instr_t instr)
  * Loads a XLEN-bit value from memory at address in rs1 and registers the address
  * for a subsequent store-conditional. Places the loaded value in rd.
  */
-static rv_exc_t rv_lr_instr(rv_cpu_t *cpu, rv_instr_t instr)
+static rv_exc_t rv_lr_instr(rv_cpu_t *cpu, const rv_decoded_t *instr)
 {
     ASSERT(cpu != NULL);
-    ASSERT(instr.r.opcode == rv_opcAMO);
-    ASSERT(instr.r.rs2 == 0);
+    ASSERT(instr->data.r.opcode == rv_opcAMO);
+    ASSERT(instr->rs2 == 0);
 
-    uxlen_t virt = cpu->regs[instr.r.rs1];
+    uxlen_t virt = cpu->regs[instr->rs1];
 
     uxlen_t val;
     rv_exc_t ex = rv_read_xlen()(cpu, virt, &val, false, true);
@@ -400,13 +400,13 @@ static rv_exc_t rv_lr_instr(rv_cpu_t *cpu, rv_instr_t instr)
     }
 
     // store the read value
-    cpu->regs[instr.r.rd] = val;
+    cpu->regs[instr->rd] = val;
 
     ptr36_t phys;
     ex = rv_convert_addr(cpu, virt, &phys, false, false, false);
     ASSERT(ex == rv_exc_none);
 
-    sc_register(cpu->csr.mhartid);
+    sc_register(cpu->csr.mhartid, phys);
     cpu->reserved_valid = true;
     cpu->reserved_addr = phys;
 
@@ -419,18 +419,18 @@ static rv_exc_t rv_lr_instr(rv_cpu_t *cpu, rv_instr_t instr)
  * Stores a XLEN-bit value from rs2 to memory at address in rs1 if a valid
  * reservation exists. Returns 0 in rd on success, 1 on failure.
  */
-static rv_exc_t rv_sc_instr(rv_cpu_t *cpu, rv_instr_t instr)
+static rv_exc_t rv_sc_instr(rv_cpu_t *cpu, const rv_decoded_t *instr)
 {
     ASSERT(cpu != NULL);
-    ASSERT(instr.r.opcode == rv_opcAMO);
+    ASSERT(instr->data.r.opcode == rv_opcAMO);
 
     // Get virtual address from rs1
-    uxlen_t virt = cpu->regs[instr.r.rs1];
+    uxlen_t virt = cpu->regs[instr->rs1];
     ptr36_t phys;
 
     if (cpu->reserved_valid == false) {
         // reservation is not valid, return failure
-        cpu->regs[instr.r.rd] = 1;
+        cpu->regs[instr->rd] = 1;
         return rv_exc_none;
     }
 
@@ -441,32 +441,32 @@ static rv_exc_t rv_sc_instr(rv_cpu_t *cpu, rv_instr_t instr)
     rv_exc_t ex = rv_convert_addr(cpu, virt, &phys, true, false, true);
 
     if (ex != rv_exc_none) {
-        cpu->regs[instr.r.rd] = 1;
+        cpu->regs[instr->rd] = 1;
         return ex;
     }
 
     // Check alignment - doubleword must be aligned to 8 bytes in RV64
     if (!IS_ALIGNED(virt, 8)) {
-        cpu->regs[instr.r.rd] = 1;
+        cpu->regs[instr->rd] = 1;
         return rv_exc_store_amo_address_misaligned;
     }
 
     // Check if this is the same address that was reserved
     if (phys != cpu->reserved_addr) {
         alert("RV64IMA: LR/SC addresses do not match");
-        cpu->regs[instr.r.rd] = 1;
+        cpu->regs[instr->rd] = 1;
         return rv_exc_none;
     }
 
-    ex = rv_write_mem64(cpu, virt, cpu->regs[instr.r.rs2], true);
+    ex = rv_write_mem64(cpu, virt, cpu->regs[instr->rs2], true);
 
     if (ex != rv_exc_none) {
         alert("RV64IMA: SC write failed after successful address translation");
-        cpu->regs[instr.r.rd] = 1;
+        cpu->regs[instr->rd] = 1;
         return ex;
     }
 
     // Success: store 0 to rd
-    cpu->regs[instr.r.rd] = 0;
+    cpu->regs[instr->rd] = 0;
     return rv_exc_none;
 }
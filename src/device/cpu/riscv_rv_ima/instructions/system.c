@@ -31,10 +31,10 @@ rv_exc_t rv_write_mem32(rv_cpu_t *cpu, virt_t virt, uint32_t value, bool noisy);
 rv_exc_t rv_write_mem64(rv_cpu_t *cpu, virt_t virt, uint64_t value, bool noisy);
 rv_exc_t rv_convert_addr(rv_cpu_t *cpu, virt_t virt, ptr36_t *phys, bool wr, bool fetch, bool noisy);
 
-static rv_exc_t rv_break_instr(rv_cpu_t *cpu, rv_instr_t instr)
+static rv_exc_t rv_break_instr(rv_cpu_t *cpu, const rv_decoded_t *instr)
 {
     ASSERT(cpu != NULL);
-    ASSERT(instr.i.opcode == rv_opcSYSTEM);
+    ASSERT(instr->data.i.opcode == rv_opcSYSTEM);
 
     if (input_is_terminal() || machine_allow_interactive_without_tty) {
         alert("EBREAK: breakpoint reached, entering interactive mode");
@@ -47,10 +47,10 @@ static rv_exc_t rv_break_instr(rv_cpu_t *cpu, rv_instr_t instr)
     return rv_exc_none;
 }
 
-static rv_exc_t rv_halt_instr(rv_cpu_t *cpu, rv_instr_t instr)
+static rv_exc_t rv_halt_instr(rv_cpu_t *cpu, const rv_decoded_t *instr)
 {
     ASSERT(cpu != NULL);
-    ASSERT(instr.i.opcode == rv_opcSYSTEM);
+    ASSERT(instr->data.i.opcode == rv_opcSYSTEM);
 
     alert("EHALT: Machine halt");
 
@@ -58,25 +58,25 @@ static rv_exc_t rv_halt_instr(rv_cpu_t *cpu, rv_instr_t instr)
     return rv_exc_none;
 }
 
-static rv_exc_t rv_trace_set_instr(rv_cpu_t *cpu, rv_instr_t instr)
+static rv_exc_t rv_trace_set_instr(rv_cpu_t *cpu, const rv_decoded_t *instr)
 {
     ASSERT(cpu != NULL);
-    ASSERT(instr.i.opcode == rv_opcSYSTEM);
+    ASSERT(instr->data.i.opcode == rv_opcSYSTEM);
     alert("ETRACES: Trace Set");
     machine_trace = true;
     return rv_exc_none;
 }
 
-static rv_exc_t rv_trace_reset_instr(rv_cpu_t *cpu, rv_instr_t instr)
+static rv_exc_t rv_trace_reset_instr(rv_cpu_t *cpu, const rv_decoded_t *instr)
 {
     ASSERT(cpu != NULL);
-    ASSERT(instr.i.opcode == rv_opcSYSTEM);
+    ASSERT(instr->data.i.opcode == rv_opcSYSTEM);
     alert("ETRACES: Trace Reset");
     machine_trace = false;
     return rv_exc_none;
 }
 
-static rv_exc_t rv_call_instr(rv_cpu_t *cpu, rv_instr_t instr)
+static rv_exc_t rv_call_instr(rv_cpu_t *cpu, const rv_decoded_t *instr)
 {
     switch (cpu->priv_mode) {
     case rv_umode:
@@ -90,7 +90,7 @@ static rv_exc_t rv_call_instr(rv_cpu_t *cpu, rv_instr_t instr)
     }
 }
 
-static rv_exc_t rv_sret_instr(rv_cpu_t *cpu, rv_instr_t instr)
+static rv_exc_t rv_sret_instr(rv_cpu_t *cpu, const rv_decoded_t *instr)
 {
     if (rv_csr_mstatus_tsr(cpu)) {
         return rv_exc_illegal_instruction;
@@ -132,7 +132,7 @@ static rv_exc_t rv_sret_instr(rv_cpu_t *cpu, rv_instr_t instr)
     return rv_exc_none;
 }
 
-static rv_exc_t rv_mret_instr(rv_cpu_t *cpu, rv_instr_t instr)
+static rv_exc_t rv_mret_instr(rv_cpu_t *cpu, const rv_decoded_t *instr)
 {
     if (cpu->priv_mode < rv_mmode) {
         return rv_exc_illegal_instruction;
@@ -172,7 +172,7 @@ static rv_exc_t rv_mret_instr(rv_cpu_t *cpu, rv_instr_t instr)
     return rv_exc_none;
 }
 
-static rv_exc_t rv_wfi_instr(rv_cpu_t *cpu, rv_instr_t instr)
+static rv_exc_t rv_wfi_instr(rv_cpu_t *cpu, const rv_decoded_t *instr)
 {
 
     if (rv_csr_mstatus_tw(cpu) && cpu->priv_mode != rv_mmode) {
@@ -190,62 +190,62 @@ static rv_exc_t rv_wfi_instr(rv_cpu_t *cpu, rv_instr_t instr)
 // Note: csrrw reads with rd = x0 shall not read the CSR and shall not have any side-efects based on the read
 //       similarly, csrrs and csrrc writes with rs1 = x0 (or uimm = 0) shall not write anything
 
-static rv_exc_t rv_csrrw_instr(rv_cpu_t *cpu, rv_instr_t instr)
+static rv_exc_t rv_csrrw_instr(rv_cpu_t *cpu, const rv_decoded_t *instr)
 {
-    int csr = ((uint32_t) instr.i.imm) & 0xFFF;
-    uxlen_t val = cpu->regs[instr.i.rs1];
-    uxlen_t *rd = (uxlen_t *) (&cpu->regs[instr.i.rd]);
-    bool read = instr.i.rd != 0;
+    int csr = ((uint32_t) instr->imm) & 0xFFF;
+    uxlen_t val = cpu->regs[instr->rs1];
+    uxlen_t *rd = (uxlen_t *) (&cpu->regs[instr->rd]);
+    bool read = instr->rd != 0;
 
     return rv_csr_rw((void *) cpu, csr, val, rd, read);
 }
 
-static rv_exc_t rv_csrrs_instr(rv_cpu_t *cpu, rv_instr_t instr)
+static rv_exc_t rv_csrrs_instr(rv_cpu_t *cpu, const rv_decoded_t *instr)
 {
-    int csr = ((uint32_t) instr.i.imm) & 0xFFF;
-    uxlen_t val = cpu->regs[instr.i.rs1];
-    uxlen_t *rd = (uxlen_t *) &cpu->regs[instr.i.rd];
-    bool write = instr.i.rs1 != 0;
+    int csr = ((uint32_t) instr->imm) & 0xFFF;
+    uxlen_t val = cpu->regs[instr->rs1];
+    uxlen_t *rd = (uxlen_t *) &cpu->regs[instr->rd];
+    bool write = instr->rs1 != 0;
 
     return rv_csr_rs((void *) cpu, csr, val, rd, write);
 }
 
-static rv_exc_t rv_csrrc_instr(rv_cpu_t *cpu, rv_instr_t instr)
+static rv_exc_t rv_csrrc_instr(rv_cpu_t *cpu, const rv_decoded_t *instr)
 {
-    int csr = ((uint32_t) instr.i.imm) & 0xFFF;
-    uxlen_t val = cpu->regs[instr.i.rs1];
-    uxlen_t *rd = (uxlen_t *) &cpu->regs[instr.i.rd];
-    bool write = instr.i.rs1 != 0;
+    int csr = ((uint32_t) instr->imm) & 0xFFF;
+    uxlen_t val = cpu->regs[instr->rs1];
+    uxlen_t *rd = (uxlen_t *) &cpu->regs[instr->rd];
+    bool write = instr->rs1 != 0;
 
     return rv_csr_rc((void *) cpu, csr, val, rd, write);
 }
 
-static rv_exc_t rv_csrrwi_instr(rv_cpu_t *cpu, rv_instr_t instr)
+static rv_exc_t rv_csrrwi_instr(rv_cpu_t *cpu, const rv_decoded_t *instr)
 {
-    int csr = ((uint32_t) instr.i.imm) & 0xFFF;
-    uxlen_t val = instr.i.rs1; // Zero extended
-    uxlen_t *rd = (uxlen_t *) &cpu->regs[instr.i.rd];
-    bool read = instr.i.rd != 0;
+    int csr = ((uint32_t) instr->imm) & 0xFFF;
+    uxlen_t val = instr->rs1; // Zero extended
+    uxlen_t *rd = (uxlen_t *) &cpu->regs[instr->rd];
+    bool read = instr->rd != 0;
 
     return rv_csr_rw((void *) cpu, csr, val, rd, read);
 }
 
-static rv_exc_t rv_csrrsi_instr(rv_cpu_t *cpu, rv_instr_t instr)
+static rv_exc_t rv_csrrsi_instr(rv_cpu_t *cpu, const rv_decoded_t *instr)
 {
-    int csr = ((uint32_t) instr.i.imm) & 0xFFF;
-    uxlen_t val = instr.i.rs1; // Zero extended
-    uxlen_t *rd = (uxlen_t *) &cpu->regs[instr.i.rd];
-    bool write = instr.i.rs1 != 0;
+    int csr = ((uint32_t) instr->imm) & 0xFFF;
+    uxlen_t val = instr->rs1; // Zero extended
+    uxlen_t *rd = (uxlen_t *) &cpu->regs[instr->rd];
+    bool write = instr->rs1 != 0;
 
     return rv_csr_rs((void *) cpu, csr, val, rd, write);
 }
 
-static rv_exc_t rv_csrrci_instr(rv_cpu_t *cpu, rv_instr_t instr)
+static rv_exc_t rv_csrrci_instr(rv_cpu_t *cpu, const rv_decoded_t *instr)
 {
-    int csr = ((uint32_t) instr.i.imm) & 0xFFF;
-    uxlen_t val = instr.i.rs1; // Zero extended
-    uxlen_t *rd = (uxlen_t *) &cpu->regs[instr.i.rd];
-    bool write = instr.i.rs1 != 0;
+    int csr = ((uint32_t) instr->imm) & 0xFFF;
+    uxlen_t val = instr->rs1; // Zero extended
+    uxlen_t *rd = (uxlen_t *) &cpu->regs[instr->rd];
+    bool write = instr->rs1 != 0;
 
     return rv_csr_rc((void *) cpu, csr, val, rd, write);
 }
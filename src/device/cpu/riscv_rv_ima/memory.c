@@ -23,8 +23,10 @@
 
 #if XLEN == 64
 #define rv_convert_addr rv64_convert_addr
+#define rv_cpu_sync_mtime rv64_cpu_sync_mtime
 #elif XLEN == 32
 #define rv_convert_addr rv32_convert_addr
+#define rv_cpu_sync_mtime rv32_cpu_sync_mtime
 #endif
 
 #define read_address_misaligned_exception (fetch ? rv_exc_instruction_address_misaligned : rv_exc_load_address_misaligned)
@@ -36,11 +38,12 @@
         return false; \
     int offset = (virt & 0x7) * 8; \
     if (ALIGN_DOWN(virt, 8) == RV_MTIME_ADDRESS) { \
-        *value = (type) EXTRACT_BITS(cpu->csr.mtime, offset, offset + (width) / 8); \
+        rv_cpu_sync_mtime(cpu); \
+        *value = (type) (cpu->csr.mtime >> offset); \
         return true; \
     } \
     if (ALIGN_DOWN(virt, 8) == RV_MTIMECMP_ADDRESS) { \
-        *value = (type) EXTRACT_BITS(cpu->csr.mtimecmp, offset, offset + (width) / 8); \
+        *value = (type) (cpu->csr.mtimecmp >> offset); \
         return true; \
     } \
     return false;
@@ -94,11 +97,13 @@ static bool try_write_memory_mapped_regs(rv_cpu_t *cpu, uint64_t virt, uint64_t
     }
     int offset = (virt & 0x7) * 8;
     if (ALIGN_DOWN(virt, 8) == RV_MTIME_ADDRESS) {
+        rv_cpu_sync_mtime(cpu);
         cpu->csr.mtime = WRITE_BITS(cpu->csr.mtime, value, offset, offset + width);
         handle_mtip(cpu);
         return true;
     }
     if (ALIGN_DOWN(virt, 8) == RV_MTIMECMP_ADDRESS) {
+        rv_cpu_sync_mtime(cpu);
         cpu->csr.mtimecmp = WRITE_BITS(cpu->csr.mtimecmp, value, offset, offset + width);
         handle_mtip(cpu);
         return true;
@@ -146,7 +151,7 @@ static rv_exc_t rv_read_mem64(rv_cpu_t *cpu, virt_t virt, uint64_t *value, bool
         throw_ex(cpu, virt, read_address_misaligned_exception, noisy);
     }
 
-    *value = physmem_read64(cpu->csr.mhartid, phys, true);
+    *value = physmem_tlb_read64(&cpu->physmem_tlb, cpu->csr.mhartid, phys);
     return rv_exc_none;
 }
 
@@ -182,7 +187,7 @@ static rv_exc_t rv_read_mem32(rv_cpu_t *cpu, virt_t virt, uint32_t *value, bool
         throw_ex(cpu, virt, read_address_misaligned_exception, noisy);
     }
 
-    *value = physmem_read32(cpu->csr.mhartid, phys, true);
+    *value = physmem_tlb_read32(&cpu->physmem_tlb, cpu->csr.mhartid, phys);
     return rv_exc_none;
 }
 
@@ -216,7 +221,7 @@ static rv_exc_t rv_read_mem16(rv_cpu_t *cpu, virt_t virt, uint16_t *value, bool
         throw_ex(cpu, virt, read_address_misaligned_exception, noisy);
     }
 
-    *value = physmem_read16(cpu->csr.mhartid, phys, true);
+    *value = physmem_tlb_read16(&cpu->physmem_tlb, cpu->csr.mhartid, phys);
     return rv_exc_none;
 }
 
@@ -246,7 +251,7 @@ static rv_exc_t rv_read_mem8(rv_cpu_t *cpu, virt_t virt, uint8_t *value, bool no
         throw_ex(cpu, virt, ex, noisy);
     }
 
-    *value = physmem_read8(cpu->csr.mhartid, phys, true);
+    *value = physmem_tlb_read8(&cpu->physmem_tlb, cpu->csr.mhartid, phys);
     return rv_exc_none;
 }
 
@@ -274,7 +279,7 @@ static rv_exc_t rv_write_mem8(rv_cpu_t *cpu, virt_t virt, uint8_t value, bool no
         throw_ex(cpu, virt, ex, noisy);
     }
 
-    if (physmem_write8(cpu->csr.mhartid, phys, value, true)) {
+    if (physmem_tlb_write8(&cpu->physmem_tlb, cpu->csr.mhartid, phys, value)) {
         return rv_exc_none;
     }
 
@@ -312,7 +317,7 @@ static rv_exc_t rv_write_mem16(rv_cpu_t *cpu, virt_t virt, uint16_t value, bool
         throw_ex(cpu, virt, rv_exc_store_amo_address_misaligned, noisy);
     }
 
-    if (physmem_write16(cpu->csr.mhartid, phys, value, true)) {
+    if (physmem_tlb_write16(&cpu->physmem_tlb, cpu->csr.mhartid, phys, value)) {
         return rv_exc_none;
     }
 
@@ -349,7 +354,7 @@ static rv_exc_t rv_write_mem32(rv_cpu_t *cpu, virt_t virt, uint32_t value, bool
         throw_ex(cpu, virt, rv_exc_store_amo_address_misaligned, noisy);
     }
 
-    if (physmem_write32(cpu->csr.mhartid, phys, value, true)) {
+    if (physmem_tlb_write32(&cpu->physmem_tlb, cpu->csr.mhartid, phys, value)) {
         return rv_exc_none;
     }
 
@@ -386,7 +391,7 @@ static rv_exc_t rv_write_mem64(rv_cpu_t *cpu, virt_t virt, uint64_t value, bool
         throw_ex(cpu, virt, rv_exc_store_amo_address_misaligned, noisy);
     }
 
-    if (physmem_write64(cpu->csr.mhartid, phys, value, true)) {
+    if (physmem_tlb_write64(&cpu->physmem_tlb, cpu->csr.mhartid, phys, value)) {
         return rv_exc_none;
     }
 
@@ -14,6 +14,7 @@
 #include <ctype.h>
 #include <inttypes.h>
 #include <math.h>
+#include <stdatomic.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -23,6 +24,7 @@
 #include "../../dsh2ewdt.h"
 #include "../../intc/superh_sh2e/intc.h"
 #include "../../peripheral.h"
+#include "../decode_cache.h"
 #include "bitops.h"
 #include "cpu.h"
 #include "debug.h"
@@ -31,56 +33,24 @@
 
 /** @brief Cached instruction item */
 typedef struct {
-    sh2e_insn_exec_fn_t insn;
+    sh2e_insn_exec_fn_t insn; /** Implementation (`NULL` until decoded, the attributes below are not valid until then either). */
+    sh2e_insn_t word;
     unsigned int cycles;
     bool disable_interrupts;
     bool disable_address_errors;
 } cached_insn_t;
 
-/** @brief Page of cached decoded instructions. */
-
-typedef struct {
-    item_t item;
-    ptr36_t addr;
-    cached_insn_t insns[FRAME_SIZE / sizeof(sh2e_insn_t)];
-} cache_item_t;
-
 #define PHYS2CACHEINSTR(phys) (((phys) & FRAME_MASK) / sizeof(sh2e_insn_t))
 
 static void
-cache_item_init(cache_item_t *cache_item)
-{
-    ASSERT(cache_item != NULL);
-
-    item_init(&cache_item->item);
-    cache_item->addr = 0;
-    // Skip insns init.
-}
+sh2e_cpu_insn_cache_decode_page(decode_page_t *page, ptr36_t start, len36_t size);
+static void
+sh2e_cpu_insn_cache_decode_page_ahead(decode_page_t *page, ptr36_t start, len36_t size);
 
-static list_t sh2e_insn_cache = LIST_INITIALIZER;
-
-/**
- * @brief Retrieves instruction cache page for the given address.
- *
- * @return `true` if a page exists, `false` otherwise.
- */
-static bool
-sh2e_cpu_insn_cache_get(ptr36_t phys, cache_item_t **const output_item)
-{
-    ASSERT(output_item != NULL);
-
-    ptr36_t const target_page = ALIGN_DOWN(phys, FRAME_SIZE);
-
-    cache_item_t *item;
-    for_each(sh2e_insn_cache, item, cache_item_t)
-    {
-        if (item->addr == target_page) {
-            *output_item = item;
-            return true;
-        }
-    }
-    return false;
-}
+/** @brief Pages of cached decoded instructions. */
+static decode_cache_t sh2e_insn_cache = DECODE_CACHE_INITIALIZER("sh2e",
+        (FRAME_SIZE / sizeof(sh2e_insn_t)) * sizeof(cached_insn_t), sh2e_cpu_insn_cache_decode_page,
+        sh2e_cpu_insn_cache_decode_page_ahead);
 
 /**
  * @brief Converts a virtual address to physical address.
@@ -140,34 +110,71 @@ sh2e_set_pc(sh2e_cpu_t *const restrict cpu, uint32_t const addr)
  ****************************************************************************/
 
 static void
-sh2e_cpu_insn_cache_decode_page(sh2e_cpu_t *const restrict cpu, cache_item_t *cache_item)
+sh2e_cpu_insn_cache_decode_page(decode_page_t *page, ptr36_t start, len36_t size)
 {
-    for (size_t i = 0; i < FRAME_SIZE / sizeof(sh2e_insn_t); i++) {
-        ptr36_t addr = cache_item->addr + (i * sizeof(sh2e_insn_t));
-        sh2e_insn_t insn = (sh2e_insn_t) sh2e_physmem_read16(cpu->id, addr, false);
-        sh2e_insn_desc_t const *desc = sh2e_insn_decode(insn);
-        cache_item->insns[i].insn = desc->exec;
-        cache_item->insns[i].disable_interrupts = desc->disable_interrupts;
-        cache_item->insns[i].disable_address_errors = desc->disable_address_errors;
-        cache_item->insns[i].cycles = desc->cycles;
+    cached_insn_t *insns = decode_page_data(page, cached_insn_t);
+    uint16_t words[FRAME_SIZE / sizeof(sh2e_insn_t)];
+    size_t count = size / sizeof(sh2e_insn_t);
+
+    physmem_frame_read16(page->frame, start, words, count);
+
+    // Only store the instruction words, they are decoded on their first execution.
+    for (size_t i = 0; i < count; i++) {
+        cached_insn_t *item = &insns[PHYS2CACHEINSTR(start) + i];
+        item->insn = NULL;
+        item->word = (sh2e_insn_t) be16toh(words[i]);
     }
 }
 
+/**
+ * @brief Decodes an instruction stored by sh2e_cpu_insn_cache_decode_page().
+ *
+ * The attributes are stored before the implementation, so that parallel
+ * processors finding the implementation find them decoded.
+ */
 static void
-sh2e_cpu_insn_cache_update(sh2e_cpu_t *const restrict cpu, cache_item_t *cache_item)
+sh2e_cpu_insn_cache_resolve(cached_insn_t const *const restrict cached)
 {
-    frame_t *frame = physmem_find_frame(cache_item->addr);
-    ASSERT(frame != NULL);
+    cached_insn_t *item = (cached_insn_t *) cached;
+    sh2e_insn_desc_t const *desc = sh2e_insn_decode(item->word);
 
-    if (!frame->valid) {
-        sh2e_cpu_insn_cache_decode_page(cpu, cache_item);
-        frame->valid = true;
+    item->disable_interrupts = desc->disable_interrupts;
+    item->disable_address_errors = desc->disable_address_errors;
+    item->cycles = desc->cycles;
+
+    atomic_thread_fence(memory_order_release);
+    item->insn = desc->exec;
+}
+
+/**
+ * @brief Fills the page with instructions decoded ahead of their execution.
+ *
+ * Used for the pages of a profile (see decode_cache_profile_load()).
+ */
+static void
+sh2e_cpu_insn_cache_decode_page_ahead(decode_page_t *page, ptr36_t start, len36_t size)
+{
+    cached_insn_t *insns = decode_page_data(page, cached_insn_t);
+
+    sh2e_cpu_insn_cache_decode_page(page, start, size);
+
+    for (size_t i = 0; i < size / sizeof(sh2e_insn_t); i++) {
+        sh2e_cpu_insn_cache_resolve(&insns[PHYS2CACHEINSTR(start) + i]);
+    }
+}
+
+static void
+sh2e_cpu_insn_cache_update(sh2e_cpu_t *const restrict cpu, decode_page_t *page, ptr36_t phys)
+{
+    // Only decode the line of the fetched instruction again.
+    if (decode_page_refresh(page, phys)) {
+        sh2e_cpu_insn_cache_decode_page(page, ALIGN_DOWN(phys, FRAME_LINE_SIZE), FRAME_LINE_SIZE);
     }
 
     return;
 }
 
-static cache_item_t *
+static decode_page_t *
 sh2e_cpu_insn_cache_try_add(sh2e_cpu_t *const restrict cpu, ptr36_t phys)
 {
     frame_t *frame = physmem_find_frame(phys);
@@ -175,34 +182,37 @@ sh2e_cpu_insn_cache_try_add(sh2e_cpu_t *const restrict cpu, ptr36_t phys)
         return NULL;
     }
 
-    cache_item_t *cache_item = safe_malloc(sizeof(cache_item_t));
-    cache_item_init(cache_item);
-    cache_item->addr = ALIGN_DOWN(phys, FRAME_SIZE);
-    list_push(&sh2e_insn_cache, &cache_item->item);
+    return decode_cache_add(&sh2e_insn_cache, frame, phys);
+}
+
+static decode_page_t *
+sh2e_cpu_insn_cache_fetch_page(sh2e_cpu_t *const restrict cpu, ptr36_t phys)
+{
+    decode_page_t *page = decode_cache_find(&sh2e_insn_cache, phys);
+    if (page != NULL) {
+        sh2e_cpu_insn_cache_update(cpu, page, phys);
+    } else {
+        //
+        // There is no instruction cache page for the given address.
+        // Add it and return the page.
+        //
+        page = sh2e_cpu_insn_cache_try_add(cpu, phys);
+    }
 
-    sh2e_cpu_insn_cache_decode_page(cpu, cache_item);
-    frame->valid = true;
-    return cache_item;
+    return page;
 }
 
 static sh2e_insn_exec_fn_t
 sh2e_cpu_fetch_insn_func(sh2e_cpu_t *const restrict cpu, ptr36_t phys, unsigned int *insn_cycles)
 {
-    cache_item_t *cache_item = NULL;
-    if (sh2e_cpu_insn_cache_get(phys, &cache_item)) {
-        ASSERT(cache_item != NULL);
-
-        sh2e_cpu_insn_cache_update(cpu, cache_item);
+    decode_page_t *page = sh2e_cpu_insn_cache_fetch_page(cpu, phys);
 
-        // Move the instruction cache page to the head of the list
-        // (if not already there) to speed up subsequent accesses.
-        if (sh2e_insn_cache.head != &cache_item->item) {
-            list_remove(&sh2e_insn_cache, &cache_item->item);
-            list_push(&sh2e_insn_cache, &cache_item->item);
+    if (page != NULL) {
+        cached_insn_t *item = &decode_page_data(page, cached_insn_t)[PHYS2CACHEINSTR(phys)];
+        if (item->insn == NULL) {
+            sh2e_cpu_insn_cache_resolve(item);
         }
 
-        cached_insn_t *item = &cache_item->insns[PHYS2CACHEINSTR(phys)];
-
         cpu->disable_interrupts = item->disable_interrupts;
         cpu->disable_address_errors = item->disable_address_errors;
         *insn_cycles = item->cycles;
@@ -211,22 +221,6 @@ sh2e_cpu_fetch_insn_func(sh2e_cpu_t *const restrict cpu, ptr36_t phys, unsigned
         return item->insn;
     }
 
-    //
-    // There is no instruction cache page for the given address.
-    // Add it and return the instruction.
-    //
-    cache_item = sh2e_cpu_insn_cache_try_add(cpu, phys);
-    if (cache_item != NULL) {
-
-        cached_insn_t *item = &cache_item->insns[PHYS2CACHEINSTR(phys)];
-
-        cpu->disable_interrupts = item->disable_interrupts;
-        cpu->disable_address_errors = item->disable_address_errors;
-        *insn_cycles = item->cycles;
-
-        return item->insn;
-    }
-
     alert("Trying to fetch instructions from outside of physical memory");
     return NULL;
 }
@@ -500,6 +494,114 @@ sh2e_cpu_reset(sh2e_cpu_t *const restrict cpu)
  * CPU state steps
  ****************************************************************************/
 
+/**
+ * @brief Update the PC after an executed instruction (respect delay slots).
+ */
+static void
+sh2e_cpu_update_pc(sh2e_cpu_t *const restrict cpu)
+{
+    switch (cpu->br_state) {
+    case SH2E_BRANCH_STATE_DELAY_NEXT: { // Just executed a branch instruction, enter delay slot. pc_target holds the address of the jump target
+        cpu->br_state = SH2E_BRANCH_STATE_DELAY;
+        cpu->cpu_regs.pc += sizeof(sh2e_insn_t);
+        break;
+    }
+    case SH2E_BRANCH_STATE_NONE: { // Advance PC to next instruction.
+        cpu->cpu_regs.pc += sizeof(sh2e_insn_t);
+        break;
+    }
+    case SH2E_BRANCH_STATE_DELAY: // Delay branch instruction.
+    case SH2E_BRANCH_STATE_EXECUTE: { // Execute delayed branch.
+        cpu->cpu_regs.pc = cpu->pc_target; // Jump to the target address.
+        cpu->br_state = SH2E_BRANCH_STATE_NONE;
+        break;
+    }
+    default: {
+        ASSERT(false && "invalid CPU branch state");
+    }
+    }
+}
+
+/**
+ * @brief Signal the sleep mode to the on-chip peripherals.
+ */
+static void
+sh2e_cpu_signal_sleep(sh2e_cpu_t *const restrict cpu)
+{
+    peripheral_link_t *peripheral_link;
+    for_each(cpu->on_chip_peripherals, peripheral_link, peripheral_link_t)
+    {
+        // Using sleep mode for now, because we don't support the other standby modes yet.
+        peripheral_link->peripheral->type->interrupt_up_from_cpu(peripheral_link->peripheral, SH2E_INTC_SLEEP_MODE_OFFSET);
+    }
+}
+
+/**
+ * @brief Report the cycles of executed instructions to the on-chip peripherals.
+ */
+static void
+sh2e_cpu_report_cycles(sh2e_cpu_t *const restrict cpu, unsigned int cycles)
+{
+    peripheral_link_t *peripheral_link;
+    for_each(cpu->on_chip_peripherals, peripheral_link, peripheral_link_t)
+    {
+        peripheral_link->peripheral->type->update_cycles(peripheral_link->peripheral, cycles);
+    }
+}
+
+/**
+ * @brief Get the number of instruction cycles after which the first
+ * on-chip peripheral sets a flag or raises an interrupt.
+ *
+ * Peripherals which cannot tell are expected to do so after each cycle.
+ */
+static uint64_t
+sh2e_cpu_peripherals_deadline(sh2e_cpu_t *const restrict cpu)
+{
+    uint64_t deadline = UINT64_MAX;
+
+    peripheral_link_t *peripheral_link;
+    for_each(cpu->on_chip_peripherals, peripheral_link, peripheral_link_t)
+    {
+        peripheral_t *peripheral = peripheral_link->peripheral;
+        uint64_t cycles = 1;
+        if (peripheral->type->deadline != NULL) {
+            cycles = peripheral->type->deadline(peripheral);
+        }
+
+        if (cycles < deadline) {
+            deadline = cycles;
+        }
+    }
+
+    return deadline;
+}
+
+/**
+ * @brief Bring the on-chip peripherals up to date before a device access
+ * within a superblock.
+ *
+ * The cycles executed so far are reported to the peripherals. The machine
+ * cycle counter is then advanced by the steps executed so far and the
+ * events are delivered (see dev_run_sync()), as if the peripherals were
+ * updated after each instruction. The superblock ends after the accessing
+ * instruction.
+ */
+static void
+sh2e_cpu_block_device_access(void *data)
+{
+    sh2e_cpu_t *cpu = (sh2e_cpu_t *) data;
+
+    cpu->block_device_access = true;
+
+    if (cpu->block_cycles > 0) {
+        unsigned int cycles = cpu->block_cycles;
+        cpu->block_cycles = 0;
+
+        sh2e_cpu_report_cycles(cpu, cycles);
+    }
+}
+
 /**
  * @brief Handle one step in the standby state.
  */
@@ -664,12 +766,7 @@ sh2e_program_execution_state_step(sh2e_cpu_t *const restrict cpu)
 
     // Can happen after executing the SLEEP instruction
     if (cpu->pr_state == SH2E_PSTATE_POWER_DOWN) {
-        peripheral_link_t *peripheral_link;
-        for_each(cpu->on_chip_peripherals, peripheral_link, peripheral_link_t)
-        {
-            // Using sleep mode for now, because we don't support the other standby modes yet.
-            peripheral_link->peripheral->type->interrupt_up_from_cpu(peripheral_link->peripheral, SH2E_INTC_SLEEP_MODE_OFFSET);
-        }
+        sh2e_cpu_signal_sleep(cpu);
     }
 
     // If interrupts are not disabled, check for pending interrupts.
@@ -689,35 +786,137 @@ sh2e_program_execution_state_step(sh2e_cpu_t *const restrict cpu)
 
     // Accounting
     cpu->program_execution_cycles += insn_cycles;
-    peripheral_link_t *peripheral_link;
-    for_each(cpu->on_chip_peripherals, peripheral_link, peripheral_link_t)
-    {
-        peripheral_link->peripheral->type->update_cycles(peripheral_link->peripheral, insn_cycles);
-    }
+    sh2e_cpu_report_cycles(cpu, insn_cycles);
 
     // Update program counter (respect delay slots).
     if (cpu->pr_state == SH2E_PSTATE_PROGRAM_EXECUTION) {
-        switch (cpu->br_state) {
-        case SH2E_BRANCH_STATE_DELAY_NEXT: { // Just executed a branch instruction, enter delay slot. pc_target holds the address of the jump target
-            cpu->br_state = SH2E_BRANCH_STATE_DELAY;
-            cpu->cpu_regs.pc += sizeof(sh2e_insn_t);
-            break;
+        sh2e_cpu_update_pc(cpu);
+    }
+}
+
+/**
+ * @brief Handle a superblock of steps in the program execution state.
+ *
+ * The instructions of a page are executed back to back, following
+ * the branches and their delay slots, as long as the CPU stays in the
+ * program execution state. Interrupts are checked after each instruction
+ * as usual, the interrupt controller is queried again only when the
+ * interrupt mask changes.
+ *
+ * The cycles of the instructions are reported to the on-chip peripherals
+ * at once at the end of the superblock. The superblock ends no later than
+ * with the instruction reaching the earliest peripheral deadline (computed
+ * before the superblock) and with any device access, before which the
+ * peripherals are brought up to date.
+ *
+ * @param limit Maximal number of steps.
+ * @return Number of steps executed.
+ */
+static unsigned int
+sh2e_program_execution_block(sh2e_cpu_t *const restrict cpu, unsigned int limit)
+{
+    ASSERT(cpu != NULL);
+
+    ptr36_t phys = cpu->cpu_regs.pc;
+    decode_page_t *page = NULL;
+
+    if (IS_ALIGNED(phys, sizeof(sh2e_insn_t))) {
+        page = sh2e_cpu_insn_cache_fetch_page(cpu, phys);
+    }
+
+    // Fetch errors and breakpoints are left to the regular step.
+    if ((page == NULL) || (page->frame->breakpoints_count > 0)) {
+        sh2e_program_execution_state_step(cpu);
+        return 1;
+    }
+
+    // Check for reset requests.
+    if (sh2e_cpu_check_reset_req(cpu)) {
+        return 1;
+    }
+
+    uint64_t const deadline = sh2e_cpu_peripherals_deadline(cpu);
+    cached_insn_t const *insns = decode_page_data(page, cached_insn_t);
+
+    unsigned int executed = 0;
+    uint64_t insn_cycles = 0;
+
+    // Interrupt mask with no pending interrupts (if any)
+    int checked_mask = -1;
+
+    cpu->block_cycles = 0;
+    cpu->block_device_access = false;
+    physmem_set_device_hook(sh2e_cpu_block_device_access, cpu);
+
+    while (true) {
+        cached_insn_t const *item = &insns[PHYS2CACHEINSTR(phys)];
+        if (item->insn == NULL) {
+            sh2e_cpu_insn_cache_resolve(item);
         }
-        case SH2E_BRANCH_STATE_NONE: { // Advance PC to next instruction.
-            cpu->cpu_regs.pc += sizeof(sh2e_insn_t);
-            break;
+
+        cpu->disable_interrupts = item->disable_interrupts;
+        cpu->disable_address_errors = item->disable_address_errors;
+        cpu->insn_exception = item->insn(cpu, item->word);
+
+        executed++;
+        insn_cycles += item->cycles;
+        cpu->block_cycles += item->cycles;
+        cpu->run_steps = executed;
+
+        // Can happen after executing the SLEEP instruction
+        if (cpu->pr_state == SH2E_PSTATE_POWER_DOWN) {
+            sh2e_cpu_signal_sleep(cpu);
+        }
+
+        // A device access (an IPR write, a device event) may have raised an interrupt
+        // without changing the mask.
+        if (cpu->block_device_access) {
+            checked_mask = -1;
+        }
+
+        // If interrupts are not disabled, check for pending interrupts.
+        if ((!cpu->disable_interrupts) && (cpu->cpu_regs.sr.im != checked_mask)) {
+            uint8_t interrupt_source = 0;
+            bool interrupt_pending = intc_check_interrupts(cpu->intc, cpu->cpu_regs.sr.im, &interrupt_source);
+            if (interrupt_pending) {
+                cpu->pending_interrupt = interrupt_source;
+            } else {
+                checked_mask = cpu->cpu_regs.sr.im;
+            }
+        }
+
+        // Go to exception processing state if there is an exception or a pending interrupt.
+        if (cpu->insn_exception != SH2E_EXCEPTION_NONE || (cpu->pending_address_error != SH2E_EXCEPTION_NONE) || cpu->pending_interrupt) {
+            cpu->pr_state = SH2E_PSTATE_EXCEPTION_PROCESSING;
         }
-        case SH2E_BRANCH_STATE_DELAY: // Delay branch instruction.
-        case SH2E_BRANCH_STATE_EXECUTE: { // Execute delayed branch.
-            cpu->cpu_regs.pc = cpu->pc_target; // Jump to the target address.
-            cpu->br_state = SH2E_BRANCH_STATE_NONE;
+
+        if (cpu->pr_state != SH2E_PSTATE_PROGRAM_EXECUTION) {
             break;
         }
-        default: {
-            ASSERT(false && "invalid CPU branch state");
+
+        sh2e_cpu_update_pc(cpu);
+
+        if ((executed == limit) || (insn_cycles >= deadline) || (cpu->block_device_access)
+                || (machine_halt) || (machine_interactive) || (machine_trace)) {
+            break;
         }
+
+        // Continue within the page as long as its decoded instructions are up to date.
+        phys = cpu->cpu_regs.pc;
+        if ((!IS_ALIGNED(phys, sizeof(sh2e_insn_t))) || (ALIGN_DOWN(phys, FRAME_SIZE) != page->addr)
+                || (!decode_page_fresh(page, phys))) {
+            break;
         }
     }
+
+    physmem_set_device_hook(NULL, NULL);
+
+    // Accounting
+    cpu->program_execution_cycles += insn_cycles;
+    sh2e_cpu_report_cycles(cpu, cpu->block_cycles);
+    cpu->block_cycles = 0;
+
+    return executed;
 }
 
 /****************************************************************************
@@ -737,6 +936,8 @@ void sh2e_cpu_init(sh2e_cpu_t *const restrict cpu, unsigned int id)
     cpu->pending_address_error = SH2E_EXCEPTION_NONE;
 
     cpu->on_chip_peripherals = (list_t) LIST_INITIALIZER;
+
+    decode_cache_register(&sh2e_insn_cache);
 }
 
 /** @brief Cleanup CPU structures. */
@@ -745,11 +946,7 @@ void sh2e_cpu_done(sh2e_cpu_t *const restrict cpu)
     ASSERT(cpu != NULL);
 
     // Clean the entire instruction cache.
-    while (!is_empty(&sh2e_insn_cache)) {
-        cache_item_t *cache_item = (cache_item_t *) (sh2e_insn_cache.head);
-        list_remove(&sh2e_insn_cache, &cache_item->item);
-        safe_free(cache_item);
-    }
+    decode_cache_done(&sh2e_insn_cache);
 }
 
 /** @brief Execute the next cpu step depending on the current cpu state. */
@@ -779,6 +976,95 @@ void sh2e_cpu_step(sh2e_cpu_t *const restrict cpu)
     }
 }
 
+/**
+ * @brief Execute at most the given number of cycles.
+ *
+ * Executes a superblock of instructions in the program execution state,
+ * a single step otherwise. The cycles of the instructions are reported
+ * to the on-chip peripherals at the end of the last executed cycle.
+ *
+ * @return Number of cycles executed.
+ */
+unsigned int sh2e_cpu_run(sh2e_cpu_t *const restrict cpu, unsigned int cycles)
+{
+    ASSERT(cpu != NULL);
+    ASSERT(cycles > 0);
+
+    cpu->run_steps = 0;
+
+    if ((cpu->pr_state == SH2E_PSTATE_PROGRAM_EXECUTION) && (!machine_trace)) {
+        return sh2e_program_execution_block(cpu, cycles);
+    }
+
+    sh2e_cpu_step(cpu);
+    return 1;
+}
+
+/**
+ * @brief Get the number of cycles executed so far by sh2e_cpu_run().
+ *
+ * To be called while an instruction is being executed.
+ */
+uint64_t sh2e_cpu_run_elapsed(sh2e_cpu_t *const restrict cpu)
+{
+    ASSERT(cpu != NULL);
+
+    return cpu->run_steps;
+}
+
+/**
+ * @brief Get the number of cycles the CPU stays idle for.
+ *
+ * The CPU is idle in the power-down state until an interrupt or a reset
+ * is requested, which can only happen from outside of the CPU, and in the
+ * bus release state.
+ *
+ * @return Number of cycles which can be accounted by sh2e_cpu_skip()
+ *         instead of stepping the CPU (0 if not idle).
+ */
+uint64_t sh2e_cpu_idle_cycles(sh2e_cpu_t *const restrict cpu)
+{
+    ASSERT(cpu != NULL);
+
+    switch (cpu->pr_state) {
+    case SH2E_PSTATE_POWER_DOWN: {
+        // The power-down state is dumped every cycle in trace mode.
+        if (machine_trace) {
+            return 0;
+        }
+
+        uint8_t reset = 0;
+        if (intc_check_resets(cpu->intc, &reset)) {
+            return 0;
+        }
+
+        if (intc_peek_interrupts(cpu->intc, cpu->cpu_regs.sr.im)) {
+            return 0;
+        }
+
+        return UINT64_MAX;
+    }
+    case SH2E_PSTATE_BUS_RELEASE:
+        return UINT64_MAX;
+    default:
+        return 0;
+    }
+}
+
+/**
+ * @brief Account idle cycles of the CPU at once.
+ *
+ * Equivalent to calling sh2e_cpu_step() for each of the cycles.
+ */
+void sh2e_cpu_skip(sh2e_cpu_t *const restrict cpu, uint64_t cycles)
+{
+    ASSERT(cpu != NULL);
+
+    if (cpu->pr_state == SH2E_PSTATE_POWER_DOWN) {
+        cpu->power_down_cycles += cycles;
+    }
+}
+
 /** @brief Set the address of the next instruction to execute. */
 void sh2e_cpu_goto(sh2e_cpu_t *const restrict cpu, ptr64_t const addr)
 {
@@ -360,6 +360,13 @@ typedef struct sh2e_cpu {
 
     /* References to on-chip peripherals */
     list_t on_chip_peripherals;
+
+    /** Superblock execution */
+    unsigned int block_cycles; /** Cycles of the current superblock not reported to the peripherals yet. */
+
+    bool block_device_access; /** A device has been accessed within the current superblock. */
+
+    unsigned int run_steps; /** Steps executed so far by sh2e_cpu_run(). */
 } sh2e_cpu_t;
 
 /** Instruction implementation. */
@@ -434,6 +441,10 @@ _Static_assert(sizeof(sh2e_eva_t) == SH2E_EVA_VECTOR_COUNT * sizeof(uint32_t), "
 extern void sh2e_cpu_init(sh2e_cpu_t *cpu, unsigned int id);
 extern void sh2e_cpu_done(sh2e_cpu_t *cpu);
 extern void sh2e_cpu_step(sh2e_cpu_t *cpu);
+extern unsigned int sh2e_cpu_run(sh2e_cpu_t *cpu, unsigned int cycles);
+extern uint64_t sh2e_cpu_run_elapsed(sh2e_cpu_t *cpu);
+extern uint64_t sh2e_cpu_idle_cycles(sh2e_cpu_t *cpu);
+extern void sh2e_cpu_skip(sh2e_cpu_t *cpu, uint64_t cycles);
 extern void sh2e_cpu_goto(sh2e_cpu_t *cpu, ptr64_t addr);
 
 /** Memory operations */
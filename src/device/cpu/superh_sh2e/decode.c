@@ -2283,8 +2283,8 @@ sh2e_insn_decode_msim_format(sh2e_insn_z_t const insn)
  * SH-2E instruction decoding
  ****************************************************************************/
 
-sh2e_insn_desc_t const *
-sh2e_insn_decode(sh2e_insn_t const insn)
+static sh2e_insn_desc_t const *
+sh2e_insn_decode_formats(sh2e_insn_t const insn)
 {
     sh2e_insn_desc_t const *desc = NULL;
 
@@ -2401,3 +2401,33 @@ sh2e_insn_decode(sh2e_insn_t const insn)
 
     return (desc != NULL) ? desc : &illegal;
 }
+
+/****************************************************************************
+ * SH-2E direct decode table
+ ****************************************************************************/
+
+// Descriptors of all 16-bit instruction words, filled on first use.
+// The descriptors are local to the format decoders, so the table
+// cannot be a constant initializer.
+static sh2e_insn_desc_t const *decode_table[1 << 16];
+static bool decode_table_ready = false;
+
+static void
+decode_table_fill(void)
+{
+    for (uint32_t word = 0; word < (1 << 16); word++) {
+        decode_table[word] = sh2e_insn_decode_formats((sh2e_insn_t) (uint16_t) word);
+    }
+
+    decode_table_ready = true;
+}
+
+sh2e_insn_desc_t const *
+sh2e_insn_decode(sh2e_insn_t const insn)
+{
+    if (!decode_table_ready) {
+        decode_table_fill();
+    }
+
+    return decode_table[insn.word];
+}
@@ -16,6 +16,8 @@
 
 #include "../assert.h"
 #include "../fault.h"
+#include "../main.h"
+#include "../physmem.h"
 #include "../utils.h"
 #include "dcycle.h"
 #include "device.h"
@@ -28,9 +30,33 @@
 /** Instance data structure */
 typedef struct {
     ptr36_t addr;
-    uint64_t cycle;
+    uint64_t start; /**< Machine cycle of the initialization */
 } dcycle_data_t;
 
+/** Compute the number of cycles counted by the device
+ *
+ * The counter is incremented every machine cycle. Instead of stepping
+ * the device, the value is derived from the machine cycle counter
+ * (taking into account whether the device would have been already
+ * stepped in the current cycle).
+ *
+ * @param dev Device pointer
+ *
+ * @return Current value of the cycle counter
+ *
+ */
+static uint64_t dcycle_cycle(device_t *dev)
+{
+    dcycle_data_t *data = (dcycle_data_t *) dev->data;
+
+    uint64_t cycle = dev_cycles() - data->start;
+    if (dev_cycle_passed(dev)) {
+        cycle++;
+    }
+
+    return cycle;
+}
+
 /** Init command implementation
  *
  * @param parm Command-line parameters
@@ -67,7 +93,9 @@ static bool dcycle_init(token_t *parm, device_t *dev)
     dev->data = data;
 
     data->addr = addr;
-    data->cycle = 0;
+    data->start = dev_cycles();
+
+    physmem_map_device(dev, addr, REGISTER_LIMIT);
 
     return true;
 }
@@ -100,10 +128,8 @@ static bool dcycle_info(token_t *parm, device_t *dev)
  */
 static bool dcycle_stat(token_t *parm, device_t *dev)
 {
-    dcycle_data_t *data = (dcycle_data_t *) dev->data;
-
     printf("[cycle              ]\n");
-    printf("%20" PRIu64 "\n", data->cycle);
+    printf("%20" PRIu64 "\n", dcycle_cycle(dev));
 
     return true;
 }
@@ -134,10 +160,10 @@ static void dcycle_read32(unsigned int procno, device_t *dev, ptr36_t addr, uint
 
     switch (addr - data->addr) {
     case REGISTER_CYCLE_LO:
-        *val = (uint32_t) data->cycle;
+        *val = (uint32_t) dcycle_cycle(dev);
         break;
     case REGISTER_CYCLE_HI:
-        *val = (uint32_t) (data->cycle >> 32);
+        *val = (uint32_t) (dcycle_cycle(dev) >> 32);
         break;
     }
 }
@@ -158,22 +184,11 @@ static void dcycle_read64(unsigned int procno, device_t *dev, ptr36_t addr, uint
 
     switch (addr - data->addr) {
     case REGISTER_CYCLE_LO:
-        *val = data->cycle;
+        *val = dcycle_cycle(dev);
         break;
     }
 }
 
-/** Cycle device implementation
- *
- */
-static void dcycle_step(device_t *dev)
-{
-    ASSERT(dev != NULL);
-
-    dcycle_data_t *data = (dcycle_data_t *) dev->data;
-    data->cycle++;
-}
-
 static cmd_t dcycle_cmds[] = {
     { "init",
             (fcmd_t) dcycle_init,
@@ -220,7 +235,6 @@ device_type_t dcycle = {
     .done = dcycle_done,
     .read32 = dcycle_read32,
     .read64 = dcycle_read64,
-    .step = dcycle_step,
 
     /* Commands */
     .cmds = dcycle_cmds
@@ -219,6 +219,8 @@ static bool ddisk_init(token_t *parm, device_t *dev)
     data->cmds_write = 0;
     data->disk_type = DISKT_NONE;
 
+    physmem_map_device(dev, addr, REGISTER_LIMIT);
+
     return true;
 }
 
@@ -726,6 +728,7 @@ static void ddisk_write32(unsigned int procno, device_t *dev, ptr36_t addr,
             data->secno = data->disk_secno;
             data->disk_status |= STATUS_BUSY;
             data->cmds_read++;
+            dev_schedule(dev, 1);
         }
 
         /* Write command */
@@ -736,6 +739,7 @@ static void ddisk_write32(unsigned int procno, device_t *dev, ptr36_t addr,
             data->secno = data->disk_secno;
             data->disk_status |= STATUS_BUSY;
             data->cmds_write++;
+            dev_schedule(dev, 1);
         }
 
         break;
@@ -743,11 +747,14 @@ static void ddisk_write32(unsigned int procno, device_t *dev, ptr36_t addr,
 }
 
 /** Disk implementation
+ *
+ * Transfers one word every machine cycle while
+ * a read or write command is in progress.
  *
  * @param dev Device pointer
  *
  */
-static void ddisk_step(device_t *dev)
+static void ddisk_event(device_t *dev)
 {
     disk_data_s *data = (disk_data_s *) dev->data;
     size_t pos;
@@ -777,16 +784,20 @@ static void ddisk_step(device_t *dev)
         return;
     }
 
-    if (data->cnt == 128) {
-        data->action = ACTION_NONE;
-        data->disk_status &= ~STATUS_BUSY;
+    if (data->cnt < 128) {
+        /* Next word in the next cycle */
+        dev_schedule(dev, 1);
+        return;
+    }
 
-        if (!data->uses_busy_bit) {
-            data->disk_status |= STATUS_INT;
-            cpu_interrupt_up(get_cpu(data->cpuid), data->intno);
-            data->ig = true;
-            data->intrcount++;
-        }
+    data->action = ACTION_NONE;
+    data->disk_status &= ~STATUS_BUSY;
+
+    if (!data->uses_busy_bit) {
+        data->disk_status |= STATUS_INT;
+        cpu_interrupt_up(get_cpu(data->cpuid), data->intno);
+        data->ig = true;
+        data->intrcount++;
     }
 }
 
@@ -872,7 +883,7 @@ device_type_t ddisk = {
 
     /* Functions */
     .done = ddisk_done,
-    .step = ddisk_step,
+    .event = ddisk_event,
     .read32 = ddisk_read32,
     .write32 = ddisk_write32,
 
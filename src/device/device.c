@@ -10,6 +10,7 @@
  */
 
 #include <inttypes.h>
+#include <limits.h>
 #include <stdarg.h>
 #include <stdbool.h>
 #include <stdio.h>
@@ -22,6 +23,7 @@
 #include "../env.h"
 #include "../fault.h"
 #include "../main.h"
+#include "../physmem.h"
 #include "../utils.h"
 #include "dcycle.h"
 #include "ddisk.h"
@@ -71,6 +73,27 @@ static device_type_t const *const device_types[] = {
 /* List of all devices */
 list_t device_list = LIST_INITIALIZER;
 
+/* Number of devices ever added (source of the stepping order) */
+static uint64_t device_order = 0;
+
+/* Devices with a step function in the device list order */
+static device_t **step_devices = NULL;
+static size_t step_devices_count = 0;
+
+/* Order of the device being stepped (0 outside of dev_step_all()) */
+static uint64_t stepping_order = 0;
+
+/* Pending device events (binary min-heap ordered by deadline and order) */
+static device_t **event_queue = NULL;
+static size_t event_queue_count = 0;
+static size_t event_queue_size = 0;
+
+/** Device executing machine cycles in dev_run() (if it tracks them) */
+static device_t *run_device = NULL;
+
+/** Cycles of the run already added to the machine cycle counter */
+static uint64_t run_synced = 0;
+
 /** Search for device type by name.
  *
  * @param device_name Name, which will be set to created device.
@@ -112,7 +135,11 @@ alloc_device(char const *const type_string, char const *const device_name)
         return NULL;
     }
 
-    if ((!machine_nondet) && (device_type->nondet)) {
+    /* Devices reading the host time are deterministic in the virtual time mode */
+    bool nondet = (device_type->nondet)
+            && (!((device_type->host_time) && (machine_time_frequency != 0)));
+
+    if ((!machine_nondet) && (nondet)) {
         error("Device \"%s\" results in non-deterministic behaviour.\n"
               "This is currently disabled. Use the command-line option\n"
               "-n to enable non-determinism.",
@@ -126,6 +153,9 @@ alloc_device(char const *const type_string, char const *const device_name)
     dev->type = device_type;
     dev->name = safe_strdup(device_name);
     dev->data = NULL;
+    dev->order = 0;
+    dev->deadline = 0;
+    dev->event_index = DEVICE_NO_EVENT;
     item_init(&dev->item);
 
     return dev;
@@ -133,6 +163,9 @@ alloc_device(char const *const type_string, char const *const device_name)
 
 void free_device(device_t *dev)
 {
+    dev_unschedule(dev);
+    physmem_unmap_device(dev);
+
     /* Clean-up only if possible and if the device was initialized. */
     if (dev->type->done && dev->data) {
         dev->type->done(dev);
@@ -141,9 +174,42 @@ void free_device(device_t *dev)
     safe_free(dev);
 }
 
+/** Rebuild the array of devices stepped every machine cycle
+ *
+ */
+static void dev_update_step_devices(void)
+{
+    size_t count = 0;
+    device_t *dev = NULL;
+    while (dev_next(&dev, DEVICE_FILTER_STEP)) {
+        count++;
+    }
+
+    safe_free(step_devices);
+    step_devices = (device_t **) safe_malloc((count + 1) * sizeof(device_t *));
+    step_devices_count = 0;
+
+    dev = NULL;
+    while (dev_next(&dev, DEVICE_FILTER_STEP)) {
+        step_devices[step_devices_count++] = dev;
+    }
+}
+
 void add_device(device_t *dev)
 {
     list_append(&device_list, &dev->item);
+    dev->order = ++device_order;
+    physmem_update_device_map();
+
+    if (dev->type->step != NULL) {
+        dev_update_step_devices();
+    }
+
+    /* Devices without own events get step4k
+       at every 4096th machine cycle */
+    if ((dev->type->step4k != NULL) && (dev->type->event == NULL)) {
+        dev_schedule(dev, 4096 - (machine_cycles % 4096));
+    }
 }
 
 /** Test device according to the given filter condition.
@@ -338,6 +404,387 @@ device_t *dev_by_name(const char *searched_name)
 void dev_remove(device_t *device)
 {
     list_remove(&device_list, &device->item);
+    dev_unschedule(device);
+    physmem_unmap_device(device);
+
+    if (device->type->step != NULL) {
+        dev_update_step_devices();
+    }
+}
+
+/** Execute one machine cycle of all stepped devices
+ *
+ * The devices are stepped in the device list order.
+ *
+ */
+void dev_step_all(void)
+{
+    for (size_t i = 0; i < step_devices_count; i++) {
+        device_t *dev = step_devices[i];
+
+        stepping_order = dev->order;
+        dev->type->step(dev);
+    }
+
+    stepping_order = 0;
+}
+
+/** Get the devices stepped every machine cycle
+ *
+ * @param count Number of the devices (returned).
+ *
+ * @return Array of the devices in the device list order.
+ *
+ */
+device_t *const *dev_step_list(size_t *count)
+{
+    *count = step_devices_count;
+    return step_devices;
+}
+
+/** Check whether the machine cycles can be executed by dev_run()
+ *
+ * This is possible if there is just a single device stepped every
+ * machine cycle (e.g. a single processor) which can execute multiple
+ * cycles at once.
+ *
+ */
+bool dev_run_supported(void)
+{
+    return (step_devices_count == 1) && (step_devices[0]->type->run != NULL);
+}
+
+/** Execute machine cycles by running the stepped device
+ *
+ * The device executes the cycles at once up to the next device event,
+ * the machine cycle counter is then advanced and the events due
+ * are delivered.
+ *
+ * @param cycles Maximal number of cycles to execute.
+ *
+ * @return Number of cycles executed.
+ *
+ */
+uint64_t dev_run(uint64_t cycles)
+{
+    ASSERT(dev_run_supported());
+
+    if ((event_queue_count > 0) && (event_queue[0]->deadline > machine_cycles)
+            && (event_queue[0]->deadline - machine_cycles < cycles)) {
+        cycles = event_queue[0]->deadline - machine_cycles;
+    }
+
+    if (cycles > UINT_MAX) {
+        cycles = UINT_MAX;
+    }
+
+    device_t *dev = step_devices[0];
+
+    if (dev->type->elapsed != NULL) {
+        run_device = dev;
+        run_synced = 0;
+    }
+
+    stepping_order = dev->order;
+    uint64_t executed = dev->type->run(dev, (unsigned int) cycles);
+    stepping_order = 0;
+
+    uint64_t synced = run_synced;
+    run_device = NULL;
+    run_synced = 0;
+
+    dev_skip_cycles(executed - synced);
+    return executed;
+}
+
+/** Get the number of completed machine cycles
+ *
+ * The machine cycle counter is advanced only at the end of a run
+ * (see dev_run()). The cycles executed so far by the running device
+ * are added, so that the devices accessed in the middle of the run
+ * observe the current machine cycle.
+ *
+ * @return Number of machine cycles completed before the current one.
+ *
+ */
+uint64_t dev_cycles(void)
+{
+    if (run_device == NULL) {
+        return machine_cycles;
+    }
+
+    return machine_cycles + (run_device->type->elapsed(run_device) - run_synced);
+}
+
+/** Bring the machine cycle counter up to date in the middle of a run
+ *
+ * The cycles executed so far by the running device are added to the
+ * machine cycle counter and the device events due in these cycles are
+ * delivered, as if the cycles were executed one by one. To be called
+ * before the devices are accessed. Does nothing outside of dev_run().
+ *
+ */
+void dev_run_sync(void)
+{
+    device_t *dev = run_device;
+    if (dev == NULL) {
+        return;
+    }
+
+    uint64_t elapsed = dev->type->elapsed(dev);
+
+    /* The events see the machine cycle counter only */
+    run_device = NULL;
+    dev_skip_cycles(elapsed - run_synced);
+    run_device = dev;
+    run_synced = elapsed;
+}
+
+/** Check whether the device has been passed in the current machine cycle
+ *
+ * Devices which do not need to be stepped every cycle use this to
+ * reconstruct the state they would have when stepped in the device
+ * list order.
+ *
+ * @param dev Device to check.
+ *
+ * @return True if the device precedes the device being stepped.
+ *
+ */
+bool dev_cycle_passed(const device_t *dev)
+{
+    return (stepping_order != 0) && (dev->order < stepping_order);
+}
+
+/** Compare the event priority of two devices
+ *
+ * @return True if the event of the first device comes first.
+ *
+ */
+static bool event_before(const device_t *first, const device_t *second)
+{
+    if (first->deadline != second->deadline) {
+        return first->deadline < second->deadline;
+    }
+
+    return first->order < second->order;
+}
+
+/** Store a device to the given event queue position */
+static void event_queue_set(size_t index, device_t *dev)
+{
+    event_queue[index] = dev;
+    dev->event_index = index;
+}
+
+/** Move an event towards the root of the event queue */
+static void event_queue_up(size_t index)
+{
+    device_t *dev = event_queue[index];
+
+    while (index > 0) {
+        size_t parent = (index - 1) / 2;
+        if (!event_before(dev, event_queue[parent])) {
+            break;
+        }
+
+        event_queue_set(index, event_queue[parent]);
+        index = parent;
+    }
+
+    event_queue_set(index, dev);
+}
+
+/** Move an event towards the leaves of the event queue */
+static void event_queue_down(size_t index)
+{
+    device_t *dev = event_queue[index];
+
+    while (true) {
+        size_t child = 2 * index + 1;
+        if (child >= event_queue_count) {
+            break;
+        }
+
+        if ((child + 1 < event_queue_count) && (event_before(event_queue[child + 1], event_queue[child]))) {
+            child++;
+        }
+
+        if (!event_before(event_queue[child], dev)) {
+            break;
+        }
+
+        event_queue_set(index, event_queue[child]);
+        index = child;
+    }
+
+    event_queue_set(index, dev);
+}
+
+/** Schedule a device event
+ *
+ * The event is delivered at the end of the machine cycle in which
+ * the given number of machine cycles (counted from the cycles
+ * completed so far, see dev_cycles()) is completed. A pending event
+ * of the device is rescheduled.
+ *
+ * @param dev    Device to be scheduled.
+ * @param cycles Number of machine cycles until the event.
+ *
+ */
+void dev_schedule(device_t *dev, uint64_t cycles)
+{
+    dev_unschedule(dev);
+
+    if (event_queue_count == event_queue_size) {
+        size_t size = (event_queue_size == 0) ? 16 : 2 * event_queue_size;
+        device_t **queue = (device_t **) safe_malloc(size * sizeof(device_t *));
+
+        if (event_queue_count > 0) {
+            memcpy(queue, event_queue, event_queue_count * sizeof(device_t *));
+        }
+
+        safe_free(event_queue);
+        event_queue = queue;
+        event_queue_size = size;
+    }
+
+    dev->deadline = dev_cycles() + cycles;
+    event_queue_set(event_queue_count++, dev);
+    event_queue_up(dev->event_index);
+}
+
+/** Cancel the pending event of a device (if any)
+ *
+ * @param dev Device to be unscheduled.
+ *
+ */
+void dev_unschedule(device_t *dev)
+{
+    size_t index = dev->event_index;
+    if (index == DEVICE_NO_EVENT) {
+        return;
+    }
+
+    dev->event_index = DEVICE_NO_EVENT;
+    event_queue_count--;
+
+    if (index < event_queue_count) {
+        device_t *last = event_queue[event_queue_count];
+
+        event_queue_set(index, last);
+        event_queue_up(index);
+        event_queue_down(last->event_index);
+    }
+}
+
+/** Advance the machine cycle counter without stepping the devices
+ *
+ * The device events due in the skipped cycles are delivered
+ * in the order of their deadlines.
+ *
+ * @param cycles Number of machine cycles to skip.
+ *
+ */
+void dev_skip_cycles(uint64_t cycles)
+{
+    uint64_t target = machine_cycles + cycles;
+
+    while ((event_queue_count > 0) && (event_queue[0]->deadline <= target)) {
+        if (event_queue[0]->deadline > machine_cycles) {
+            machine_cycles = event_queue[0]->deadline;
+        }
+
+        dev_run_events();
+    }
+
+    machine_cycles = target;
+}
+
+/** Get the number of machine cycles in which nothing happens
+ *
+ * Such cycles can be skipped if all devices stepped every machine
+ * cycle are idle (e.g. processors waiting for an interrupt) and
+ * no device event is due before.
+ *
+ * @param limit Maximal number of cycles to return.
+ *
+ * @return Number of cycles which can be passed to dev_skip_idle().
+ *
+ */
+uint64_t dev_idle_cycles(uint64_t limit)
+{
+    uint64_t cycles = limit;
+
+    if (event_queue_count > 0) {
+        uint64_t deadline = event_queue[0]->deadline;
+        if (deadline <= machine_cycles) {
+            return 0;
+        }
+
+        if (deadline - machine_cycles < cycles) {
+            cycles = deadline - machine_cycles;
+        }
+    }
+
+    for (size_t i = 0; (i < step_devices_count) && (cycles > 0); i++) {
+        device_t *dev = step_devices[i];
+
+        if (dev->type->idle == NULL) {
+            return 0;
+        }
+
+        uint64_t idle = dev->type->idle(dev);
+        if (idle < cycles) {
+            cycles = idle;
+        }
+    }
+
+    return cycles;
+}
+
+/** Skip idle machine cycles
+ *
+ * The devices account the cycles at once and the machine cycle
+ * counter is advanced. The events due at the end of the last
+ * cycle are delivered.
+ *
+ * @param cycles Number of cycles as returned by dev_idle_cycles().
+ *
+ */
+void dev_skip_idle(uint64_t cycles)
+{
+    for (size_t i = 0; i < step_devices_count; i++) {
+        device_t *dev = step_devices[i];
+
+        stepping_order = dev->order;
+        dev->type->skip(dev, cycles);
+    }
+
+    stepping_order = 0;
+    dev_skip_cycles(cycles);
+}
+
+/** Deliver all device events due in the completed machine cycle
+ *
+ * Events with the same deadline are delivered in the device
+ * list order.
+ *
+ */
+void dev_run_events(void)
+{
+    while ((event_queue_count > 0) && (event_queue[0]->deadline <= machine_cycles)) {
+        device_t *dev = event_queue[0];
+        dev_unschedule(dev);
+
+        if (dev->type->event != NULL) {
+            dev->type->event(dev);
+        } else {
+            /* Periodic step4k adapter */
+            dev_schedule(dev, 4096);
+            dev->type->step4k(dev);
+        }
+    }
 }
 
 /** Generic help generation
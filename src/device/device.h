@@ -26,6 +26,8 @@ struct device;
  */
 typedef struct {
     bool nondet; /**< Device is non-deterministic. */
+    bool host_time; /**< Device reads the host time unless the virtual
+                         time mode is used (see machine_time_frequency). */
     const char *const name; /**< Device type name (i82xx etc.). */
     const char *const brief; /**< Brief decription of the device type. */
     const char *const full; /**< Full device type description. */
@@ -36,9 +38,24 @@ typedef struct {
     /** Called every machine cycle. */
     void (*step)(struct device *dev);
 
+    /** Execute multiple machine cycles at once (returns the number executed). */
+    unsigned int (*run)(struct device *dev, unsigned int cycles);
+
+    /** Number of machine cycles executed so far by the current run. */
+    uint64_t (*elapsed)(struct device *dev);
+
     /** Called every 4096th machine cycle. */
     void (*step4k)(struct device *dev);
 
+    /** Called when the deadline requested by dev_schedule() is reached. */
+    void (*event)(struct device *dev);
+
+    /** Number of machine cycles the device stays idle for (0 if busy). */
+    uint64_t (*idle)(struct device *dev);
+
+    /** Account idle machine cycles at once instead of stepping. */
+    void (*skip)(struct device *dev, uint64_t cycles);
+
     /** Device memory read */
     void (*read8)(unsigned int procno, struct device *dev, ptr36_t addr,
             uint8_t *val);
@@ -79,8 +96,16 @@ typedef struct device {
                      Must be unique. */
     void *data; /**< Device specific pointer where
                      internal data are stored. */
+
+    uint64_t order; /**< Position of the device in the stepping order. */
+    uint64_t deadline; /**< Machine cycle of the pending event. */
+    size_t event_index; /**< Position in the event queue
+                             (DEVICE_NO_EVENT if not scheduled). */
 } device_t;
 
+/** Event queue position of a device without a pending event */
+#define DEVICE_NO_EVENT SIZE_MAX
+
 typedef enum {
     DEVICE_FILTER_ALL,
     DEVICE_FILTER_STEP,
@@ -118,6 +143,23 @@ extern size_t dev_count_by_partial_name(const char *prefix_name,
 
 extern bool dev_next(device_t **dev, device_filter_t filter);
 
+/*
+ * Device scheduling
+ */
+extern void dev_step_all(void);
+extern device_t *const *dev_step_list(size_t *count);
+extern bool dev_run_supported(void);
+extern uint64_t dev_run(uint64_t cycles);
+extern uint64_t dev_cycles(void);
+extern void dev_run_sync(void);
+extern void dev_run_events(void);
+extern void dev_skip_cycles(uint64_t cycles);
+extern uint64_t dev_idle_cycles(uint64_t limit);
+extern void dev_skip_idle(uint64_t cycles);
+extern void dev_schedule(device_t *dev, uint64_t cycles);
+extern void dev_unschedule(device_t *dev);
+extern bool dev_cycle_passed(const device_t *dev);
+
 extern bool is_dev_cpu(const device_t *dev);
 
 extern bool is_dev_peripheral(const device_t *dev);
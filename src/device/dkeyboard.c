@@ -20,6 +20,7 @@
 #include "../assert.h"
 #include "../env.h"
 #include "../fault.h"
+#include "../physmem.h"
 #include "../text.h"
 #include "../utils.h"
 #include "cpu/general_cpu.h"
@@ -108,6 +109,8 @@ static bool dkeyboard_init(token_t *parm, device_t *dev)
     data->keycount = 0;
     data->overrun = 0;
 
+    physmem_map_device(dev, addr, REGISTER_LIMIT);
+
     return true;
 }
 
@@ -19,6 +19,7 @@
 #include "../assert.h"
 #include "../fault.h"
 #include "../parser.h"
+#include "../physmem.h"
 #include "../text.h"
 #include "../utils.h"
 #include "device.h"
@@ -110,6 +111,8 @@ static bool dlcd_init(token_t *parm, device_t *dev)
 
     data->addr = addr;
 
+    physmem_map_device(dev, addr, REGISTER_LIMIT);
+
     return true;
 }
 
@@ -16,6 +16,7 @@
 
 #include "../assert.h"
 #include "../fault.h"
+#include "../physmem.h"
 #include "../utils.h"
 #include "cpu/general_cpu.h"
 #include "dnomem.h"
@@ -110,6 +111,8 @@ static bool dnomem_init(token_t *parm, device_t *dev)
     data->mode = &access_mode_warn;
     data->register_dump = false;
 
+    physmem_map_device(dev, start_addr, size);
+
     return true;
 }
 
@@ -16,6 +16,7 @@
 
 #include "../fault.h"
 #include "../parser.h"
+#include "../physmem.h"
 #include "../text.h"
 #include "../utils.h"
 #include "cpu/general_cpu.h"
@@ -119,6 +120,8 @@ static bool dorder_init(token_t *parm, device_t *dev)
     data->intno = _intno;
     data->cmds = 0;
 
+    physmem_map_device(dev, addr, REGISTER_LIMIT);
+
     return true;
 }
 
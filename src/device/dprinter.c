@@ -19,6 +19,7 @@
 #include "../assert.h"
 #include "../fault.h"
 #include "../parser.h"
+#include "../physmem.h"
 #include "../text.h"
 #include "../utils.h"
 #include "device.h"
@@ -81,6 +82,8 @@ static bool dprinter_init(token_t *parm, device_t *dev)
     data->count = 0;
     data->endianness = true;
 
+    physmem_map_device(dev, addr, REGISTER_LIMIT);
+
     return true;
 }
 
@@ -100,9 +100,12 @@ static bool dr4kcpu_stat(token_t *parm, device_t *dev)
             cpu->intr[2], cpu->intr[3], cpu->intr[4]);
 
     printf("[Interrupt 5       ] [Interrupt 6       ] [Interrupt 7       ]\n");
-    printf("%20" PRIu64 " %20" PRIu64 " %20" PRIu64 "\n",
+    printf("%20" PRIu64 " %20" PRIu64 " %20" PRIu64 "\n\n",
             cpu->intr[5], cpu->intr[6], cpu->intr[7]);
 
+    printf("[Code line refresh ]\n");
+    printf("%20" PRIu64 "\n", cpu->line_refresh);
+
     return true;
 }
 
@@ -363,6 +366,38 @@ static void dr4kcpu_step(device_t *dev)
     r4k_step(get_r4k(dev));
 }
 
+/** Execute the given number of processor cycles
+ *
+ */
+static unsigned int dr4kcpu_run(device_t *dev, unsigned int cycles)
+{
+    return r4k_run(get_r4k(dev), cycles);
+}
+
+/** Get the number of processor cycles executed so far by the run
+ *
+ */
+static uint64_t dr4kcpu_elapsed(device_t *dev)
+{
+    return r4k_run_elapsed(get_r4k(dev));
+}
+
+/** Get the number of idle processor cycles
+ *
+ */
+static uint64_t dr4kcpu_idle(device_t *dev)
+{
+    return r4k_idle_cycles(get_r4k(dev));
+}
+
+/** Account idle processor cycles at once
+ *
+ */
+static void dr4kcpu_skip(device_t *dev, uint64_t cycles)
+{
+    r4k_skip(get_r4k(dev), cycles);
+}
+
 cmd_t dr4kcpu_cmds[] = {
     { "init",
             (fcmd_t) dr4kcpu_init,
@@ -476,6 +511,10 @@ device_type_t dr4kcpu = {
     /* Functions */
     .done = dr4kcpu_done,
     .step = dr4kcpu_step,
+    .run = dr4kcpu_run,
+    .elapsed = dr4kcpu_elapsed,
+    .idle = dr4kcpu_idle,
+    .skip = dr4kcpu_skip,
 
     /* Commands */
     .cmds = dr4kcpu_cmds
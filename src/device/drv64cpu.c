@@ -306,6 +306,38 @@ static void drv64cpu_step(device_t *dev)
     rv64_cpu_step(get_rv64(dev));
 }
 
+/**
+ * Run device operation
+ */
+static unsigned int drv64cpu_run(device_t *dev, unsigned int cycles)
+{
+    return rv64_cpu_run(get_rv64(dev), cycles);
+}
+
+/**
+ * Elapsed run cycles query operation
+ */
+static uint64_t drv64cpu_elapsed(device_t *dev)
+{
+    return rv64_cpu_run_elapsed(get_rv64(dev));
+}
+
+/**
+ * Idle cycles query operation
+ */
+static uint64_t drv64cpu_idle(device_t *dev)
+{
+    return rv64_cpu_idle_cycles(get_rv64(dev));
+}
+
+/**
+ * Idle cycles skip operation
+ */
+static void drv64cpu_skip(device_t *dev, uint64_t cycles)
+{
+    rv64_cpu_skip(get_rv64(dev), cycles);
+}
+
 /**
  * Device commands specification
  */
@@ -410,6 +442,7 @@ cmd_t drv64cpu_cmds[] = {
  */
 device_type_t drv64cpu = {
     .nondet = false,
+    .host_time = true,
 
     .name = "drv64cpu",
 
@@ -419,6 +452,10 @@ device_type_t drv64cpu = {
 
     .done = drv64cpu_done,
     .step = drv64cpu_step,
+    .run = drv64cpu_run,
+    .elapsed = drv64cpu_elapsed,
+    .idle = drv64cpu_idle,
+    .skip = drv64cpu_skip,
 
     .cmds = drv64cpu_cmds
 };
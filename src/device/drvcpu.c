@@ -306,6 +306,38 @@ static void drvcpu_step(device_t *dev)
     rv32_cpu_step(get_rv(dev));
 }
 
+/**
+ * Run device operation
+ */
+static unsigned int drvcpu_run(device_t *dev, unsigned int cycles)
+{
+    return rv32_cpu_run(get_rv(dev), cycles);
+}
+
+/**
+ * Elapsed run cycles query operation
+ */
+static uint64_t drvcpu_elapsed(device_t *dev)
+{
+    return rv32_cpu_run_elapsed(get_rv(dev));
+}
+
+/**
+ * Idle cycles query operation
+ */
+static uint64_t drvcpu_idle(device_t *dev)
+{
+    return rv32_cpu_idle_cycles(get_rv(dev));
+}
+
+/**
+ * Idle cycles skip operation
+ */
+static void drvcpu_skip(device_t *dev, uint64_t cycles)
+{
+    rv32_cpu_skip(get_rv(dev), cycles);
+}
+
 /**
  * Device commands specification
  */
@@ -410,6 +442,7 @@ cmd_t drvcpu_cmds[] = {
  */
 device_type_t drvcpu = {
     .nondet = false,
+    .host_time = true,
 
     .name = "drvcpu",
 
@@ -419,6 +452,10 @@ device_type_t drvcpu = {
 
     .done = drvcpu_done,
     .step = drvcpu_step,
+    .run = drvcpu_run,
+    .elapsed = drvcpu_elapsed,
+    .idle = drvcpu_idle,
+    .skip = drvcpu_skip,
 
     .cmds = drvcpu_cmds
 };
@@ -21,6 +21,7 @@
 #include "../arch/endianness.h"
 #include "../assert.h"
 #include "../fault.h"
+#include "../physmem.h"
 #include "../utils.h"
 #include "cpu/general_cpu.h"
 #include "dsh2ecmt.h"
@@ -114,6 +115,11 @@ static void sh2e_cmt_cpu_cycles_update(void *peripheral, unsigned int cycles)
 {
     sh2e_cmt_t *cmt = (sh2e_cmt_t *) ((peripheral_t *) peripheral)->data;
     cmt->cpu_cycles = cycles;
+
+    /* Process the cycles at the end of the machine cycle */
+    if (cycles > 0) {
+        dev_schedule(((peripheral_t *) peripheral)->dev, 0);
+    }
 }
 
 static void sh2e_cmt_interrupt_up(void *peripheral, unsigned int int_no)
@@ -130,9 +136,76 @@ static void sh2e_cmt_interrupt_up(void *peripheral, unsigned int int_no)
     }
 }
 
+/**
+ * @brief Gets the number of CPU cycles per counter increment of a CMT channel
+ */
+static uint16_t sh2e_cmt_channel_period(sh2e_cmt_channel_reg_t *channel_reg)
+{
+    uint16_t period = 0;
+    switch ((channel_reg->cmcsr.cks1 << 1) | channel_reg->cmcsr.cks0) {
+    case 0: {
+        period = SH2E_CMT_PERIOD_INTERVAL_1;
+        break;
+    }
+    case 1: {
+        period = SH2E_CMT_PERIOD_INTERVAL_2;
+        break;
+    }
+    case 2: {
+        period = SH2E_CMT_PERIOD_INTERVAL_3;
+        break;
+    }
+    case 3: {
+        period = SH2E_CMT_PERIOD_INTERVAL_4;
+        break;
+    }
+    }
+
+    return period;
+}
+
+/**
+ * @brief Gets the number of CPU cycles until the first compare match
+ * of the running CMT channels
+ */
+static uint64_t sh2e_cmt_deadline(void *peripheral)
+{
+    sh2e_cmt_t *cmt = (sh2e_cmt_t *) ((peripheral_t *) peripheral)->data;
+
+    bool const enabled[SH2E_CMT_CHANNELS_COUNT] = {
+        cmt->cmt_regs.cmstr.str0,
+        cmt->cmt_regs.cmstr.str1
+    };
+    uint_fast16_t const counters[SH2E_CMT_CHANNELS_COUNT] = {
+        cmt->counter0,
+        cmt->counter1
+    };
+
+    uint64_t deadline = UINT64_MAX;
+
+    for (unsigned int i = 0; i < SH2E_CMT_CHANNELS_COUNT; ++i) {
+        if (!enabled[i]) {
+            continue;
+        }
+
+        sh2e_cmt_channel_reg_t *channel_reg = &cmt->cmt_regs.channels[i];
+
+        // Counter increments up to the compare match (the counter wraps around)
+        uint64_t steps = (uint16_t) (channel_reg->cmcor - channel_reg->cmcnt - 1) + UINT64_C(1);
+        uint64_t cycles = steps * sh2e_cmt_channel_period(channel_reg) - counters[i];
+
+        if (cycles < deadline) {
+            deadline = cycles;
+        }
+    }
+
+    return deadline;
+}
+
 static peripheral_ops_t const sh2e_cmt_peripheral_ops = {
     .interrupt_up_from_cpu = (interrupt_func_t) sh2e_cmt_interrupt_up,
-    .update_cycles = (update_cycles_func_t) sh2e_cmt_cpu_cycles_update
+    .update_cycles = (update_cycles_func_t) sh2e_cmt_cpu_cycles_update,
+    .deadline = (deadline_func_t) sh2e_cmt_deadline
 };
 
 /** Init command implementation
@@ -195,10 +268,13 @@ static bool dsh2ecmt_init(token_t *parm, device_t *dev)
     *generic_peripheral = (peripheral_t) {
         .data = sh2e_cmt,
         .type = &sh2e_cmt_peripheral_ops,
+        .dev = dev,
     };
 
     dev->data = generic_peripheral;
 
+    physmem_map_device(dev, addr, (SH2E_CMT_CHANNELS_COUNT * sizeof(sh2e_cmt_channel_reg_t)) + sizeof(uint16_t));
+
     return true;
 }
 
@@ -500,25 +576,7 @@ static void update_channel_counter(sh2e_cmt_t *cmt, unsigned int channel_num)
 
     sh2e_cmt_channel_reg_t *channel_reg = &cmt->cmt_regs.channels[channel_num];
 
-    uint16_t period = 0;
-    switch ((channel_reg->cmcsr.cks1 << 1) | channel_reg->cmcsr.cks0) {
-    case 0: {
-        period = SH2E_CMT_PERIOD_INTERVAL_1;
-        break;
-    }
-    case 1: {
-        period = SH2E_CMT_PERIOD_INTERVAL_2;
-        break;
-    }
-    case 2: {
-        period = SH2E_CMT_PERIOD_INTERVAL_3;
-        break;
-    }
-    case 3: {
-        period = SH2E_CMT_PERIOD_INTERVAL_4;
-        break;
-    }
-    }
+    uint16_t period = sh2e_cmt_channel_period(channel_reg);
 
     uint_fast16_t *counter = NULL;
     unsigned int *int_no = NULL;
@@ -561,12 +619,14 @@ static void update_channel_counter(sh2e_cmt_t *cmt, unsigned int channel_num)
     }
 }
 
-/** CMT step implementation
+/** CMT event implementation
+ *
+ * Processes the CPU cycles reported by the last executed instruction.
  *
  * @param dev Device pointer
  *
  */
-static void dsh2ecmt_step(device_t *dev)
+static void dsh2ecmt_event(device_t *dev)
 {
     ASSERT(dev != NULL);
 
@@ -736,7 +796,7 @@ device_type_t const dsh2ecmt = {
     .write16 = dsh2ecmt_write16,
     .write32 = dsh2ecmt_write32,
 
-    .step = dsh2ecmt_step,
+    .event = dsh2ecmt_event,
     .done = dsh2ecmt_done,
 
     /* Commands */
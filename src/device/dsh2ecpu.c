@@ -249,6 +249,42 @@ dsh2ecpu_step(device_t *const dev)
     sh2e_cpu_step(device_get_sh2e_cpu(dev));
 }
 
+/** Execute the given number of processor cycles. */
+static unsigned int
+dsh2ecpu_run(device_t *const dev, unsigned int cycles)
+{
+    ASSERT(dev != NULL);
+
+    return sh2e_cpu_run(device_get_sh2e_cpu(dev), cycles);
+}
+
+/** Get the number of processor cycles executed so far by the run. */
+static uint64_t
+dsh2ecpu_elapsed(device_t *const dev)
+{
+    ASSERT(dev != NULL);
+
+    return sh2e_cpu_run_elapsed(device_get_sh2e_cpu(dev));
+}
+
+/** Get the number of idle processor cycles. */
+static uint64_t
+dsh2ecpu_idle(device_t *const dev)
+{
+    ASSERT(dev != NULL);
+
+    return sh2e_cpu_idle_cycles(device_get_sh2e_cpu(dev));
+}
+
+/** Account idle processor cycles at once. */
+static void
+dsh2ecpu_skip(device_t *const dev, uint64_t cycles)
+{
+    ASSERT(dev != NULL);
+
+    sh2e_cpu_skip(device_get_sh2e_cpu(dev), cycles);
+}
+
 static cmd_t const dsh2ecpu_cmds[] = {
     { "init",
             (fcmd_t) dsh2ecpu_cmd_init,
@@ -355,6 +391,10 @@ device_type_t const dsh2ecpu = {
     /* Device functions. */
     .done = dsh2ecpu_done,
     .step = dsh2ecpu_step,
+    .run = dsh2ecpu_run,
+    .elapsed = dsh2ecpu_elapsed,
+    .idle = dsh2ecpu_idle,
+    .skip = dsh2ecpu_skip,
 
     /* Commands */
     .cmds = dsh2ecpu_cmds,
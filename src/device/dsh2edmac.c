@@ -224,12 +224,47 @@ static void sh2e_dmac_cpu_cycles_update(void *peripheral, unsigned int cycles)
 {
     sh2e_dmac_t *dmac = (sh2e_dmac_t *) ((peripheral_t *) peripheral)->data;
     dmac->cpu_cycles = cycles;
+
+    /* Process the cycles at the end of the machine cycle */
+    if (cycles > 0) {
+        dev_schedule(((peripheral_t *) peripheral)->dev, 0);
+    }
+}
+
+/**
+ * @brief Gets the number of CPU cycles the DMAC stays idle for.
+ * @param peripheral Pointer to the peripheral structure which contains the DMAC instance data.
+ * @return UINT64_MAX if no transfer can start, 1 otherwise (the DMAC works every cycle).
+ */
+static uint64_t sh2e_dmac_deadline(void *peripheral)
+{
+    sh2e_dmac_t *dmac = (sh2e_dmac_t *) ((peripheral_t *) peripheral)->data;
+
+    if (dmac->transfer_state != SH2E_DMAC_TRANSFER_STATE_INITIAL) {
+        return 1;
+    }
+
+    // Mirrors the conditions of step_initial()
+    if (!dmac->dmac_regs.dmaor.dme || dmac->dmac_regs.dmaor.nmif || dmac->dmac_regs.dmaor.ae) {
+        return UINT64_MAX;
+    }
+
+    for (unsigned int i = 0; i < SH2E_DMAC_CHANNELS_COUNT; ++i) {
+        sh2e_dmac_channel_regs_t *channel_regs = &dmac->dmac_regs.channels[i];
+
+        if (channel_regs->chcr.de && !channel_regs->chcr.te) {
+            return 1;
+        }
+    }
+
+    return UINT64_MAX;
 }
 
 static peripheral_ops_t const sh2e_dmac_peripheral_ops = {
     .interrupt_up_from_cpu = (interrupt_func_t) sh2e_dmac_interrupt_up_from_cpu,
     .interrupt_up_from_peripheral = (interrupt_func_t) sh2e_dmac_interrupt_up_from_peripheral,
-    .update_cycles = (update_cycles_func_t) sh2e_dmac_cpu_cycles_update
+    .update_cycles = (update_cycles_func_t) sh2e_dmac_cpu_cycles_update,
+    .deadline = (deadline_func_t) sh2e_dmac_deadline
 };
 
 /** Init command implementation
@@ -296,10 +331,13 @@ static bool dsh2edmac_init(token_t *parm, device_t *dev)
     *generic_peripheral = (peripheral_t) {
         .data = sh2e_dmac,
         .type = &sh2e_dmac_peripheral_ops,
+        .dev = dev,
     };
 
     dev->data = generic_peripheral;
 
+    physmem_map_device(dev, addr, SH2E_DMAC_REGISTERS_SIZE);
+
     return true;
 }
 
@@ -848,12 +886,14 @@ static void step_initial(sh2e_dmac_t *dmac)
     }
 }
 
-/** DMAC step implementation
+/** DMAC event implementation
+ *
+ * Processes the CPU cycles reported by the last executed instruction.
  *
  * @param dev Device pointer
  *
  */
-static void dsh2edmac_step(device_t *dev)
+static void dsh2edmac_event(device_t *dev)
 {
     ASSERT(dev != NULL);
 
@@ -1072,7 +1112,7 @@ device_type_t const dsh2edmac = {
     .write16 = dsh2edmac_write16,
     .write32 = dsh2edmac_write32,
 
-    .step = dsh2edmac_step,
+    .event = dsh2edmac_event,
     .done = dsh2edmac_done,
 
     /* Commands */
@@ -4,6 +4,7 @@
 #include "../arch/endianness.h"
 #include "../assert.h"
 #include "../fault.h"
+#include "../physmem.h"
 #include "../utils.h"
 #include "device.h"
 #include "dsh2eintc.h"
@@ -18,6 +19,7 @@ static intc_ops_t const sh2e_intc_ops = {
     .interrupt_down = (interrupt_func_t) sh2e_intc_deassert_interrupt,
 
     .check_interrupts = (check_interrupts_func_t) sh2e_check_pending_interrupts,
+    .peek_interrupts = (peek_interrupts_func_t) sh2e_peek_pending_interrupts,
     .accept_interrupt = (accept_interrupt_func_t) sh2e_accept_interrupt,
 
     .check_resets = (check_resets_func_t) sh2e_check_pending_resets,
@@ -79,6 +81,8 @@ dsh2eintc_cmd_init(token_t *parm, device_t *const dev)
 
     dev->data = generic_intc;
 
+    physmem_map_device(dev, addr, (SH2E_INTC_IPR_REGISTERS_COUNT + SH2E_INTC_SYSTEM_REGISTERS_COUNT) * sizeof(uint16_t));
+
     return true;
 }
 
@@ -21,6 +21,7 @@
 #include "../arch/endianness.h"
 #include "../assert.h"
 #include "../fault.h"
+#include "../physmem.h"
 #include "../utils.h"
 #include "cpu/general_cpu.h"
 #include "dsh2ewdt.h"
@@ -83,6 +84,51 @@ static void sh2e_wdt_rstcsr_reset(sh2e_wdt_t *wdt)
     wdt->wdt_regs.rstcsr._rf = 0x1F; // Reserved bits must be 1
 }
 
+/**
+ * @brief Gets the number of CPU cycles per WDT counter increment
+ */
+static uint16_t sh2e_wdt_period(sh2e_wdt_t *wdt)
+{
+    uint16_t period = 0;
+
+    switch ((wdt->wdt_regs.tcsr.cks2 << 2) | (wdt->wdt_regs.tcsr.cks1 << 1) | wdt->wdt_regs.tcsr.cks0) {
+    case 0: {
+        period = SH2E_WDT_PERIOD_INTERVAL_1;
+        break;
+    }
+    case 1: {
+        period = SH2E_WDT_PERIOD_INTERVAL_2;
+        break;
+    }
+    case 2: {
+        period = SH2E_WDT_PERIOD_INTERVAL_3;
+        break;
+    }
+    case 3: {
+        period = SH2E_WDT_PERIOD_INTERVAL_4;
+        break;
+    }
+    case 4: {
+        period = SH2E_WDT_PERIOD_INTERVAL_5;
+        break;
+    }
+    case 5: {
+        period = SH2E_WDT_PERIOD_INTERVAL_6;
+        break;
+    }
+    case 6: {
+        period = SH2E_WDT_PERIOD_INTERVAL_7;
+        break;
+    }
+    case 7: {
+        period = SH2E_WDT_PERIOD_INTERVAL_8;
+        break;
+    }
+    }
+
+    return period;
+}
+
 /**
  * @brief Updates the internal cycle counter of the specified CMT in the system with the given number of cycles
  * @param cmt The CMT instance to update
@@ -92,6 +138,11 @@ static void sh2e_wdt_cpu_cycles_update(void *peripheral, unsigned int cycles)
 {
     sh2e_wdt_t *wdt = (sh2e_wdt_t *) ((peripheral_t *) peripheral)->data;
     wdt->cpu_cycles = cycles;
+
+    /* Process the cycles at the end of the machine cycle */
+    if (cycles > 0) {
+        dev_schedule(((peripheral_t *) peripheral)->dev, 0);
+    }
 }
 
 static void sh2e_wdt_interrupt_up(void *peripheral, unsigned int int_no)
@@ -114,9 +165,25 @@ static void sh2e_wdt_interrupt_up(void *peripheral, unsigned int int_no)
     }
 }
 
+/**
+ * @brief Gets the number of CPU cycles until the WDT counter overflows
+ */
+static uint64_t sh2e_wdt_deadline(void *peripheral)
+{
+    sh2e_wdt_t *wdt = (sh2e_wdt_t *) ((peripheral_t *) peripheral)->data;
+
+    if (!wdt->wdt_regs.tcsr.tme) {
+        return UINT64_MAX;
+    }
+
+    uint64_t steps = 256 - wdt->wdt_regs.tcnt;
+    return steps * sh2e_wdt_period(wdt) - wdt->counter;
+}
+
 static peripheral_ops_t const sh2e_wdt_peripheral_ops = {
     .interrupt_up_from_cpu = (interrupt_func_t) sh2e_wdt_interrupt_up,
-    .update_cycles = (update_cycles_func_t) sh2e_wdt_cpu_cycles_update
+    .update_cycles = (update_cycles_func_t) sh2e_wdt_cpu_cycles_update,
+    .deadline = (deadline_func_t) sh2e_wdt_deadline
 };
 
 /** Init command implementation
@@ -178,10 +245,13 @@ static bool dsh2ewdt_init(token_t *parm, device_t *dev)
     *generic_peripheral = (peripheral_t) {
         .data = sh2e_wdt,
         .type = &sh2e_wdt_peripheral_ops,
+        .dev = dev,
     };
 
     dev->data = generic_peripheral;
 
+    physmem_map_device(dev, addr, SH2E_WDT_REGISTERS_COUNT * sizeof(uint8_t));
+
     return true;
 }
 
@@ -396,12 +466,14 @@ static void dsh2ewdt_write32(unsigned int procno, device_t *dev, ptr36_t addr, u
     }
 }
 
-/** WDT step implementation
+/** WDT event implementation
+ *
+ * Processes the CPU cycles reported by the last executed instruction.
  *
  * @param dev Device pointer
  *
  */
-static void dsh2ewdt_step(device_t *dev)
+static void dsh2ewdt_event(device_t *dev)
 {
     ASSERT(dev != NULL);
 
@@ -409,42 +481,7 @@ static void dsh2ewdt_step(device_t *dev)
 
     // Check if the timer is enabled
     if (wdt->wdt_regs.tcsr.tme) {
-        uint16_t period;
-
-        switch ((wdt->wdt_regs.tcsr.cks2 << 2) | (wdt->wdt_regs.tcsr.cks1 << 1) | wdt->wdt_regs.tcsr.cks0) {
-        case 0: {
-            period = SH2E_WDT_PERIOD_INTERVAL_1;
-            break;
-        }
-        case 1: {
-            period = SH2E_WDT_PERIOD_INTERVAL_2;
-            break;
-        }
-        case 2: {
-            period = SH2E_WDT_PERIOD_INTERVAL_3;
-            break;
-        }
-        case 3: {
-            period = SH2E_WDT_PERIOD_INTERVAL_4;
-            break;
-        }
-        case 4: {
-            period = SH2E_WDT_PERIOD_INTERVAL_5;
-            break;
-        }
-        case 5: {
-            period = SH2E_WDT_PERIOD_INTERVAL_6;
-            break;
-        }
-        case 6: {
-            period = SH2E_WDT_PERIOD_INTERVAL_7;
-            break;
-        }
-        case 7: {
-            period = SH2E_WDT_PERIOD_INTERVAL_8;
-            break;
-        }
-        }
+        uint16_t period = sh2e_wdt_period(wdt);
 
         wdt->counter += wdt->cpu_cycles;
 
@@ -610,7 +647,7 @@ device_type_t const dsh2ewdt = {
     .write16 = dsh2ewdt_write16,
     .write32 = dsh2ewdt_write32,
 
-    .step = dsh2ewdt_step,
+    .event = dsh2ewdt_event,
     .done = dsh2ewdt_done,
 
     /* Commands */
@@ -18,6 +18,8 @@
 
 #include "../assert.h"
 #include "../fault.h"
+#include "../main.h"
+#include "../physmem.h"
 #include "../utils.h"
 #include "device.h"
 #include "dtime.h"
@@ -71,6 +73,8 @@ static bool dtime_init(token_t *parm, device_t *dev)
 
     data->addr = addr;
 
+    physmem_map_device(dev, addr, REGISTER_LIMIT);
+
     return true;
 }
 
@@ -116,9 +120,37 @@ static void dtime_done(device_t *dev)
     safe_free(dev->data);
 }
 
+/** Get the current time
+ *
+ * In the virtual time mode, the time elapsed since the start
+ * of the simulation is derived from the machine cycles.
+ * Otherwise the host time is read via gettimeofday().
+ *
+ * @param sec  Seconds since the Epoch (returned)
+ * @param usec Microseconds past the seconds (returned)
+ *
+ */
+static void dtime_now(uint32_t *sec, uint32_t *usec)
+{
+    if (machine_time_frequency != 0) {
+        uint64_t hz = (uint64_t) machine_time_frequency * 1000;
+        uint64_t cycles = dev_cycles();
+
+        *sec = (uint32_t) (cycles / hz);
+        *usec = (uint32_t) ((cycles % hz) * 1000 / machine_time_frequency);
+        return;
+    }
+
+    struct timeval timeval;
+    gettimeofday(&timeval, NULL);
+
+    *sec = (uint32_t) timeval.tv_sec;
+    *usec = (uint32_t) timeval.tv_usec;
+}
+
 /** Read command implementation (32 bits)
  *
- * Read host time via gettimeofday().
+ * Read the current time (see dtime_now()).
  *
  * @param dev  Device pointer
  * @param addr Address of the read operation
@@ -133,23 +165,24 @@ static void dtime_read32(unsigned int procno, device_t *dev, ptr36_t addr, uint3
     dtime_data_t *data = (dtime_data_t *) dev->data;
 
     /* Get actual time */
-    struct timeval timeval;
+    uint32_t sec;
+    uint32_t usec;
 
     switch (addr - data->addr) {
     case REGISTER_SEC:
-        gettimeofday(&timeval, NULL);
-        *val = (uint32_t) timeval.tv_sec;
+        dtime_now(&sec, &usec);
+        *val = sec;
         break;
     case REGISTER_USEC:
-        gettimeofday(&timeval, NULL);
-        *val = (uint32_t) timeval.tv_usec;
+        dtime_now(&sec, &usec);
+        *val = usec;
         break;
     }
 }
 
 /** Read command implementation (64 bits)
  *
- * Read host time via gettimeofday().
+ * Read the current time (see dtime_now()).
  *
  * @param dev  Device pointer
  * @param addr Address of the read operation
@@ -164,14 +197,13 @@ static void dtime_read64(unsigned int procno, device_t *dev, ptr36_t addr, uint6
     dtime_data_t *data = (dtime_data_t *) dev->data;
 
     /* Get actual time */
-    struct timeval timeval;
-    uint32_t sec = (uint32_t) timeval.tv_sec;
-    uint32_t usec = (uint32_t) timeval.tv_usec;
+    uint32_t sec;
+    uint32_t usec;
 
     /* Pack the values in little-endian fashion */
     switch (addr - data->addr) {
     case REGISTER_SEC:
-        gettimeofday(&timeval, NULL);
+        dtime_now(&sec, &usec);
         *val = ((uint64_t) sec) | ((uint64_t) usec << 32);
         break;
     }
@@ -214,6 +246,7 @@ static cmd_t dtime_cmds[] = {
 device_type_t dtime = {
     /* Real-time device induces non-determinism */
     .nondet = true,
+    .host_time = true,
 
     /* Type name and description */
     .name = "dtime",
@@ -221,7 +254,8 @@ device_type_t dtime = {
     .full = "The time device brings the host real time to the simulated "
             "environment. One memory-mapped register allows programs"
             "to read hosts time since the Epoch as specified in the"
-            "POSIX.",
+            "POSIX. In the virtual time mode (see the timefreq variable), "
+            "the time since the start of the simulation is read instead.",
 
     /* Functions */
     .done = dtime_done,
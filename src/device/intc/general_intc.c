@@ -99,6 +99,14 @@ bool intc_check_interrupts(general_intc_t *intc, uint8_t mask, uint8_t *interrup
     return intc->type->check_interrupts(intc->data, mask, interrupt_out);
 }
 
+bool intc_peek_interrupts(general_intc_t *intc, uint8_t mask)
+{
+    if (intc == NULL) {
+        intc = get_fallback_intc();
+    }
+    return intc->type->peek_interrupts(intc->data, mask);
+}
+
 void intc_accept_interrupt(general_intc_t *intc, uint32_t *new_mask_out)
 {
     if (intc == NULL) {
@@ -27,6 +27,8 @@
 typedef void (*interrupt_func_t)(void *, unsigned int);
 /** Function type for checking pending interrupts */
 typedef bool (*check_interrupts_func_t)(void *, uint8_t, uint8_t *);
+/** Function type for checking pending interrupts without side effects */
+typedef bool (*peek_interrupts_func_t)(void *, uint8_t);
 /** Function type for accepting interrupt */
 typedef void (*accept_interrupt_func_t)(void *, uint32_t *);
 /** Function type for initializing the INTC */
@@ -40,6 +42,7 @@ typedef struct {
     interrupt_func_t interrupt_down; /** Cancel an interrupt */
 
     check_interrupts_func_t check_interrupts; /** Check for pending interrupts */
+    peek_interrupts_func_t peek_interrupts; /** Check for pending interrupts without side effects */
     accept_interrupt_func_t accept_interrupt; /** Accept an interrupt */
 
     check_resets_func_t check_resets; /** Check for pending resets */
@@ -93,6 +96,13 @@ extern void intc_interrupt_down(general_intc_t *intc, unsigned int no);
 
 extern bool intc_check_interrupts(general_intc_t *intc, uint8_t mask, uint8_t *interrupt_out);
 
+/**
+ * @brief Checks for pending interrupts without side effects
+ *
+ * Unlike intc_check_interrupts, the NMI edge is not consumed.
+ */
+extern bool intc_peek_interrupts(general_intc_t *intc, uint8_t mask);
+
 extern void intc_accept_interrupt(general_intc_t *intc, uint32_t *new_mask_out);
 
 extern bool intc_check_resets(general_intc_t *intc, uint8_t *reset_out);
@@ -186,18 +186,10 @@ sh2e_get_priority(sh2e_intc_t *intc, sh2e_intc_source_t *source)
     return (intc->intc_regs.priority[reg_index] >> shift) & 0x0F;
 }
 
-bool sh2e_check_pending_interrupts(sh2e_intc_t *intc, uint8_t mask, uint8_t *interrupt_out)
+/** Find the pending interrupt source with the highest priority above the mask (0 if none). */
+static uint8_t
+sh2e_find_pending_interrupt(sh2e_intc_t *intc, uint8_t mask, uint32_t *priority_out)
 {
-    ASSERT(intc != NULL);
-    ASSERT(interrupt_out != NULL);
-
-    // Check NMI
-    if (sh2e_check_nmi_and_update_nmi_prev_value(intc)) {
-        intc->interrupt_out = SH2E_INTC_NMI_VECTOR_ADDRESS_OFFSET;
-        intc->priority_out = SH2E_INTC_PRIORITY_MAX_VALUE;
-        return SH2E_INTC_NMI_VECTOR_ADDRESS_OFFSET;
-    }
-
     uint8_t interrupt_source = 0;
     uint32_t interrupt_priority = 0;
 
@@ -215,6 +207,25 @@ bool sh2e_check_pending_interrupts(sh2e_intc_t *intc, uint8_t mask, uint8_t *int
         }
     }
 
+    *priority_out = interrupt_priority;
+    return interrupt_source;
+}
+
+bool sh2e_check_pending_interrupts(sh2e_intc_t *intc, uint8_t mask, uint8_t *interrupt_out)
+{
+    ASSERT(intc != NULL);
+    ASSERT(interrupt_out != NULL);
+
+    // Check NMI
+    if (sh2e_check_nmi_and_update_nmi_prev_value(intc)) {
+        intc->interrupt_out = SH2E_INTC_NMI_VECTOR_ADDRESS_OFFSET;
+        intc->priority_out = SH2E_INTC_PRIORITY_MAX_VALUE;
+        return SH2E_INTC_NMI_VECTOR_ADDRESS_OFFSET;
+    }
+
+    uint32_t interrupt_priority = 0;
+    uint8_t interrupt_source = sh2e_find_pending_interrupt(intc, mask, &interrupt_priority);
+
     intc->priority_out = interrupt_priority;
     intc->interrupt_out = interrupt_source;
 
@@ -227,6 +238,18 @@ bool sh2e_check_pending_interrupts(sh2e_intc_t *intc, uint8_t mask, uint8_t *int
     return false;
 }
 
+bool sh2e_peek_pending_interrupts(sh2e_intc_t *intc, uint8_t mask)
+{
+    ASSERT(intc != NULL);
+
+    if (sh2e_check_nmi_interrupt(intc)) {
+        return true;
+    }
+
+    uint32_t interrupt_priority = 0;
+    return sh2e_find_pending_interrupt(intc, mask, &interrupt_priority) != 0;
+}
+
 bool sh2e_check_pending_resets(sh2e_intc_t *intc, uint8_t *reset_out)
 {
     ASSERT(intc != NULL);
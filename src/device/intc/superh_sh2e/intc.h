@@ -185,6 +185,7 @@ extern void sh2e_intc_init_regs(sh2e_intc_t *intc);
 extern void sh2e_intc_done(sh2e_intc_t *intc);
 
 extern bool sh2e_check_pending_interrupts(sh2e_intc_t *intc, uint8_t mask, uint8_t *interrupt_out);
+extern bool sh2e_peek_pending_interrupts(sh2e_intc_t *intc, uint8_t mask);
 
 extern bool sh2e_check_pending_resets(sh2e_intc_t *intc, uint8_t *reset_out);
 
@@ -174,8 +174,9 @@ static bool mem_load(token_t *parm, device_t *dev)
         return false;
     }
 
-    // FIXME: invalidate binary translation
     size_t rd = fread(area->data, 1, fsize, file);
+    physmem_invalidate_area(area);
+
     if (rd != fsize) {
         io_error(path);
         safe_fclose(file, path);
@@ -225,8 +226,8 @@ static bool mem_fill(token_t *parm, device_t *dev)
         return false;
     }
 
-    // FIXME: invalidate binary translation
     memset(area->data, c, FRAMES2SIZE(area->count));
+    physmem_invalidate_area(area);
     return true;
 }
 
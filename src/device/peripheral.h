@@ -7,19 +7,24 @@
 
 #include "../list.h"
 
+struct device;
+
 typedef void (*interrupt_func_t)(void *peripheral, unsigned int int_no);
 typedef void (*update_cycles_func_t)(void *peripheral, unsigned int cycles);
+typedef uint64_t (*deadline_func_t)(void *peripheral);
 
 typedef struct {
     interrupt_func_t interrupt_up_from_cpu; /** Signal an interrupt from CPU to the peripheral */
     interrupt_func_t interrupt_up_from_peripheral; /** Signal an interrupt from the peripheral to another peripheral */
     update_cycles_func_t update_cycles; /** Function which notifies the peripheral about cycle updates */
+    deadline_func_t deadline; /** Number of cycles until the peripheral sets a flag or raises an interrupt (UINT64_MAX if never) */
 } peripheral_ops_t;
 
 /** Structure describing a peripheral device */
 typedef struct peripheral {
     const peripheral_ops_t *type;
     void *data;
+    struct device *dev; /** Device owning the peripheral */
 } peripheral_t;
 
 /** Structure describing a link to a peripheral device */
@@ -18,6 +18,7 @@
 #include "device/cpu/mips_r4000/debug.h"
 #include "device/cpu/riscv_rv32ima/debug.h"
 #include "device/cpu/superh_sh2e/debug.h"
+#include "device/device.h"
 #include "env.h"
 #include "fault.h"
 #include "parser.h"
@@ -136,6 +137,72 @@ static bool change_ireg(unsigned int i)
     return true;
 }
 
+/** Change the machine_quantum variable
+ *
+ * @return true if successful
+ *
+ */
+static bool change_quantum(unsigned int quantum)
+{
+    if (quantum == 0) {
+        error("Quantum must be at least 1 cycle");
+        return false;
+    }
+
+    machine_quantum = quantum;
+
+    return true;
+}
+
+/** Change the machine_parallel variable
+ *
+ * @return true if successful
+ *
+ */
+static bool change_parallel(bool parallel)
+{
+    if ((parallel) && (!machine_nondet)) {
+        error("Parallel execution is non-deterministic.\n"
+              "Use the command-line option -n to enable non-determinism.");
+        return false;
+    }
+
+    machine_parallel = parallel;
+
+    return true;
+}
+
+/** Change the machine_time_frequency variable
+ *
+ * The devices reading the time (the mtime of the RISC-V processors,
+ * dtime) are set up for the time mode they were added in, hence
+ * the mode cannot change afterwards.
+ *
+ * @return true if successful
+ *
+ */
+static bool change_timefreq(unsigned int freq)
+{
+    if (freq == machine_time_frequency) {
+        return true;
+    }
+
+    device_t *dev = NULL;
+    while (dev_next(&dev, DEVICE_FILTER_ALL)) {
+        if (dev->type->host_time) {
+            error("The time frequency cannot be changed once devices reading\n"
+                  "the time (%s) are added. Set it before adding them\n"
+                  "or use the command-line option -T.",
+                    dev->name);
+            return false;
+        }
+    }
+
+    machine_time_frequency = freq;
+
+    return true;
+}
+
 /*
  * Description of variables
  */
@@ -146,6 +213,65 @@ const env_t global_env[] = {
             vt_uint,
             NULL,
             NULL },
+    { "quantum",
+            "Machine cycles executed between event checks",
+            "Number of machine cycles executed in a row before the "
+            "simulator checks for interactive mode, stepping and "
+            "debugger events. Code breakpoints and debugger sessions "
+            "force a quantum of a single cycle.",
+            vt_uint,
+            &machine_quantum,
+            change_quantum },
+    { "parallel",
+            "Run processors in parallel",
+            "Step each MIPS and RISC-V processor by its own host thread. "
+            "The processors synchronize at the end of each quantum, "
+            "which is also when interprocessor and device interrupts "
+            "are delivered. Requires non-deterministic mode.",
+            vt_bool,
+            &machine_parallel,
+            change_parallel },
+    { "idleskip",
+            "Skip idle machine cycles",
+            "When all processors wait for an interrupt, advance the "
+            "machine cycle counter, the processor counters and timers "
+            "at once up to the next device event instead of simulating "
+            "the idle cycles one by one.",
+            vt_bool,
+            &machine_idle_skip,
+            NULL },
+    { "decodecache",
+            "Decoded instruction cache limit (MiB)",
+            "Maximum amount of memory in MiB used by the caches of "
+            "decoded instruction pages of all processors. When the "
+            "limit is reached, the least recently used pages are "
+            "evicted and decoded again when executed. Zero means "
+            "no limit.",
+            vt_uint,
+            &machine_decode_cache_limit,
+            NULL },
+    { "jit",
+            "Translate hot RISC-V blocks",
+            "Translate frequently executed basic blocks of RV32IMA "
+            "processors to host code (only on x86-64 Linux hosts). "
+            "Blocks with system and atomic instructions are always "
+            "interpreted. Not used while processors run in parallel.",
+            vt_bool,
+            &machine_jit,
+            NULL },
+    { "timefreq",
+            "Virtual time frequency (kHz)",
+            "When non-zero, the time of the simulated machine (RISC-V "
+            "mtime and the dtime device) is derived from the machine "
+            "cycles as if the machine ran at the given frequency in kHz, "
+            "which makes the timer interrupts reproducible. Zero means "
+            "the host time is used. It cannot be changed once RISC-V "
+            "processors or dtime devices are added (use the -T option "
+            "or set it first). In the virtual time mode, dtime does not "
+            "require the -n option.",
+            vt_uint,
+            &machine_time_frequency,
+            change_timefreq },
     { "disassembling",
             "Disassembling features",
             NULL,
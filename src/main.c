@@ -12,6 +12,7 @@
 
 #include <fcntl.h>
 #include <getopt.h>
+#include <limits.h>
 #include <stdbool.h>
 #include <stdio.h>
 #include <stdlib.h>
@@ -24,6 +25,7 @@
 #include "debug/breakpoint.h"
 #include "debug/dap.h"
 #include "debug/gdb.h"
+#include "device/cpu/decode_cache.h"
 #include "device/cpu/general_cpu.h"
 #include "device/cpu/mips_r4000/cpu.h"
 #include "device/cpu/mips_r4000/debug.h"
@@ -35,6 +37,7 @@
 #include "fault.h"
 #include "input.h"
 #include "parser.h"
+#include "smp.h"
 #include "text.h"
 #include "utils.h"
 
@@ -76,6 +79,9 @@ dap_state_t dap_state = DAP_READY;
 /** Enable non-deterministic behaviour */
 bool machine_nondet = false;
 
+/** Execute processors in parallel host threads */
+bool machine_parallel = false;
+
 /** Trace instructions */
 bool machine_trace = false;
 
@@ -109,11 +115,35 @@ bool machine_unit_testing = false;
  */
 uint64_t stepping = 0;
 
+/**
+ * Maximum number of machine cycles executed in a row
+ * without checking for debugger and interactive events.
+ */
+unsigned int machine_quantum = DEFAULT_MACHINE_QUANTUM;
+
+/** Skip machine cycles in which all processors are idle */
+bool machine_idle_skip = true;
+
+/** Memory limit of the decoded instruction caches in MiB (0 = unlimited) */
+unsigned int machine_decode_cache_limit = DEFAULT_DECODE_CACHE_LIMIT;
+
+/** Binary translation of hot RISC-V blocks */
+bool machine_jit = false;
+
+/**
+ * Frequency of the virtual time in kHz, i.e. the number
+ * of machine cycles per millisecond. Zero means host time.
+ */
+unsigned int machine_time_frequency = 0;
+
+/** Profile of the decoded instruction pages (NULL if not used) */
+static char *decode_profile = NULL;
+
 /** SC-LL tracking */
 list_t sc_list;
 
-/** Total number of machine steps completed */
-static uint64_t steps = 0;
+/** Total number of machine cycles completed */
+uint64_t machine_cycles = 0;
 
 /** Command line options */
 static struct option long_options[] = {
@@ -157,6 +187,18 @@ static struct option long_options[] = {
             no_argument,
             0,
             'X' },
+    { "parallel",
+            no_argument,
+            0,
+            'P' },
+    { "decode-profile",
+            required_argument,
+            0,
+            'D' },
+    { "virtual-time",
+            required_argument,
+            0,
+            'T' },
     { NULL, 0, NULL, 0 }
 };
 
@@ -205,6 +247,23 @@ static void setup_dap(const char *opt)
     alert("DAP debugging enabled for this session.");
 }
 
+/** Setup the virtual time
+ *
+ */
+static void setup_virtual_time(const char *opt)
+{
+    ASSERT(opt != NULL);
+
+    char *endp;
+    unsigned long int frequency = strtoul(opt, &endp, 0);
+
+    if ((*endp != 0) || (frequency == 0) || (frequency > UINT_MAX)) {
+        die(ERR_PARM, "Invalid virtual time frequency");
+    }
+
+    machine_time_frequency = frequency;
+}
+
 static bool parse_cmdline(int argc, char *args[])
 {
     opterr = 0;
@@ -212,7 +271,7 @@ static bool parse_cmdline(int argc, char *args[])
     while (true) {
         int option_index = 0;
 
-        int c = getopt_long(argc, args, "tVic:hg:d::nXI",
+        int c = getopt_long(argc, args, "tVic:hg:d::nXIPD:T:",
                 long_options, &option_index);
 
         if (c == -1) {
@@ -254,6 +313,18 @@ static bool parse_cmdline(int argc, char *args[])
         case 'X':
             machine_specific_instructions = false;
             break;
+        case 'P':
+            machine_parallel = true;
+            break;
+        case 'D':
+            if (decode_profile) {
+                safe_free(decode_profile);
+            }
+            decode_profile = safe_strdup(optarg);
+            break;
+        case 'T':
+            setup_virtual_time(optarg);
+            break;
         case '?':
             die(ERR_PARM, "Unknown parameter or argument required");
             break;
@@ -266,6 +337,11 @@ static bool parse_cmdline(int argc, char *args[])
         die(ERR_PARM, "Unexpected arguments");
     }
 
+    if ((machine_parallel) && (!machine_nondet)) {
+        die(ERR_PARM, "Parallel execution is non-deterministic, "
+                      "use it together with -n");
+    }
+
     return true;
 }
 
@@ -316,27 +392,103 @@ static void dap_startup(void)
     }
 }
 
-/** Run 4096 machine cycles
+/** Run one machine cycle
  *
  */
 static void machine_step(void)
 {
     /* Execute device cycles */
-    device_t *dev = NULL;
-    while (dev_next(&dev, DEVICE_FILTER_STEP)) {
-        dev->type->step(dev);
-    }
+    dev_step_all();
 
     /* Increase machine cycle counter */
-    steps++;
-
-    /* Every 4096th cycle execute
-       the step4k device functions */
-    if ((steps % 4096) == 0) {
-        dev = NULL;
-        while (dev_next(&dev, DEVICE_FILTER_STEP4K)) {
-            dev->type->step4k(dev);
+    machine_cycles++;
+
+    /* Deliver device events due in this cycle
+       (including the step4k device functions) */
+    dev_run_events();
+}
+
+/** Check whether the machine has to be controlled every cycle
+ *
+ * Debugger sessions and code breakpoints need to be checked
+ * before each machine cycle, so the quantum degrades to
+ * a single cycle in that case.
+ *
+ */
+static bool machine_needs_cycle_control(void)
+{
+    return (remote_gdb) || (dap_enabled)
+            || (breakpoint_code_breakpoints_armed());
+}
+
+/** Run a quantum of machine cycles by the single stepped device
+ *
+ * The device executes multiple cycles at once up to the next
+ * device event. Idle cycles are skipped as in machine_run_quantum().
+ *
+ */
+static void machine_run_blocks(unsigned int budget)
+{
+    while ((budget > 0) && (!machine_halt) && (!machine_interactive)) {
+        if (machine_idle_skip) {
+            /* Fast-forward to the next event while the processor waits */
+            uint64_t idle = dev_idle_cycles(budget);
+            if (idle > 1) {
+                dev_skip_idle(idle);
+                budget -= idle;
+                continue;
+            }
+        }
+
+        budget -= dev_run(budget);
+    }
+}
+
+/** Run a quantum of machine cycles
+ *
+ * The first cycle is always executed. The following cycles
+ * are executed only as long as nothing asks the simulation
+ * to stop and the stepping countdown would not expire.
+ * The countdown is updated exactly as if each cycle went
+ * through the main loop.
+ *
+ */
+static void machine_run_quantum(void)
+{
+    unsigned int budget = machine_needs_cycle_control() ? 1 : machine_quantum;
+
+    /* Processors run in parallel only between stepping commands */
+    if ((budget > 1) && (stepping == 0) && (smp_run_quantum(budget))) {
+        return;
+    }
+
+    /* A single processor executes whole basic blocks */
+    if ((budget > 1) && (stepping == 0) && (dev_run_supported())) {
+        machine_run_blocks(budget);
+        return;
+    }
+
+    machine_step();
+
+    while ((--budget > 0) && (!machine_halt) && (!machine_interactive)) {
+        if (stepping > 0) {
+            /* The next cycle has to go through the main loop */
+            if (stepping == 1) {
+                break;
+            }
+
+            stepping--;
+        } else if (machine_idle_skip) {
+            /* Fast-forward to the next event while all processors wait */
+            uint64_t idle = dev_idle_cycles(budget);
+            if (idle > 1) {
+                dev_skip_idle(idle);
+                budget -= idle - 1;
+                continue;
+            }
         }
+
+        machine_step();
     }
 }
 
@@ -409,13 +561,15 @@ static void machine_run(void)
          * Continue with the simulation
          */
         if (!machine_halt) {
-            machine_step();
+            machine_run_quantum();
         }
     }
 }
 
 static void cleanup()
 {
+    smp_done();
+
     /* Execute device cycles */
     device_t *dev = NULL;
     device_t *next_dev = NULL;
@@ -467,6 +621,11 @@ int main(int argc, char *args[])
         alert("Entering interactive mode, type `help' for help.");
     }
 
+    /* Warm up the decoded instruction caches */
+    if (decode_profile != NULL) {
+        decode_cache_profile_load(decode_profile);
+    }
+
     /*
      * Main simulation loop
      */
@@ -476,8 +635,14 @@ int main(int argc, char *args[])
      * Finalization
      */
     input_back();
-    if (steps > 0) {
-        printf("\nCycles: %" PRIu64 "\n", steps);
+    if (machine_cycles > 0) {
+        printf("\nCycles: %" PRIu64 "\n", machine_cycles);
+    }
+
+    /* The decoded pages are released with the processors */
+    if (decode_profile != NULL) {
+        decode_cache_profile_save(decode_profile);
+        safe_free(decode_profile);
     }
 
     cleanup();
@@ -19,6 +19,12 @@
 #define MAX_CPUS 32
 #define MAX_INTRS 11
 
+/** Default number of machine cycles in one execution quantum */
+#define DEFAULT_MACHINE_QUANTUM 4096
+
+/** Default memory limit of the decoded instruction caches in MiB */
+#define DEFAULT_DECODE_CACHE_LIMIT 64
+
 /** Physical frame number type */
 typedef uint32_t pfn_t;
 
@@ -75,6 +81,7 @@ extern dap_state_t dap_state;
 
 /** General simulator behaviour */
 extern bool machine_nondet;
+extern bool machine_parallel;
 extern bool machine_trace;
 extern bool machine_halt;
 extern bool machine_break;
@@ -85,5 +92,11 @@ extern bool machine_specific_instructions;
 extern bool machine_allow_interactive_without_tty;
 extern bool machine_unit_testing;
 extern uint64_t stepping;
+extern unsigned int machine_quantum;
+extern bool machine_idle_skip;
+extern unsigned int machine_decode_cache_limit;
+extern bool machine_jit;
+extern unsigned int machine_time_frequency;
+extern uint64_t machine_cycles;
 
 #endif
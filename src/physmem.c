@@ -9,17 +9,21 @@
  *
  */
 #include <inttypes.h>
+#include <sched.h>
+#include <stdatomic.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 
 #include "assert.h"
 #include "debug/breakpoint.h"
+#include "device/cpu/decode_cache.h"
 #include "device/cpu/general_cpu.h"
 #include "device/device.h"
 #include "endian.h"
 #include "list.h"
 #include "physmem.h"
+#include "smp.h"
 #include "utils.h"
 
 /** Physical memory management
@@ -43,6 +47,10 @@ typedef ftl1_t *ftl0_t[FTL1_COUNT];
 
 static ftl0_t ftl0;
 
+unsigned int physmem_tlb_epoch = 0;
+
+static void sc_forget_frame(frame_t *frame);
+
 void physmem_wire(physmem_area_t *area)
 {
     ASSERT(area != NULL);
@@ -77,8 +85,10 @@ void physmem_wire(physmem_area_t *area)
         frame->area = area;
         frame->data = area->data + FRAMES2SIZE(pfn);
         // frame->trans = area->trans + SIZE2INSTRS(FRAMES2SIZE(pfn));
-        frame->valid = false;
+        physmem_written(frame, addr, FRAME_SIZE);
     }
+
+    physmem_update_breakpoints();
 }
 
 void physmem_unwire(physmem_area_t *area)
@@ -101,6 +111,8 @@ void physmem_unwire(physmem_area_t *area)
         ASSERT(*frame_ref != NULL);
 
         /* Remove frame */
+        sc_forget_frame(*frame_ref);
+        safe_free((*frame_ref)->breakpoints);
         safe_free(*frame_ref);
 
         /* Deallocate ftl1 if it contains only NULL entries*/
@@ -115,6 +127,30 @@ void physmem_unwire(physmem_area_t *area)
 
         if (ftl1_empty) {
             safe_free(ftl1);
+            ftl0[(addr >> FTL1_SHIFT) & FTL1_MASK] = NULL;
+        }
+    }
+
+    /* The decoded pages refer to the removed frames */
+    decode_cache_flush();
+    physmem_update_breakpoints();
+}
+
+/** Invalidate the decoded instructions of a memory area
+ *
+ * To be called when the content of the area is modified
+ * bypassing physmem_write*().
+ *
+ */
+void physmem_invalidate_area(physmem_area_t *area)
+{
+    ASSERT(area != NULL);
+
+    for (pfn_t pfn = 0; pfn < area->count; pfn++) {
+        frame_t *frame = physmem_find_frame(FRAME2ADDR(area->start + pfn));
+
+        if ((frame != NULL) && (frame->area == area)) {
+            physmem_written(frame, FRAME2ADDR(area->start + pfn), FRAME_SIZE);
         }
     }
 }
@@ -132,48 +168,556 @@ frame_t *physmem_find_frame(ptr36_t addr)
     return NULL;
 }
 
+/** Fill a soft-TLB entry
+ *
+ * Flushes the whole soft-TLB if it is out of date.
+ *
+ * @param tlb  Soft-TLB of the processor.
+ * @param addr Physical address.
+ *
+ * @return The entry or NULL if the address is not backed by memory.
+ *
+ */
+physmem_tlb_entry_t *physmem_tlb_fill(physmem_tlb_t *tlb, ptr36_t addr)
+{
+    if (tlb->epoch != physmem_tlb_epoch) {
+        memset(tlb->entries, 0, sizeof(tlb->entries));
+        tlb->epoch = physmem_tlb_epoch;
+    }
+
+    frame_t *frame = physmem_find_frame(addr);
+    if (frame == NULL) {
+        return NULL;
+    }
+
+    ASSERT(frame->area);
+    ASSERT(frame->data);
+
+    physmem_tlb_entry_t *entry = &tlb->entries[ADDR2FRAME(addr) & PHYSMEM_TLB_MASK];
+
+    entry->tag = PHYSMEM_TLB_TAG(addr);
+    entry->flags = 0;
+    entry->frame = frame;
+    entry->data = frame->data;
+
+    if (frame->area->writable) {
+        entry->flags |= PHYSMEM_TLB_WRITABLE;
+    }
+
+    if (frame->breakpoints_count > 0) {
+        entry->flags |= PHYSMEM_TLB_WATCHED;
+    }
+
+    return entry;
+}
+
+/** Invalidate the soft-TLBs of all processors
+ *
+ * To be called whenever the memory frames or the memory breakpoints
+ * change. The soft-TLBs are flushed lazily on their next use.
+ *
+ */
+void physmem_tlb_flush_all(void)
+{
+    physmem_tlb_epoch++;
+}
+
+/** Compare frame breakpoint intervals by their start */
+static int frame_breakpoint_compare(const void *first, const void *second)
+{
+    const frame_breakpoint_t *a = (const frame_breakpoint_t *) first;
+    const frame_breakpoint_t *b = (const frame_breakpoint_t *) second;
+
+    return (a->start > b->start) - (a->start < b->start);
+}
+
+/** Add a memory breakpoint interval to a frame
+ *
+ */
+static void frame_breakpoint_add(frame_t *frame, ptr36_t start, ptr36_t end,
+        physmem_breakpoint_t *breakpoint)
+{
+    frame_breakpoint_t *breakpoints = (frame_breakpoint_t *)
+            safe_malloc((frame->breakpoints_count + 1) * sizeof(frame_breakpoint_t));
+
+    if (frame->breakpoints_count > 0) {
+        memcpy(breakpoints, frame->breakpoints,
+                frame->breakpoints_count * sizeof(frame_breakpoint_t));
+    }
+
+    breakpoints[frame->breakpoints_count] = (frame_breakpoint_t) {
+        .start = start,
+        .end = end,
+        .max_end = end,
+        .breakpoint = breakpoint
+    };
+
+    safe_free(frame->breakpoints);
+    frame->breakpoints = breakpoints;
+    frame->breakpoints_count++;
+}
+
+/** Rebuild the per-frame index of the memory breakpoints
+ *
+ * To be called whenever the memory breakpoints or the memory
+ * frames change.
+ *
+ */
+void physmem_update_breakpoints(void)
+{
+    /* Clear the index */
+    for (size_t i = 0; i < FTL1_COUNT; i++) {
+        ftl1_t *ftl1 = ftl0[i];
+        if (ftl1 == NULL) {
+            continue;
+        }
+
+        for (size_t j = 0; j < FTL2_COUNT; j++) {
+            frame_t *frame = (*ftl1)[j];
+            if (frame != NULL) {
+                safe_free(frame->breakpoints);
+                frame->breakpoints_count = 0;
+            }
+        }
+    }
+
+    /* Add the breakpoints to the frames they overlap */
+    physmem_breakpoint_t *breakpoint;
+
+    for_each(physmem_breakpoints, breakpoint, physmem_breakpoint_t)
+    {
+        if (breakpoint->size == 0) {
+            continue;
+        }
+
+        ptr36_t start = breakpoint->addr;
+        ptr36_t end = breakpoint->addr + breakpoint->size;
+        ptr36_t frame_addr = start & ~((ptr36_t) FRAME_MASK);
+
+        for (; frame_addr < end; frame_addr += FRAME_SIZE) {
+            frame_t *frame = physmem_find_frame(frame_addr);
+            if (frame != NULL) {
+                frame_breakpoint_add(frame, start, end, breakpoint);
+            }
+        }
+    }
+
+    /* Sort the intervals */
+    for (size_t i = 0; i < FTL1_COUNT; i++) {
+        ftl1_t *ftl1 = ftl0[i];
+        if (ftl1 == NULL) {
+            continue;
+        }
+
+        for (size_t j = 0; j < FTL2_COUNT; j++) {
+            frame_t *frame = (*ftl1)[j];
+            if ((frame == NULL) || (frame->breakpoints_count == 0)) {
+                continue;
+            }
+
+            qsort(frame->breakpoints, frame->breakpoints_count,
+                    sizeof(frame_breakpoint_t), frame_breakpoint_compare);
+
+            for (size_t k = 1; k < frame->breakpoints_count; k++) {
+                if (frame->breakpoints[k - 1].max_end > frame->breakpoints[k].max_end) {
+                    frame->breakpoints[k].max_end = frame->breakpoints[k - 1].max_end;
+                }
+            }
+        }
+    }
+
+    physmem_tlb_flush_all();
+}
+
 /** Find an activated memory breakpoint
  *
  * Find an activated memory breakpoint which would be hit for specified
  * memory address and access conditions.
  *
+ * @param frame        Frame containing the address.
  * @param addr         Address, where the breakpoint can be hit.
  * @param size         Size of the access operation.
  * @param access_flags Specifies the access condition, under the breakpoint
  *                     will be hit.
  *
- * @return Found breakpoint structure or NULL if there is not any.
- *
  */
-static void physmem_breakpoint_find(ptr36_t addr, len36_t size,
+static void physmem_breakpoint_find(frame_t *frame, ptr36_t addr, len36_t size,
         access_t access_type)
 {
-    physmem_breakpoint_t *breakpoint;
+    if (frame->breakpoints_count == 0) {
+        return;
+    }
 
-    for_each(physmem_breakpoints, breakpoint, physmem_breakpoint_t)
-    {
-        if (breakpoint->addr + breakpoint->size < addr) {
+    /* Intervals starting before the end of the access */
+    size_t last = 0;
+    size_t high = frame->breakpoints_count;
+
+    while (last < high) {
+        size_t middle = last + (high - last) / 2;
+
+        if (frame->breakpoints[middle].start < addr + size) {
+            last = middle + 1;
+        } else {
+            high = middle;
+        }
+    }
+
+    /* Skip the intervals ending before the access */
+    size_t first = 0;
+    high = last;
+
+    while (first < high) {
+        size_t middle = first + (high - first) / 2;
+
+        if (frame->breakpoints[middle].max_end <= addr) {
+            first = middle + 1;
+        } else {
+            high = middle;
+        }
+    }
+
+    for (size_t i = first; i < last; i++) {
+        frame_breakpoint_t *interval = &frame->breakpoints[i];
+
+        if ((interval->end > addr)
+                && ((access_type & interval->breakpoint->access_flags) != 0)) {
+            physmem_breakpoint_hit(interval->breakpoint, access_type);
+            break;
+        }
+    }
+}
+
+/** Device register window
+ *
+ */
+typedef struct {
+    ptr36_t start;
+    ptr36_t end;
+    device_t *dev;
+} devmem_window_t;
+
+/** Address range dispatched to the same devices
+ *
+ */
+typedef struct {
+    ptr36_t start;
+    ptr36_t end;
+
+    /** Devices of the range in devmem_targets */
+    size_t first;
+    size_t count;
+} devmem_range_t;
+
+/** Register windows declared by the devices */
+static devmem_window_t *devmem_windows = NULL;
+static size_t devmem_windows_count = 0;
+static size_t devmem_windows_size = 0;
+
+/** Dispatch map (sorted disjoint ranges) */
+static devmem_range_t *devmem_ranges = NULL;
+static size_t devmem_ranges_count = 0;
+static device_t **devmem_targets = NULL;
+
+/** Devices with memory callbacks which have not declared any window.
+    They are called for every address. */
+static device_t **devmem_unmapped = NULL;
+static size_t devmem_unmapped_count = 0;
+
+static bool devmem_map_valid = false;
+
+/** Declare a device register window
+ *
+ * Only the devices owning the accessed address are called by
+ * the device memory access functions. The windows may overlap.
+ *
+ * @param dev  Device owning the window.
+ * @param addr Start address of the window.
+ * @param size Size of the window.
+ *
+ */
+void physmem_map_device(device_t *dev, ptr36_t addr, len36_t size)
+{
+    ASSERT(dev != NULL);
+
+    if (size == 0) {
+        return;
+    }
+
+    if (devmem_windows_count == devmem_windows_size) {
+        size_t windows_size = (devmem_windows_size == 0) ? 16 : 2 * devmem_windows_size;
+        devmem_window_t *windows = (devmem_window_t *) safe_malloc(windows_size * sizeof(devmem_window_t));
+
+        if (devmem_windows_count > 0) {
+            memcpy(windows, devmem_windows, devmem_windows_count * sizeof(devmem_window_t));
+        }
+
+        safe_free(devmem_windows);
+        devmem_windows = windows;
+        devmem_windows_size = windows_size;
+    }
+
+    devmem_windows[devmem_windows_count++] = (devmem_window_t) {
+        .start = addr,
+        .end = addr + size,
+        .dev = dev
+    };
+
+    devmem_map_valid = false;
+}
+
+/** Remove all register windows of a device
+ *
+ */
+void physmem_unmap_device(device_t *dev)
+{
+    size_t count = 0;
+
+    for (size_t i = 0; i < devmem_windows_count; i++) {
+        if (devmem_windows[i].dev != dev) {
+            devmem_windows[count++] = devmem_windows[i];
+        }
+    }
+
+    devmem_windows_count = count;
+    devmem_map_valid = false;
+}
+
+/** Rebuild the dispatch map on the next device memory access
+ *
+ * To be called whenever the device list changes.
+ *
+ */
+void physmem_update_device_map(void)
+{
+    devmem_map_valid = false;
+}
+
+static bool devmem_has_callbacks(const device_t *dev)
+{
+    const device_type_t *type = dev->type;
+
+    return (type->read8 != NULL) || (type->read16 != NULL)
+            || (type->read32 != NULL) || (type->read64 != NULL)
+            || (type->write8 != NULL) || (type->write16 != NULL)
+            || (type->write32 != NULL) || (type->write64 != NULL);
+}
+
+static bool devmem_has_window(const device_t *dev)
+{
+    for (size_t i = 0; i < devmem_windows_count; i++) {
+        if (devmem_windows[i].dev == dev) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+static int devmem_ptr36_compare(const void *first, const void *second)
+{
+    ptr36_t a = *((const ptr36_t *) first);
+    ptr36_t b = *((const ptr36_t *) second);
+
+    return (a > b) - (a < b);
+}
+
+/** Insert a device into a target list keeping the device list order
+ *
+ */
+static void devmem_insert_target(device_t **targets, size_t *count, device_t *dev)
+{
+    size_t i = *count;
+
+    while ((i > 0) && (targets[i - 1]->order > dev->order)) {
+        targets[i] = targets[i - 1];
+        i--;
+    }
+
+    if ((i > 0) && (targets[i - 1] == dev)) {
+        /* Overlapping windows of the same device */
+        for (; i < *count; i++) {
+            targets[i] = targets[i + 1];
+        }
+
+        return;
+    }
+
+    targets[i] = dev;
+    (*count)++;
+}
+
+/** Build the dispatch map from the declared windows
+ *
+ * The window boundaries split the address space into ranges,
+ * each range is dispatched to the windows covering it (and to
+ * the devices without windows) in the device list order.
+ *
+ */
+static void devmem_map_build(void)
+{
+    safe_free(devmem_unmapped);
+    safe_free(devmem_ranges);
+    safe_free(devmem_targets);
+
+    /* Devices without windows */
+    size_t devices = 0;
+    device_t *dev = NULL;
+    while (dev_next(&dev, DEVICE_FILTER_ALL)) {
+        devices++;
+    }
+
+    devmem_unmapped = (device_t **) safe_malloc((devices + 1) * sizeof(device_t *));
+    devmem_unmapped_count = 0;
+
+    dev = NULL;
+    while (dev_next(&dev, DEVICE_FILTER_ALL)) {
+        if ((devmem_has_callbacks(dev)) && (!devmem_has_window(dev))) {
+            devmem_unmapped[devmem_unmapped_count++] = dev;
+        }
+    }
+
+    /* Range boundaries */
+    size_t points_count = 2 * devmem_windows_count;
+    ptr36_t *points = (ptr36_t *) safe_malloc((points_count + 1) * sizeof(ptr36_t));
+
+    for (size_t i = 0; i < devmem_windows_count; i++) {
+        points[2 * i] = devmem_windows[i].start;
+        points[2 * i + 1] = devmem_windows[i].end;
+    }
+
+    qsort(points, points_count, sizeof(ptr36_t), devmem_ptr36_compare);
+
+    /* Ranges */
+    size_t targets_size = (points_count + 1) * (devmem_windows_count + devmem_unmapped_count + 1);
+    devmem_ranges = (devmem_range_t *) safe_malloc((points_count + 1) * sizeof(devmem_range_t));
+    devmem_targets = (device_t **) safe_malloc(targets_size * sizeof(device_t *));
+    devmem_ranges_count = 0;
+
+    size_t targets_count = 0;
+    for (size_t i = 0; i + 1 < points_count; i++) {
+        ptr36_t start = points[i];
+        ptr36_t end = points[i + 1];
+
+        if (start == end) {
             continue;
         }
 
-        if (breakpoint->addr > addr + breakpoint->size) {
+        device_t **targets = devmem_targets + targets_count;
+        size_t count = 0;
+
+        for (size_t j = 0; j < devmem_windows_count; j++) {
+            if ((devmem_windows[j].start <= start) && (devmem_windows[j].end >= end)) {
+                devmem_insert_target(targets, &count, devmem_windows[j].dev);
+            }
+        }
+
+        if (count == 0) {
             continue;
         }
 
-        if ((access_type & breakpoint->access_flags) != 0) {
-            physmem_breakpoint_hit(breakpoint, access_type);
-            break;
+        for (size_t j = 0; j < devmem_unmapped_count; j++) {
+            devmem_insert_target(targets, &count, devmem_unmapped[j]);
+        }
+
+        devmem_ranges[devmem_ranges_count++] = (devmem_range_t) {
+            .start = start,
+            .end = end,
+            .first = targets_count,
+            .count = count
+        };
+
+        targets_count += count;
+    }
+
+    safe_free(points);
+    devmem_map_valid = true;
+}
+
+/** Find the devices to dispatch a device memory access to
+ *
+ * @param addr  Accessed address.
+ * @param count Number of the devices (returned).
+ *
+ * @return Array of the devices in the device list order.
+ *
+ */
+static device_t *const *devmem_find(ptr36_t addr, size_t *count)
+{
+    if (!devmem_map_valid) {
+        devmem_map_build();
+    }
+
+    size_t low = 0;
+    size_t high = devmem_ranges_count;
+
+    while (low < high) {
+        size_t middle = low + (high - low) / 2;
+        devmem_range_t *range = &devmem_ranges[middle];
+
+        if (addr < range->start) {
+            high = middle;
+        } else if (addr >= range->end) {
+            low = middle + 1;
+        } else {
+            *count = range->count;
+            return devmem_targets + range->first;
         }
     }
+
+    *count = devmem_unmapped_count;
+    return devmem_unmapped;
+}
+
+/** Device access hook */
+static physmem_device_hook_t device_hook = NULL;
+static void *device_hook_data = NULL;
+
+/** Set the function called before each device register access
+ *
+ * Allows a processor executing multiple cycles at once to bring
+ * the devices up to date before they are accessed.
+ *
+ * @param hook Function to call (NULL to remove the hook).
+ * @param data Argument of the function.
+ *
+ */
+void physmem_set_device_hook(physmem_device_hook_t hook, void *data)
+{
+    device_hook = hook;
+    device_hook_data = data;
+}
+
+/** Prepare the devices for a register access
+ *
+ * The processor hook is called and the machine cycle counter is brought
+ * up to date if the access happens in the middle of a run.
+ *
+ */
+static void devmem_access(void)
+{
+    if (device_hook != NULL) {
+        device_hook(device_hook_data);
+    }
+
+    dev_run_sync();
 }
 
 static uint8_t devmem_read8(unsigned int procno, ptr36_t addr)
 {
+    devmem_access();
+
     uint32_t val = (uint32_t) DEFAULT_MEMORY_VALUE;
 
-    /* List for each device */
-    device_t *dev = NULL;
-    while (dev_next(&dev, DEVICE_FILTER_ALL)) {
+    /* Device registers are shared by all processors */
+    smp_lock();
+
+    /* Devices owning the address */
+    size_t count;
+    device_t *const *devices = devmem_find(addr, &count);
+
+    for (size_t i = 0; i < count; i++) {
+        device_t *dev = devices[i];
+
         if (dev->type->read8) {
             dev->type->read8(procno, dev, addr, (uint8_t *) &val);
         } else if (dev->type->read32) {
@@ -181,16 +725,27 @@ static uint8_t devmem_read8(unsigned int procno, ptr36_t addr)
         }
     }
 
+    smp_unlock();
+
     return val;
 }
 
 static uint16_t devmem_read16(unsigned int procno, ptr36_t addr)
 {
+    devmem_access();
+
     uint32_t val = (uint32_t) DEFAULT_MEMORY_VALUE;
 
-    /* List for each device */
-    device_t *dev = NULL;
-    while (dev_next(&dev, DEVICE_FILTER_ALL)) {
+    /* Device registers are shared by all processors */
+    smp_lock();
+
+    /* Devices owning the address */
+    size_t count;
+    device_t *const *devices = devmem_find(addr, &count);
+
+    for (size_t i = 0; i < count; i++) {
+        device_t *dev = devices[i];
+
         if (dev->type->read16) {
             dev->type->read16(procno, dev, addr, (uint16_t *) &val);
         } else if (dev->type->read32) {
@@ -198,36 +753,60 @@ static uint16_t devmem_read16(unsigned int procno, ptr36_t addr)
         }
     }
 
+    smp_unlock();
+
     return val;
 }
 
 static uint32_t devmem_read32(unsigned int procno, ptr36_t addr)
 {
+    devmem_access();
+
     uint32_t val = (uint32_t) DEFAULT_MEMORY_VALUE;
 
-    /* List for each device */
-    device_t *dev = NULL;
-    while (dev_next(&dev, DEVICE_FILTER_ALL)) {
+    /* Device registers are shared by all processors */
+    smp_lock();
+
+    /* Devices owning the address */
+    size_t count;
+    device_t *const *devices = devmem_find(addr, &count);
+
+    for (size_t i = 0; i < count; i++) {
+        device_t *dev = devices[i];
+
         if (dev->type->read32) {
             dev->type->read32(procno, dev, addr, &val);
         }
     }
 
+    smp_unlock();
+
     return val;
 }
 
 static uint64_t devmem_read64(unsigned int procno, ptr36_t addr)
 {
+    devmem_access();
+
     uint64_t val = (uint64_t) DEFAULT_MEMORY_VALUE;
 
-    /* List for each device */
-    device_t *dev = NULL;
-    while (dev_next(&dev, DEVICE_FILTER_ALL)) {
+    /* Device registers are shared by all processors */
+    smp_lock();
+
+    /* Devices owning the address */
+    size_t count;
+    device_t *const *devices = devmem_find(addr, &count);
+
+    for (size_t i = 0; i < count; i++) {
+        device_t *dev = devices[i];
+
         if (dev->type->read64) {
             dev->type->read64(procno, dev, addr, &val);
         }
     }
 
+    smp_unlock();
+
     return val;
 }
 
@@ -260,7 +839,7 @@ uint8_t physmem_read8(unsigned int procno, ptr36_t addr, bool protected)
 
     /* Check for memory read breakpoints */
     if (protected) {
-        physmem_breakpoint_find(addr, 1, ACCESS_READ);
+        physmem_breakpoint_find(frame, addr, 1, ACCESS_READ);
     }
 
     ASSERT(frame->data);
@@ -298,7 +877,7 @@ uint16_t physmem_read16(unsigned int procno, ptr36_t addr, bool protected)
 
     /* Check for memory read breakpoints */
     if (protected) {
-        physmem_breakpoint_find(addr, 2, ACCESS_READ);
+        physmem_breakpoint_find(frame, addr, 2, ACCESS_READ);
     }
 
     ASSERT(frame->data);
@@ -337,7 +916,7 @@ uint32_t physmem_read32(unsigned int procno, ptr36_t addr, bool protected)
 
     /* Check for memory read breakpoints */
     if (protected) {
-        physmem_breakpoint_find(addr, 4, ACCESS_READ);
+        physmem_breakpoint_find(frame, addr, 4, ACCESS_READ);
     }
 
     ASSERT(frame->data);
@@ -376,7 +955,7 @@ uint64_t physmem_read64(unsigned int procno, ptr36_t addr, bool protected)
 
     /* Check for memory read breakpoints */
     if (protected) {
-        physmem_breakpoint_find(addr, 8, ACCESS_READ);
+        physmem_breakpoint_find(frame, addr, 8, ACCESS_READ);
     }
 
     ASSERT(frame->data);
@@ -385,13 +964,68 @@ uint64_t physmem_read64(unsigned int procno, ptr36_t addr, bool protected)
     return convert_uint64_t_endian(*data);
 }
 
+/** Read consecutive 16-bit words of a frame
+ *
+ * The words are copied at once without the memory breakpoints check,
+ * as when reading the words one by one with physmem_read16().
+ *
+ * @param frame Frame containing the words.
+ * @param addr  Physical address of the first word.
+ * @param words Buffer for the words.
+ * @param count Number of words to read (not crossing the frame).
+ *
+ */
+void physmem_frame_read16(frame_t *frame, ptr36_t addr, uint16_t *words, size_t count)
+{
+    ASSERT(frame->data);
+    ASSERT((addr & FRAME_MASK) + count * sizeof(uint16_t) <= FRAME_SIZE);
+
+    const uint16_t *data = (const uint16_t *) (frame->data + (addr & FRAME_MASK));
+
+    for (size_t i = 0; i < count; i++) {
+        words[i] = convert_uint16_t_endian(data[i]);
+    }
+}
+
+/** Read consecutive 32-bit words of a frame
+ *
+ * The words are copied at once without the memory breakpoints check,
+ * as when reading the words one by one with physmem_read32().
+ *
+ * @param frame Frame containing the words.
+ * @param addr  Physical address of the first word.
+ * @param words Buffer for the words.
+ * @param count Number of words to read (not crossing the frame).
+ *
+ */
+void physmem_frame_read32(frame_t *frame, ptr36_t addr, uint32_t *words, size_t count)
+{
+    ASSERT(frame->data);
+    ASSERT((addr & FRAME_MASK) + count * sizeof(uint32_t) <= FRAME_SIZE);
+
+    const uint32_t *data = (const uint32_t *) (frame->data + (addr & FRAME_MASK));
+
+    for (size_t i = 0; i < count; i++) {
+        words[i] = convert_uint32_t_endian(data[i]);
+    }
+}
+
 static bool devmem_write8(unsigned int procno, ptr36_t addr, uint8_t val)
 {
+    devmem_access();
+
     bool written = false;
 
-    /* List for each device */
-    device_t *dev = NULL;
-    while (dev_next(&dev, DEVICE_FILTER_ALL)) {
+    /* Device registers are shared by all processors */
+    smp_lock();
+
+    /* Devices owning the address */
+    size_t count;
+    device_t *const *devices = devmem_find(addr, &count);
+
+    for (size_t i = 0; i < count; i++) {
+        device_t *dev = devices[i];
+
         if (dev->type->write8) {
             dev->type->write8(procno, dev, addr, val);
             written = true;
@@ -402,16 +1036,27 @@ static bool devmem_write8(unsigned int procno, ptr36_t addr, uint8_t val)
         }
     }
 
+    smp_unlock();
+
     return written;
 }
 
 static bool devmem_write16(unsigned int procno, ptr36_t addr, uint16_t val)
 {
+    devmem_access();
+
     bool written = false;
 
-    /* List for each device */
-    device_t *dev = NULL;
-    while (dev_next(&dev, DEVICE_FILTER_ALL)) {
+    /* Device registers are shared by all processors */
+    smp_lock();
+
+    /* Devices owning the address */
+    size_t count;
+    device_t *const *devices = devmem_find(addr, &count);
+
+    for (size_t i = 0; i < count; i++) {
+        device_t *dev = devices[i];
+
         if (dev->type->write16) {
             dev->type->write16(procno, dev, addr, val);
             written = true;
@@ -423,86 +1068,154 @@ static bool devmem_write16(unsigned int procno, ptr36_t addr, uint16_t val)
         }
     }
 
+    smp_unlock();
+
     return written;
 }
 
 static bool devmem_write32(unsigned int procno, ptr36_t addr, uint32_t val)
 {
+    devmem_access();
+
     bool written = false;
 
-    /* List for each device */
-    device_t *dev = NULL;
-    while (dev_next(&dev, DEVICE_FILTER_ALL)) {
+    /* Device registers are shared by all processors */
+    smp_lock();
+
+    /* Devices owning the address */
+    size_t count;
+    device_t *const *devices = devmem_find(addr, &count);
+
+    for (size_t i = 0; i < count; i++) {
+        device_t *dev = devices[i];
+
         if (dev->type->write32) {
             dev->type->write32(procno, dev, addr, val);
             written = true;
         }
     }
 
+    smp_unlock();
+
     return written;
 }
 
 static bool devmem_write64(unsigned int procno, ptr36_t addr, uint64_t val)
 {
+    devmem_access();
+
     bool written = false;
 
-    /* List for each device */
-    device_t *dev = NULL;
-    while (dev_next(&dev, DEVICE_FILTER_ALL)) {
+    /* Device registers are shared by all processors */
+    smp_lock();
+
+    /* Devices owning the address */
+    size_t count;
+    device_t *const *devices = devmem_find(addr, &count);
+
+    for (size_t i = 0; i < count; i++) {
+        device_t *dev = devices[i];
+
         if (dev->type->write64) {
             dev->type->write64(procno, dev, addr, val);
             written = true;
         }
     }
 
+    smp_unlock();
+
     return written;
 }
 
 /** SC-LL tracking
+ *
+ * The reservations are indexed by the processor number and
+ * the frames count the reservations they contain, so that
+ * writes to frames without a reservation skip the tracking.
  *
  */
 
 typedef struct {
-    item_t item;
-    unsigned int procno;
-} sc_item_t;
+    bool active;
+    ptr36_t addr;
+
+    /* Frame containing the address (NULL if not in memory) */
+    frame_t *frame;
+} sc_reservation_t;
+
+static sc_reservation_t sc_reservations[MAX_CPUS];
 
-static list_t sc_list = LIST_INITIALIZER;
+/** Number of exclusive sections */
+static atomic_uint sc_exclusive = 0;
 
-/** Register current processor in LL-SC tracking list
+/** Number of writes in progress outside of the SMP lock */
+static atomic_uint sc_writers = 0;
+
+static void sc_release(sc_reservation_t *reservation)
+{
+    if (reservation->frame != NULL) {
+        atomic_fetch_sub(&reservation->frame->reservations, 1);
+    }
+
+    reservation->active = false;
+    reservation->frame = NULL;
+}
+
+/** Register current processor in LL-SC tracking
+ *
+ * Replaces the previous reservation of the processor.
+ *
+ * @param procno Processor number.
+ * @param addr   Physical address of the reservation.
  *
  */
-void sc_register(unsigned int procno)
+void sc_register(unsigned int procno, ptr36_t addr)
 {
-    /* Ignore if already registered. */
-    sc_item_t *sc_item;
+    ASSERT(procno < MAX_CPUS);
 
-    for_each(sc_list, sc_item, sc_item_t)
-    {
-        if (sc_item->procno == procno) {
-            return;
-        }
+    physmem_exclusive_begin();
+
+    sc_reservation_t *reservation = &sc_reservations[procno];
+
+    if (reservation->active) {
+        sc_release(reservation);
     }
 
-    sc_item = safe_malloc_t(sc_item_t);
-    item_init(&sc_item->item);
-    sc_item->procno = procno;
-    list_append(&sc_list, &sc_item->item);
+    reservation->active = true;
+    reservation->addr = addr;
+    reservation->frame = physmem_find_frame(addr);
+
+    if (reservation->frame != NULL) {
+        atomic_fetch_add(&reservation->frame->reservations, 1);
+    }
+
+    physmem_exclusive_end();
 }
 
-/** Remove current processor from the LL-SC tracking list
+/** Remove current processor from the LL-SC tracking
  *
  */
 void sc_unregister(unsigned int procno)
 {
-    sc_item_t *sc_item;
+    ASSERT(procno < MAX_CPUS);
 
-    for_each(sc_list, sc_item, sc_item_t)
-    {
-        if (sc_item->procno == procno) {
-            list_remove(&sc_list, &sc_item->item);
-            safe_free(sc_item);
-            break;
+    smp_lock();
+
+    if (sc_reservations[procno].active) {
+        sc_release(&sc_reservations[procno]);
+    }
+
+    smp_unlock();
+}
+
+/** Drop the reservations in a frame being removed
+ *
+ */
+static void sc_forget_frame(frame_t *frame)
+{
+    for (unsigned int procno = 0; procno < MAX_CPUS; procno++) {
+        if (sc_reservations[procno].frame == frame) {
+            sc_reservations[procno].frame = NULL;
         }
     }
 }
@@ -510,24 +1223,102 @@ void sc_unregister(unsigned int procno)
 /** Load Linked and Store Conditional control
  *
  */
-static void sc_control(ptr36_t addr, int size)
+static void sc_control(frame_t *frame, ptr36_t addr, int size)
 {
-    sc_item_t *sc_item = (sc_item_t *) sc_list.head;
+    if (atomic_load_explicit(&frame->reservations, memory_order_relaxed) == 0) {
+        return;
+    }
 
-    while (sc_item != NULL) {
+    for (unsigned int procno = 0; procno < MAX_CPUS; procno++) {
+        sc_reservation_t *reservation = &sc_reservations[procno];
 
-        if (cpu_sc_access(get_cpu(sc_item->procno), addr, size)) {
-            sc_item_t *tmp = sc_item;
-            sc_item = (sc_item_t *) sc_item->item.next;
+        if ((!reservation->active) || (reservation->frame != frame)) {
+            continue;
+        }
 
-            list_remove(&sc_list, &tmp->item);
-            safe_free(tmp);
-        } else {
-            sc_item = (sc_item_t *) sc_item->item.next;
+        if (cpu_sc_access(get_cpu(procno), addr, size)) {
+            sc_release(reservation);
         }
     }
 }
 
+/** Start a memory write
+ *
+ * While the processors run in parallel, writes proceed without
+ * locking unless the frame contains an LL-SC reservation or there
+ * is an exclusive section, which has to observe the write.
+ *
+ * @return True if the write has to be finished by physmem_write_end()
+ *         with the SMP lock held.
+ *
+ */
+static bool physmem_write_begin(frame_t *frame, ptr36_t addr, int size)
+{
+    if (smp_active) {
+        atomic_fetch_add(&sc_writers, 1);
+
+        if ((atomic_load(&sc_exclusive) == 0)
+                && (atomic_load(&frame->reservations) == 0)) {
+            return false;
+        }
+
+        atomic_fetch_sub(&sc_writers, 1);
+    }
+
+    smp_lock();
+    sc_control(frame, addr, size);
+
+    return true;
+}
+
+/** Finish a memory write
+ *
+ */
+static void physmem_write_end(bool locked)
+{
+    if (locked) {
+        smp_unlock();
+    } else {
+        atomic_fetch_sub(&sc_writers, 1);
+    }
+}
+
+/** Start an exclusive memory access
+ *
+ * The read-modify-write sequence of an atomic instruction (or
+ * the LL-SC bookkeeping) is not interleaved with writes of other
+ * processors running in parallel. Does nothing when the processors
+ * are stepped sequentially.
+ *
+ */
+void physmem_exclusive_begin(void)
+{
+    if (!smp_active) {
+        return;
+    }
+
+    smp_lock();
+    atomic_fetch_add(&sc_exclusive, 1);
+
+    /* Wait for the writes which did not notice the section */
+    while (atomic_load(&sc_writers) > 0) {
+        sched_yield();
+    }
+}
+
+/** Finish an exclusive memory access
+ *
+ */
+void physmem_exclusive_end(void)
+{
+    if (!smp_active) {
+        return;
+    }
+
+    atomic_fetch_sub(&sc_exclusive, 1);
+    smp_unlock();
+}
+
 /** Physical memory write (8 bits)
  *
  * Write 8 bits of data to memory at given address. At first try to find
@@ -562,19 +1353,21 @@ bool physmem_write8(unsigned int procno, ptr36_t addr, uint8_t val, bool protect
         return false;
     }
 
-    sc_control(addr, 1);
+    bool locked = physmem_write_begin(frame, addr, 1);
 
     /* Check for memory write breakpoints */
     if (protected) {
-        physmem_breakpoint_find(addr, 1, ACCESS_WRITE);
+        physmem_breakpoint_find(frame, addr, 1, ACCESS_WRITE);
     }
 
-    /* Invalidate binary translation */
-    frame->valid = false;
-
     uint8_t *data = frame->data + (addr & FRAME_MASK);
     *data = convert_uint8_t_endian(val);
 
+    /* Invalidate binary translation */
+    physmem_written(frame, addr, 1);
+
+    physmem_write_end(locked);
+
     return true;
 }
 
@@ -612,19 +1405,21 @@ bool physmem_write16(unsigned int procno, ptr36_t addr, uint16_t val, bool prote
         return false;
     }
 
-    sc_control(addr, 2);
+    bool locked = physmem_write_begin(frame, addr, 2);
 
     /* Check for memory write breakpoints */
     if (protected) {
-        physmem_breakpoint_find(addr, 2, ACCESS_WRITE);
+        physmem_breakpoint_find(frame, addr, 2, ACCESS_WRITE);
     }
 
-    /* Invalidate binary translation */
-    frame->valid = false;
-
     uint16_t *data = (uint16_t *) (frame->data + (addr & FRAME_MASK));
     *data = convert_uint16_t_endian(val);
 
+    /* Invalidate binary translation */
+    physmem_written(frame, addr, 2);
+
+    physmem_write_end(locked);
+
     return true;
 }
 
@@ -662,19 +1457,21 @@ bool physmem_write32(unsigned int procno, ptr36_t addr, uint32_t val, bool prote
         return false;
     }
 
-    sc_control(addr, 4);
+    bool locked = physmem_write_begin(frame, addr, 4);
 
     /* Check for memory write breakpoints */
     if (protected) {
-        physmem_breakpoint_find(addr, 4, ACCESS_WRITE);
+        physmem_breakpoint_find(frame, addr, 4, ACCESS_WRITE);
     }
 
-    /* Invalidate binary translation */
-    frame->valid = false;
-
     uint32_t *data = (uint32_t *) (frame->data + (addr & FRAME_MASK));
     *data = convert_uint32_t_endian(val);
 
+    /* Invalidate binary translation */
+    physmem_written(frame, addr, 4);
+
+    physmem_write_end(locked);
+
     return true;
 }
 
@@ -712,18 +1509,20 @@ bool physmem_write64(unsigned int procno, ptr36_t addr, uint64_t val, bool prote
         return false;
     }
 
-    sc_control(addr, 8);
+    bool locked = physmem_write_begin(frame, addr, 8);
 
     /* Check for memory write breakpoints */
     if (protected) {
-        physmem_breakpoint_find(addr, 8, ACCESS_WRITE);
+        physmem_breakpoint_find(frame, addr, 8, ACCESS_WRITE);
     }
 
-    /* Invalidate binary translation */
-    frame->valid = false;
-
     uint64_t *data = (uint64_t *) (frame->data + (addr & FRAME_MASK));
     *data = convert_uint64_t_endian(val);
 
+    /* Invalidate binary translation */
+    physmem_written(frame, addr, 8);
+
+    physmem_write_end(locked);
+
     return true;
 }
@@ -15,12 +15,15 @@
 #define PHYSMEM_H_
 
 #include <inttypes.h>
+#include <stdatomic.h>
 #include <stdbool.h>
 #include <stdint.h>
 #include <unistd.h>
 
+#include "endian.h"
 #include "list.h"
 #include "main.h"
+#include "smp.h"
 #include "utils.h"
 
 #define FRAME_WIDTH 12
@@ -39,6 +42,14 @@
 #define ADDR2FRAME(addr) \
     ((addr) >> FRAME_WIDTH)
 
+/** Lines of a frame with independent decoded instruction validity */
+#define FRAME_LINE_WIDTH 6
+#define FRAME_LINE_SIZE (1 << FRAME_LINE_WIDTH)
+#define FRAME_LINES (FRAME_SIZE / FRAME_LINE_SIZE)
+
+#define FRAME_LINE(addr) \
+    (((addr) & FRAME_MASK) >> FRAME_LINE_WIDTH)
+
 #define DEFAULT_MEMORY_VALUE UINT64_C(0xffffffffffffffff)
 
 typedef enum {
@@ -62,6 +73,20 @@ typedef struct {
     uint8_t *data;
 } physmem_area_t;
 
+struct device;
+struct physmem_breakpoint;
+
+/** Memory breakpoint interval within a frame */
+typedef struct {
+    ptr36_t start;
+    ptr36_t end;
+
+    /* Maximal end of this and all preceding intervals */
+    ptr36_t max_end;
+
+    struct physmem_breakpoint *breakpoint;
+} frame_breakpoint_t;
+
 typedef struct frame {
     /* Physical memory area containing the frame */
     physmem_area_t *area;
@@ -69,21 +94,126 @@ typedef struct frame {
     /* Frame data (with displacement) */
     uint8_t *data;
 
-    /* Binary translation valid flag */
-    bool valid;
+    /*
+     * Write generation of each line (advanced by every write,
+     * decoded instructions record the generation they were
+     * decoded from)
+     */
+    atomic_uint generations[FRAME_LINES];
+
+    /* Memory breakpoints overlapping the frame (sorted by start) */
+    frame_breakpoint_t *breakpoints;
+    size_t breakpoints_count;
+
+    /* Number of LL-SC reservations in the frame */
+    atomic_uint reservations;
 } frame_t;
 
 /** Physical memory management */
 extern void physmem_wire(physmem_area_t *area);
 extern void physmem_unwire(physmem_area_t *area);
+extern void physmem_invalidate_area(physmem_area_t *area);
 
 extern frame_t *physmem_find_frame(ptr36_t addr);
+extern void physmem_update_breakpoints(void);
+
+/** Advance the write generation of the lines overlapping a write
+ *
+ * To be called after the data is written, so that a concurrent decoder
+ * reading the previous generation decodes the line again.
+ *
+ * @param frame Written frame.
+ * @param addr  Physical address of the write.
+ * @param size  Size of the write (not crossing the frame).
+ *
+ */
+static inline void physmem_written(frame_t *frame, ptr36_t addr, len36_t size)
+{
+    size_t first = FRAME_LINE(addr);
+    size_t last = FRAME_LINE(addr + size - 1);
+
+    if (last < first) {
+        last = first;
+    }
+
+    for (size_t line = first; line <= last; line++) {
+        if (smp_active) {
+            atomic_fetch_add_explicit(&frame->generations[line], 1, memory_order_release);
+        } else {
+            unsigned int generation = atomic_load_explicit(&frame->generations[line], memory_order_relaxed);
+            atomic_store_explicit(&frame->generations[line], generation + 1, memory_order_relaxed);
+        }
+    }
+}
+
+/** Get the write generation of the line containing the address
+ *
+ * The instructions of the line have to be decoded after reading
+ * the generation not to miss a concurrent write.
+ *
+ */
+static inline unsigned int physmem_line_generation(frame_t *frame, ptr36_t addr)
+{
+    return atomic_load_explicit(&frame->generations[FRAME_LINE(addr)], memory_order_acquire);
+}
+
+/** Physical memory soft-TLB
+ *
+ * Direct-mapped per-processor cache of the physical frames backed
+ * by host memory. A hit turns a memory access into a tag compare
+ * and a host memory access.
+ *
+ */
+
+#define PHYSMEM_TLB_WIDTH 8
+#define PHYSMEM_TLB_COUNT (1 << PHYSMEM_TLB_WIDTH)
+#define PHYSMEM_TLB_MASK (PHYSMEM_TLB_COUNT - 1)
+
+/** Entry tag (the lowest bit marks a valid entry) */
+#define PHYSMEM_TLB_TAG(addr) \
+    (((addr) & ~((ptr36_t) FRAME_MASK)) | 1)
+
+/** Frame is writable by the processors */
+#define PHYSMEM_TLB_WRITABLE (1 << 0)
+
+/** Frame is covered by a memory breakpoint */
+#define PHYSMEM_TLB_WATCHED (1 << 1)
+
+typedef struct {
+    ptr36_t tag;
+    unsigned int flags;
+    frame_t *frame;
+    uint8_t *data;
+} physmem_tlb_entry_t;
+
+typedef struct {
+    /** Value of physmem_tlb_epoch the entries are valid for */
+    unsigned int epoch;
+    physmem_tlb_entry_t entries[PHYSMEM_TLB_COUNT];
+} physmem_tlb_t;
+
+/** Incremented whenever the cached frames change */
+extern unsigned int physmem_tlb_epoch;
+
+extern physmem_tlb_entry_t *physmem_tlb_fill(physmem_tlb_t *tlb, ptr36_t addr);
+extern void physmem_tlb_flush_all(void);
+
+/** Device register windows */
+extern void physmem_map_device(struct device *dev, ptr36_t addr, len36_t size);
+extern void physmem_unmap_device(struct device *dev);
+extern void physmem_update_device_map(void);
+
+/** Function called before each device register access */
+typedef void (*physmem_device_hook_t)(void *data);
+extern void physmem_set_device_hook(physmem_device_hook_t hook, void *data);
 
 /** Physical memory access */
 extern uint8_t physmem_read8(unsigned int cpu, ptr36_t addr, bool protected);
 extern uint16_t physmem_read16(unsigned int cpu, ptr36_t addr, bool protected);
 extern uint32_t physmem_read32(unsigned int cpu, ptr36_t addr, bool protected);
 extern uint64_t physmem_read64(unsigned int cpu, ptr36_t addr, bool protected);
+extern void physmem_frame_read16(frame_t *frame, ptr36_t addr, uint16_t *words, size_t count);
+extern void physmem_frame_read32(frame_t *frame, ptr36_t addr, uint32_t *words, size_t count);
 
 extern bool physmem_write8(unsigned int cpu, ptr36_t addr, uint8_t val,
         bool protected);
@@ -95,7 +225,81 @@ extern bool physmem_write64(unsigned int cpu, ptr36_t addr, uint64_t val,
         bool protected);
 
 /** Store-conditional control */
-extern void sc_register(unsigned int procno);
+extern void sc_register(unsigned int procno, ptr36_t addr);
 extern void sc_unregister(unsigned int procno);
 
+extern void physmem_exclusive_begin(void);
+extern void physmem_exclusive_end(void);
+
+/** Find a physical frame in the soft-TLB
+ *
+ * @return The entry or NULL if the address is not backed by memory.
+ *
+ */
+static inline physmem_tlb_entry_t *physmem_tlb_find(physmem_tlb_t *tlb, ptr36_t addr)
+{
+    physmem_tlb_entry_t *entry = &tlb->entries[ADDR2FRAME(addr) & PHYSMEM_TLB_MASK];
+
+    if ((entry->tag == PHYSMEM_TLB_TAG(addr)) && (tlb->epoch == physmem_tlb_epoch)) {
+        return entry;
+    }
+
+    return physmem_tlb_fill(tlb, addr);
+}
+
+/** Check whether a write can bypass physmem_write*()
+ *
+ * The writes to frames with an LL-SC reservation have to be observed
+ * by the tracking and the writes of processors running in parallel
+ * have to be synchronized with the exclusive sections.
+ *
+ */
+static inline bool physmem_tlb_writable(const physmem_tlb_entry_t *entry)
+{
+    return (entry != NULL)
+            && ((entry->flags & (PHYSMEM_TLB_WRITABLE | PHYSMEM_TLB_WATCHED)) == PHYSMEM_TLB_WRITABLE)
+            && (!smp_active)
+            && (atomic_load_explicit(&entry->frame->reservations, memory_order_relaxed) == 0);
+}
+
+/** Processor memory access through the soft-TLB
+ *
+ * Equivalent to the protected physmem_read*() and physmem_write*().
+ * The address has to be naturally aligned.
+ *
+ */
+#define PHYSMEM_TLB_ACCESS(width) \
+    static inline uint##width##_t physmem_tlb_read##width(physmem_tlb_t *tlb, \
+            unsigned int procno, ptr36_t addr) \
+    { \
+        physmem_tlb_entry_t *entry = physmem_tlb_find(tlb, addr); \
+        if ((entry != NULL) && ((entry->flags & PHYSMEM_TLB_WATCHED) == 0)) { \
+            uint##width##_t *data = (uint##width##_t *) (entry->data + (addr & FRAME_MASK)); \
+            return convert_uint##width##_t_endian(*data); \
+        } \
+\
+        return physmem_read##width(procno, addr, true); \
+    } \
+\
+    static inline bool physmem_tlb_write##width(physmem_tlb_t *tlb, \
+            unsigned int procno, ptr36_t addr, uint##width##_t val) \
+    { \
+        physmem_tlb_entry_t *entry = physmem_tlb_find(tlb, addr); \
+        if (physmem_tlb_writable(entry)) { \
+            uint##width##_t *data = (uint##width##_t *) (entry->data + (addr & FRAME_MASK)); \
+            *data = convert_uint##width##_t_endian(val); \
+\
+            /* Invalidate binary translation */ \
+            physmem_written(entry->frame, addr, sizeof(uint##width##_t)); \
+            return true; \
+        } \
+\
+        return physmem_write##width(procno, addr, val, true); \
+    }
+
+PHYSMEM_TLB_ACCESS(8)
+PHYSMEM_TLB_ACCESS(16)
+PHYSMEM_TLB_ACCESS(32)
+PHYSMEM_TLB_ACCESS(64)
+
 #endif /* PHYSMEM_H_ */
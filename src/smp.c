@@ -0,0 +1,371 @@
+/*
+ * Copyright (c) 2026 Matus Jurcak
+ * All rights reserved.
+ *
+ * Distributed under the terms of GPL.
+ *
+ *
+ *  Parallel SMP execution
+ *
+ */
+
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "assert.h"
+#include "debug/breakpoint.h"
+#include "device/cpu/decode_cache.h"
+#include "device/device.h"
+#include "fault.h"
+#include "main.h"
+#include "smp.h"
+#include "utils.h"
+
+/** Worker thread stepping a single processor */
+typedef struct {
+    pthread_t thread;
+
+    /** Index of the stepped device */
+    size_t index;
+
+    /** Quantum generation seen by the thread */
+    uint64_t generation;
+
+    /** Number of cycles executed in the last quantum */
+    unsigned int executed;
+} smp_worker_t;
+
+/** Interrupt request deferred to the end of the quantum */
+typedef struct {
+    general_cpu_t *cpu;
+    unsigned int no;
+    bool up;
+} smp_interrupt_t;
+
+bool smp_active = false;
+
+/** Lock protecting the shared machine state */
+static pthread_mutex_t smp_mutex;
+static bool smp_mutex_initialized = false;
+
+/** Worker pool */
+static pthread_mutex_t pool_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t pool_start = PTHREAD_COND_INITIALIZER;
+static pthread_cond_t pool_finish = PTHREAD_COND_INITIALIZER;
+
+static smp_worker_t *workers = NULL;
+static size_t workers_count = 0;
+static bool workers_exit = false;
+
+/** Current quantum (protected by pool_mutex) */
+static uint64_t quantum_generation = 0;
+static device_t *const *quantum_devices = NULL;
+static unsigned int quantum_cycles = 0;
+static size_t quantum_pending = 0;
+
+/** Deferred interrupt requests (protected by smp_mutex) */
+static smp_interrupt_t *interrupts = NULL;
+static size_t interrupts_count = 0;
+static size_t interrupts_size = 0;
+
+/** Lock the shared machine state
+ *
+ * The lock is recursive and it is taken only while the processors
+ * are executed in parallel.
+ *
+ */
+void smp_lock(void)
+{
+    if (smp_active) {
+        pthread_mutex_lock(&smp_mutex);
+    }
+}
+
+/** Unlock the shared machine state
+ *
+ */
+void smp_unlock(void)
+{
+    if (smp_active) {
+        pthread_mutex_unlock(&smp_mutex);
+    }
+}
+
+/** Defer an interrupt request to the end of the quantum
+ *
+ * The processors cannot change the interrupt state of each other
+ * while running in parallel.
+ *
+ * @param cpu Target processor.
+ * @param no  Interrupt number.
+ * @param up  True to assert the interrupt, false to deassert it.
+ *
+ * @return True if the request has been deferred.
+ *
+ */
+bool smp_defer_interrupt(general_cpu_t *cpu, unsigned int no, bool up)
+{
+    if (!smp_active) {
+        return false;
+    }
+
+    pthread_mutex_lock(&smp_mutex);
+
+    if (interrupts_count == interrupts_size) {
+        size_t size = (interrupts_size == 0) ? 16 : 2 * interrupts_size;
+        smp_interrupt_t *requests = (smp_interrupt_t *) safe_malloc(size * sizeof(smp_interrupt_t));
+
+        if (interrupts_count > 0) {
+            memcpy(requests, interrupts, interrupts_count * sizeof(smp_interrupt_t));
+        }
+
+        safe_free(interrupts);
+        interrupts = requests;
+        interrupts_size = size;
+    }
+
+    interrupts[interrupts_count++] = (smp_interrupt_t) {
+        .cpu = cpu,
+        .no = no,
+        .up = up
+    };
+
+    pthread_mutex_unlock(&smp_mutex);
+    return true;
+}
+
+/** Deliver the interrupt requests deferred during the quantum
+ *
+ */
+static void smp_deliver_interrupts(void)
+{
+    for (size_t i = 0; i < interrupts_count; i++) {
+        if (interrupts[i].up) {
+            cpu_interrupt_up(interrupts[i].cpu, interrupts[i].no);
+        } else {
+            cpu_interrupt_down(interrupts[i].cpu, interrupts[i].no);
+        }
+    }
+
+    interrupts_count = 0;
+}
+
+/** Step a processor device for the given number of cycles
+ *
+ * @return Number of cycles executed.
+ *
+ */
+static unsigned int smp_step_device(device_t *dev, unsigned int cycles)
+{
+    if (dev->type->run != NULL) {
+        return dev->type->run(dev, cycles);
+    }
+
+    unsigned int executed = 0;
+
+    while ((executed < cycles) && (!machine_halt) && (!machine_interactive)) {
+        dev->type->step(dev);
+        executed++;
+    }
+
+    return executed;
+}
+
+/** Worker thread body
+ *
+ */
+static void *smp_worker(void *arg)
+{
+    smp_worker_t *worker = (smp_worker_t *) arg;
+
+    pthread_mutex_lock(&pool_mutex);
+
+    while (true) {
+        while ((worker->generation == quantum_generation) && (!workers_exit)) {
+            pthread_cond_wait(&pool_start, &pool_mutex);
+        }
+
+        if (workers_exit) {
+            break;
+        }
+
+        worker->generation = quantum_generation;
+        device_t *dev = quantum_devices[worker->index];
+        unsigned int cycles = quantum_cycles;
+
+        pthread_mutex_unlock(&pool_mutex);
+        worker->executed = smp_step_device(dev, cycles);
+        pthread_mutex_lock(&pool_mutex);
+
+        quantum_pending--;
+        if (quantum_pending == 0) {
+            pthread_cond_signal(&pool_finish);
+        }
+    }
+
+    pthread_mutex_unlock(&pool_mutex);
+    return NULL;
+}
+
+/** Stop and join all worker threads
+ *
+ */
+static void smp_stop_workers(void)
+{
+    pthread_mutex_lock(&pool_mutex);
+    workers_exit = true;
+    pthread_cond_broadcast(&pool_start);
+    pthread_mutex_unlock(&pool_mutex);
+
+    for (size_t i = 0; i < workers_count; i++) {
+        pthread_join(workers[i].thread, NULL);
+    }
+
+    safe_free(workers);
+    workers_count = 0;
+    workers_exit = false;
+}
+
+/** Make sure there is the given number of worker threads
+ *
+ */
+static void smp_start_workers(size_t count)
+{
+    if (workers_count == count) {
+        return;
+    }
+
+    smp_stop_workers();
+
+    if (!smp_mutex_initialized) {
+        pthread_mutexattr_t attr;
+        pthread_mutexattr_init(&attr);
+        pthread_mutexattr_settype(&attr, PTHREAD_MUTEX_RECURSIVE);
+        pthread_mutex_init(&smp_mutex, &attr);
+        pthread_mutexattr_destroy(&attr);
+
+        smp_mutex_initialized = true;
+    }
+
+    workers = (smp_worker_t *) safe_malloc(count * sizeof(smp_worker_t));
+    workers_count = count;
+
+    for (size_t i = 0; i < count; i++) {
+        workers[i].index = i + 1;
+        workers[i].generation = quantum_generation;
+        workers[i].executed = 0;
+
+        if (pthread_create(&workers[i].thread, NULL, smp_worker, &workers[i]) != 0) {
+            die(ERR_INTERN, "Unable to create processor thread");
+        }
+    }
+}
+
+/** Check whether a device can be stepped by its own thread
+ *
+ * Only the MIPS and RISC-V processors are supported. Any other device
+ * requiring per-cycle stepping prevents the parallel execution.
+ *
+ */
+static bool smp_device_supported(const device_t *dev)
+{
+    return (is_dev_cpu(dev)) && (strcmp(dev->type->name, "dsh2ecpu") != 0);
+}
+
+/** Check whether the debugging state prevents the parallel execution
+ *
+ * Memory breakpoints are checked by the memory accesses themselves
+ * and a hit is reported to the debugger immediately, which must not
+ * happen on a worker thread in the middle of an unlocked write.
+ *
+ */
+static bool smp_debugging(void)
+{
+    return (!is_empty(&physmem_breakpoints)) || (remote_gdb_conn)
+            || (dap_state == DAP_CONNECTED) || (dap_state == DAP_RUNNING);
+}
+
+/** Run a quantum of machine cycles in parallel
+ *
+ * Each processor is stepped by its own host thread (the first one
+ * by the calling thread) independently of the others. The threads
+ * synchronize at the end of the quantum, where the machine cycle
+ * counter is advanced, the deferred interrupt requests and the
+ * device events are delivered.
+ *
+ * @param cycles Number of machine cycles to run.
+ *
+ * @return False if the machine cannot be run in parallel
+ *         (nothing has been executed in such a case).
+ *
+ */
+bool smp_run_quantum(unsigned int cycles)
+{
+    if ((!machine_parallel) || (machine_trace) || (smp_debugging())) {
+        return false;
+    }
+
+    size_t count;
+    device_t *const *devices = dev_step_list(&count);
+
+    if (count < 2) {
+        return false;
+    }
+
+    for (size_t i = 0; i < count; i++) {
+        if (!smp_device_supported(devices[i])) {
+            return false;
+        }
+    }
+
+    smp_start_workers(count - 1);
+
+    /* Start the quantum */
+    pthread_mutex_lock(&pool_mutex);
+
+    smp_active = true;
+    quantum_devices = devices;
+    quantum_cycles = cycles;
+    quantum_pending = workers_count;
+    quantum_generation++;
+
+    pthread_cond_broadcast(&pool_start);
+    pthread_mutex_unlock(&pool_mutex);
+
+    unsigned int executed = smp_step_device(devices[0], cycles);
+
+    /* Wait for the other processors */
+    pthread_mutex_lock(&pool_mutex);
+
+    while (quantum_pending > 0) {
+        pthread_cond_wait(&pool_finish, &pool_mutex);
+    }
+
+    smp_active = false;
+    pthread_mutex_unlock(&pool_mutex);
+
+    decode_cache_collect();
+
+    for (size_t i = 0; i < workers_count; i++) {
+        if (workers[i].executed > executed) {
+            executed = workers[i].executed;
+        }
+    }
+
+    smp_deliver_interrupts();
+    dev_skip_cycles(executed);
+
+    return true;
+}
+
+/** Terminate the worker threads
+ *
+ */
+void smp_done(void)
+{
+    smp_stop_workers();
+    safe_free(interrupts);
+    interrupts_size = 0;
+}
@@ -0,0 +1,30 @@
+/*
+ * Copyright (c) 2026 Matus Jurcak
+ * All rights reserved.
+ *
+ * Distributed under the terms of GPL.
+ *
+ *
+ *  Parallel SMP execution
+ *
+ */
+
+#ifndef SMP_H_
+#define SMP_H_
+
+#include <stdbool.h>
+
+#include "device/cpu/general_cpu.h"
+
+/** Processors are being executed by multiple host threads */
+extern bool smp_active;
+
+extern void smp_lock(void);
+extern void smp_unlock(void);
+
+extern bool smp_defer_interrupt(general_cpu_t *cpu, unsigned int no, bool up);
+
+extern bool smp_run_quantum(unsigned int cycles);
+extern void smp_done(void);
+
+#endif
@@ -84,6 +84,11 @@ const char txt_help[] = "  -V, --version               display version info\n"
                         "  -g, --remote-gdb=port       enter gdb mode\n"
                         "  -d, --dap[port]            enter DAP mode (default: 10505)\n"
                         "  -n, --non-deterministic     enable non-deterministic behaviour\n"
-                        "  -X, --no-extra-instructions disable MSIM-specific instructions\n";
+                        "  -X, --no-extra-instructions disable MSIM-specific instructions\n"
+                        "  -P, --parallel              run processors in parallel (needs -n)\n"
+                        "  -D, --decode-profile=file   pre-decode the pages listed in the file\n"
+                        "                              and save the executed pages to it at exit\n"
+                        "  -T, --virtual-time=kHz      derive the time from machine cycles\n"
+                        "                              at the given frequency\n";
 
 const char hexchar[] = "0123456789abcdef";
@@ -79,7 +79,7 @@ PCUT_TEST(csr_write_masks)
 
     cpu0.csr.satp = 0;
 
-    rv_exc_t ex = rv_csrrw_instr(&cpu0, instr);
+    rv_exc_t ex = rv_csrrw_instr(&cpu0, predecode(instr));
 
     PCUT_ASSERT_INT_EQUALS(rv_exc_none, ex);
 
@@ -108,7 +108,7 @@ PCUT_TEST(csr_set_masks)
 
     cpu0.csr.satp = 0;
 
-    rv_exc_t ex = rv_csrrs_instr(&cpu0, instr);
+    rv_exc_t ex = rv_csrrs_instr(&cpu0, predecode(instr));
 
     PCUT_ASSERT_INT_EQUALS(rv_exc_none, ex);
 
@@ -134,7 +134,7 @@ static uxlen_t probe_asid_len()
     cpu0.regs[instr.i.rs1] = XLEN_UMAX;
     cpu0.regs[instr.i.rd] = 0;
 
-    rv_exc_t ex = rv_csrrs_instr(&cpu0, instr);
+    rv_exc_t ex = rv_csrrs_instr(&cpu0, predecode(instr));
     PCUT_ASSERT_INT_EQUALS(rv_exc_none, ex);
 
     // Read the content of SATP
@@ -142,7 +142,7 @@ static uxlen_t probe_asid_len()
     cpu0.regs[instr.i.rs1] = 0;
     cpu0.regs[instr.i.rd] = 0;
 
-    ex = rv_csrrs_instr(&cpu0, instr);
+    ex = rv_csrrs_instr(&cpu0, predecode(instr));
     PCUT_ASSERT_INT_EQUALS(rv_exc_none, ex);
 
     uxlen_t satp_content = cpu0.regs[instr.i.rd];
@@ -49,5 +49,13 @@
 #error "Unsupported architecture for tests"
 #endif
 
+/** Extract the operands of an instruction passed to its implementation */
+static inline const rv_decoded_t *predecode(rv_instr_t instr)
+{
+    static rv_decoded_t decoded;
+    decoded = rv_decode_operands(instr);
+    return &decoded;
+}
+
 #define _RVTEST_COMMON_H
 #endif // _RVTEST_COMMON_H
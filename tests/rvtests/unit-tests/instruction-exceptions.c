@@ -22,7 +22,7 @@ PCUT_TEST(add_no_ex)
                                  .funct7 = rv_func_ADD >> 3,
                          } };
 
-    rv_exc_t ex = rv_add_instr(&cpu1, instr);
+    rv_exc_t ex = rv_add_instr(&cpu1, predecode(instr));
 
     PCUT_ASSERT_INT_EQUALS(rv_exc_none, ex);
 }
@@ -33,7 +33,7 @@ PCUT_TEST(jal_address_misaligned)
                                  .opcode = rv_opcJAL,
                                  .imm10_1 = 1 } };
 
-    rv_exc_t ex = rv_jal_instr(&cpu1, instr);
+    rv_exc_t ex = rv_jal_instr(&cpu1, predecode(instr));
 
     PCUT_ASSERT_INT_EQUALS(rv_exc_instruction_address_misaligned, ex);
 }
@@ -44,7 +44,7 @@ PCUT_TEST(jalr_address_misaligned)
                                  .opcode = rv_opcJALR,
                                  .imm = 2 } };
 
-    rv_exc_t ex = rv_jalr_instr(&cpu1, instr);
+    rv_exc_t ex = rv_jalr_instr(&cpu1, predecode(instr));
 
     PCUT_ASSERT_INT_EQUALS(rv_exc_instruction_address_misaligned, ex);
 }
@@ -62,7 +62,7 @@ PCUT_TEST(beq_address_misaligned_taken)
     cpu1.regs[0] = 0;
     cpu1.regs[1] = 0;
 
-    rv_exc_t ex = rv_beq_instr(&cpu1, instr);
+    rv_exc_t ex = rv_beq_instr(&cpu1, predecode(instr));
     PCUT_ASSERT_INT_EQUALS(rv_exc_instruction_address_misaligned, ex);
 }
 
@@ -77,7 +77,7 @@ PCUT_TEST(beq_address_misaligned_not_taken)
     cpu1.regs[0] = 0;
     cpu1.regs[1] = 1;
 
-    rv_exc_t ex = rv_beq_instr(&cpu1, instr);
+    rv_exc_t ex = rv_beq_instr(&cpu1, predecode(instr));
     PCUT_ASSERT_INT_EQUALS(rv_exc_none, ex);
 }
 
@@ -88,7 +88,7 @@ PCUT_TEST(lh_address_misaligned)
                                  .funct3 = rv_func_LH,
                                  .imm = 1 } };
 
-    rv_exc_t ex = rv_lh_instr(&cpu1, instr);
+    rv_exc_t ex = rv_lh_instr(&cpu1, predecode(instr));
 
     PCUT_ASSERT_INT_EQUALS(rv_exc_load_address_misaligned, ex);
 }
@@ -102,7 +102,7 @@ PCUT_TEST(lw_address_misaligned)
                                  .funct3 = rv_func_LW,
                                  .imm = 2 } };
 
-    rv_exc_t ex = rv_lw_instr(&cpu1, instr);
+    rv_exc_t ex = rv_lw_instr(&cpu1, predecode(instr));
 
     PCUT_ASSERT_INT_EQUALS(rv_exc_load_address_misaligned, ex);
 }
@@ -114,7 +114,7 @@ PCUT_TEST(sh_address_misaligned)
                                  .funct3 = rv_func_SH,
                                  .imm4_0 = 1 } };
 
-    rv_exc_t ex = rv_sh_instr(&cpu1, instr);
+    rv_exc_t ex = rv_sh_instr(&cpu1, predecode(instr));
 
     PCUT_ASSERT_INT_EQUALS(rv_exc_store_amo_address_misaligned, ex);
 }
@@ -126,7 +126,7 @@ PCUT_TEST(sw_address_misaligned)
                                  .funct3 = rv_func_SW,
                                  .imm4_0 = 2 } };
 
-    rv_exc_t ex = rv_sw_instr(&cpu1, instr);
+    rv_exc_t ex = rv_sw_instr(&cpu1, predecode(instr));
 
     PCUT_ASSERT_INT_EQUALS(rv_exc_store_amo_address_misaligned, ex);
 }
@@ -139,7 +139,7 @@ PCUT_TEST(syscall_umode)
                                  .imm = rv_privECALL } };
     cpu1.priv_mode = rv_umode;
 
-    rv_exc_t ex = rv_call_instr(&cpu1, instr);
+    rv_exc_t ex = rv_call_instr(&cpu1, predecode(instr));
     PCUT_ASSERT_INT_EQUALS(rv_exc_umode_environment_call, ex);
 }
 
@@ -151,7 +151,7 @@ PCUT_TEST(syscall_smode)
                                  .imm = rv_privECALL } };
     cpu1.priv_mode = rv_smode;
 
-    rv_exc_t ex = rv_call_instr(&cpu1, instr);
+    rv_exc_t ex = rv_call_instr(&cpu1, predecode(instr));
     PCUT_ASSERT_INT_EQUALS(rv_exc_smode_environment_call, ex);
 }
 
@@ -165,7 +165,7 @@ PCUT_TEST(syscall_mmode)
                                  .imm = rv_privECALL } };
     cpu1.priv_mode = rv_mmode;
 
-    rv_exc_t ex = rv_call_instr(&cpu1, instr);
+    rv_exc_t ex = rv_call_instr(&cpu1, predecode(instr));
     PCUT_ASSERT_INT_EQUALS(rv_exc_mmode_environment_call, ex);
 }
 
@@ -179,7 +179,7 @@ PCUT_TEST(sret_trapped)
     // TSR bit => sret traps
     cpu1.csr.mstatus |= 1 << 22;
 
-    rv_exc_t ex = rv_sret_instr(&cpu1, instr);
+    rv_exc_t ex = rv_sret_instr(&cpu1, predecode(instr));
 
     PCUT_ASSERT_INT_EQUALS(rv_exc_illegal_instruction, ex);
 }
@@ -194,7 +194,7 @@ PCUT_TEST(wfi_trapped_Smode)
     // TW => Trap wait for interrupt (in smode or umode)
     cpu1.csr.mstatus |= 1 << 21;
 
-    rv_exc_t ex = rv_wfi_instr(&cpu1, instr);
+    rv_exc_t ex = rv_wfi_instr(&cpu1, predecode(instr));
 
     PCUT_ASSERT_INT_EQUALS(rv_exc_illegal_instruction, ex);
 }
@@ -209,7 +209,7 @@ PCUT_TEST(wfi_trapped_Mmode)
     // TW => Trap wait for interrupt (in smode or umode)
     cpu1.csr.mstatus |= 1 << 21;
 
-    rv_exc_t ex = rv_wfi_instr(&cpu1, instr);
+    rv_exc_t ex = rv_wfi_instr(&cpu1, predecode(instr));
 
     PCUT_ASSERT_INT_EQUALS(rv_exc_none, ex);
 }
@@ -224,7 +224,7 @@ PCUT_TEST(wfi_illegal_Umode)
     // TW => Trap wait for interrupt (clear to 0 - does not trap for S or M mode)
     cpu1.csr.mstatus &= ~(1 << 21);
 
-    rv_exc_t ex = rv_wfi_instr(&cpu1, instr);
+    rv_exc_t ex = rv_wfi_instr(&cpu1, predecode(instr));
 
     PCUT_ASSERT_INT_EQUALS(rv_exc_illegal_instruction, ex);
 }
@@ -239,7 +239,7 @@ PCUT_TEST(sfence_vma_trapped)
     // TVM => Trap virtual memory (sfence.vma)
     cpu1.csr.mstatus |= 1 << 20;
 
-    rv_exc_t ex = rv_sfence_instr(&cpu1, instr);
+    rv_exc_t ex = rv_sfence_instr(&cpu1, predecode(instr));
 
     PCUT_ASSERT_INT_EQUALS(rv_exc_illegal_instruction, ex);
 }
@@ -255,7 +255,7 @@ PCUT_TEST(lr_address_missaligned)
 
     cpu1.regs[0] = 2;
 
-    rv_exc_t ex = rv_lr_instr(&cpu1, instr);
+    rv_exc_t ex = rv_lr_instr(&cpu1, predecode(instr));
     PCUT_ASSERT_INT_EQUALS(rv_exc_load_address_misaligned, ex);
 }
 
@@ -271,7 +271,7 @@ PCUT_TEST(sc_address_missaligned)
     cpu1.regs[0] = 2;
     cpu1.reserved_valid = true;
 
-    rv_exc_t ex = rv_sc_instr(&cpu1, instr);
+    rv_exc_t ex = rv_sc_instr(&cpu1, predecode(instr));
     PCUT_ASSERT_INT_EQUALS(rv_exc_store_amo_address_misaligned, ex);
 }
 
@@ -287,7 +287,7 @@ PCUT_TEST(amo_address_missaligned)
 
     cpu1.regs[0] = 2;
 
-    rv_exc_t ex = rv_amoswap_w_instr(&cpu1, instr);
+    rv_exc_t ex = rv_amoswap_w_instr(&cpu1, predecode(instr));
     PCUT_ASSERT_INT_EQUALS(rv_exc_store_amo_address_misaligned, ex);
 }
 
@@ -299,7 +299,7 @@ PCUT_TEST(csrrw_non_existent_csr)
                                  .imm = 0x6C0, // Custom hypervisor csr in standard,
                                  .rd = 1 } };
 
-    rv_exc_t ex = rv_csrrw_instr(&cpu1, instr);
+    rv_exc_t ex = rv_csrrw_instr(&cpu1, predecode(instr));
 
     PCUT_ASSERT_INT_EQUALS(rv_exc_illegal_instruction, ex);
 }
@@ -315,7 +315,7 @@ PCUT_TEST(csrrsi_wrong_privilege)
     cpu1.priv_mode = rv_smode;
 
     // modifying mmode register in smode
-    rv_exc_t ex = rv_csrrsi_instr(&cpu1, instr);
+    rv_exc_t ex = rv_csrrsi_instr(&cpu1, predecode(instr));
 
     PCUT_ASSERT_INT_EQUALS(rv_exc_illegal_instruction, ex);
 }
@@ -332,7 +332,7 @@ PCUT_TEST(csrrw_write_read_only_csr)
     cpu1.regs[instr.i.rd] = (uint32_t) -1;
     cpu1.priv_mode = rv_mmode;
 
-    rv_exc_t ex = rv_csrrw_instr(&cpu1, instr);
+    rv_exc_t ex = rv_csrrw_instr(&cpu1, predecode(instr));
 
     PCUT_ASSERT_INT_EQUALS(rv_exc_illegal_instruction, ex);
     // value in rd didn't change
@@ -349,7 +349,7 @@ PCUT_TEST(csrrsi_read_read_only_csr)
                                  .rd = 2 } };
     cpu1.priv_mode = rv_mmode;
 
-    rv_exc_t ex = rv_csrrsi_instr(&cpu1, instr);
+    rv_exc_t ex = rv_csrrsi_instr(&cpu1, predecode(instr));
 
     PCUT_ASSERT_INT_EQUALS(rv_exc_none, ex);
 }
@@ -365,7 +365,7 @@ PCUT_TEST(csrrw_WLRL_write_illegal)
     cpu1.regs[instr.i.rs1] = RV_EXCEPTION_EXC_BITS | 48; // Exception designated for custom use that is not used int msim
     cpu1.priv_mode = rv_mmode;
 
-    rv_exc_t ex = rv_csrrw_instr(&cpu1, instr);
+    rv_exc_t ex = rv_csrrw_instr(&cpu1, predecode(instr));
 
     PCUT_ASSERT_INT_EQUALS(rv_exc_illegal_instruction, ex);
 }
@@ -381,7 +381,7 @@ PCUT_TEST(csrrw_WARL_write_illegal)
     cpu1.regs[instr.i.rs1] = 2; // Illegal MODE
     cpu1.priv_mode = rv_mmode;
 
-    rv_exc_t ex = rv_csrrw_instr(&cpu1, instr);
+    rv_exc_t ex = rv_csrrw_instr(&cpu1, predecode(instr));
 
     // No Exception
     PCUT_ASSERT_INT_EQUALS(rv_exc_none, ex);
@@ -403,7 +403,7 @@ PCUT_TEST(csrrsi_read_from_disabled_counter_Smode)
     cpu1.csr.mcounteren = 0;
     cpu1.priv_mode = rv_smode;
 
-    rv_exc_t ex = rv_csrrsi_instr(&cpu1, instr);
+    rv_exc_t ex = rv_csrrsi_instr(&cpu1, predecode(instr));
 
     PCUT_ASSERT_INT_EQUALS(rv_exc_illegal_instruction, ex);
 }
@@ -422,7 +422,7 @@ PCUT_TEST(csrrsi_read_from_disabled_counter_Mmode)
     cpu1.csr.mcounteren = 0;
     cpu1.priv_mode = rv_mmode;
 
-    rv_exc_t ex = rv_csrrsi_instr(&cpu1, instr);
+    rv_exc_t ex = rv_csrrsi_instr(&cpu1, predecode(instr));
 
     PCUT_ASSERT_INT_EQUALS(rv_exc_none, ex);
 }
@@ -442,7 +442,7 @@ PCUT_TEST(csrrsi_read_from_M_disabled_counter_Umode)
     cpu1.csr.scounteren = (uint32_t) -1;
     cpu1.priv_mode = rv_umode;
 
-    rv_exc_t ex = rv_csrrsi_instr(&cpu1, instr);
+    rv_exc_t ex = rv_csrrsi_instr(&cpu1, predecode(instr));
 
     PCUT_ASSERT_INT_EQUALS(rv_exc_illegal_instruction, ex);
 }
@@ -462,7 +462,7 @@ PCUT_TEST(csrrsi_read_from_S_disabled_counter_Umode)
     cpu1.csr.scounteren = 0;
     cpu1.priv_mode = rv_umode;
 
-    rv_exc_t ex = rv_csrrsi_instr(&cpu1, instr);
+    rv_exc_t ex = rv_csrrsi_instr(&cpu1, predecode(instr));
 
     PCUT_ASSERT_INT_EQUALS(rv_exc_illegal_instruction, ex);
 }
@@ -482,7 +482,7 @@ PCUT_TEST(csrrsi_read_from_enabled_counter_Umode)
     cpu1.csr.scounteren = (uint32_t) -1;
     cpu1.priv_mode = rv_umode;
 
-    rv_exc_t ex = rv_csrrsi_instr(&cpu1, instr);
+    rv_exc_t ex = rv_csrrsi_instr(&cpu1, predecode(instr));
 
     PCUT_ASSERT_INT_EQUALS(rv_exc_none, ex);
 }
@@ -502,7 +502,7 @@ PCUT_TEST(csrrsi_read_from_M_enabled_S_disabled_counter_Smode)
     cpu1.csr.scounteren = 0;
     cpu1.priv_mode = rv_smode;
 
-    rv_exc_t ex = rv_csrrsi_instr(&cpu1, instr);
+    rv_exc_t ex = rv_csrrsi_instr(&cpu1, predecode(instr));
 
     PCUT_ASSERT_INT_EQUALS(rv_exc_none, ex);
 }
@@ -520,7 +520,7 @@ PCUT_TEST(csrrw_satp_vm_trapped)
     // TVM => Trap virtual memory (any satp interaction)
     cpu1.csr.mstatus |= 1 << 20;
 
-    rv_exc_t ex = rv_csrrw_instr(&cpu1, instr);
+    rv_exc_t ex = rv_csrrw_instr(&cpu1, predecode(instr));
 
     PCUT_ASSERT_INT_EQUALS(rv_exc_illegal_instruction, ex);
 }
@@ -541,7 +541,7 @@ PCUT_TEST(csrrw_WPRI_field_ignores_writes)
     // We expect these fields to be set to 1 and the rest to stay at 0
     uint64_t expected_mstatus = rv_csr_mstatus_mask;
 
-    rv_exc_t ex = rv_csrrw_instr(&cpu1, instr);
+    rv_exc_t ex = rv_csrrw_instr(&cpu1, predecode(instr));
 
     // No exception should occur
     PCUT_ASSERT_INT_EQUALS(rv_exc_none, ex);
@@ -564,7 +564,7 @@ PCUT_TEST(csrrs_WPRI_field_ignores_writes)
     // We expect these fields to be set to 1 and the rest to stay at 0
     uint64_t expected_mstatus = rv_csr_mstatus_mask;
 
-    rv_exc_t ex = rv_csrrs_instr(&cpu1, instr);
+    rv_exc_t ex = rv_csrrs_instr(&cpu1, predecode(instr));
 
     // No exception should occur
     PCUT_ASSERT_INT_EQUALS(rv_exc_none, ex);
@@ -589,7 +589,7 @@ PCUT_TEST(csrrc_WPRI_field_ignores_writes)
 
     // This is an illegal value only used for this test
     cpu1.csr.mstatus = 0xFFFFFFFF;
-    rv_exc_t ex = rv_csrrc_instr(&cpu1, instr);
+    rv_exc_t ex = rv_csrrc_instr(&cpu1, predecode(instr));
 
     // No exception should occur
     PCUT_ASSERT_INT_EQUALS(rv_exc_none, ex);
@@ -393,4 +393,61 @@ PCUT_TEST(flush_by_asid_and_addr_ignores_global)
     PCUT_ASSERT_EQUALS(true, success);
 }
 
+PCUT_TEST(replace_least_recently_used)
+{
+    ptr36_t phys = 0x0;
+    unsigned asid = 1;
+
+    sv32_pte_t added_pte = { 0 };
+    added_pte.ppn = phys >> 12;
+
+    // A single set of 4 entries
+    rv32_tlb_resize(&tlb, 4);
+
+    for (uint32_t virt = 0x0; virt < 0x4000; virt += 0x1000) {
+        rv32_tlb_add_mapping(&tlb, asid, virt, added_pte, false, false);
+    }
+
+    sv32_pte_t pte;
+    bool megapage;
+
+    rv32_tlb_get_mapping(&tlb, asid, 0x0, &pte, &megapage, true);
+    rv32_tlb_add_mapping(&tlb, asid, 0x4000, added_pte, false, false);
+
+    bool success1 = rv32_tlb_get_mapping(&tlb, asid, 0x0, &pte, &megapage, true);
+    bool success2 = rv32_tlb_get_mapping(&tlb, asid, 0x1000, &pte, &megapage, true);
+    bool success3 = rv32_tlb_get_mapping(&tlb, asid, 0x4000, &pte, &megapage, true);
+
+    PCUT_ASSERT_EQUALS(true, success1);
+    PCUT_ASSERT_EQUALS(false, success2);
+    PCUT_ASSERT_EQUALS(true, success3);
+}
+
+PCUT_TEST(resize_flushes)
+{
+    uint32_t virt = 0x0;
+    ptr36_t phys = 0x0;
+    unsigned asid = 1;
+
+    sv32_pte_t added_pte = { 0 };
+    added_pte.ppn = phys >> 12;
+
+    rv32_tlb_add_mapping(&tlb, asid, virt, added_pte, false, false);
+
+    rv32_tlb_resize(&tlb, 7);
+
+    sv32_pte_t pte;
+    bool megapage;
+
+    bool success = rv32_tlb_get_mapping(&tlb, asid, virt, &pte, &megapage, true);
+
+    PCUT_ASSERT_EQUALS(false, success);
+
+    rv32_tlb_add_mapping(&tlb, asid, virt, added_pte, false, false);
+
+    success = rv32_tlb_get_mapping(&tlb, asid, virt, &pte, &megapage, true);
+
+    PCUT_ASSERT_EQUALS(true, success);
+}
+
 PCUT_EXPORT(tlb);
@@ -0,0 +1,6 @@
+#!/bin/bash
+sh-unknown-elf-gcc -m2e -fno-pic -fno-builtin -ffreestanding -nostdlib -nostdinc -c -o main.raw main.S
+sh-unknown-elf-objcopy -O binary main.raw main.bin
+
+sh-unknown-elf-gcc -m2e -fno-pic -fno-builtin -ffreestanding -nostdlib -nostdinc -c -o handler-cmt0.raw handler-cmt0.S
+sh-unknown-elf-objcopy -O binary handler-cmt0.raw handler-cmt0.bin
@@ -97,6 +97,7 @@ TESTS = [
     "cmt/interrupt_8_32",
     "cmt/interrupt_8_128",
     "cmt/interrupt_8_512",
+    "cmt/interrupt_priority_raise",
     "data_transfer/mov",
     "data_transfer/mov_b_load",
     "data_transfer/mov_b_load_0",
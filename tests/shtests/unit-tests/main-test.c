@@ -23,6 +23,7 @@ dap_state_t dap_state = DAP_READY;
 
 /** General simulator behaviour */
 bool machine_nondet = false;
+bool machine_parallel = false;
 
 // set to true for debugging
 bool machine_trace = false;
@@ -35,6 +36,12 @@ bool machine_specific_instructions = true;
 bool machine_allow_interactive_without_tty = false;
 bool machine_unit_testing = true;
 uint64_t stepping = 0;
+unsigned int machine_quantum = DEFAULT_MACHINE_QUANTUM;
+bool machine_idle_skip = true;
+unsigned int machine_decode_cache_limit = DEFAULT_DECODE_CACHE_LIMIT;
+bool machine_jit = false;
+unsigned int machine_time_frequency = 0;
+uint64_t machine_cycles = 0;
 
 PCUT_INIT
 
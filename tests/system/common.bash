@@ -83,6 +83,10 @@ msim_run_code() {
 
     echo "quit" >>"$MSIM_TEST_TMPDIR/msim.conf"
     (
+        # Extra configuration (e.g. variables) precedes the test one
+        if [ -n "${prelude:-}" ]; then
+            echo "$prelude"
+        fi
         sed "s#\"boot.bin\"#\"$test_dir/boot.bin\"#" <"$test_dir/msim.conf"
         if grep -q printer "$test_dir/msim.conf"; then
             echo "printer redir \"$MSIM_TEST_TMPDIR/printer.output\""
@@ -95,7 +99,14 @@ msim_run_code() {
         sed 's:.*:#  | &:' "$MSIM_TEST_TMPDIR/msim.conf"
     } >&2
 
-    run bash -c "cd '$MSIM_TEST_TMPDIR' && '$MSIM' "$@" </dev/null"
+    # Commands for the interactive mode are read from the input file
+    local input="/dev/null"
+    if [ -f "$test_dir/input" ]; then
+        input="$test_dir/input"
+    fi
+
+    # The arguments are passed to the inner shell one by one
+    run bash -c "cd '$MSIM_TEST_TMPDIR' && '$MSIM' \"\$@\" <'$input'" msim "$@"
     {
         echo
         echo "# MSIM output (stdout and stderr interleaved)"
@@ -6,6 +6,10 @@ load "common"
     msim_run_code "mips32-hello"
 }
 
+@test "MIPS32: Cycle counter read in a loop" {
+    msim_run_code "mips32-dcycle"
+}
+
 @test "MIPS32: dnomem device in warn mode" {
     msim_run_code "mips32-dnomem-warn"
 }
@@ -26,6 +30,14 @@ load "common"
     msim_run_code "mips32-xint"
 }
 
+@test "MIPS32: Memory breakpoint" {
+    msim_run_code "mips32-mbreak"
+}
+
+@test "MIPS32: Self-modifying code" {
+    msim_run_code "mips32-smc" -I
+}
+
 @test "MIPS32: Register dumps" {
     msim_run_code "mips32-rd"
 }
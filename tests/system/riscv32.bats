@@ -9,3 +9,31 @@ load "common"
 @test "RISC-V32: Simple with trace" {
     expected=host-trace.expected msim_run_code "riscv32-simple" -t
 }
+
+@test "RISC-V32: Cycle counter read in a loop" {
+    msim_run_code "riscv32-dcycle"
+}
+
+@test "RISC-V32: Virtual time read in a loop" {
+    msim_run_code "riscv32-vtime" -T 1
+}
+
+@test "RISC-V32: Self-modifying code" {
+    msim_run_code "riscv32-smc"
+}
+
+@test "RISC-V32: Hot loops" {
+    msim_run_code "riscv32-hotloop"
+}
+
+@test "RISC-V32: Simple with binary translation" {
+    prelude="set jit = on" msim_run_code "riscv32-simple"
+}
+
+@test "RISC-V32: Cycle counter read in a loop with binary translation" {
+    prelude="set jit = on" msim_run_code "riscv32-dcycle"
+}
+
+@test "RISC-V32: Hot loops with binary translation" {
+    prelude="set jit = on" msim_run_code "riscv32-hotloop"
+}